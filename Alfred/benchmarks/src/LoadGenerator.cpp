@@ -0,0 +1,297 @@
+/**
+ * @file LoadGenerator.cpp
+ *
+ * This module holds the main() function of the load generator, which drives
+ * a store holding synthetic data with many writers, readers and subscribers
+ * at once, and reports throughput and how long changes take to reach
+ * subscribers.
+ */
+
+#include "Statistics.hpp"
+#include "SyntheticStore.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <Json/Value.hpp>
+#include <memory>
+#include <Metrics.hpp>
+#include <mutex>
+#include <random>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <Store.hpp>
+#include <string>
+#include <SystemAbstractions/File.hpp>
+#include <thread>
+#include <TimeKeeper.hpp>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+    /**
+     * This holds the settings of the load generator, given on the
+     * command line.
+     */
+    struct Settings {
+        /**
+         * This describes the shape of the synthetic data in the store.
+         */
+        SyntheticStore::Shape shape;
+
+        /**
+         * This is the number of threads changing the store.
+         */
+        size_t writers = 4;
+
+        /**
+         * This is the number of threads reading the store.
+         */
+        size_t readers = 4;
+
+        /**
+         * This is the number of subscribers to the whole of the
+         * synthetic data.
+         */
+        size_t subscribers = 100;
+
+        /**
+         * This is how long, in seconds, to run.
+         */
+        double duration = 10.0;
+    };
+
+    /**
+     * Return the current time, in seconds, on a clock which never goes
+     * backwards.
+     *
+     * @return
+     *     The current time is returned.
+     */
+    double GetCurrentTime() {
+        return std::chrono::duration< double >(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    /**
+     * Make a mutation which sets the value at the given path.
+     *
+     * @param[in] path
+     *     This is the sequence of keys identifying where to set the value.
+     *
+     * @param[in] value
+     *     This is the value to set.
+     *
+     * @return
+     *     The mutation is returned.
+     */
+    Store::Mutation MakeSet(
+        const std::vector< std::string >& path,
+        const Json::Value& value
+    ) {
+        Store::Mutation mutation;
+        mutation.type = Store::Mutation::Type::Set;
+        mutation.path = path;
+        mutation.value = value;
+        return mutation;
+    }
+
+    /**
+     * Take the settings of the load generator from the command line.
+     *
+     * @param[in] argc
+     *     This is the number of command-line arguments given to the program.
+     *
+     * @param[in] argv
+     *     This is the array of command-line arguments given to the program.
+     *
+     * @param[out] settings
+     *     This is where to store the settings.
+     *
+     * @return
+     *     An indication of whether or not the settings were understood
+     *     is returned.
+     */
+    bool ParseArguments(
+        int argc,
+        char* argv[],
+        Settings& settings
+    ) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string argument(argv[i]);
+            if (SyntheticStore::ParseShapeArgument(argument, settings.shape)) {
+                continue;
+            }
+            if (argument.substr(0, 10) == "--writers=") {
+                settings.writers = (size_t)strtoul(argument.c_str() + 10, nullptr, 10);
+            } else if (argument.substr(0, 10) == "--readers=") {
+                settings.readers = (size_t)strtoul(argument.c_str() + 10, nullptr, 10);
+            } else if (argument.substr(0, 14) == "--subscribers=") {
+                settings.subscribers = (size_t)strtoul(argument.c_str() + 14, nullptr, 10);
+            } else if (argument.substr(0, 11) == "--duration=") {
+                settings.duration = strtod(argument.c_str() + 11, nullptr);
+            } else {
+                fprintf(
+                    stderr,
+                    (
+                        "usage: AlfredLoadGenerator [--depth=N] [--width=N] [--meta=F]"
+                        " [--seed=N] [--writers=N] [--readers=N] [--subscribers=N]"
+                        " [--duration=S]\n"
+                    )
+                );
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+    Settings settings;
+    if (!ParseArguments(argc, argv, settings)) {
+        return EXIT_FAILURE;
+    }
+    const auto filePath = SystemAbstractions::File::GetExeParentDirectory() + "/LoadGenerator.json";
+    Store store;
+    if (
+        !SyntheticStore::Mobilize(
+            store,
+            filePath,
+            settings.shape,
+            std::make_shared< TimeKeeper >(),
+            std::make_shared< Metrics >()
+        )
+    ) {
+        fprintf(stderr, "Unable to set up store in '%s'\n", filePath.c_str());
+        return EXIT_FAILURE;
+    }
+    const auto leafPaths = SyntheticStore::ListLeafPaths(settings.shape);
+    const std::vector< std::string > treePath{SyntheticStore::treeKey};
+    const std::vector< std::string > probePath{SyntheticStore::treeKey, SyntheticStore::probeKey};
+    const std::unordered_set< std::string > readerRoles{SyntheticStore::readerRole};
+
+    // Every update carries the time of the latest change it reflects, so
+    // each subscriber measures how long that change took to reach it.
+    Statistics latencies;
+    std::mutex latenciesMutex;
+    std::atomic< size_t > updatesDelivered{0};
+    std::vector< std::function< void() > > unsubscribers;
+    for (size_t i = 0; i < settings.subscribers; ++i) {
+        unsubscribers.push_back(
+            store.SubscribeToData(
+                treePath,
+                readerRoles,
+                [&](const Store::Update& update){
+                    const auto& data = update.view->GetData();
+                    if (
+                        (data.GetType() != Json::Value::Type::Object)
+                        || !data.Has(SyntheticStore::probeKey)
+                    ) {
+                        return;
+                    }
+                    const auto sendTime = (double)data[SyntheticStore::probeKey];
+                    if (sendTime == 0.0) {
+                        return;
+                    }
+                    const auto latency = GetCurrentTime() - sendTime;
+                    ++updatesDelivered;
+                    std::lock_guard< decltype(latenciesMutex) > lock(latenciesMutex);
+                    latencies.Add(latency);
+                },
+                (
+                    ((i % 2) == 0)
+                    ? Store::UpdateMode::Snapshot
+                    : Store::UpdateMode::MergePatch
+                )
+            )
+        );
+    }
+
+    // Run the writers and readers until time is up.
+    std::atomic< bool > stop{false};
+    std::atomic< size_t > writes{0};
+    std::atomic< size_t > reads{0};
+    std::vector< std::thread > threads;
+    for (size_t i = 0; i < settings.writers; ++i) {
+        threads.emplace_back(
+            [&, i]{
+                std::mt19937 generator((unsigned int)(settings.shape.seed + i));
+                std::uniform_int_distribution< size_t > leafDistribution(0, leafPaths.size() - 1);
+                int nextValue = 1;
+                while (!stop) {
+                    (void)store.ApplyMutations({
+                        MakeSet(leafPaths[leafDistribution(generator)], nextValue++),
+                        MakeSet(probePath, GetCurrentTime()),
+                    });
+                    ++writes;
+                }
+            }
+        );
+    }
+    for (size_t i = 0; i < settings.readers; ++i) {
+        threads.emplace_back(
+            [&]{
+                while (!stop) {
+                    (void)store.GetView(treePath, readerRoles)->GetDataEncoding();
+                    ++reads;
+                }
+            }
+        );
+    }
+    const auto startTime = GetCurrentTime();
+    std::this_thread::sleep_for(std::chrono::duration< double >(settings.duration));
+    stop = true;
+    const auto stopTime = GetCurrentTime();
+    const auto elapsed = stopTime - startTime;
+    const size_t writesDone = writes;
+    const size_t readsDone = reads;
+
+    // Changes are delivered by the threads making them, so any backlog
+    // of updates is delivered before the writers finish.
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    const auto drainTime = GetCurrentTime() - stopTime;
+    for (const auto& unsubscribe: unsubscribers) {
+        unsubscribe();
+    }
+    store.Demobilize();
+    SyntheticStore::RemoveFiles(filePath);
+    printf(
+        (
+            "Store: depth %zu, width %zu, metadata density %.2lf, %zu leaves\n"
+            "Load: %zu writers, %zu readers, %zu subscribers, %.1lf seconds\n"
+            "Writes: %.0lf per second\n"
+            "Reads: %.0lf per second\n"
+            "Updates delivered: %zu (backlog delivered in %.1lf seconds after stopping)\n"
+            "Latency: %s\n"
+        ),
+        settings.shape.depth,
+        settings.shape.width,
+        settings.shape.metaDensity,
+        leafPaths.size(),
+        settings.writers,
+        settings.readers,
+        settings.subscribers,
+        elapsed,
+        writesDone / elapsed,
+        readsDone / elapsed,
+        (size_t)updatesDelivered,
+        drainTime,
+        latencies.SummarizeDurations().c_str()
+    );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file Statistics.cpp
+ *
+ * This module contains the implementation of the Statistics class, which
+ * collects samples of some measurement (such as how long an operation
+ * took) and summarizes them.
+ */
+
+#include "Statistics.hpp"
+
+#include <algorithm>
+#include <stddef.h>
+#include <string>
+#include <StringExtensions/StringExtensions.hpp>
+#include <vector>
+
+void Statistics::Add(double sample) {
+    if (
+        !samples_.empty()
+        && (sample < samples_.back())
+    ) {
+        sorted_ = false;
+    }
+    samples_.push_back(sample);
+}
+
+size_t Statistics::GetCount() const {
+    return samples_.size();
+}
+
+double Statistics::GetPercentile(double fraction) {
+    if (samples_.empty()) {
+        return 0.0;
+    }
+    if (!sorted_) {
+        std::sort(samples_.begin(), samples_.end());
+        sorted_ = true;
+    }
+    auto index = (size_t)(fraction * samples_.size());
+    if (index >= samples_.size()) {
+        index = samples_.size() - 1;
+    }
+    return samples_[index];
+}
+
+std::string Statistics::SummarizeDurations() {
+    double total = 0.0;
+    for (const auto sample: samples_) {
+        total += sample;
+    }
+    const auto mean = (
+        samples_.empty()
+        ? 0.0
+        : total / samples_.size()
+    );
+    return StringExtensions::sprintf(
+        "%zu samples, mean %.1lf us, p50 %.1lf us, p90 %.1lf us, p99 %.1lf us, max %.1lf us",
+        samples_.size(),
+        mean * 1e6,
+        GetPercentile(0.50) * 1e6,
+        GetPercentile(0.90) * 1e6,
+        GetPercentile(0.99) * 1e6,
+        GetPercentile(1.0) * 1e6
+    );
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+/**
+ * @file Statistics.hpp
+ *
+ * This module declares the Statistics class, which collects samples of
+ * some measurement (such as how long an operation took) and summarizes
+ * them.
+ */
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * This collects samples of some measurement and summarizes them.
+ */
+class Statistics {
+    // Methods
+public:
+    /**
+     * Add a sample of the measurement.
+     *
+     * @param[in] sample
+     *     This is the value measured.
+     */
+    void Add(double sample);
+
+    /**
+     * Return the number of samples collected.
+     *
+     * @return
+     *     The number of samples collected is returned.
+     */
+    size_t GetCount() const;
+
+    /**
+     * Return the value below which the given fraction of the samples fall.
+     *
+     * @param[in] fraction
+     *     This is the fraction of the samples, from 0.0 to 1.0.
+     *
+     * @return
+     *     The value below which the given fraction of the samples fall
+     *     is returned, or zero if there are no samples.
+     */
+    double GetPercentile(double fraction);
+
+    /**
+     * Return a one-line summary of the samples, giving each value as a
+     * number of microseconds, on the assumption that the samples are
+     * durations in seconds.
+     *
+     * @return
+     *     The summary of the samples is returned.
+     */
+    std::string SummarizeDurations();
+
+    // Private properties
+private:
+    /**
+     * These are the samples collected.
+     */
+    std::vector< double > samples_;
+
+    /**
+     * This indicates whether or not the samples are in order.
+     */
+    bool sorted_ = true;
+};
@@ -0,0 +1,269 @@
+/**
+ * @file StoreBenchmarks.cpp
+ *
+ * This module holds the main() function of the benchmarks of the Store
+ * class, which time the common operations on a store holding synthetic
+ * data of a shape given on the command line.
+ */
+
+#include "Statistics.hpp"
+#include "SyntheticStore.hpp"
+
+#include <chrono>
+#include <functional>
+#include <Json/Value.hpp>
+#include <memory>
+#include <Metrics.hpp>
+#include <random>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <Store.hpp>
+#include <string>
+#include <StringExtensions/StringExtensions.hpp>
+#include <SystemAbstractions/File.hpp>
+#include <TimeKeeper.hpp>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+    /**
+     * This holds the settings of the benchmarks, given on the command line.
+     */
+    struct Settings {
+        /**
+         * This describes the shape of the synthetic data in the store.
+         */
+        SyntheticStore::Shape shape;
+
+        /**
+         * This is the number of times to run each benchmark.
+         */
+        size_t iterations = 1000;
+
+        /**
+         * This is the number of subscribers for the fan-out benchmark.
+         */
+        size_t subscribers = 100;
+    };
+
+    /**
+     * Time the given operation, run the given number of times,
+     * and report the results.
+     *
+     * @param[in] name
+     *     This is the name of the benchmark to report.
+     *
+     * @param[in] iterations
+     *     This is the number of times to run the operation.
+     *
+     * @param[in] operation
+     *     This is the operation to time.
+     */
+    void Run(
+        const char* name,
+        size_t iterations,
+        const std::function< void() >& operation
+    ) {
+        Statistics durations;
+        for (size_t i = 0; i < iterations; ++i) {
+            const auto startTime = std::chrono::steady_clock::now();
+            operation();
+            durations.Add(
+                std::chrono::duration< double >(std::chrono::steady_clock::now() - startTime).count()
+            );
+        }
+        printf("%s: %s\n", name, durations.SummarizeDurations().c_str());
+    }
+
+    /**
+     * Make a mutation which sets the value at the given path.
+     *
+     * @param[in] path
+     *     This is the sequence of keys identifying where to set the value.
+     *
+     * @param[in] value
+     *     This is the value to set.
+     *
+     * @return
+     *     The mutation is returned.
+     */
+    Store::Mutation MakeSet(
+        const std::vector< std::string >& path,
+        const Json::Value& value
+    ) {
+        Store::Mutation mutation;
+        mutation.type = Store::Mutation::Type::Set;
+        mutation.path = path;
+        mutation.value = value;
+        return mutation;
+    }
+
+    /**
+     * Take the settings of the benchmarks from the command line.
+     *
+     * @param[in] argc
+     *     This is the number of command-line arguments given to the program.
+     *
+     * @param[in] argv
+     *     This is the array of command-line arguments given to the program.
+     *
+     * @param[out] settings
+     *     This is where to store the settings.
+     *
+     * @return
+     *     An indication of whether or not the settings were understood
+     *     is returned.
+     */
+    bool ParseArguments(
+        int argc,
+        char* argv[],
+        Settings& settings
+    ) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string argument(argv[i]);
+            if (SyntheticStore::ParseShapeArgument(argument, settings.shape)) {
+                continue;
+            }
+            if (argument.substr(0, 13) == "--iterations=") {
+                settings.iterations = (size_t)strtoul(argument.c_str() + 13, nullptr, 10);
+            } else if (argument.substr(0, 14) == "--subscribers=") {
+                settings.subscribers = (size_t)strtoul(argument.c_str() + 14, nullptr, 10);
+            } else {
+                fprintf(
+                    stderr,
+                    (
+                        "usage: AlfredBenchmarks [--depth=N] [--width=N] [--meta=F]"
+                        " [--seed=N] [--iterations=N] [--subscribers=N]\n"
+                    )
+                );
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+    Settings settings;
+    if (!ParseArguments(argc, argv, settings)) {
+        return EXIT_FAILURE;
+    }
+    const auto filePath = SystemAbstractions::File::GetExeParentDirectory() + "/StoreBenchmarks.json";
+    Store store;
+    if (
+        !SyntheticStore::Mobilize(
+            store,
+            filePath,
+            settings.shape,
+            std::make_shared< TimeKeeper >(),
+            std::make_shared< Metrics >()
+        )
+    ) {
+        fprintf(stderr, "Unable to set up store in '%s'\n", filePath.c_str());
+        return EXIT_FAILURE;
+    }
+    const auto leafPaths = SyntheticStore::ListLeafPaths(settings.shape);
+    printf(
+        "Store: depth %zu, width %zu, metadata density %.2lf, %zu leaves\n",
+        settings.shape.depth,
+        settings.shape.width,
+        settings.shape.metaDensity,
+        leafPaths.size()
+    );
+    const std::vector< std::string > treePath{SyntheticStore::treeKey};
+    const std::unordered_set< std::string > readerRoles{SyntheticStore::readerRole};
+    std::mt19937 generator(settings.shape.seed);
+    std::uniform_int_distribution< size_t > leafDistribution(0, leafPaths.size() - 1);
+    int nextValue = 1;
+    const auto setRandomLeaf = [&]{
+        (void)store.ApplyMutations({MakeSet(leafPaths[leafDistribution(generator)], nextValue++)});
+    };
+    Run(
+        "GetData (unrestricted)",
+        settings.iterations,
+        [&]{ (void)store.GetData(treePath, {}); }
+    );
+    Run(
+        "GetData (filtered by role)",
+        settings.iterations,
+        [&]{ (void)store.GetData(treePath, readerRoles); }
+    );
+    Run(
+        "GetView and encoding (unchanged store)",
+        settings.iterations,
+        [&]{ (void)store.GetView(treePath, readerRoles)->GetDataEncoding(); }
+    );
+    Run(
+        "Set leaf",
+        settings.iterations,
+        setRandomLeaf
+    );
+    Run(
+        "Set leaf, then GetData of leaf (new snapshot)",
+        settings.iterations,
+        [&]{
+            const auto& path = leafPaths[leafDistribution(generator)];
+            (void)store.ApplyMutations({MakeSet(path, nextValue++)});
+            (void)store.GetData(path, readerRoles);
+        }
+    );
+    Run(
+        "Set leaf, then GetView and encoding (new snapshot)",
+        settings.iterations,
+        [&]{
+            setRandomLeaf();
+            (void)store.GetView(treePath, readerRoles)->GetDataEncoding();
+        }
+    );
+    std::vector< std::function< void() > > unsubscribers;
+    size_t updatesDelivered = 0;
+    for (size_t i = 0; i < settings.subscribers; ++i) {
+        unsubscribers.push_back(
+            store.SubscribeToData(
+                treePath,
+                readerRoles,
+                [&updatesDelivered](const Store::Update& update){
+                    (void)update.view->GetDataEncoding();
+                    ++updatesDelivered;
+                },
+                (
+                    ((i % 2) == 0)
+                    ? Store::UpdateMode::Snapshot
+                    : Store::UpdateMode::MergePatch
+                )
+            )
+        );
+    }
+    updatesDelivered = 0;
+    const auto fanOutName = StringExtensions::sprintf(
+        "Set leaf, delivered to %zu subscribers",
+        settings.subscribers
+    );
+    Run(
+        fanOutName.c_str(),
+        settings.iterations,
+        setRandomLeaf
+    );
+    printf(
+        "  (%zu updates delivered)\n",
+        updatesDelivered
+    );
+    for (const auto& unsubscribe: unsubscribers) {
+        unsubscribe();
+    }
+    store.Demobilize();
+    SyntheticStore::RemoveFiles(filePath);
+    return EXIT_SUCCESS;
+}
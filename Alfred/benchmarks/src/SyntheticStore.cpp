@@ -0,0 +1,187 @@
+/**
+ * @file SyntheticStore.cpp
+ *
+ * This module contains the implementation of functions used to fill a
+ * store with synthetic data of a given shape, for benchmarking.
+ */
+
+#include "SyntheticStore.hpp"
+
+#include <Json/Value.hpp>
+#include <memory>
+#include <Metrics.hpp>
+#include <random>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <Store.hpp>
+#include <string>
+#include <Timekeeping/Clock.hpp>
+#include <vector>
+
+namespace {
+
+    /**
+     * Make one level of synthetic data.
+     *
+     * @param[in] shape
+     *     This describes the shape of the data.
+     *
+     * @param[in] depth
+     *     This is the number of levels of objects still to make
+     *     above the leaves.
+     *
+     * @param[in,out] generator
+     *     This is used to choose which objects have metadata.
+     *
+     * @return
+     *     The data made is returned.
+     */
+    Json::Value MakeTree(
+        const SyntheticStore::Shape& shape,
+        size_t depth,
+        std::mt19937& generator
+    ) {
+        if (depth == 0) {
+            return 0;
+        }
+        auto tree = Json::Object({});
+        for (size_t i = 0; i < shape.width; ++i) {
+            tree["k" + std::to_string(i)] = MakeTree(shape, depth - 1, generator);
+        }
+        std::uniform_real_distribution< double > distribution(0.0, 1.0);
+        if (distribution(generator) < shape.metaDensity) {
+            return Json::Object({
+                {"data", std::move(tree)},
+                {"meta", Json::Object({
+                    {"allow", Json::Object({
+                        {"read_data", Json::Array({SyntheticStore::readerRole})},
+                    })},
+                })},
+            });
+        }
+        return tree;
+    }
+
+    /**
+     * Add the paths of all the leaves below the given one to the given list.
+     *
+     * @param[in] shape
+     *     This describes the shape of the data.
+     *
+     * @param[in] depth
+     *     This is the number of levels of objects below the given path
+     *     and above the leaves.
+     *
+     * @param[in,out] path
+     *     This is the path below which to list the leaves.
+     *
+     * @param[in,out] paths
+     *     This is where to add the paths of the leaves.
+     */
+    void ListLeafPaths(
+        const SyntheticStore::Shape& shape,
+        size_t depth,
+        std::vector< std::string >& path,
+        std::vector< std::vector< std::string > >& paths
+    ) {
+        if (depth == 0) {
+            paths.push_back(path);
+            return;
+        }
+        for (size_t i = 0; i < shape.width; ++i) {
+            path.push_back("k" + std::to_string(i));
+            ListLeafPaths(shape, depth - 1, path, paths);
+            path.pop_back();
+        }
+    }
+
+}
+
+namespace SyntheticStore {
+
+    bool ParseShapeArgument(
+        const std::string& argument,
+        Shape& shape
+    ) {
+        const auto delimiter = argument.find('=');
+        if (delimiter == std::string::npos) {
+            return false;
+        }
+        const auto name = argument.substr(0, delimiter);
+        const auto value = argument.substr(delimiter + 1);
+        if (name == "--depth") {
+            shape.depth = (size_t)strtoul(value.c_str(), nullptr, 10);
+            if (shape.depth == 0) {
+                return false;
+            }
+        } else if (name == "--width") {
+            shape.width = (size_t)strtoul(value.c_str(), nullptr, 10);
+            if (shape.width == 0) {
+                return false;
+            }
+        } else if (name == "--meta") {
+            shape.metaDensity = strtod(value.c_str(), nullptr);
+        } else if (name == "--seed") {
+            shape.seed = (unsigned int)strtoul(value.c_str(), nullptr, 10);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    std::vector< std::vector< std::string > > ListLeafPaths(const Shape& shape) {
+        std::vector< std::vector< std::string > > paths;
+        std::vector< std::string > path{treeKey};
+        ::ListLeafPaths(shape, shape.depth, path, paths);
+        return paths;
+    }
+
+    Json::Value MakeStoreContents(const Shape& shape) {
+        std::mt19937 generator(shape.seed);
+        auto tree = MakeTree(shape, shape.depth, generator);
+        if (tree.Has("meta")) {
+            tree["data"][probeKey] = 0;
+        } else {
+            tree[probeKey] = 0;
+        }
+        return Json::Object({
+            {treeKey, Json::Object({
+                {"data", std::move(tree)},
+                {"meta", Json::Object({
+                    {"allow", Json::Object({
+                        {"read_data", Json::Array({readerRole})},
+                    })},
+                })},
+            })},
+        });
+    }
+
+    bool Mobilize(
+        Store& store,
+        const std::string& filePath,
+        const Shape& shape,
+        const std::shared_ptr< Timekeeping::Clock >& clock,
+        const std::shared_ptr< Metrics >& metrics
+    ) {
+        RemoveFiles(filePath);
+        const auto encoding = MakeStoreContents(shape).ToEncoding();
+        const auto file = fopen(filePath.c_str(), "wb");
+        if (file == NULL) {
+            return false;
+        }
+        const auto amountWritten = fwrite(encoding.data(), 1, encoding.length(), file);
+        (void)fclose(file);
+        if (amountWritten != encoding.length()) {
+            return false;
+        }
+        return store.Mobilize(filePath, clock, metrics);
+    }
+
+    void RemoveFiles(const std::string& filePath) {
+        (void)remove(filePath.c_str());
+        (void)remove((filePath + ".journal").c_str());
+        (void)remove((filePath + ".journal.old").c_str());
+    }
+
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+/**
+ * @file SyntheticStore.hpp
+ *
+ * This module declares functions used to fill a store with synthetic data
+ * of a given shape, for benchmarking.
+ */
+
+#include <Json/Value.hpp>
+#include <memory>
+#include <Metrics.hpp>
+#include <stddef.h>
+#include <Store.hpp>
+#include <string>
+#include <Timekeeping/Clock.hpp>
+#include <vector>
+
+namespace SyntheticStore {
+
+    /**
+     * This is the role which synthetic data permits to read it.
+     */
+    constexpr const char* readerRole = "reader";
+
+    /**
+     * This is the top-level key under which the synthetic data is kept.
+     */
+    constexpr const char* treeKey = "tree";
+
+    /**
+     * This is the key, directly under the synthetic data, of a number
+     * which load generators set to the time of each change, so that
+     * subscribers can tell how long each change took to reach them.
+     */
+    constexpr const char* probeKey = "probe";
+
+    /**
+     * This describes the shape of the synthetic data.
+     */
+    struct Shape {
+        /**
+         * This is the number of levels of objects above the leaves.
+         * It must be at least one.
+         */
+        size_t depth = 4;
+
+        /**
+         * This is the number of keys in each object.
+         * It must be at least one.
+         */
+        size_t width = 8;
+
+        /**
+         * This is the fraction of objects which are wrapped
+         * with metadata.
+         */
+        double metaDensity = 0.1;
+
+        /**
+         * This is used to seed the choice of which objects
+         * have metadata.
+         */
+        unsigned int seed = 1;
+    };
+
+    /**
+     * Set the given property of the shape from a command-line argument
+     * of the form "--depth=4", "--width=8", "--meta=0.1" or "--seed=1".
+     *
+     * @param[in] argument
+     *     This is the command-line argument.
+     *
+     * @param[in,out] shape
+     *     This is the shape to change.
+     *
+     * @return
+     *     An indication of whether or not the argument described
+     *     the shape is returned.  The depth and width must be at least one.
+     */
+    bool ParseShapeArgument(
+        const std::string& argument,
+        Shape& shape
+    );
+
+    /**
+     * Return the paths of all the leaves of synthetic data of the
+     * given shape.
+     *
+     * @param[in] shape
+     *     This describes the shape of the data.
+     *
+     * @return
+     *     The paths of all the leaves are returned.
+     */
+    std::vector< std::vector< std::string > > ListLeafPaths(const Shape& shape);
+
+    /**
+     * Make the top-level object of a store holding synthetic data of
+     * the given shape.  Every leaf, and the probe, starts out as zero.
+     *
+     * @param[in] shape
+     *     This describes the shape of the data.
+     *
+     * @return
+     *     The top-level object of the store is returned.
+     */
+    Json::Value MakeStoreContents(const Shape& shape);
+
+    /**
+     * Write a store file holding synthetic data of the given shape,
+     * and mobilize the given store with it.
+     *
+     * @param[in,out] store
+     *     This is the store to mobilize.
+     *
+     * @param[in] filePath
+     *     This is the path of the store file to write.
+     *
+     * @param[in] shape
+     *     This describes the shape of the data.
+     *
+     * @param[in] clock
+     *     This is the clock to give the store.
+     *
+     * @param[in] metrics
+     *     This is where the store keeps its metrics.
+     *
+     * @return
+     *     An indication of whether or not the store was mobilized
+     *     is returned.
+     */
+    bool Mobilize(
+        Store& store,
+        const std::string& filePath,
+        const Shape& shape,
+        const std::shared_ptr< Timekeeping::Clock >& clock,
+        const std::shared_ptr< Metrics >& metrics
+    );
+
+    /**
+     * Remove the store file with the given path, along with its journal.
+     *
+     * @param[in] filePath
+     *     This is the path of the store file to remove.
+     */
+    void RemoveFiles(const std::string& filePath);
+
+}
@@ -0,0 +1,610 @@
+/**
+ * @file WsLoadGenerator.cpp
+ *
+ * This module holds the main() function of the WebSocket load generator,
+ * which connects many clients to a running instance of the service over
+ * WebSockets, authenticates them with an access key, subscribes them all
+ * to the same data, and reports how long changes to that data take to
+ * reach them.
+ */
+
+#include "Statistics.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <Http/Client.hpp>
+#include <HttpClientTransactions.hpp>
+#include <HttpNetworkTransport/HttpClientNetworkTransport.hpp>
+#include <Json/Value.hpp>
+#include <LoadFile.hpp>
+#include <memory>
+#include <Metrics.hpp>
+#include <mutex>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <StringExtensions/StringExtensions.hpp>
+#include <SystemAbstractions/DiagnosticsSender.hpp>
+#include <SystemAbstractions/File.hpp>
+#include <SystemAbstractions/NetworkConnection.hpp>
+#include <thread>
+#include <TimeKeeper.hpp>
+#include <TlsDecorator/TlsDecorator.hpp>
+#include <vector>
+#include <WebSockets/WebSocket.hpp>
+
+namespace {
+
+    /**
+     * This is how long, in seconds, to wait for every client to connect,
+     * authenticate, and receive the first update of its subscription.
+     */
+    constexpr double connectTimeout = 30.0;
+
+    /**
+     * This is how long, in seconds, to wait after the last change for
+     * the updates still on their way to reach the clients.
+     */
+    constexpr double drainTime = 1.0;
+
+    /**
+     * This holds the settings of the load generator, given on the
+     * command line.
+     */
+    struct Settings {
+        /**
+         * This is the URL of the WebSocket resource of the service.
+         */
+        std::string url = "wss://localhost/ws";
+
+        /**
+         * This is the access key with which every client authenticates.
+         * The service must grant its identifier ("key:" followed by the
+         * key) roles permitting the changes made and the data read.
+         */
+        std::string key;
+
+        /**
+         * This is the path of the data which every client subscribes to,
+         * and which is changed to measure how long the changes take to
+         * reach the clients.
+         */
+        std::vector< std::string > path{"LoadGenerator"};
+
+        /**
+         * This is the path of the file holding the certificates of the
+         * certificate authorities trusted to vouch for the service.
+         */
+        std::string caCertificatesPath = SystemAbstractions::File::GetExeParentDirectory() + "/cacerts.pem";
+
+        /**
+         * This is the number of clients subscribing to the data.
+         * The last one also makes the changes.
+         */
+        size_t clients = 100;
+
+        /**
+         * This is how long, in seconds, to wait between changes.
+         */
+        double interval = 0.1;
+
+        /**
+         * This is how long, in seconds, to keep making changes.
+         */
+        double duration = 10.0;
+    };
+
+    /**
+     * This holds what the load generator measures.
+     */
+    struct Results {
+        /**
+         * This is the time at which changes began to be made, or zero
+         * if they haven't started yet.  Updates carrying times earlier
+         * than this hold data left by an earlier run.
+         */
+        double changesStartTime = 0.0;
+
+        /**
+         * This is the number of clients which have received the first
+         * update of their subscription.
+         */
+        size_t clientsReady = 0;
+
+        /**
+         * This is the number of clients whose connections were refused
+         * or lost.
+         */
+        size_t clientsFailed = 0;
+
+        /**
+         * This is the number of changes acknowledged by the service.
+         */
+        size_t changesApplied = 0;
+
+        /**
+         * This is the number of errors reported by the service,
+         * including changes it refused.
+         */
+        size_t errors = 0;
+
+        /**
+         * This is the last error reported by the service.
+         */
+        std::string lastError;
+
+        /**
+         * These measure how long, in seconds, it took each client to
+         * connect, authenticate, and receive the first update of
+         * its subscription.
+         */
+        Statistics connectTimes;
+
+        /**
+         * These measure how long, in seconds, each change took to reach
+         * each client.
+         */
+        Statistics latencies;
+
+        /**
+         * This is notified whenever a client becomes ready or fails.
+         */
+        std::condition_variable clientsChanged;
+
+        /**
+         * This is used to synchronize access to the results.
+         */
+        std::mutex mutex;
+    };
+
+    /**
+     * This represents one client of the service.
+     */
+    struct Client {
+        std::shared_ptr< WebSockets::WebSocket > ws;
+
+        /**
+         * This is the time at which the client began connecting.
+         */
+        double connectStartTime = 0.0;
+
+        /**
+         * This indicates whether or not the client has received the first
+         * update of its subscription.
+         */
+        bool ready = false;
+
+        /**
+         * This indicates whether or not the client's connection was
+         * refused or lost.
+         */
+        bool failed = false;
+    };
+
+    /**
+     * Return the current time, in seconds, on a clock which never goes
+     * backwards.
+     *
+     * @return
+     *     The current time is returned.
+     */
+    double GetCurrentTime() {
+        return std::chrono::duration< double >(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    /**
+     * Take the settings of the load generator from the command line.
+     *
+     * @param[in] argc
+     *     This is the number of command-line arguments given to the program.
+     *
+     * @param[in] argv
+     *     This is the array of command-line arguments given to the program.
+     *
+     * @param[out] settings
+     *     This is where to store the settings.
+     *
+     * @return
+     *     An indication of whether or not the settings were understood
+     *     is returned.
+     */
+    bool ParseArguments(
+        int argc,
+        char* argv[],
+        Settings& settings
+    ) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string argument(argv[i]);
+            if (argument.substr(0, 6) == "--url=") {
+                settings.url = argument.substr(6);
+            } else if (argument.substr(0, 6) == "--key=") {
+                settings.key = argument.substr(6);
+            } else if (argument.substr(0, 7) == "--path=") {
+                settings.path = StringExtensions::Split(argument.substr(7), '/');
+            } else if (argument.substr(0, 10) == "--cacerts=") {
+                settings.caCertificatesPath = argument.substr(10);
+            } else if (argument.substr(0, 10) == "--clients=") {
+                settings.clients = (size_t)strtoul(argument.c_str() + 10, nullptr, 10);
+            } else if (argument.substr(0, 11) == "--interval=") {
+                settings.interval = strtod(argument.c_str() + 11, nullptr);
+            } else if (argument.substr(0, 11) == "--duration=") {
+                settings.duration = strtod(argument.c_str() + 11, nullptr);
+            } else {
+                settings.key.clear();
+                break;
+            }
+        }
+        if (
+            settings.key.empty()
+            || (settings.clients == 0)
+        ) {
+            fprintf(
+                stderr,
+                (
+                    "usage: AlfredWsLoadGenerator --key=KEY [--url=URL] [--path=A/B/C]"
+                    " [--cacerts=PATH] [--clients=N] [--interval=S] [--duration=S]\n"
+                )
+            );
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Make the client used to connect to the service, securing
+     * connections with TLS where the scheme calls for it.
+     *
+     * @param[in] caCertificates
+     *     These are the certificates of the certificate authorities
+     *     trusted to vouch for the service.
+     *
+     * @param[in] diagnosticsSender
+     *     This is used to publish diagnostic messages of the connections.
+     *
+     * @return
+     *     The client is returned.
+     */
+    std::shared_ptr< Http::Client > MakeHttpClient(
+        const std::string& caCertificates,
+        const SystemAbstractions::DiagnosticsSender& diagnosticsSender
+    ) {
+        const auto transport = std::make_shared< HttpNetworkTransport::HttpClientNetworkTransport >();
+        transport->SetConnectionFactory(
+            [caCertificates, &diagnosticsSender](
+                const std::string& scheme,
+                const std::string& serverName
+            ) -> std::shared_ptr< SystemAbstractions::INetworkConnection > {
+                const auto connection = std::make_shared< SystemAbstractions::NetworkConnection >();
+                (void)connection->SubscribeToDiagnostics(
+                    diagnosticsSender.Chain(),
+                    SystemAbstractions::DiagnosticsSender::Levels::WARNING
+                );
+                if (
+                    (scheme == "https")
+                    || (scheme == "wss")
+                ) {
+                    const auto tlsDecorator = std::make_shared< TlsDecorator::TlsDecorator >();
+                    (void)tlsDecorator->SubscribeToDiagnostics(
+                        diagnosticsSender.Chain(),
+                        SystemAbstractions::DiagnosticsSender::Levels::WARNING
+                    );
+                    tlsDecorator->ConfigureAsClient(connection, caCertificates, serverName);
+                    return tlsDecorator;
+                } else {
+                    return connection;
+                }
+            }
+        );
+        const auto httpClient = std::make_shared< Http::Client >();
+        Http::Client::MobilizationDependencies httpClientDeps;
+        httpClientDeps.timeKeeper = std::make_shared< TimeKeeper >();
+        httpClientDeps.transport = transport;
+        httpClient->Mobilize(httpClientDeps);
+        return httpClient;
+    }
+
+    /**
+     * Record that the given client's connection was refused or lost.
+     *
+     * @param[in,out] client
+     *     This is the client whose connection failed.
+     *
+     * @param[in,out] results
+     *     This is where to record the failure.
+     */
+    void OnClientFailed(
+        Client& client,
+        Results& results
+    ) {
+        std::lock_guard< decltype(results.mutex) > lock(results.mutex);
+        if (client.failed) {
+            return;
+        }
+        client.failed = true;
+        ++results.clientsFailed;
+        results.clientsChanged.notify_all();
+    }
+
+    /**
+     * Encode the given path in the form used in messages to the service.
+     *
+     * @param[in] path
+     *     This is the path to encode.
+     *
+     * @return
+     *     The encoded path is returned.
+     */
+    Json::Value EncodePath(const std::vector< std::string >& path) {
+        auto encodedPath = Json::Array({});
+        for (const auto& key: path) {
+            encodedPath.Add(key);
+        }
+        return encodedPath;
+    }
+
+    /**
+     * Handle one message received by the given client.
+     *
+     * @param[in,out] client
+     *     This is the client which received the message.
+     *
+     * @param[in] message
+     *     This is the message received.
+     *
+     * @param[in] settings
+     *     These are the settings of the load generator.
+     *
+     * @param[in,out] results
+     *     This is where to record what the message measured.
+     */
+    void OnMessage(
+        Client& client,
+        const Json::Value& message,
+        const Settings& settings,
+        Results& results
+    ) {
+        const std::string type = message["type"];
+        if (type == "Authenticated") {
+            client.ws->SendText(
+                Json::Object({
+                    {"type", "Subscribe"},
+                    {"id", ""},
+                    {"path", EncodePath(settings.path)},
+                }).ToEncoding()
+            );
+        } else if (type == "Applied") {
+            std::lock_guard< decltype(results.mutex) > lock(results.mutex);
+            ++results.changesApplied;
+        } else if (type == "Batch") {
+            for (const auto update: message["updates"]) {
+                OnMessage(client, update.value()["message"], settings, results);
+            }
+        } else if (type == "Data") {
+            const auto now = GetCurrentTime();
+            const auto& data = message["data"];
+            std::lock_guard< decltype(results.mutex) > lock(results.mutex);
+            if (!client.ready) {
+                client.ready = true;
+                ++results.clientsReady;
+                results.connectTimes.Add(now - client.connectStartTime);
+                results.clientsChanged.notify_all();
+            }
+            if (
+                (results.changesStartTime != 0.0)
+                && (data.GetType() == Json::Value::Type::FloatingPoint)
+                && ((double)data >= results.changesStartTime)
+            ) {
+                results.latencies.Add(now - (double)data);
+            }
+        } else if (type == "Error") {
+            std::lock_guard< decltype(results.mutex) > lock(results.mutex);
+            ++results.errors;
+            results.lastError = (std::string)message["message"];
+        }
+    }
+
+    /**
+     * Begin connecting the given client to the service.  Once connected,
+     * it authenticates, and once authenticated, it subscribes.
+     *
+     * @param[in,out] client
+     *     This is the client to connect.
+     *
+     * @param[in] settings
+     *     These are the settings of the load generator.
+     *
+     * @param[in,out] httpClientTransactions
+     *     This is used to make the request to open the WebSocket.
+     *
+     * @param[in,out] results
+     *     This is where to record what the client measures.
+     */
+    void Connect(
+        Client& client,
+        const Settings& settings,
+        HttpClientTransactions& httpClientTransactions,
+        Results& results
+    ) {
+        Http::Request request;
+        request.method = "GET";
+        (void)request.target.ParseFromString(settings.url);
+        client.ws = std::make_shared< WebSockets::WebSocket >();
+        client.ws->StartOpenAsClient(request);
+        client.connectStartTime = GetCurrentTime();
+        httpClientTransactions.Post(
+            request,
+            [&client, &results](Http::Response& response){
+                if (response.statusCode != 101) {
+                    OnClientFailed(client, results);
+                }
+            },
+            [&client, &settings, &results](
+                const Http::Response& response,
+                std::shared_ptr< Http::Connection > connection,
+                const std::string& trailer
+            ){
+                if (!client.ws->FinishOpenAsClient(connection, response)) {
+                    OnClientFailed(client, results);
+                    return;
+                }
+                WebSockets::WebSocket::Delegates delegates;
+                delegates.close = [&client, &results](
+                    unsigned int code,
+                    const std::string& reason
+                ){
+                    OnClientFailed(client, results);
+                };
+                delegates.text = [&client, &settings, &results](const std::string& data){
+                    OnMessage(client, Json::Value::FromEncoding(data), settings, results);
+                };
+                client.ws->SetDelegates(std::move(delegates));
+                client.ws->SendText(
+                    Json::Object({
+                        {"type", "Authenticate"},
+                        {"key", settings.key},
+                    }).ToEncoding()
+                );
+            }
+        );
+    }
+
+}
+
+/**
+ * This function is the entrypoint of the program.
+ *
+ * @param[in] argc
+ *     This is the number of command-line arguments given to the program.
+ *
+ * @param[in] argv
+ *     This is the array of command-line arguments given to the program.
+ */
+int main(int argc, char* argv[]) {
+    Settings settings;
+    if (!ParseArguments(argc, argv, settings)) {
+        return EXIT_FAILURE;
+    }
+    SystemAbstractions::DiagnosticsSender diagnosticsSender("AlfredWsLoadGenerator");
+    (void)diagnosticsSender.SubscribeToDiagnostics(
+        [](
+            std::string senderName,
+            size_t level,
+            std::string message
+        ){
+            fprintf(stderr, "%s: %s\n", senderName.c_str(), message.c_str());
+        },
+        SystemAbstractions::DiagnosticsSender::Levels::WARNING
+    );
+    std::string caCertificates;
+    if (
+        !LoadFile(
+            settings.caCertificatesPath,
+            "CA certificates",
+            diagnosticsSender,
+            caCertificates
+        )
+    ) {
+        return EXIT_FAILURE;
+    }
+    const auto httpClient = MakeHttpClient(caCertificates, diagnosticsSender);
+    HttpClientTransactions httpClientTransactions;
+    httpClientTransactions.Mobilize(httpClient, std::make_shared< Metrics >());
+
+    // Connect every client, and wait for them all to be subscribed.
+    Results results;
+    std::vector< Client > clients(settings.clients);
+    for (auto& client: clients) {
+        Connect(client, settings, httpClientTransactions, results);
+    }
+    {
+        std::unique_lock< decltype(results.mutex) > lock(results.mutex);
+        (void)results.clientsChanged.wait_for(
+            lock,
+            std::chrono::duration< double >(connectTimeout),
+            [&results, &clients]{
+                return (results.clientsReady + results.clientsFailed >= clients.size());
+            }
+        );
+        if (results.clientsReady < clients.size()) {
+            fprintf(
+                stderr,
+                "Only %zu of %zu clients ready (%zu failed)\n",
+                results.clientsReady,
+                clients.size(),
+                results.clientsFailed
+            );
+            if (!clients.back().ready) {
+                lock.unlock();
+                httpClientTransactions.Demobilize();
+                httpClient->Demobilize();
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    // Have the last client make changes carrying the time at which they're
+    // made, so that each client measures how long each change took to
+    // reach it.
+    auto& writer = clients.back();
+    double changesStartTime;
+    {
+        std::lock_guard< decltype(results.mutex) > lock(results.mutex);
+        changesStartTime = GetCurrentTime();
+        results.changesStartTime = changesStartTime;
+    }
+    size_t changesMade = 0;
+    const auto stopTime = changesStartTime + settings.duration;
+    for (auto now = changesStartTime; now < stopTime; now = GetCurrentTime()) {
+        writer.ws->SendText(
+            Json::Object({
+                {"type", "Set"},
+                {"id", (int)changesMade},
+                {"path", EncodePath(settings.path)},
+                {"value", now},
+            }).ToEncoding()
+        );
+        ++changesMade;
+        std::this_thread::sleep_for(std::chrono::duration< double >(settings.interval));
+    }
+    std::this_thread::sleep_for(std::chrono::duration< double >(drainTime));
+
+    // Report before closing the connections, so that closing them isn't
+    // counted as failure.
+    std::unique_lock< decltype(results.mutex) > lock(results.mutex);
+    printf(
+        (
+            "Service: %s, path /%s\n"
+            "Clients: %zu ready of %zu (%zu failed)\n"
+            "Connect, authenticate and first update: %s\n"
+            "Changes: %zu made, %zu applied, one every %.3lf seconds\n"
+            "Errors: %zu%s%s\n"
+            "Updates delivered: %zu\n"
+            "Latency: %s\n"
+        ),
+        settings.url.c_str(),
+        StringExtensions::Join(settings.path, "/").c_str(),
+        results.clientsReady,
+        clients.size(),
+        results.clientsFailed,
+        results.connectTimes.SummarizeDurations().c_str(),
+        changesMade,
+        results.changesApplied,
+        settings.interval,
+        results.errors,
+        (results.lastError.empty() ? "" : ", last: "),
+        results.lastError.c_str(),
+        results.latencies.GetCount(),
+        results.latencies.SummarizeDurations().c_str()
+    );
+    lock.unlock();
+    for (auto& client: clients) {
+        client.ws->Close();
+    }
+    httpClientTransactions.Demobilize();
+    httpClient->Demobilize();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,44 @@
+/**
+ * @file AccessKeys.cpp
+ *
+ * This module contains the implementation of functions used to keep the
+ * access keys granted roles under "Roles" in the store from leaving the
+ * node which holds them.
+ */
+
+#include "AccessKeys.hpp"
+
+#include <Hash/Sha2.hpp>
+#include <Hash/Templates.hpp>
+#include <Json/Value.hpp>
+#include <string>
+#include <string.h>
+
+namespace AccessKeys {
+
+    std::string HideIdentifier(const std::string& identifier) {
+        const auto keyPrefixLength = strlen(keyPrefix);
+        if (identifier.compare(0, keyPrefixLength, keyPrefix) != 0) {
+            return identifier;
+        }
+        return keyHashPrefix + Hash::StringToString< Hash::Sha256 >(identifier.substr(keyPrefixLength));
+    }
+
+    Json::Value HideRoles(const Json::Value& roles) {
+        if (roles.GetType() != Json::Value::Type::Object) {
+            return roles;
+        }
+        if (roles.Has("data")) {
+            // The roles are wrapped with metadata.
+            auto hidden = roles;
+            hidden["data"] = HideRoles(roles["data"]);
+            return hidden;
+        }
+        auto hidden = Json::Object({});
+        for (const auto rolesEntry: roles) {
+            hidden[HideIdentifier(rolesEntry.key())] = rolesEntry.value();
+        }
+        return hidden;
+    }
+
+}
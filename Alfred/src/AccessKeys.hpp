@@ -0,0 +1,57 @@
+#pragma once
+
+/**
+ * @file AccessKeys.hpp
+ *
+ * This module declares functions used to keep the access keys granted
+ * roles under "Roles" in the store from leaving the node which holds
+ * them.  Replicas are given a hash of each key instead, which is enough
+ * to check a key presented by a client, but not to present it.
+ */
+
+#include <Json/Value.hpp>
+#include <string>
+
+namespace AccessKeys {
+
+    /**
+     * This is the prefix of client identifiers which are access keys.
+     */
+    constexpr const char* keyPrefix = "key:";
+
+    /**
+     * This is the prefix of client identifiers which are hashes
+     * of access keys.
+     */
+    constexpr const char* keyHashPrefix = "keyhash:";
+
+    /**
+     * Return the given client identifier, with any access key in it
+     * replaced by its hash.
+     *
+     * @param[in] identifier
+     *     This is the client identifier to hide.
+     *
+     * @return
+     *     If the identifier is an access key ("key:" followed by the key),
+     *     the identifier of its hash ("keyhash:" followed by the SHA-256
+     *     digest of the key, in hexadecimal) is returned.  Otherwise, the
+     *     identifier is returned as is.
+     */
+    std::string HideIdentifier(const std::string& identifier);
+
+    /**
+     * Return a copy of the given roles granted to client identifiers, as
+     * found under "Roles" in the store, with every access key replaced
+     * by its hash.
+     *
+     * @param[in] roles
+     *     These are the roles granted to client identifiers, keyed by
+     *     identifier, along with any metadata.
+     *
+     * @return
+     *     The roles, with every access key hidden, are returned.
+     */
+    Json::Value HideRoles(const Json::Value& roles);
+
+}
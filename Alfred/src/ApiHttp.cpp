@@ -7,18 +7,68 @@
  */
 
 #include "ApiHttp.hpp"
+#include "HttpCaching.hpp"
 
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <Json/Value.hpp>
 #include <memory>
-
+#include <mutex>
+#include <string>
 #include <unordered_set>
+#include <vector>
 
 namespace {
 
+    /**
+     * This is the longest a long-poll request is held waiting for the data
+     * to change, before the client is told it hasn't.  It's kept shorter
+     * than the idle timeouts commonly used by proxies, and must be shorter
+     * than the inactivity timeout of the HTTP server.
+     */
+    constexpr auto longPollTimeout = std::chrono::seconds(20);
+
+    /**
+     * Return the tag which distinguishes this run of the service from any
+     * other, for the entity tags of views delivered.
+     *
+     * @return
+     *     The tag for this run of the service is returned.
+     */
+    const std::string& GetRunTag() {
+        static const std::string runTag = HttpCaching::MakeRunTag();
+        return runTag;
+    }
+
+    /**
+     * This holds the latest view of the data for which a long-poll
+     * request is waiting.
+     */
+    struct LongPoll {
+        std::shared_ptr< const Store::View > view;
+
+        /**
+         * This is notified whenever a newer view is delivered.
+         */
+        std::condition_variable viewDelivered;
+
+        /**
+         * This is used to synchronize access to the view.
+         */
+        std::mutex mutex;
+    };
+
+    /**
+     * This is the type of function which handles requests for one
+     * resource subspace.  It either returns the JSON value to encode as the
+     * body of the response, or an invalid value if it filled in the body
+     * of the response itself.
+     */
     using Handler = std::function<
         Json::Value(
             const std::shared_ptr< Store >& store,
+            const std::shared_ptr< Metrics >& metrics,
             const Http::Request& request,
             Http::Response& response
         )
@@ -51,6 +101,7 @@ namespace {
     #define DEFINE_HANDLER(handler) \
         Json::Value handler( \
             const std::shared_ptr< Store >& store, \
+            const std::shared_ptr< Metrics >& metrics, \
             const Http::Request& request, \
             Http::Response& response \
         ); \
@@ -63,6 +114,7 @@ namespace {
         ); \
         Json::Value handler( \
             const std::shared_ptr< Store >& store, \
+            const std::shared_ptr< Metrics >& metrics, \
             const Http::Request& request, \
             Http::Response& response \
         )
@@ -84,10 +136,76 @@ namespace {
     #define HANDLER_METHODS {"GET"}
     #define HANDLER_PATH {"data"}
     DEFINE_HANDLER(Test){
-        return store->GetData(
+        // Polling clients ask for the same few paths over and over, so
+        // serve them from the store's cached views, encoded once per
+        // revision of the store, and let them revalidate cheaply.
+        const auto view = store->GetView(
             request.target.GetPath(),
             {"public"}
         );
+        (void)HttpCaching::RespondWithView(request, *view, GetRunTag(), response);
+        return Json::Value(Json::Value::Type::Invalid);
+    }
+
+    #undef HANDLER_METHODS
+    #undef HANDLER_PATH
+    #define HANDLER_METHODS {"GET"}
+    #define HANDLER_PATH {"poll"}
+    DEFINE_HANDLER(Poll){
+        // Rather than have clients which can't use WebSockets poll for
+        // changes in a tight loop, hold the request of a client which
+        // already has the latest data until the data changes, and then
+        // answer it straight away, as a request for the data would be.
+        // The subscription is formed before the view is taken, so that no
+        // change made in between is missed.
+        const auto& path = request.target.GetPath();
+        const auto longPoll = std::make_shared< LongPoll >();
+        const auto unsubscribeFromStore = store->SubscribeToData(
+            path,
+            {"public"},
+            [longPoll](const Store::Update& update){
+                std::lock_guard< decltype(longPoll->mutex) > lock(longPoll->mutex);
+                longPoll->view = update.view;
+                longPoll->viewDelivered.notify_all();
+            }
+        );
+        const auto view = store->GetView(path, {"public"});
+        if (HttpCaching::RespondWithView(request, *view, GetRunTag(), response)) {
+            std::unique_lock< decltype(longPoll->mutex) > lock(longPoll->mutex);
+            const auto revision = view->GetRevision();
+            if (
+                longPoll->viewDelivered.wait_for(
+                    lock,
+                    longPollTimeout,
+                    [longPoll, revision]{
+                        return (
+                            (longPoll->view != nullptr)
+                            && (longPoll->view->GetRevision() > revision)
+                        );
+                    }
+                )
+            ) {
+                const auto newView = longPoll->view;
+                lock.unlock();
+                response = Http::Response();
+                response.statusCode = 200;
+                response.reasonPhrase = "OK";
+                (void)HttpCaching::RespondWithView(request, *newView, GetRunTag(), response);
+            }
+        }
+        unsubscribeFromStore();
+        return Json::Value(Json::Value::Type::Invalid);
+    }
+
+    #undef HANDLER_METHODS
+    #undef HANDLER_PATH
+    #define HANDLER_METHODS {"GET"}
+    #define HANDLER_PATH {"metrics"}
+    DEFINE_HANDLER(ReportMetrics){
+        response.headers.SetHeader("Content-Type", "text/plain; version=0.0.4");
+        response.headers.SetHeader("Cache-Control", "no-cache");
+        response.body = metrics->Render();
+        return Json::Value(Json::Value::Type::Invalid);
     }
 
     #undef DEFINE_HANDLER
@@ -99,9 +217,15 @@ namespace ApiHttp {
 
     void RegisterResources(
         const std::shared_ptr< Store >& store,
+        const std::shared_ptr< Metrics >& metrics,
         Http::Server& httpServer
     ) {
         std::weak_ptr< Store > storeWeak(store);
+        const auto requestTime = metrics->GetHistogram(
+            "alfred_http_request_seconds",
+            "Time taken to handle HTTP requests",
+            Metrics::MakeDurationBounds()
+        );
         for (
             auto handlerRegistration = handlerRegistrations;
             handlerRegistration != nullptr;
@@ -111,11 +235,12 @@ namespace ApiHttp {
             const auto methods = handlerRegistration->methods;
             (void)httpServer.RegisterResource(
                 handlerRegistration->resourceSubspacePath,
-                [storeWeak, handler, methods](
+                [storeWeak, metrics, requestTime, handler, methods](
                     const Http::Request& request,
                     std::shared_ptr< Http::Connection > connection,
                     const std::string& trailer
                 ){
+                    const auto startTime = std::chrono::steady_clock::now();
                     Http::Response response;
                     const auto store = storeWeak.lock();
                     if (store == nullptr) {
@@ -130,16 +255,28 @@ namespace ApiHttp {
                     } else {
                         response.statusCode = 200;
                         response.reasonPhrase = "OK";
-                        response.body = handler(store, request, response).ToEncoding();
+                        const auto body = handler(store, metrics, request, response);
+                        if (body.GetType() != Json::Value::Type::Invalid) {
+                            response.body = body.ToEncoding();
+                        }
                     }
-                    if (response.body.empty()) {
+                    if (response.statusCode == 304) {
+                        // A "304 Not Modified" response has no body, and
+                        // must not describe one.
+                    } else if (response.body.empty()) {
                         response.headers.SetHeader("Content-Length", "0");
-                    } else {
+                    } else if (!response.headers.HasHeader("Content-Type")) {
                         response.headers.SetHeader("Content-Type", "application/json");
                     }
-                    if (response.statusCode / 100 == 2) {
+                    if (
+                        (response.statusCode / 100 == 2)
+                        || (response.statusCode == 304)
+                    ) {
                         response.headers.SetHeader("Access-Control-Allow-Origin", "*");
                     }
+                    requestTime->Observe(
+                        std::chrono::duration< double >(std::chrono::steady_clock::now() - startTime).count()
+                    );
                     return response;
                 }
             );
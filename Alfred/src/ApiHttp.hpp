@@ -7,6 +7,7 @@
  * Interface (API) to the service via Hypertext Transfer Protocol (HTTP).
  */
 
+#include "Metrics.hpp"
 #include "Store.hpp"
 
 #include <Http/Server.hpp>
@@ -14,8 +15,22 @@
 
 namespace ApiHttp {
 
+    /**
+     * Register with the given HTTP server the resources
+     * which make up the HTTP API.
+     *
+     * @param[in] store
+     *     This is the store to serve.
+     *
+     * @param[in] metrics
+     *     This holds the metrics to publish, and those measuring the API.
+     *
+     * @param[in] httpServer
+     *     This is the server with which to register the resources.
+     */
     void RegisterResources(
         const std::shared_ptr< Store >& store,
+        const std::shared_ptr< Metrics >& metrics,
         Http::Server& httpServer
     );
 
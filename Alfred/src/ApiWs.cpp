@@ -5,9 +5,18 @@
  * Application Programming Interface (API) to the service via WebSockets (WS).
  */
 
+#include "AccessKeys.hpp"
 #include "ApiWs.hpp"
+#include "Cbor.hpp"
+#include "Diagnostics.hpp"
+#include "Metrics.hpp"
+#include "Replica.hpp"
+#include "TimerWheel.hpp"
+#include "TokenValidations.hpp"
+#include "UpdateQueue.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <functional>
 #include <Http/Server.hpp>
 #include <inttypes.h>
@@ -26,6 +35,252 @@
 
 namespace {
 
+    /**
+     * This is the WebSocket subprotocol clients ask for in order to
+     * exchange messages encoded in CBOR, in binary frames, rather than
+     * JSON text.
+     */
+    constexpr const char* cborSubprotocol = "alfred.cbor";
+
+    /**
+     * This is the resolution, in seconds, of the per-connection timeouts
+     * (waiting for authentication, and lingering after close).  They are
+     * kept in a timer wheel rather than given a scheduler job each,
+     * so that many connections cost no more to time than a few.
+     */
+    constexpr double connectionTimeoutResolution = 0.1;
+
+    /**
+     * This is the role a client must hold in order to replicate the store,
+     * and to make changes on behalf of its own clients.  It's meant only
+     * for other instances of the service, since they are trusted to say
+     * who their clients are.
+     */
+    constexpr const char* replicationRole = "replica";
+
+    /**
+     * Work out which roles are held by a client with the given
+     * identifiers.
+     *
+     * @param[in] identifiers
+     *     These are the identifiers of the client.
+     *
+     * @param[in] identifierRoles
+     *     These are the roles granted to each client identifier.
+     *
+     * @return
+     *     The roles held by the client are returned.
+     */
+    std::unordered_set< std::string > GetRolesHeld(
+        const std::unordered_set< std::string >& identifiers,
+        const Store::IdentifierRoles& identifierRoles
+    ) {
+        std::unordered_set< std::string > rolesHeld{"public"};
+        for (const auto& identifier: identifiers) {
+            const auto rolesEntry = identifierRoles.roles.find(identifier);
+            if (rolesEntry != identifierRoles.roles.end()) {
+                rolesHeld.insert(rolesEntry->second.begin(), rolesEntry->second.end());
+            }
+        }
+        return rolesHeld;
+    }
+
+    /**
+     * Encode the message sent to clients to deliver data they have
+     * subscribed to.  This is used to make the encoding once for each
+     * view of the store, shared by all clients receiving that view.
+     *
+     * @param[in] view
+     *     This is the view holding the data to deliver.
+     *
+     * @return
+     *     The encoding of the message is returned.
+     */
+    std::string EncodeDataMessage(const Store::View& view) {
+        // Splice in the encoding of the data, rather than building
+        // a copy of it inside the message.
+        return (
+            "{\"type\":\"Data\",\"revision\":"
+            + std::to_string(view.GetRevision())
+            + ",\"data\":"
+            + view.GetDataEncoding()
+            + "}"
+        );
+    }
+
+    /**
+     * Encode the message sent to clients to deliver a JSON Patch to data
+     * they have subscribed to.
+     *
+     * @param[in] view
+     *     This is the view holding the patch to deliver.
+     *
+     * @return
+     *     The encoding of the message is returned.
+     */
+    std::string EncodePatchMessage(const Store::View& view) {
+        return Json::Object({
+            {"type", "Patch"},
+            {"revision", view.GetRevision()},
+            {"patch", view.GetData()},
+        }).ToEncoding();
+    }
+
+    /**
+     * Encode the message sent to clients to deliver a JSON Merge Patch to
+     * data they have subscribed to.
+     *
+     * @param[in] view
+     *     This is the view holding the patch to deliver.
+     *
+     * @return
+     *     The encoding of the message is returned.
+     */
+    std::string EncodeMergePatchMessage(const Store::View& view) {
+        return Json::Object({
+            {"type", "MergePatch"},
+            {"revision", view.GetRevision()},
+            {"patch", view.GetData()},
+        }).ToEncoding();
+    }
+
+    /**
+     * Encode in CBOR a message sent to clients to deliver data, or a patch
+     * to data, they have subscribed to.  The data is encoded straight into
+     * the message, rather than copied into a message object first.
+     *
+     * @param[in] type
+     *     This is the type of the message.
+     *
+     * @param[in] key
+     *     This is the key of the message under which to put the data.
+     *
+     * @param[in] view
+     *     This is the view holding the data to deliver.
+     *
+     * @return
+     *     The encoding of the message is returned.
+     */
+    std::string EncodeCborUpdateMessage(
+        const std::string& type,
+        const std::string& key,
+        const Store::View& view
+    ) {
+        std::string message;
+        Cbor::AppendHead(Cbor::MajorType::Map, 3, message);
+        Cbor::AppendText("type", message);
+        Cbor::AppendText(type, message);
+        Cbor::AppendText("revision", message);
+        Cbor::AppendHead(Cbor::MajorType::UnsignedInteger, view.GetRevision(), message);
+        Cbor::AppendText(key, message);
+        Cbor::Append(view.GetData(), message);
+        return message;
+    }
+
+    std::string EncodeCborDataMessage(const Store::View& view) {
+        return EncodeCborUpdateMessage("Data", "data", view);
+    }
+
+    std::string EncodeCborPatchMessage(const Store::View& view) {
+        return EncodeCborUpdateMessage("Patch", "patch", view);
+    }
+
+    std::string EncodeCborMergePatchMessage(const Store::View& view) {
+        return EncodeCborUpdateMessage("MergePatch", "patch", view);
+    }
+
+    /**
+     * Return the encoding of the message to send to a client
+     * to deliver the given update.
+     *
+     * @param[in] update
+     *     This is the update to deliver.
+     *
+     * @param[in] mode
+     *     This is the form in which the client asked for updates.
+     *
+     * @param[in] cbor
+     *     This indicates whether the client exchanges messages
+     *     encoded in CBOR rather than JSON.
+     *
+     * @return
+     *     The encoding of the message, shared by all clients receiving
+     *     the same update in the same encoding, is returned.
+     */
+    std::shared_ptr< const std::string > EncodeUpdateMessage(
+        const Store::Update& update,
+        Store::UpdateMode mode,
+        bool cbor
+    ) {
+        if (!update.patch) {
+            if (cbor) {
+                return update.view->GetEncoding("DataMessage+cbor", EncodeCborDataMessage);
+            }
+            return update.view->GetEncoding("DataMessage", EncodeDataMessage);
+        } else if (mode == Store::UpdateMode::JsonPatch) {
+            if (cbor) {
+                return update.view->GetEncoding("PatchMessage+cbor", EncodeCborPatchMessage);
+            }
+            return update.view->GetEncoding("PatchMessage", EncodePatchMessage);
+        } else {
+            if (cbor) {
+                return update.view->GetEncoding("MergePatchMessage+cbor", EncodeCborMergePatchMessage);
+            }
+            return update.view->GetEncoding("MergePatchMessage", EncodeMergePatchMessage);
+        }
+    }
+
+    /**
+     * Decode one change to make to the store, as given in a "Set", "Add",
+     * or "Remove" message, or as one of the operations of a "Batch"
+     * message.
+     *
+     * @param[in] operation
+     *     This is the encoded change.
+     *
+     * @param[out] mutation
+     *     This is where to store the decoded change.
+     *
+     * @return
+     *     An indication of whether or not the change was decoded
+     *     is returned.
+     */
+    bool DecodeMutation(
+        const Json::Value& operation,
+        Store::Mutation& mutation
+    ) {
+        const std::string type = operation["type"];
+        if (type == "Set") {
+            mutation.type = Store::Mutation::Type::Set;
+        } else if (type == "Add") {
+            mutation.type = Store::Mutation::Type::Add;
+        } else if (type == "Remove") {
+            mutation.type = Store::Mutation::Type::Remove;
+        } else {
+            return false;
+        }
+        const auto& path = operation["path"];
+        if (path.GetType() != Json::Value::Type::Array) {
+            return false;
+        }
+        mutation.path.clear();
+        mutation.path.reserve(path.GetSize());
+        for (const auto pathElement: path) {
+            const auto& key = pathElement.value();
+            if (key.GetType() != Json::Value::Type::String) {
+                return false;
+            }
+            mutation.path.push_back(key);
+        }
+        if (mutation.type != Store::Mutation::Type::Remove) {
+            if (!operation.Has("value")) {
+                return false;
+            }
+            mutation.value = operation["value"];
+        }
+        return true;
+    }
+
     std::vector< std::string > Sorted(const std::unordered_set< std::string >& unsorted) {
         std::vector< std::string > sorted(
             unsorted.begin(),
@@ -35,6 +290,157 @@ namespace {
         return sorted;
     }
 
+    /**
+     * These are the metrics counting messages of one type
+     * sent or received.
+     */
+    struct MessageMetrics {
+        std::shared_ptr< Metrics::Counter > messages;
+        std::shared_ptr< Metrics::Counter > bytes;
+
+        void Count(size_t size) const {
+            messages->Add();
+            bytes->Add(size);
+        }
+    };
+
+    /**
+     * These are the metrics measuring the WebSocket API.
+     */
+    struct ApiWsMetrics {
+        // Properties
+
+        std::shared_ptr< Metrics::Histogram > authenticationTime;
+        std::shared_ptr< Metrics::Gauge > clients;
+
+        /**
+         * These count messages received, keyed by type.  Messages of
+         * any other type, or malformed ones, are counted under the
+         * empty type.
+         */
+        std::unordered_map< std::string, MessageMetrics > received;
+
+        /**
+         * These count messages sent, keyed by type.  Messages of any
+         * other type are counted under the empty type.
+         */
+        std::unordered_map< std::string, MessageMetrics > sent;
+
+        // Methods
+
+        static MessageMetrics MakeMessageMetrics(
+            Metrics& metrics,
+            const std::string& direction,
+            const std::string& type
+        ) {
+            const auto labels = "type=\"" + (type.empty() ? std::string("other") : type) + "\"";
+            MessageMetrics messageMetrics;
+            messageMetrics.messages = metrics.GetCounter(
+                "alfred_ws_messages_" + direction + "_total",
+                "WebSocket messages " + direction + ", by type",
+                labels
+            );
+            messageMetrics.bytes = metrics.GetCounter(
+                "alfred_ws_bytes_" + direction + "_total",
+                "Bytes of WebSocket messages " + direction + ", by type",
+                labels
+            );
+            return messageMetrics;
+        }
+
+        ApiWsMetrics(
+            Metrics& metrics,
+            const std::vector< std::string >& receivedTypes,
+            const std::vector< std::string >& sentTypes
+        )
+            : authenticationTime(
+                metrics.GetHistogram(
+                    "alfred_ws_authentication_seconds",
+                    "Time taken to validate the OAuth tokens of WebSocket clients",
+                    Metrics::MakeDurationBounds()
+                )
+            )
+            , clients(
+                metrics.GetGauge(
+                    "alfred_ws_clients",
+                    "Clients connected via WebSocket"
+                )
+            )
+        {
+            received[""] = MakeMessageMetrics(metrics, "received", "");
+            for (const auto& type: receivedTypes) {
+                received[type] = MakeMessageMetrics(metrics, "received", type);
+            }
+            sent[""] = MakeMessageMetrics(metrics, "sent", "");
+            for (const auto& type: sentTypes) {
+                sent[type] = MakeMessageMetrics(metrics, "sent", type);
+            }
+        }
+
+        void CountReceived(
+            const std::string& type,
+            size_t size
+        ) const {
+            auto receivedEntry = received.find(type);
+            if (receivedEntry == received.end()) {
+                receivedEntry = received.find("");
+            }
+            receivedEntry->second.Count(size);
+        }
+
+        void CountSent(
+            const std::string& type,
+            size_t size
+        ) const {
+            auto sentEntry = sent.find(type);
+            if (sentEntry == sent.end()) {
+                sentEntry = sent.find("");
+            }
+            sentEntry->second.Count(size);
+        }
+    };
+
+    /**
+     * These are the types of messages sent to clients.
+     */
+    const std::vector< std::string > sentMessageTypes{
+        "Applied",
+        "Authenticated",
+        "Batch",
+        "Data",
+        "Error",
+        "Forwarded",
+        "MergePatch",
+        "Patch",
+        "Replication",
+    };
+
+    /**
+     * Return the type of message sent to a client
+     * to deliver the given update.
+     *
+     * @param[in] update
+     *     This is the update to deliver.
+     *
+     * @param[in] mode
+     *     This is the form in which the client asked for updates.
+     *
+     * @return
+     *     The type of message sent to deliver the update is returned.
+     */
+    const char* GetUpdateMessageType(
+        const Store::Update& update,
+        Store::UpdateMode mode
+    ) {
+        if (!update.patch) {
+            return "Data";
+        } else if (mode == Store::UpdateMode::JsonPatch) {
+            return "Patch";
+        } else {
+            return "MergePatch";
+        }
+    }
+
     struct Client
         : public std::enable_shared_from_this< Client >
     {
@@ -57,29 +463,114 @@ namespace {
             std::unique_lock< decltype(mutex) >& lock \
         )
 
+        /**
+         * This represents one subscription the client has made
+         * to data in the store.
+         */
+        struct Subscription {
+            /**
+             * This distinguishes the subscription from any earlier one
+             * made with the same identifier, so that updates still pending
+             * for the earlier one can be dropped.
+             */
+            int number = 0;
+
+            std::vector< std::string > path;
+            std::unordered_set< std::string > roles;
+            Store::UpdateMode mode = Store::UpdateMode::Snapshot;
+            std::function< void() > unsubscribeFromStore;
+
+            /**
+             * This is the revision of the store from which the last update
+             * sent for the subscription was made.  Updates from earlier
+             * revisions are obsolete.
+             */
+            size_t revision = 0;
+
+            /**
+             * This indicates whether or not any update has been sent
+             * for the subscription yet.
+             */
+            bool sentAny = false;
+
+            /**
+             * This is the least amount of time, in seconds, to leave between
+             * sending updates for the subscription.
+             */
+            double minInterval = 0.0;
+        };
+
         // Properties
 
         bool authenticated = false;
         int authenticationTimeout = 0;
+
+        /**
+         * This indicates whether the client negotiated the CBOR subprotocol,
+         * so that messages sent to it are encoded in CBOR, in binary frames,
+         * rather than JSON text.
+         */
+        bool cbor = false;
+
         CloseDelegate closeDelegate;
         SystemAbstractions::DiagnosticsSender diagnosticsSender;
-        std::shared_ptr< HttpClientTransactions > httpClientTransactions;
         std::unordered_set< std::string > identifiers;
         static const std::unordered_map< std::string, MessageHandler > messageHandlers;
+        std::shared_ptr< const ApiWsMetrics > metrics;
         std::mutex mutex;
-        int nextHttpClientTransactionId = 1;
+        int nextSubscriptionNumber = 1;
+
+        /**
+         * This is the time for which the flush of the updates waiting
+         * to be sent is scheduled, if one is.
+         */
+        double flushTime = 0.0;
+
+        /**
+         * This is the token of the scheduler job which flushes the updates
+         * waiting to be sent, or zero if none is scheduled.
+         */
+        int flushToken = 0;
+
+        /**
+         * This holds the updates waiting to be sent to the client.
+         */
+        UpdateQueue pendingUpdates;
+
+        /**
+         * If the store is a replica of another, this is used to forward
+         * to the other the changes the client asks to make.
+         */
+        std::shared_ptr< Replica > replica;
+
+        /**
+         * This is used to synchronize access to the pending updates and the
+         * job which flushes them.  It's separate from the client's main
+         * mutex, because the store delivers updates while the main mutex
+         * may be held (for example, while the client is subscribing).
+         */
+        std::mutex pendingUpdatesMutex;
+
         std::unordered_set< std::string > roles;
         std::shared_ptr< Timekeeping::Scheduler > scheduler;
         std::shared_ptr< Store > store;
-        std::shared_ptr< std::vector< std::string > > subscriptionPath;
-        std::function< void() > unsubscribeFromStore;
+        std::unordered_map< std::string, Subscription > subscriptions;
+        std::shared_ptr< TimerWheel > timeouts;
+        std::shared_ptr< TokenValidations > tokenValidations;
+        std::function< void() > unsubscribeFromReplication;
         std::weak_ptr< WebSockets::WebSocket > wsWeak;
 
         // Lifecycle
 
         ~Client() {
-            if (unsubscribeFromStore != nullptr) {
-                unsubscribeFromStore();
+            for (const auto& subscriptionsEntry: subscriptions) {
+                subscriptionsEntry.second.unsubscribeFromStore();
+            }
+            if (unsubscribeFromReplication != nullptr) {
+                unsubscribeFromReplication();
+            }
+            if (flushToken != 0) {
+                scheduler->Cancel(flushToken);
             }
         }
         Client(const Client&) = delete;
@@ -92,41 +583,96 @@ namespace {
         Client(
             const std::string& peerId,
             const std::weak_ptr< WebSockets::WebSocket >& wsWeak,
-            const std::shared_ptr< HttpClientTransactions >& httpClientTransactions,
+            const std::shared_ptr< TokenValidations >& tokenValidations,
             const std::shared_ptr< Store >& store,
+            const std::shared_ptr< Replica >& replica,
             const std::shared_ptr< Timekeeping::Scheduler >& scheduler,
+            const std::shared_ptr< TimerWheel >& timeouts,
+            const std::shared_ptr< const ApiWsMetrics >& metrics,
             CloseDelegate closeDelegate
         )
             : closeDelegate(closeDelegate)
             , diagnosticsSender(peerId)
+            , metrics(metrics)
+            , replica(replica)
             , scheduler(scheduler)
-            , httpClientTransactions(httpClientTransactions)
             , store(store)
+            , timeouts(timeouts)
+            , tokenValidations(tokenValidations)
             , wsWeak(wsWeak)
         {
         }
 
         // Methods
 
+        /**
+         * Send the given message to the client, encoded in whichever
+         * way the client negotiated.
+         *
+         * @param[in] ws
+         *     This is the WebSocket connected to the client.
+         *
+         * @param[in] message
+         *     This is the message to send.
+         */
+        void Send(
+            const std::shared_ptr< WebSockets::WebSocket >& ws,
+            const Json::Value& message
+        ) {
+            SendEncoded(
+                ws,
+                message["type"],
+                cbor ? Cbor::Encode(message) : message.ToEncoding()
+            );
+        }
+
+        /**
+         * Send to the client a message already encoded
+         * in whichever way the client negotiated.
+         *
+         * @param[in] ws
+         *     This is the WebSocket connected to the client.
+         *
+         * @param[in] type
+         *     This is the type of the message.
+         *
+         * @param[in] message
+         *     This is the encoding of the message to send.
+         */
+        void SendEncoded(
+            const std::shared_ptr< WebSockets::WebSocket >& ws,
+            const std::string& type,
+            const std::string& message
+        ) {
+            metrics->CountSent(type, message.size());
+            if (cbor) {
+                ws->SendBinary(message);
+            } else {
+                ws->SendText(message);
+            }
+        }
+
         void AddRole(const std::string& role) {
             if (roles.insert(role).second) {
-                diagnosticsSender.SendDiagnosticInformationString(
+                Diagnostics::SendLazily(
+                    diagnosticsSender,
                     1,
-                    std::string("Role added: ") + role
+                    [&role]{ return "Role added: " + role; }
                 );
             }
         }
 
         void AddIdentifier(const std::string& identifier) {
             if (identifiers.insert(identifier).second) {
-                diagnosticsSender.SendDiagnosticInformationString(
+                Diagnostics::SendLazily(
+                    diagnosticsSender,
                     1,
-                    std::string("Identifier added: ") + identifier
+                    [&identifier]{ return "Identifier added: " + identifier; }
                 );
-                const auto roles = store->GetData({"Roles"}, {});
-                if (roles.Has(identifier)) {
-                    for (const auto rolesEntry: roles[identifier]) {
-                        const auto role = (std::string)rolesEntry.value();
+                const auto identifierRoles = store->GetIdentifierRoles();
+                const auto rolesEntry = identifierRoles->roles.find(identifier);
+                if (rolesEntry != identifierRoles->roles.end()) {
+                    for (const auto& role: rolesEntry->second) {
                         AddRole(role);
                     }
                 }
@@ -139,10 +685,14 @@ namespace {
                 return;
             }
             if (message.Has("key")) {
-                const auto identifier = std::string("key:") + (std::string)message["key"];
-                const auto roles = store->GetData({"Roles"}, {});
-                if (roles.Has(identifier)) {
+                // A replica holds only the hashes of access keys.
+                const auto identifier = std::string(AccessKeys::keyPrefix) + (std::string)message["key"];
+                const auto hiddenIdentifier = AccessKeys::HideIdentifier(identifier);
+                const auto identifierRoles = store->GetIdentifierRoles();
+                if (identifierRoles->roles.find(identifier) != identifierRoles->roles.end()) {
                     AddIdentifier(identifier);
+                } else if (identifierRoles->roles.find(hiddenIdentifier) != identifierRoles->roles.end()) {
+                    AddIdentifier(hiddenIdentifier);
                 } else {
                     ReportError("Invalid access key", lock, true);
                     return;
@@ -155,7 +705,6 @@ namespace {
                             "twitch:%" PRIdMAX,
                             twitchId
                         );
-                        const auto roles = self.store->GetData({"Roles"}, {});
                         self.AddIdentifier(identifier);
                         self.OnAuthenticated();
                     },
@@ -174,22 +723,69 @@ namespace {
 
         void OnAuthenticated() {
             AddRole("public");
-            diagnosticsSender.SendDiagnosticInformationFormatted(
+            Diagnostics::SendLazily(
+                diagnosticsSender,
                 2,
-                "Authenticated, identifiers: %s; roles: %s",
-                StringExtensions::Join(Sorted(identifiers), ", ").c_str(),
-                StringExtensions::Join(Sorted(roles), ", ").c_str()
+                [this]{
+                    return (
+                        "Authenticated, identifiers: "
+                        + StringExtensions::Join(Sorted(identifiers), ", ")
+                        + "; roles: "
+                        + StringExtensions::Join(Sorted(roles), ", ")
+                    );
+                }
             );
             authenticated = true;
             if (authenticationTimeout) {
-                scheduler->Cancel(authenticationTimeout);
+                timeouts->Cancel(authenticationTimeout);
                 authenticationTimeout = 0;
             }
             const auto ws = wsWeak.lock();
             if (ws != nullptr) {
-                ws->SendText(Json::Object({
+                Send(ws, Json::Object({
                     {"type", "Authenticated"},
-                }).ToEncoding());
+                }));
+            }
+        }
+
+        /**
+         * Work out again which roles the client holds, from its identifiers,
+         * now that the roles in the store have changed.  If they're not the
+         * same as before, the client's subscriptions are formed again with
+         * the new roles, so that it's sent fresh snapshots of what it may
+         * now see, without having to reconnect.
+         */
+        void RefreshRoles() {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            if (!authenticated) {
+                return;
+            }
+            auto newRoles = GetRolesHeld(identifiers, *store->GetIdentifierRoles());
+            if (newRoles == roles) {
+                return;
+            }
+            roles = std::move(newRoles);
+            Diagnostics::SendLazily(
+                diagnosticsSender,
+                2,
+                [this]{
+                    return (
+                        "Roles changed: "
+                        + StringExtensions::Join(Sorted(roles), ", ")
+                    );
+                }
+            );
+            if (
+                (unsubscribeFromReplication != nullptr)
+                && (roles.find(replicationRole) == roles.end())
+            ) {
+                unsubscribeFromReplication();
+                unsubscribeFromReplication = nullptr;
+            }
+            for (auto& subscriptionsEntry: subscriptions) {
+                auto& subscription = subscriptionsEntry.second;
+                subscription.unsubscribeFromStore();
+                SubscribeToStore(subscriptionsEntry.first, subscription);
             }
         }
 
@@ -213,8 +809,8 @@ namespace {
                 "Opened"
             );
             std::weak_ptr< Client > selfWeak(shared_from_this());
-            const auto configuration = store->GetData({"Configuration"}, {});
-            authenticationTimeout = scheduler->Schedule(
+            const auto configuration = store->GetConfiguration();
+            authenticationTimeout = timeouts->Schedule(
                 [
                     selfWeak
                 ]{
@@ -224,7 +820,7 @@ namespace {
                     }
                     self->OnAuthenticationTimeout();
                 },
-                scheduler->GetClock()->GetCurrentTime() + (double)configuration["WebSocketAuthenticationTimeout"]
+                scheduler->GetClock()->GetCurrentTime() + configuration->webSocketAuthenticationTimeout
             );
         }
 
@@ -241,6 +837,417 @@ namespace {
             );
         }
 
+        /**
+         * Queue an update received from the store, to be sent to the client
+         * as soon as the rate limit of the subscription allows, along with
+         * any others which can be sent by then.
+         *
+         * @param[in] subscriptionId
+         *     This identifies the subscription for which the update
+         *     was received.
+         *
+         * @param[in] subscriptionNumber
+         *     This distinguishes the subscription from any earlier one
+         *     with the same identifier.
+         *
+         * @param[in] update
+         *     This is the update received.
+         */
+        void QueueUpdate(
+            const std::string& subscriptionId,
+            int subscriptionNumber,
+            const Store::Update& update
+        ) {
+            std::lock_guard< decltype(pendingUpdatesMutex) > lock(pendingUpdatesMutex);
+            const auto configuration = store->GetConfiguration();
+            const auto now = scheduler->GetClock()->GetCurrentTime();
+            if (
+                pendingUpdates.Queue(
+                    subscriptionId,
+                    subscriptionNumber,
+                    update,
+                    configuration->webSocketMaxPendingUpdates,
+                    configuration->webSocketOverflowWindow,
+                    now
+                )
+            ) {
+                diagnosticsSender.SendDiagnosticInformationFormatted(
+                    SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                    "Too many updates pending for subscription '%s'; falling back to snapshot",
+                    subscriptionId.c_str()
+                );
+            }
+            ScheduleFlush(now);
+        }
+
+        /**
+         * Make sure the job which flushes the updates waiting to be sent is
+         * scheduled for when the earliest of them are due, if any are
+         * waiting.  The pending updates mutex must be held.
+         *
+         * @param[in] now
+         *     This is the current time.
+         */
+        void ScheduleFlush(double now) {
+            double nextFlushTime;
+            if (!pendingUpdates.GetNextFlushTime(nextFlushTime)) {
+                return;
+            }
+            nextFlushTime = std::max(now, nextFlushTime);
+            if (flushToken != 0) {
+                if (flushTime <= nextFlushTime) {
+                    return;
+                }
+                scheduler->Cancel(flushToken);
+            }
+            flushTime = nextFlushTime;
+            std::weak_ptr< Client > selfWeak(shared_from_this());
+            flushToken = scheduler->Schedule(
+                [selfWeak]{
+                    const auto self = selfWeak.lock();
+                    if (self == nullptr) {
+                        return;
+                    }
+                    self->FlushUpdates();
+                },
+                flushTime
+            );
+        }
+
+        /**
+         * Send the client all the updates queued for it which the rate limits
+         * of their subscriptions allow to be sent now.  A single update for
+         * the unnamed subscription is sent as is.  Otherwise, all the updates
+         * are sent together in one "Batch" message, each labeled with the
+         * identifier of its subscription.
+         *
+         * For a subscription with a rate limit, only one update is sent each
+         * time.  If more than one is waiting, a new snapshot of the
+         * subscribed data is sent in their place.
+         */
+        void FlushUpdates() {
+            std::vector< UpdateQueue::Due > due;
+            size_t overflowsNow;
+            {
+                std::lock_guard< decltype(pendingUpdatesMutex) > lock(pendingUpdatesMutex);
+                const auto now = scheduler->GetClock()->GetCurrentTime();
+                flushToken = 0;
+                due = pendingUpdates.TakeDue(now);
+                overflowsNow = pendingUpdates.GetOverflows();
+                ScheduleFlush(now);
+            }
+            std::unique_lock< decltype(mutex) > lock(mutex);
+            if (overflowsNow > store->GetConfiguration()->webSocketMaxOverflows) {
+                ReportError("Too many updates pending", lock, true);
+                return;
+            }
+            const auto ws = wsWeak.lock();
+            if (ws == nullptr) {
+                return;
+            }
+            std::vector< std::pair< const std::string*, std::shared_ptr< const std::string > > > messages;
+            const char* lastMessageType = "";
+            for (auto& pending: due) {
+                const auto& subscriptionId = pending.subscriptionId;
+                const auto subscriptionsEntry = subscriptions.find(subscriptionId);
+                if (
+                    (subscriptionsEntry == subscriptions.end())
+                    || (subscriptionsEntry->second.number != pending.subscriptionNumber)
+                ) {
+                    continue;
+                }
+                auto& subscription = subscriptionsEntry->second;
+                if (
+                    pending.overflowed
+                    || (
+                        (pending.minInterval > 0.0)
+                        && (pending.updates.size() > 1)
+                    )
+                ) {
+                    Store::Update update;
+                    update.view = store->GetView(subscription.path, subscription.roles);
+                    pending.updates.assign(1, std::move(update));
+                }
+                for (const auto& update: pending.updates) {
+                    const auto revision = update.view->GetRevision();
+                    if (
+                        subscription.sentAny
+                        && (revision <= subscription.revision)
+                    ) {
+                        // This is from a revision of the store already
+                        // covered by an update sent before.
+                        continue;
+                    }
+                    subscription.sentAny = true;
+                    subscription.revision = revision;
+                    lastMessageType = GetUpdateMessageType(update, subscription.mode);
+                    messages.emplace_back(
+                        &subscriptionId,
+                        EncodeUpdateMessage(update, subscription.mode, cbor)
+                    );
+                }
+            }
+            if (messages.empty()) {
+                return;
+            }
+            if (
+                (messages.size() == 1)
+                && messages[0].first->empty()
+            ) {
+                SendEncoded(ws, lastMessageType, *messages[0].second);
+                return;
+            }
+            // The messages are already encoded, so splice them
+            // into the batch rather than decoding and reencoding them.
+            if (cbor) {
+                std::string batch;
+                Cbor::AppendHead(Cbor::MajorType::Map, 2, batch);
+                Cbor::AppendText("type", batch);
+                Cbor::AppendText("Batch", batch);
+                Cbor::AppendText("updates", batch);
+                Cbor::AppendHead(Cbor::MajorType::Array, messages.size(), batch);
+                for (const auto& message: messages) {
+                    Cbor::AppendHead(Cbor::MajorType::Map, 2, batch);
+                    Cbor::AppendText("id", batch);
+                    Cbor::AppendText(*message.first, batch);
+                    Cbor::AppendText("message", batch);
+                    batch += *message.second;
+                }
+                SendEncoded(ws, "Batch", batch);
+                return;
+            }
+            std::string batch = "{\"type\":\"Batch\",\"updates\":[";
+            bool first = true;
+            for (const auto& message: messages) {
+                if (!first) {
+                    batch += ',';
+                }
+                first = false;
+                batch += "{\"id\":";
+                batch += Json::Value(*message.first).ToEncoding();
+                batch += ",\"message\":";
+                batch += *message.second;
+                batch += '}';
+            }
+            batch += "]}";
+            SendEncoded(ws, "Batch", batch);
+        }
+
+        /**
+         * Make the given changes to the store on behalf of the client, all
+         * together or not at all, and let the client know how it went.
+         *
+         * @param[in] message
+         *     This is the message from the client asking for the changes.
+         *
+         * @param[in] mutations
+         *     These are the changes to make, in order.
+         *
+         * @param[in] lock
+         *     This is the object holding the client's mutex.
+         */
+        void ApplyMutations(
+            const Json::Value& message,
+            const std::vector< Store::Mutation >& mutations,
+            std::unique_lock< decltype(mutex) >& lock
+        ) {
+            if (!authenticated) {
+                ReportError("Not authenticated", lock);
+                return;
+            }
+            auto reply = Json::Object({
+                {"type", "Applied"},
+            });
+            if (message.Has("id")) {
+                reply["id"] = message["id"];
+            }
+            if (replica != nullptr) {
+                // The store is a replica, so only the leader may change it.
+                std::weak_ptr< Client > selfWeak(shared_from_this());
+                const auto forwarded = replica->Forward(
+                    mutations,
+                    identifiers,
+                    [reply, selfWeak](bool applied){
+                        const auto self = selfWeak.lock();
+                        if (self == nullptr) {
+                            return;
+                        }
+                        std::unique_lock< decltype(self->mutex) > lock(self->mutex);
+                        self->OnMutationsApplied(reply, applied, lock);
+                    }
+                );
+                if (!forwarded) {
+                    ReportError("Unable to make changes; leader unavailable", lock);
+                }
+                return;
+            }
+            OnMutationsApplied(
+                reply,
+                store->ApplyMutations(mutations, roles),
+                lock
+            );
+        }
+
+        /**
+         * Let the client know how it went making the changes it asked for.
+         *
+         * @param[in] reply
+         *     This is the message to send the client if the changes
+         *     were made.
+         *
+         * @param[in] applied
+         *     This indicates whether or not the changes were made.
+         *
+         * @param[in] lock
+         *     This is the object holding the client's mutex.
+         */
+        void OnMutationsApplied(
+            const Json::Value& reply,
+            bool applied,
+            std::unique_lock< decltype(mutex) >& lock
+        ) {
+            if (!applied) {
+                ReportError("Unable to make changes", lock);
+                return;
+            }
+            const auto ws = wsWeak.lock();
+            if (ws == nullptr) {
+                return;
+            }
+            Send(ws, reply);
+        }
+
+        /**
+         * Send to the client, which is a replica of the store, an update
+         * received from the store's replication subscription.  This is
+         * called by the store without the client's mutex held, and doesn't
+         * take it, since the first update is delivered while the client
+         * is subscribing.
+         *
+         * @param[in] update
+         *     This is the update to send.
+         */
+        void SendReplicationUpdate(const Store::Update& update) {
+            const auto ws = wsWeak.lock();
+            if (ws == nullptr) {
+                return;
+            }
+            const auto& view = *update.view;
+            if (cbor) {
+                Send(ws, Json::Object({
+                    {"type", "Replication"},
+                    {"whole", !update.patch},
+                    {"revision", view.GetRevision()},
+                    {"data", view.GetData()},
+                }));
+                return;
+            }
+            SendEncoded(
+                ws,
+                "Replication",
+                std::string("{\"type\":\"Replication\",\"whole\":")
+                + (update.patch ? "false" : "true")
+                + ",\"revision\":"
+                + std::to_string(view.GetRevision())
+                + ",\"data\":"
+                + view.GetDataEncoding()
+                + "}"
+            );
+        }
+
+        DEFINE_MESSAGE_HANDLER(OnBatch) {
+            const auto& operations = message["operations"];
+            if (operations.GetType() != Json::Value::Type::Array) {
+                ReportError("Malformed batch", lock);
+                return;
+            }
+            std::vector< Store::Mutation > mutations(operations.GetSize());
+            for (size_t i = 0; i < mutations.size(); ++i) {
+                if (!DecodeMutation(operations[i], mutations[i])) {
+                    ReportError("Malformed batch", lock);
+                    return;
+                }
+            }
+            ApplyMutations(message, mutations, lock);
+        }
+
+        DEFINE_MESSAGE_HANDLER(OnForward) {
+            const auto ws = wsWeak.lock();
+            if (ws == nullptr) {
+                return;
+            }
+            if (roles.find(replicationRole) == roles.end()) {
+                ReportError("Not permitted", lock);
+                return;
+            }
+            auto reply = Json::Object({
+                {"type", "Forwarded"},
+                {"id", message["id"]},
+                {"applied", false},
+            });
+            const auto& operations = message["operations"];
+            const auto& forwardedIdentifiers = message["identifiers"];
+            if (
+                (operations.GetType() != Json::Value::Type::Array)
+                || (forwardedIdentifiers.GetType() != Json::Value::Type::Array)
+            ) {
+                Send(ws, reply);
+                return;
+            }
+            std::vector< Store::Mutation > mutations(operations.GetSize());
+            for (size_t i = 0; i < mutations.size(); ++i) {
+                if (!DecodeMutation(operations[i], mutations[i])) {
+                    Send(ws, reply);
+                    return;
+                }
+            }
+
+            // Only who the client is comes from the replica.  What the
+            // client may do is up to us.
+            std::unordered_set< std::string > clientIdentifiers;
+            for (const auto forwardedIdentifiersEntry: forwardedIdentifiers) {
+                (void)clientIdentifiers.insert(forwardedIdentifiersEntry.value());
+            }
+            reply["applied"] = store->ApplyMutations(
+                mutations,
+                GetRolesHeld(clientIdentifiers, *store->GetIdentifierRoles())
+            );
+            Send(ws, reply);
+        }
+
+        DEFINE_MESSAGE_HANDLER(OnMutation) {
+            std::vector< Store::Mutation > mutations(1);
+            if (!DecodeMutation(message, mutations[0])) {
+                ReportError("Malformed change", lock);
+                return;
+            }
+            ApplyMutations(message, mutations, lock);
+        }
+
+        DEFINE_MESSAGE_HANDLER(OnReplicate) {
+            if (roles.find(replicationRole) == roles.end()) {
+                ReportError("Not permitted", lock, true);
+                return;
+            }
+            if (unsubscribeFromReplication != nullptr) {
+                return;
+            }
+            diagnosticsSender.SendDiagnosticInformationString(
+                2,
+                "Replicating"
+            );
+            std::weak_ptr< Client > selfWeak(shared_from_this());
+            unsubscribeFromReplication = store->SubscribeToReplication(
+                [selfWeak](const Store::Update& update){
+                    const auto self = selfWeak.lock();
+                    if (self == nullptr) {
+                        return;
+                    }
+                    self->SendReplicationUpdate(update);
+                }
+            );
+        }
+
         DEFINE_MESSAGE_HANDLER(OnSubscribe) {
             const auto& path = message["path"];
             if (path.GetType() != Json::Value::Type::Array) {
@@ -250,49 +1257,134 @@ namespace {
             for (const auto pathElement: path) {
                 subscriptionPath.push_back(pathElement.value());
             }
-            if (unsubscribeFromStore != nullptr) {
-                unsubscribeFromStore();
+            const std::string subscriptionId = message["id"];
+            auto& subscription = subscriptions[subscriptionId];
+            if (subscription.unsubscribeFromStore != nullptr) {
+                subscription.unsubscribeFromStore();
             }
-            const auto wsWeakCopy(wsWeak);
-            unsubscribeFromStore = store->SubscribeToData(
-                subscriptionPath,
-                roles,
-                [wsWeakCopy](
-                    Json::Value&& data
-                ){
-                    const auto ws = wsWeakCopy.lock();
-                    if (ws != nullptr) {
-                        ws->SendText(Json::Object({
-                            {"type", "Data"},
-                            {"data", std::move(data)},
-                        }).ToEncoding());
-                    }
+            subscription.path = subscriptionPath;
+            subscription.mode = Store::UpdateMode::Snapshot;
+            const std::string modeName = message["mode"];
+            if (modeName == "patch") {
+                subscription.mode = Store::UpdateMode::JsonPatch;
+            } else if (modeName == "merge") {
+                subscription.mode = Store::UpdateMode::MergePatch;
+            }
+            auto maxUpdateRate = store->GetConfiguration()->webSocketMaxUpdateRate;
+            if (message.Has("maxRate")) {
+                const double requestedMaxUpdateRate = message["maxRate"];
+                if (
+                    (requestedMaxUpdateRate > 0.0)
+                    && (
+                        (maxUpdateRate <= 0.0)
+                        || (requestedMaxUpdateRate < maxUpdateRate)
+                    )
+                ) {
+                    maxUpdateRate = requestedMaxUpdateRate;
                 }
+            }
+            subscription.minInterval = (
+                (maxUpdateRate > 0.0)
+                ? 1.0 / maxUpdateRate
+                : 0.0
             );
+            SubscribeToStore(subscriptionId, subscription);
         }
 
-        void OnText(const std::string& data) {
-            std::unique_lock< decltype(mutex) > lock(mutex);
-            diagnosticsSender.SendDiagnosticInformationFormatted(
-                0,
-                "Received: \"%s\"",
-                data.c_str()
+        /**
+         * Subscribe to the store for the data requested by the given
+         * subscription, with the roles the client holds now.
+         *
+         * @param[in] subscriptionId
+         *     This is the identifier the client gave the subscription.
+         *
+         * @param[in,out] subscription
+         *     This is the subscription to form.  Any earlier subscription
+         *     to the store made for it must already be terminated.
+         */
+        void SubscribeToStore(
+            const std::string& subscriptionId,
+            Subscription& subscription
+        ) {
+            subscription.number = nextSubscriptionNumber++;
+            subscription.roles = roles;
+            subscription.revision = 0;
+            subscription.sentAny = false;
+            {
+                // This must be done before subscribing, because the store
+                // delivers the first update right away.
+                std::lock_guard< decltype(pendingUpdatesMutex) > lock(pendingUpdatesMutex);
+                pendingUpdates.Open(
+                    subscriptionId,
+                    subscription.number,
+                    subscription.minInterval
+                );
+            }
+            std::weak_ptr< Client > selfWeak(shared_from_this());
+            const auto subscriptionNumber = subscription.number;
+            subscription.unsubscribeFromStore = store->SubscribeToData(
+                subscription.path,
+                roles,
+                [selfWeak, subscriptionId, subscriptionNumber](const Store::Update& update){
+                    const auto self = selfWeak.lock();
+                    if (self == nullptr) {
+                        return;
+                    }
+                    self->QueueUpdate(subscriptionId, subscriptionNumber, update);
+                },
+                subscription.mode
             );
-            const auto ws = wsWeak.lock();
-            const auto message = Json::Value::FromEncoding(data);
+        }
+
+        DEFINE_MESSAGE_HANDLER(OnUnsubscribe) {
+            const std::string subscriptionId = message["id"];
+            const auto subscriptionsEntry = subscriptions.find(subscriptionId);
+            if (subscriptionsEntry == subscriptions.end()) {
+                return;
+            }
+            subscriptionsEntry->second.unsubscribeFromStore();
+            (void)subscriptions.erase(subscriptionsEntry);
+            std::lock_guard< decltype(pendingUpdatesMutex) > pendingUpdatesLock(pendingUpdatesMutex);
+            pendingUpdates.Close(subscriptionId);
+        }
+
+        /**
+         * Handle a message received from the client, once it's decoded.
+         *
+         * @param[in] message
+         *     This is the message received.
+         *
+         * @param[in] size
+         *     This is the size of the message, as received.
+         *
+         * @param[in] describe
+         *     This is the function to call to describe the message as
+         *     received, if it's malformed.
+         *
+         * @param[in] lock
+         *     This is the object holding the client's mutex.
+         */
+        void OnMessage(
+            const Json::Value& message,
+            size_t size,
+            const std::function< std::string() >& describe,
+            std::unique_lock< decltype(mutex) >& lock
+        ) {
             if (
                 (message.GetType() != Json::Value::Type::Object)
                 || !message.Has("type")
             ) {
+                metrics->CountReceived("", size);
                 diagnosticsSender.SendDiagnosticInformationFormatted(
                     SystemAbstractions::DiagnosticsSender::Levels::WARNING,
-                    "Malformed message received: \"%s\"",
-                    data.c_str()
+                    "Malformed message received: %s",
+                    describe().c_str()
                 );
                 ReportError("malformed message received", lock, true);
                 return;
             }
             const auto messageType = (std::string)message["type"];
+            metrics->CountReceived(messageType, size);
             const auto messageHandler = messageHandlers.find(messageType);
             if (messageHandler == messageHandlers.end()) {
                 ReportError(
@@ -307,6 +1399,30 @@ namespace {
             }
         }
 
+        void OnText(const std::string& data) {
+            std::unique_lock< decltype(mutex) > lock(mutex);
+            const auto describe = [&data]{ return "\"" + data + "\""; };
+            Diagnostics::SendLazily(
+                diagnosticsSender,
+                0,
+                [&describe]{ return "Received: " + describe(); }
+            );
+            OnMessage(Json::Value::FromEncoding(data), data.size(), describe, lock);
+        }
+
+        void OnBinary(const std::string& data) {
+            std::unique_lock< decltype(mutex) > lock(mutex);
+            const auto describe = [&data]{
+                return StringExtensions::sprintf("%zu bytes of CBOR", data.size());
+            };
+            Diagnostics::SendLazily(
+                diagnosticsSender,
+                0,
+                [&describe]{ return "Received: " + describe(); }
+            );
+            OnMessage(Cbor::Decode(data), data.size(), describe, lock);
+        }
+
         void ReportError(
             const std::string& message,
             std::unique_lock< std::mutex >& lock,
@@ -314,10 +1430,10 @@ namespace {
         ) {
             const auto ws = wsWeak.lock();
             if (ws != nullptr) {
-                ws->SendText(Json::Object({
+                Send(ws, Json::Object({
                     {"type", "Error"},
                     {"message", message},
-                }).ToEncoding());
+                }));
             }
             if (disconnect) {
                 auto closeDelegateCopy = closeDelegate;
@@ -333,41 +1449,29 @@ namespace {
             std::function< void(Client& self, std::unique_lock< std::mutex >& lock, intmax_t twitchId) > onSuccess,
             std::function< void(Client& self, std::unique_lock< std::mutex >& lock) > onFailure
         ) {
-            Http::Request request;
-            request.method = "GET";
-            request.target.ParseFromString("https://id.twitch.tv/oauth2/validate");
-            request.headers.SetHeader(
-                "Authorization",
-                std::string("OAuth ") + token
-            );
             std::weak_ptr< Client > selfWeak(shared_from_this());
-            httpClientTransactions->Post(
-                request,
+            const auto startTime = std::chrono::steady_clock::now();
+            tokenValidations->Validate(
+                token,
                 [
                     onFailure,
                     onSuccess,
-                    selfWeak
-                ](Http::Response& response){
+                    selfWeak,
+                    startTime
+                ](bool valid, intmax_t twitchId){
                     auto self = selfWeak.lock();
                     if (self == nullptr) {
                         return;
                     }
+                    self->metrics->authenticationTime->Observe(
+                        std::chrono::duration< double >(std::chrono::steady_clock::now() - startTime).count()
+                    );
                     std::unique_lock< decltype(self->mutex) > lock(self->mutex);
-                    if (response.statusCode == 200) {
-                        const auto data = Json::Value::FromEncoding(response.body);
-                        intmax_t twitchId;
-                        if (
-                            sscanf(
-                                ((std::string)data["user_id"]).c_str(),
-                                "%" SCNdMAX,
-                                &twitchId
-                            ) == 1
-                        ) {
-                            onSuccess(*self, lock, twitchId);
-                            return;
-                        }
+                    if (valid) {
+                        onSuccess(*self, lock, twitchId);
+                    } else {
+                        onFailure(*self, lock);
                     }
-                    onFailure(*self, lock);
                 }
             );
         }
@@ -375,8 +1479,15 @@ namespace {
     };
 
     const std::unordered_map< std::string, Client::MessageHandler > Client::messageHandlers{
+        {"Add", &Client::OnMutation},
         {"Authenticate", &Client::OnAuthenticate},
+        {"Batch", &Client::OnBatch},
+        {"Forward", &Client::OnForward},
+        {"Remove", &Client::OnMutation},
+        {"Replicate", &Client::OnReplicate},
+        {"Set", &Client::OnMutation},
         {"Subscribe", &Client::OnSubscribe},
+        {"Unsubscribe", &Client::OnUnsubscribe},
     };
 
 }
@@ -397,11 +1508,21 @@ struct ApiWs::Impl
     size_t generation = 0;
     std::shared_ptr< HttpClientTransactions > httpClientTransactions;
     std::shared_ptr< Http::Server > httpServer;
+    std::shared_ptr< const ApiWsMetrics > metrics;
     bool mobilized = false;
     std::recursive_mutex mutex;
+    std::shared_ptr< Replica > replica;
     Http::IServer::UnregistrationDelegate resourceUnregistrationDelegate;
     std::shared_ptr< Timekeeping::Scheduler > scheduler;
     std::shared_ptr< Store > store;
+    std::shared_ptr< TimerWheel > timeouts;
+    std::shared_ptr< TokenValidations > tokenValidations;
+
+    /**
+     * This is the function to call to stop receiving updates when
+     * the "Roles" part of the store changes.
+     */
+    std::function< void() > unsubscribeFromRoles;
 
     // Constructor
 
@@ -427,12 +1548,12 @@ struct ApiWs::Impl
         ws->Close(code, reason);
         clientsEntry->second->OnClosed(code, reason);
         clientsEntry->second = nullptr;
+        metrics->clients->Add(-1);
         const auto thisGeneration = generation;
-        const auto configuration = store->GetData({"Configuration"}, {});
-        const auto webSocketCloseLinger = (double)configuration["WebSocketCloseLinger"];
+        const auto webSocketCloseLinger = store->GetConfiguration()->webSocketCloseLinger;
         std::weak_ptr< WebSockets::WebSocket > wsWeak(ws);
         std::weak_ptr< Impl > implWeak(shared_from_this());
-        (void)scheduler->Schedule(
+        (void)timeouts->Schedule(
             [
                 implWeak,
                 thisGeneration,
@@ -470,9 +1591,10 @@ struct ApiWs::Impl
     Http::Response HandleWebSocketRequest(
         const Http::Request& request,
         std::shared_ptr< Http::Connection > connection,
-        const std::string& trailer,
-        const Json::Value& configuration
+        const std::string& trailer
     ) {
+        const auto currentConfiguration = store->GetConfiguration();
+        const auto& configuration = currentConfiguration->settings;
         Http::Response response;
         const auto ws = std::make_shared< WebSockets::WebSocket >();
         WebSockets::WebSocket::Configuration webSocketConfiguration;
@@ -487,9 +1609,12 @@ struct ApiWs::Impl
             client = std::make_shared< Client >(
                 connection->GetPeerId(),
                 wsWeak,
-                httpClientTransactions,
+                tokenValidations,
                 store,
+                replica,
                 scheduler,
+                timeouts,
+                metrics,
                 [implWeak, wsWeak](
                     unsigned int code,
                     const std::string& reason
@@ -510,6 +1635,11 @@ struct ApiWs::Impl
                 diagnosticsSender.Chain(),
                 configuration["DiagnosticReportingThresholds"]["WebSocket"]
             );
+            if (request.headers.HasHeaderToken("Sec-WebSocket-Protocol", cborSubprotocol)) {
+                response.headers.SetHeader("Sec-WebSocket-Protocol", cborSubprotocol);
+                client->cbor = true;
+            }
+            metrics->clients->Add(1);
             client->OnOpened();
             WebSockets::WebSocket::Delegates delegates;
             const auto thisGeneration = generation;
@@ -538,29 +1668,24 @@ struct ApiWs::Impl
                 }
                 impl->OnWebSocketClosed(ws, code, reason);
             };
-            delegates.text = [
-                implWeak,
-                thisGeneration,
-                wsWeak
-            ](
-                const std::string& data
-            ){
-                const auto impl = implWeak.lock();
-                if (impl == nullptr) {
+            // Messages go straight to the client, and are handled under only
+            // the client's own lock, so that clients don't hold each other
+            // up.  Once the client is dropped (when the WebSocket is closed,
+            // or we're demobilized) any more messages are ignored.
+            std::weak_ptr< Client > clientWeak(client);
+            delegates.text = [clientWeak](const std::string& data){
+                const auto client = clientWeak.lock();
+                if (client == nullptr) {
                     return;
                 }
-                const auto ws = wsWeak.lock();
-                if (ws == nullptr) {
-                    return;
-                }
-                std::lock_guard< decltype(impl->mutex) > lock(impl->mutex);
-                if (
-                    !impl->mobilized
-                    || (impl->generation != thisGeneration)
-                ) {
+                client->OnText(data);
+            };
+            delegates.binary = [clientWeak](const std::string& data){
+                const auto client = clientWeak.lock();
+                if (client == nullptr) {
                     return;
                 }
-                impl->OnWebSocketText(ws, data);
+                client->OnBinary(data);
             };
             ws->SetDelegates(std::move(delegates));
         } else if (response.statusCode == 0) {
@@ -572,6 +1697,28 @@ struct ApiWs::Impl
         return response;
     }
 
+    /**
+     * Have every connected client work out again which roles it holds,
+     * now that the roles in the store have changed.
+     */
+    void RefreshClientRoles() {
+        std::vector< std::shared_ptr< Client > > clientsToRefresh;
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            if (!mobilized) {
+                return;
+            }
+            for (const auto& clientsEntry: clients) {
+                if (clientsEntry.second != nullptr) {
+                    clientsToRefresh.push_back(clientsEntry.second);
+                }
+            }
+        }
+        for (const auto& client: clientsToRefresh) {
+            client->RefreshRoles();
+        }
+    }
+
     void OnWebSocketClosed(
         std::shared_ptr< WebSockets::WebSocket > ws,
         unsigned int code,
@@ -580,17 +1727,6 @@ struct ApiWs::Impl
         CloseWebSocket(ws);
     }
 
-    void OnWebSocketText(
-        std::shared_ptr< WebSockets::WebSocket > ws,
-        const std::string& data
-    ) {
-        auto clientsEntry = clients.find(ws);
-        if (clientsEntry == clients.end()) {
-            return;
-        }
-        clientsEntry->second->OnText(data);
-    }
-
 };
 
 ApiWs::~ApiWs() noexcept {
@@ -615,9 +1751,16 @@ void ApiWs::Demobilize() {
     }
     impl_->clients.clear();
     impl_->resourceUnregistrationDelegate();
+    impl_->unsubscribeFromRoles();
+    impl_->unsubscribeFromRoles = nullptr;
     impl_->httpServer = nullptr;
+    impl_->timeouts->Demobilize();
+    impl_->timeouts = nullptr;
+    impl_->replica = nullptr;
     impl_->scheduler = nullptr;
     impl_->store = nullptr;
+    impl_->tokenValidations->Demobilize();
+    impl_->tokenValidations = nullptr;
     impl_->mobilized = false;
 }
 
@@ -631,26 +1774,70 @@ SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate ApiWs::SubscribeToDia
 void ApiWs::Mobilize(
     const std::shared_ptr< Store >& store,
     const std::shared_ptr< HttpClientTransactions >& httpClientTransactions,
+    const std::shared_ptr< Replica >& replica,
     const std::shared_ptr< Http::Server >& httpServer,
     const std::shared_ptr< Timekeeping::Clock >& clock,
-    const Json::Value& configuration
+    const std::shared_ptr< Metrics >& metrics
 ) {
     std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
     if (impl_->mobilized) {
         return;
     }
+    std::vector< std::string > receivedMessageTypes;
+    for (const auto& messageHandlersEntry: Client::messageHandlers) {
+        receivedMessageTypes.push_back(messageHandlersEntry.first);
+    }
+    impl_->metrics = std::make_shared< const ApiWsMetrics >(
+        *metrics,
+        receivedMessageTypes,
+        sentMessageTypes
+    );
     impl_->store = store;
     impl_->httpClientTransactions = httpClientTransactions;
+    impl_->replica = replica;
     impl_->httpServer = httpServer;
     impl_->scheduler = std::make_shared< Timekeeping::Scheduler >();
     impl_->scheduler->SetClock(clock);
+    impl_->timeouts = std::make_shared< TimerWheel >();
+    impl_->timeouts->Mobilize(impl_->scheduler, connectionTimeoutResolution);
+    impl_->tokenValidations = std::make_shared< TokenValidations >();
+    impl_->tokenValidations->Mobilize(
+        [httpClientTransactions](
+            Http::Request& request,
+            TokenValidations::CompletionDelegate completionDelegate
+        ){
+            httpClientTransactions->Post(request, completionDelegate);
+        },
+        impl_->scheduler,
+        [store]{
+            return store->GetConfiguration()->twitchTokenValidationCacheTime;
+        }
+    );
     std::weak_ptr< Impl > implWeak(impl_);
+    const auto scheduler = impl_->scheduler;
+    impl_->unsubscribeFromRoles = store->SubscribeToData(
+        {"Roles"},
+        {},
+        [implWeak, scheduler](const Store::Update& update){
+            // The store doesn't hold its lock while calling this, but it
+            // may be called by a client changing the roles, while that
+            // client's lock is held, so refresh the roles of the clients
+            // from the scheduler instead.
+            (void)scheduler->Schedule(
+                [implWeak]{
+                    const auto impl = implWeak.lock();
+                    if (impl == nullptr) {
+                        return;
+                    }
+                    impl->RefreshClientRoles();
+                },
+                scheduler->GetClock()->GetCurrentTime()
+            );
+        }
+    );
     impl_->resourceUnregistrationDelegate = impl_->httpServer->RegisterResource(
         {"ws"},
-        [
-            configuration,
-            implWeak
-        ](
+        [implWeak](
             const Http::Request& request,
             std::shared_ptr< Http::Connection > connection,
             const std::string& trailer
@@ -666,7 +1853,7 @@ void ApiWs::Mobilize(
                 return response;
             }
             std::lock_guard< decltype(impl->mutex) > lock(impl->mutex);
-            return impl->HandleWebSocketRequest(request, connection, trailer, configuration);
+            return impl->HandleWebSocketRequest(request, connection, trailer);
         }
     );
     ++impl_->generation;
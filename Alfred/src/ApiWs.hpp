@@ -8,6 +8,8 @@
  */
 
 #include "HttpClientTransactions.hpp"
+#include "Metrics.hpp"
+#include "Replica.hpp"
 #include "Store.hpp"
 
 #include <Http/Server.hpp>
@@ -54,12 +56,42 @@ public:
         size_t minLevel = 0
     );
 
+    /**
+     * Begin serving the WebSocket API.
+     *
+     * @param[in] store
+     *     This is the store to which the API gives access.
+     *
+     * @param[in] httpClientTransactions
+     *     This is used to make requests of other servers, such as to
+     *     validate OAuth tokens.
+     *
+     * @param[in] replica
+     *     If the store is a replica of another, this is used to forward to
+     *     the other the changes clients ask to make.  Otherwise it's null.
+     *
+     * @param[in] httpServer
+     *     This is the server through which clients connect.
+     *
+     * @param[in] clock
+     *     This is used to time connections and updates.
+     *
+     * @param[in] metrics
+     *     This is where to keep the metrics measuring the API.
+     *
+     * @note
+     *     Settings are read from the "Configuration" part of the store as
+     *     they're needed, and the roles of connected clients are worked out
+     *     again whenever the "Roles" part of the store changes, so neither
+     *     requires the API to be mobilized again.
+     */
     void Mobilize(
         const std::shared_ptr< Store >& store,
         const std::shared_ptr< HttpClientTransactions >& httpClientTransactions,
+        const std::shared_ptr< Replica >& replica,
         const std::shared_ptr< Http::Server >& httpServer,
         const std::shared_ptr< Timekeeping::Clock >& clock,
-        const Json::Value& configuration
+        const std::shared_ptr< Metrics >& metrics
     );
 
     // Private properties
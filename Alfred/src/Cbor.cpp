@@ -0,0 +1,356 @@
+/**
+ * @file Cbor.cpp
+ *
+ * This module contains the implementation of functions used to encode and
+ * decode JSON values in the Concise Binary Object Representation (CBOR).
+ */
+
+#include "Cbor.hpp"
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace {
+
+    /**
+     * This is the deepest nesting of arrays and maps which may be decoded,
+     * so that hostile input can't exhaust the stack.
+     */
+    constexpr size_t maxDecodeDepth = 64;
+
+    /**
+     * These are the additional information values which
+     * have special meanings.
+     */
+    constexpr uint8_t oneByteArgument = 24;
+    constexpr uint8_t twoByteArgument = 25;
+    constexpr uint8_t fourByteArgument = 26;
+    constexpr uint8_t eightByteArgument = 27;
+
+    /**
+     * These are the simple values and floating-point
+     * additional information values used.
+     */
+    constexpr uint8_t simpleFalse = 20;
+    constexpr uint8_t simpleTrue = 21;
+    constexpr uint8_t simpleNull = 22;
+    constexpr uint8_t simpleUndefined = 23;
+    constexpr uint8_t halfFloat = twoByteArgument;
+    constexpr uint8_t singleFloat = fourByteArgument;
+    constexpr uint8_t doubleFloat = eightByteArgument;
+
+    void AppendBigEndian(
+        uint64_t value,
+        size_t size,
+        std::string& output
+    ) {
+        for (size_t i = size; i > 0; --i) {
+            output += (char)((value >> ((i - 1) * 8)) & 0xFF);
+        }
+    }
+
+    double DecodeHalfFloat(uint16_t half) {
+        const int exponent = ((half >> 10) & 0x1F);
+        const int mantissa = (half & 0x3FF);
+        double value;
+        if (exponent == 0) {
+            value = ldexp(mantissa, -24);
+        } else if (exponent == 31) {
+            value = ((mantissa == 0) ? INFINITY : NAN);
+        } else {
+            value = ldexp(mantissa + 1024, exponent - 25);
+        }
+        return ((half & 0x8000) ? -value : value);
+    }
+
+    /**
+     * This decodes CBOR data items from a given encoding.
+     */
+    struct Decoder {
+        // Properties
+
+        const std::string& encoding;
+        size_t offset = 0;
+
+        // Methods
+
+        Decoder(const std::string& encoding)
+            : encoding(encoding)
+        {
+        }
+
+        bool ReadBigEndian(
+            size_t size,
+            uint64_t& value
+        ) {
+            if (encoding.size() - offset < size) {
+                return false;
+            }
+            value = 0;
+            for (size_t i = 0; i < size; ++i) {
+                value = (value << 8) | (uint8_t)encoding[offset++];
+            }
+            return true;
+        }
+
+        bool ReadArgument(
+            uint8_t additionalInformation,
+            uint64_t& argument
+        ) {
+            switch (additionalInformation) {
+                case oneByteArgument: return ReadBigEndian(1, argument);
+                case twoByteArgument: return ReadBigEndian(2, argument);
+                case fourByteArgument: return ReadBigEndian(4, argument);
+                case eightByteArgument: return ReadBigEndian(8, argument);
+                default: {
+                    if (additionalInformation > eightByteArgument) {
+                        // Indefinite lengths aren't supported.
+                        return false;
+                    }
+                    argument = additionalInformation;
+                    return true;
+                }
+            }
+        }
+
+        bool ReadString(
+            uint64_t length,
+            std::string& value
+        ) {
+            if (encoding.size() - offset < length) {
+                return false;
+            }
+            value = encoding.substr(offset, (size_t)length);
+            offset += (size_t)length;
+            return true;
+        }
+
+        Json::Value ReadSimple(
+            uint8_t additionalInformation,
+            uint64_t argument
+        ) {
+            switch (additionalInformation) {
+                case halfFloat: {
+                    return DecodeHalfFloat((uint16_t)argument);
+                }
+
+                case singleFloat: {
+                    const auto bits = (uint32_t)argument;
+                    float value;
+                    (void)memcpy(&value, &bits, sizeof(value));
+                    return (double)value;
+                }
+
+                case doubleFloat: {
+                    double value;
+                    (void)memcpy(&value, &argument, sizeof(value));
+                    return value;
+                }
+
+                default: {
+                    switch (argument) {
+                        case simpleFalse: return false;
+                        case simpleTrue: return true;
+                        case simpleNull:
+                        case simpleUndefined: return nullptr;
+                        default: return Json::Value();
+                    }
+                }
+            }
+        }
+
+        Json::Value ReadItem(size_t depth) {
+            if (
+                (offset >= encoding.size())
+                || (depth > maxDecodeDepth)
+            ) {
+                return Json::Value();
+            }
+            const auto initialByte = (uint8_t)encoding[offset++];
+            const auto majorType = (Cbor::MajorType)(initialByte >> 5);
+            const auto additionalInformation = (uint8_t)(initialByte & 0x1F);
+            uint64_t argument;
+            if (!ReadArgument(additionalInformation, argument)) {
+                return Json::Value();
+            }
+            switch (majorType) {
+                case Cbor::MajorType::UnsignedInteger: {
+                    if (argument > (uint64_t)INTMAX_MAX) {
+                        return (double)argument;
+                    }
+                    return (intmax_t)argument;
+                }
+
+                case Cbor::MajorType::NegativeInteger: {
+                    if (argument > (uint64_t)INTMAX_MAX) {
+                        return -1.0 - (double)argument;
+                    }
+                    return -1 - (intmax_t)argument;
+                }
+
+                case Cbor::MajorType::ByteString:
+                case Cbor::MajorType::TextString: {
+                    std::string value;
+                    if (!ReadString(argument, value)) {
+                        return Json::Value();
+                    }
+                    return value;
+                }
+
+                case Cbor::MajorType::Array: {
+                    auto value = Json::Array({});
+                    for (uint64_t i = 0; i < argument; ++i) {
+                        auto element = ReadItem(depth + 1);
+                        if (element.GetType() == Json::Value::Type::Invalid) {
+                            return Json::Value();
+                        }
+                        value.Add(std::move(element));
+                    }
+                    return value;
+                }
+
+                case Cbor::MajorType::Map: {
+                    auto value = Json::Object({});
+                    for (uint64_t i = 0; i < argument; ++i) {
+                        const auto key = ReadItem(depth + 1);
+                        if (key.GetType() != Json::Value::Type::String) {
+                            return Json::Value();
+                        }
+                        auto element = ReadItem(depth + 1);
+                        if (element.GetType() == Json::Value::Type::Invalid) {
+                            return Json::Value();
+                        }
+                        value[(std::string)key] = std::move(element);
+                    }
+                    return value;
+                }
+
+                case Cbor::MajorType::Tag: {
+                    return ReadItem(depth + 1);
+                }
+
+                default: {
+                    return ReadSimple(additionalInformation, argument);
+                }
+            }
+        }
+    };
+
+}
+
+namespace Cbor {
+
+    void AppendHead(
+        MajorType majorType,
+        uint64_t argument,
+        std::string& output
+    ) {
+        const auto majorTypeBits = (uint8_t)((uint8_t)majorType << 5);
+        if (argument < oneByteArgument) {
+            output += (char)(majorTypeBits | (uint8_t)argument);
+        } else if (argument <= 0xFF) {
+            output += (char)(majorTypeBits | oneByteArgument);
+            AppendBigEndian(argument, 1, output);
+        } else if (argument <= 0xFFFF) {
+            output += (char)(majorTypeBits | twoByteArgument);
+            AppendBigEndian(argument, 2, output);
+        } else if (argument <= 0xFFFFFFFF) {
+            output += (char)(majorTypeBits | fourByteArgument);
+            AppendBigEndian(argument, 4, output);
+        } else {
+            output += (char)(majorTypeBits | eightByteArgument);
+            AppendBigEndian(argument, 8, output);
+        }
+    }
+
+    void AppendText(
+        const std::string& text,
+        std::string& output
+    ) {
+        AppendHead(MajorType::TextString, text.size(), output);
+        output += text;
+    }
+
+    void Append(
+        const Json::Value& value,
+        std::string& output
+    ) {
+        const auto simpleBits = (char)((uint8_t)MajorType::Simple << 5);
+        switch (value.GetType()) {
+            case Json::Value::Type::Boolean: {
+                output += (char)(simpleBits | ((bool)value ? simpleTrue : simpleFalse));
+            } break;
+
+            case Json::Value::Type::String: {
+                AppendText((std::string)value, output);
+            } break;
+
+            case Json::Value::Type::Integer: {
+                const auto integer = (intmax_t)value;
+                if (integer < 0) {
+                    AppendHead(MajorType::NegativeInteger, (uint64_t)(-1 - integer), output);
+                } else {
+                    AppendHead(MajorType::UnsignedInteger, (uint64_t)integer, output);
+                }
+            } break;
+
+            case Json::Value::Type::FloatingPoint: {
+                // Use single precision wherever it loses nothing,
+                // since it takes half the space.
+                const auto number = (double)value;
+                const auto single = (float)number;
+                if (
+                    ((double)single == number)
+                    || isnan(number)
+                ) {
+                    uint32_t bits;
+                    (void)memcpy(&bits, &single, sizeof(bits));
+                    output += (char)(simpleBits | singleFloat);
+                    AppendBigEndian(bits, 4, output);
+                } else {
+                    uint64_t bits;
+                    (void)memcpy(&bits, &number, sizeof(bits));
+                    output += (char)(simpleBits | doubleFloat);
+                    AppendBigEndian(bits, 8, output);
+                }
+            } break;
+
+            case Json::Value::Type::Array: {
+                const auto size = value.GetSize();
+                AppendHead(MajorType::Array, size, output);
+                for (size_t i = 0; i < size; ++i) {
+                    Append(value[i], output);
+                }
+            } break;
+
+            case Json::Value::Type::Object: {
+                AppendHead(MajorType::Map, value.GetSize(), output);
+                for (const auto entry: value) {
+                    AppendText(entry.key(), output);
+                    Append(entry.value(), output);
+                }
+            } break;
+
+            default: {
+                output += (char)(simpleBits | simpleNull);
+            } break;
+        }
+    }
+
+    std::string Encode(const Json::Value& value) {
+        std::string output;
+        Append(value, output);
+        return output;
+    }
+
+    Json::Value Decode(const std::string& encoding) {
+        Decoder decoder(encoding);
+        auto value = decoder.ReadItem(0);
+        if (decoder.offset != encoding.size()) {
+            return Json::Value();
+        }
+        return value;
+    }
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+/**
+ * @file Cbor.hpp
+ *
+ * This module declares functions used to encode and decode JSON values in
+ * the Concise Binary Object Representation (CBOR)
+ * ([RFC 8949](https://tools.ietf.org/html/rfc8949)), for clients which would
+ * rather not parse and format text.
+ */
+
+#include <Json/Value.hpp>
+#include <stdint.h>
+#include <string>
+
+namespace Cbor {
+
+    /**
+     * These are the major types of CBOR data items.
+     */
+    enum class MajorType : uint8_t {
+        UnsignedInteger = 0,
+        NegativeInteger = 1,
+        ByteString = 2,
+        TextString = 3,
+        Array = 4,
+        Map = 5,
+        Tag = 6,
+        Simple = 7,
+    };
+
+    /**
+     * Append to the given output the initial bytes of a CBOR data item of
+     * the given major type.  This is used to splice together data items
+     * already encoded.
+     *
+     * @param[in] majorType
+     *     This is the major type of the data item.
+     *
+     * @param[in] argument
+     *     This is the value, length, or number of elements
+     *     of the data item, depending on its major type.
+     *
+     * @param[in,out] output
+     *     This is where to append the encoding.
+     */
+    void AppendHead(
+        MajorType majorType,
+        uint64_t argument,
+        std::string& output
+    );
+
+    /**
+     * Append to the given output the CBOR encoding of the given text string.
+     *
+     * @param[in] text
+     *     This is the text string to encode.
+     *
+     * @param[in,out] output
+     *     This is where to append the encoding.
+     */
+    void AppendText(
+        const std::string& text,
+        std::string& output
+    );
+
+    /**
+     * Append to the given output the CBOR encoding of the given value.
+     *
+     * @param[in] value
+     *     This is the value to encode.
+     *
+     * @param[in,out] output
+     *     This is where to append the encoding.
+     */
+    void Append(
+        const Json::Value& value,
+        std::string& output
+    );
+
+    /**
+     * Return the CBOR encoding of the given value.
+     *
+     * @param[in] value
+     *     This is the value to encode.
+     *
+     * @return
+     *     The CBOR encoding of the given value is returned.
+     */
+    std::string Encode(const Json::Value& value);
+
+    /**
+     * Decode the given CBOR encoding of a single data item.  Byte strings
+     * are decoded as strings, tags are ignored, and map keys must be text
+     * strings.
+     *
+     * @param[in] encoding
+     *     This is the encoding to decode.
+     *
+     * @return
+     *     The decoded value is returned.  It is invalid if the encoding is
+     *     malformed, uses a feature not supported, or has anything
+     *     following the data item.
+     */
+    Json::Value Decode(const std::string& encoding);
+
+}
@@ -0,0 +1,64 @@
+/**
+ * @file Compression.cpp
+ *
+ * This module contains the implementation of functions used to compress
+ * data sent to clients.
+ */
+
+#include "Compression.hpp"
+
+#include <zlib.h>
+
+namespace {
+
+    /**
+     * This is the base-two logarithm of the size of the history window
+     * used by the compressor.  Adding 16 selects the gzip wrapper
+     * rather than the zlib one.
+     */
+    constexpr int windowBits = 15;
+    constexpr int gzipWrapper = 16;
+
+    /**
+     * This is the amount of memory used for the compressor's
+     * internal state, on zlib's scale of 1 through 9.
+     */
+    constexpr int memoryLevel = 8;
+
+}
+
+namespace Compression {
+
+    bool Compress(
+        const std::string& input,
+        Format format,
+        std::string& output
+    ) {
+        z_stream stream;
+        stream.zalloc = Z_NULL;
+        stream.zfree = Z_NULL;
+        stream.opaque = Z_NULL;
+        if (
+            deflateInit2(
+                &stream,
+                Z_BEST_COMPRESSION,
+                Z_DEFLATED,
+                windowBits + ((format == Format::Gzip) ? gzipWrapper : 0),
+                memoryLevel,
+                Z_DEFAULT_STRATEGY
+            ) != Z_OK
+        ) {
+            return false;
+        }
+        output.resize(deflateBound(&stream, (uLong)input.size()));
+        stream.next_in = (Bytef*)input.data();
+        stream.avail_in = (uInt)input.size();
+        stream.next_out = (Bytef*)&output[0];
+        stream.avail_out = (uInt)output.size();
+        const auto result = deflate(&stream, Z_FINISH);
+        output.resize(output.size() - stream.avail_out);
+        (void)deflateEnd(&stream);
+        return (result == Z_STREAM_END);
+    }
+
+}
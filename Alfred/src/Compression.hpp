@@ -0,0 +1,53 @@
+#pragma once
+
+/**
+ * @file Compression.hpp
+ *
+ * This module declares functions used to compress data sent to clients.
+ */
+
+#include <string>
+
+namespace Compression {
+
+    /**
+     * These are the compressed formats supported.
+     */
+    enum class Format {
+        /**
+         * This is the "gzip" format
+         * ([RFC 1952](https://tools.ietf.org/html/rfc1952)).
+         */
+        Gzip,
+
+        /**
+         * This is the "zlib" format
+         * ([RFC 1950](https://tools.ietf.org/html/rfc1950)),
+         * known to HTTP as the "deflate" content coding.
+         */
+        Deflate,
+    };
+
+    /**
+     * Compress the given data in the given format.
+     *
+     * @param[in] input
+     *     This is the data to compress.
+     *
+     * @param[in] format
+     *     This is the format in which to compress the data.
+     *
+     * @param[out] output
+     *     This is where to store the compressed data.
+     *
+     * @return
+     *     An indication of whether or not the data was compressed
+     *     is returned.
+     */
+    bool Compress(
+        const std::string& input,
+        Format format,
+        std::string& output
+    );
+
+}
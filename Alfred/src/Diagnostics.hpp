@@ -0,0 +1,62 @@
+#pragma once
+
+/**
+ * @file Diagnostics.hpp
+ *
+ * This module declares functions used to publish diagnostic messages only
+ * when someone is listening for them, so that messages nobody wants cost
+ * next to nothing on hot paths.
+ */
+
+#include <stddef.h>
+#include <string>
+#include <SystemAbstractions/DiagnosticsSender.hpp>
+
+namespace Diagnostics {
+
+    /**
+     * Determine whether or not any subscriber of the given sender wants
+     * messages of the given level.
+     *
+     * @param[in] diagnosticsSender
+     *     This is the object which would publish the messages.
+     *
+     * @param[in] level
+     *     This is the level of the messages.
+     *
+     * @return
+     *     An indication of whether or not any subscriber wants
+     *     messages of the given level is returned.
+     */
+    inline bool IsLevelEnabled(
+        const SystemAbstractions::DiagnosticsSender& diagnosticsSender,
+        size_t level
+    ) {
+        return (level >= diagnosticsSender.GetMinLevel());
+    }
+
+    /**
+     * Publish a diagnostic message, made by the given function only if some
+     * subscriber wants messages of the given level.
+     *
+     * @param[in] diagnosticsSender
+     *     This is the object to use to publish the message.
+     *
+     * @param[in] level
+     *     This is the level of the message.
+     *
+     * @param[in] makeMessage
+     *     This is the function to call to make the message.  It takes no
+     *     arguments and returns the message as a std::string.
+     */
+    template< typename MakeMessage > void SendLazily(
+        const SystemAbstractions::DiagnosticsSender& diagnosticsSender,
+        size_t level,
+        MakeMessage makeMessage
+    ) {
+        if (IsLevelEnabled(diagnosticsSender, level)) {
+            diagnosticsSender.SendDiagnosticInformationString(level, makeMessage());
+        }
+    }
+
+}
@@ -0,0 +1,229 @@
+/**
+ * @file HttpCaching.cpp
+ *
+ * This module contains the implementation of functions used to deliver
+ * views of the store in the bodies of HTTP responses, compressed once per
+ * view and tagged so that clients can revalidate what they have cheaply.
+ */
+
+#include "Compression.hpp"
+#include "HttpCaching.hpp"
+
+#include <inttypes.h>
+#include <memory>
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <StringExtensions/StringExtensions.hpp>
+
+namespace {
+
+    /**
+     * This is the format name under which views of the store are encoded
+     * as the bodies of HTTP responses.
+     */
+    constexpr const char* httpBodyFormat = "HttpBody";
+
+    /**
+     * These are the format names under which compressed bodies of HTTP
+     * responses are cached alongside the uncompressed ones, so that each
+     * view is compressed at most once per content coding, no matter how
+     * many clients ask for it.
+     */
+    constexpr const char* httpBodyGzipFormat = "HttpBody+gzip";
+    constexpr const char* httpBodyDeflateFormat = "HttpBody+deflate";
+
+    /**
+     * Bodies smaller than this are sent uncompressed, since compressing
+     * them saves too little to be worth it.
+     */
+    constexpr size_t minCompressedBodySize = 256;
+
+    std::string EncodeHttpBody(const Store::View& view) {
+        return view.GetDataEncoding();
+    }
+
+    std::string CompressHttpBody(
+        const Store::View& view,
+        Compression::Format format
+    ) {
+        std::string compressed;
+        const auto body = view.GetEncoding(httpBodyFormat, EncodeHttpBody);
+        if (
+            (body->size() < minCompressedBodySize)
+            || !Compression::Compress(*body, format, compressed)
+            || (compressed.size() >= body->size())
+        ) {
+            // An empty encoding tells SetBody to send
+            // the body uncompressed.
+            compressed.clear();
+        }
+        return compressed;
+    }
+
+    std::string EncodeHttpBodyGzip(const Store::View& view) {
+        return CompressHttpBody(view, Compression::Format::Gzip);
+    }
+
+    std::string EncodeHttpBodyDeflate(const Store::View& view) {
+        return CompressHttpBody(view, Compression::Format::Deflate);
+    }
+
+    /**
+     * Return the quality value the client gave the given content coding
+     * in the "Accept-Encoding" header of the given request.
+     *
+     * @param[in] request
+     *     This is the request to check.
+     *
+     * @param[in] coding
+     *     This is the name of the content coding to look up.
+     *
+     * @return
+     *     The quality value the client gave the content coding is
+     *     returned.  This is zero if the client doesn't accept it.
+     */
+    double GetCodingQuality(
+        const Http::Request& request,
+        const std::string& coding
+    ) {
+        double quality = 0.0;
+        for (const auto& token: request.headers.GetHeaderTokens("Accept-Encoding")) {
+            const auto parameters = StringExtensions::Split(token, ';');
+            if (parameters.empty()) {
+                continue;
+            }
+            const auto name = StringExtensions::ToLower(StringExtensions::Trim(parameters[0]));
+            if (
+                (name != coding)
+                && (name != "*")
+            ) {
+                continue;
+            }
+            double tokenQuality = 1.0;
+            for (size_t i = 1; i < parameters.size(); ++i) {
+                const auto parameter = StringExtensions::Trim(parameters[i]);
+                if (parameter.substr(0, 2) == "q=") {
+                    tokenQuality = strtod(parameter.c_str() + 2, nullptr);
+                }
+            }
+            if (name == coding) {
+                // An exact match overrides any wildcard.
+                return tokenQuality;
+            }
+            quality = tokenQuality;
+        }
+        return quality;
+    }
+
+}
+
+namespace HttpCaching {
+
+    std::string MakeRunTag() {
+        std::random_device randomDevice;
+        const auto tag = (
+            ((uint64_t)randomDevice() << 32)
+            | (uint64_t)randomDevice()
+        );
+        char buffer[17];
+        (void)snprintf(buffer, sizeof(buffer), "%016" PRIx64, tag);
+        return std::string(buffer);
+    }
+
+    const char* SetBody(
+        const Http::Request& request,
+        const Store::View& view,
+        Http::Response& response
+    ) {
+        if (request.headers.HasHeader("Accept-Encoding")) {
+            const auto gzipQuality = GetCodingQuality(request, "gzip");
+            const auto deflateQuality = GetCodingQuality(request, "deflate");
+            const char* coding = nullptr;
+            std::shared_ptr< const std::string > compressed;
+            if (
+                (gzipQuality > 0.0)
+                && (gzipQuality >= deflateQuality)
+            ) {
+                coding = "gzip";
+                compressed = view.GetEncoding(httpBodyGzipFormat, EncodeHttpBodyGzip);
+            } else if (deflateQuality > 0.0) {
+                coding = "deflate";
+                compressed = view.GetEncoding(httpBodyDeflateFormat, EncodeHttpBodyDeflate);
+            }
+            if (
+                (compressed != nullptr)
+                && !compressed->empty()
+            ) {
+                response.headers.SetHeader("Content-Encoding", coding);
+                response.body = *compressed;
+                return coding;
+            }
+        }
+        response.body = *view.GetEncoding(httpBodyFormat, EncodeHttpBody);
+        return nullptr;
+    }
+
+    std::string MakeEntityTag(
+        const Store::View& view,
+        const std::string& runTag,
+        const char* coding
+    ) {
+        auto entityTag = "\"" + runTag + "-" + std::to_string(view.GetRevision());
+        if (coding != nullptr) {
+            entityTag += '-';
+            entityTag += coding;
+        }
+        return entityTag + "\"";
+    }
+
+    bool ClientHasEntity(
+        const Http::Request& request,
+        const std::string& entityTag
+    ) {
+        if (!request.headers.HasHeader("If-None-Match")) {
+            return false;
+        }
+        for (auto token: request.headers.GetHeaderTokens("If-None-Match")) {
+            // Comparison for "If-None-Match" is weak, so ignore any
+            // weakness indicator on the tags sent by the client.
+            if (token.substr(0, 2) == "W/") {
+                token = token.substr(2);
+            }
+            if (
+                (token == "*")
+                || (token == entityTag)
+            ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool RespondWithView(
+        const Http::Request& request,
+        const Store::View& view,
+        const std::string& runTag,
+        Http::Response& response
+    ) {
+        // The body is chosen even for a revalidation, since the entity tag
+        // depends on its content coding, but every encoding of the view is
+        // made only once anyway.
+        const auto coding = SetBody(request, view, response);
+        const auto entityTag = MakeEntityTag(view, runTag, coding);
+        response.headers.SetHeader("ETag", entityTag);
+        response.headers.SetHeader("Cache-Control", "no-cache");
+        response.headers.SetHeader("Vary", "Accept-Encoding");
+        if (!ClientHasEntity(request, entityTag)) {
+            return false;
+        }
+        response.statusCode = 304;
+        response.reasonPhrase = "Not Modified";
+        response.headers.RemoveHeader("Content-Encoding");
+        response.body.clear();
+        return true;
+    }
+
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+/**
+ * @file HttpCaching.hpp
+ *
+ * This module declares functions used to deliver views of the store in
+ * the bodies of HTTP responses, compressed once per view and tagged so
+ * that clients can revalidate what they have cheaply.
+ */
+
+#include "Store.hpp"
+
+#include <Http/Server.hpp>
+#include <string>
+
+namespace HttpCaching {
+
+    /**
+     * Make a new tag to distinguish one run of the service from any other,
+     * so that entity tags made from store revisions (which start over
+     * every run) never match those handed out by an earlier run.
+     *
+     * @return
+     *     A new, randomly chosen run tag is returned.
+     */
+    std::string MakeRunTag();
+
+    /**
+     * Set the body of the given response to the encoding of the given view,
+     * compressed in whichever content coding the client prefers, if any.
+     *
+     * @param[in] request
+     *     This is the request being answered.
+     *
+     * @param[in] view
+     *     This is the view of the store to send.
+     *
+     * @param[in,out] response
+     *     This is the response to fill in.
+     *
+     * @return
+     *     The name of the content coding in which the body was compressed
+     *     is returned, or nullptr if it wasn't compressed.
+     */
+    const char* SetBody(
+        const Http::Request& request,
+        const Store::View& view,
+        Http::Response& response
+    );
+
+    /**
+     * Return the entity tag
+     * ([RFC 7232](https://tools.ietf.org/html/rfc7232)) for
+     * the given view of the store, in the given content coding.  Each
+     * content coding is a different representation, so it gets a
+     * different tag.
+     *
+     * @param[in] view
+     *     This is the view for which to make the entity tag.
+     *
+     * @param[in] runTag
+     *     This is the tag of the run of the service making the entity tag.
+     *
+     * @param[in] coding
+     *     This is the name of the content coding in which the view is
+     *     compressed, or nullptr if it isn't compressed.
+     *
+     * @return
+     *     The entity tag for the given view is returned.
+     */
+    std::string MakeEntityTag(
+        const Store::View& view,
+        const std::string& runTag,
+        const char* coding
+    );
+
+    /**
+     * Determine whether or not the given request has an "If-None-Match"
+     * header matching the given entity tag, meaning the client already
+     * has the representation identified by the tag.
+     *
+     * @param[in] request
+     *     This is the request to check.
+     *
+     * @param[in] entityTag
+     *     This is the entity tag of the current representation.
+     *
+     * @return
+     *     An indication of whether or not the client already has the
+     *     current representation is returned.
+     */
+    bool ClientHasEntity(
+        const Http::Request& request,
+        const std::string& entityTag
+    );
+
+    /**
+     * Fill in the given response to deliver the given view of the store,
+     * with an entity tag identifying it, or tell the client it already
+     * has it, if the request says so.
+     *
+     * @param[in] request
+     *     This is the request being answered.
+     *
+     * @param[in] view
+     *     This is the view of the store to deliver.
+     *
+     * @param[in] runTag
+     *     This is the tag of the run of the service delivering the view.
+     *
+     * @param[in,out] response
+     *     This is the response to fill in.
+     *
+     * @return
+     *     An indication of whether or not the client already has the
+     *     view is returned.
+     */
+    bool RespondWithView(
+        const Http::Request& request,
+        const Store::View& view,
+        const std::string& runTag,
+        Http::Response& response
+    );
+
+}
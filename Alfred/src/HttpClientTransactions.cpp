@@ -6,10 +6,14 @@
  * transactions.
  */
 
+#include "Diagnostics.hpp"
 #include "HttpClientTransactions.hpp"
 
+#include <chrono>
+#include <inttypes.h>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 
 /**
@@ -22,8 +26,11 @@ struct HttpClientTransactions::Impl
 
     SystemAbstractions::DiagnosticsSender diagnosticsSender;
     std::shared_ptr< Http::Client > httpClient;
+    std::shared_ptr< Metrics::Histogram > metricsCompletionTime;
+    std::shared_ptr< Metrics::Gauge > metricsInProgress;
     std::mutex mutex;
     int nextTransactionId = 1;
+    std::unordered_map< std::string, ServerStatistics > statistics;
     std::unordered_set< std::shared_ptr< Http::IClient::Transaction > > transactions;
 
     // Constructor
@@ -31,21 +38,50 @@ struct HttpClientTransactions::Impl
     Impl()
         : diagnosticsSender("HttpClientTransactions")
     {
+        // Until mobilized, keep metrics nobody will see.
+        Metrics unpublishedMetrics;
+        SetUpMetrics(unpublishedMetrics);
+    }
+
+    // Methods
+
+    void SetUpMetrics(Metrics& metrics) {
+        metricsCompletionTime = metrics.GetHistogram(
+            "alfred_http_client_request_seconds",
+            "Time taken to complete requests made of other servers",
+            Metrics::MakeDurationBounds()
+        );
+        metricsInProgress = metrics.GetGauge(
+            "alfred_http_client_requests_in_progress",
+            "Requests made of other servers not yet completed"
+        );
     }
 
     void OnCompletion(
         int id,
+        const std::string& serverName,
+        std::chrono::steady_clock::time_point startTime,
         const std::shared_ptr< Http::IClient::Transaction >& transaction,
         CompletionDelegate completionDelegate
     ) {
-        std::unique_lock< decltype(mutex) > lock(mutex);
-        diagnosticsSender.SendDiagnosticInformationFormatted(
-            0,
-            "%d reply: %u (%s)",
-            id,
-            transaction->response.statusCode,
-            transaction->response.reasonPhrase.c_str()
+        metricsInProgress->Add(-1);
+        metricsCompletionTime->Observe(
+            std::chrono::duration< double >(std::chrono::steady_clock::now() - startTime).count()
         );
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        auto& serverStatistics = statistics[serverName];
+        if (serverStatistics.requestsInProgress > 0) {
+            --serverStatistics.requestsInProgress;
+        }
+        if (Diagnostics::IsLevelEnabled(diagnosticsSender, 0)) {
+            diagnosticsSender.SendDiagnosticInformationFormatted(
+                0,
+                "%d reply: %u (%s)",
+                id,
+                transaction->response.statusCode,
+                transaction->response.reasonPhrase.c_str()
+            );
+        }
         auto response = std::move(transaction->response);
         (void)transactions.erase(transaction);
         lock.unlock();
@@ -71,6 +107,29 @@ void HttpClientTransactions::Demobilize() {
     impl_->transactions.clear();
 }
 
+auto HttpClientTransactions::GetStatistics() -> std::unordered_map< std::string, ServerStatistics > {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->statistics;
+}
+
+void HttpClientTransactions::OnConnectionOpened(
+    const std::string& scheme,
+    const std::string& serverName
+) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    auto& serverStatistics = impl_->statistics[serverName];
+    ++serverStatistics.connectionsOpened;
+    impl_->diagnosticsSender.SendDiagnosticInformationFormatted(
+        1,
+        "Opened %s connection %zu to %s (%zu requests made, %zu in progress)",
+        scheme.c_str(),
+        serverStatistics.connectionsOpened,
+        serverName.c_str(),
+        serverStatistics.requests,
+        serverStatistics.requestsInProgress
+    );
+}
+
 SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate HttpClientTransactions::SubscribeToDiagnostics(
     SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
     size_t minLevel
@@ -79,14 +138,17 @@ SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate HttpClientTransaction
 }
 
 void HttpClientTransactions::Mobilize(
-    const std::shared_ptr< Http::Client >& httpClient
+    const std::shared_ptr< Http::Client >& httpClient,
+    const std::shared_ptr< Metrics >& metrics
 ) {
+    impl_->SetUpMetrics(*metrics);
     impl_->httpClient = httpClient;
 }
 
 void HttpClientTransactions::Post(
     Http::Request& request,
-    CompletionDelegate completionDelegate
+    CompletionDelegate completionDelegate,
+    UpgradeDelegate upgradeDelegate
 ) {
     std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
     if (!request.target.HasPort()) {
@@ -99,13 +161,22 @@ void HttpClientTransactions::Post(
         }
     }
     const auto id = impl_->nextTransactionId++;
-    impl_->diagnosticsSender.SendDiagnosticInformationFormatted(
+    const auto serverName = request.target.GetHost();
+    auto& serverStatistics = impl_->statistics[serverName];
+    ++serverStatistics.requests;
+    ++serverStatistics.requestsInProgress;
+    impl_->metricsInProgress->Add(1);
+    const auto startTime = std::chrono::steady_clock::now();
+    Diagnostics::SendLazily(
+        impl_->diagnosticsSender,
         0,
-        "%d request: %s",
-        id,
-        request.target.GenerateString().c_str()
+        [id, &request]{
+            return std::to_string(id) + " request: " + request.target.GenerateString();
+        }
     );
-    auto transaction = impl_->httpClient->Request(request);
+    // Ask for the connection to be kept open afterwards, so that later
+    // requests of the same server skip connecting and the TLS handshake.
+    auto transaction = impl_->httpClient->Request(request, true, upgradeDelegate);
     (void)impl_->transactions.insert(transaction);
     std::weak_ptr< Http::IClient::Transaction > transactionWeak(transaction);
     std::weak_ptr< Impl > implWeak(impl_);
@@ -114,6 +185,8 @@ void HttpClientTransactions::Post(
             completionDelegate,
             id,
             implWeak,
+            serverName,
+            startTime,
             transactionWeak
         ]{
             auto impl = implWeak.lock();
@@ -122,6 +195,12 @@ void HttpClientTransactions::Post(
             }
             auto transaction = transactionWeak.lock();
             if (transaction == nullptr) {
+                impl->metricsInProgress->Add(-1);
+                std::lock_guard< decltype(impl->mutex) > lock(impl->mutex);
+                auto& serverStatistics = impl->statistics[serverName];
+                if (serverStatistics.requestsInProgress > 0) {
+                    --serverStatistics.requestsInProgress;
+                }
                 impl->diagnosticsSender.SendDiagnosticInformationFormatted(
                     SystemAbstractions::DiagnosticsSender::Levels::WARNING,
                     "%d abandoned",
@@ -129,7 +208,7 @@ void HttpClientTransactions::Post(
                 );
                 return;
             }
-            impl->OnCompletion(id, transaction, completionDelegate);
+            impl->OnCompletion(id, serverName, startTime, transaction, completionDelegate);
         }
     );
 }
@@ -7,15 +7,50 @@
  * Http::Client object to create and complete request-response transactions.
  */
 
+#include "Metrics.hpp"
+
 #include <Http/Client.hpp>
 #include <memory>
+#include <stddef.h>
+#include <string>
 #include <SystemAbstractions/DiagnosticsSender.hpp>
+#include <unordered_map>
 
 class HttpClientTransactions {
     // Types
 public:
     using CompletionDelegate = std::function< void(Http::Response& response) >;
 
+    /**
+     * This is the type of function called if the server agrees to
+     * upgrade the connection to some other protocol (such as WebSocket),
+     * handing over the connection.
+     */
+    using UpgradeDelegate = Http::IClient::UpgradeDelegate;
+
+    /**
+     * These are statistics about the use of the connections made
+     * to one server.  Requests are sent over persistent connections,
+     * so normally many more requests are made than connections.
+     */
+    struct ServerStatistics {
+        /**
+         * This is the number of connections opened to the server.
+         */
+        size_t connectionsOpened = 0;
+
+        /**
+         * This is the number of requests made of the server.
+         */
+        size_t requests = 0;
+
+        /**
+         * This is the number of requests made of the server
+         * still awaiting responses.
+         */
+        size_t requestsInProgress = 0;
+    };
+
     // Lifecycle
 public:
     ~HttpClientTransactions() noexcept;
@@ -32,6 +67,34 @@ public:
 public:
     void Demobilize();
 
+    /**
+     * Return statistics about the use of the connections made to each
+     * server of which requests have been made.
+     *
+     * @return
+     *     Statistics about the use of the connections made to each server,
+     *     keyed by server name, are returned.
+     */
+    std::unordered_map< std::string, ServerStatistics > GetStatistics();
+
+    /**
+     * This should be called whenever a new connection is opened
+     * on behalf of the Http::Client used by the instance, in order
+     * to track how well connections are being reused.
+     *
+     * @param[in] scheme
+     *     This is the scheme of the URI of the request which
+     *     needed the connection.
+     *
+     * @param[in] serverName
+     *     This is the name of the server to which
+     *     the connection is made.
+     */
+    void OnConnectionOpened(
+        const std::string& scheme,
+        const std::string& serverName
+    );
+
     /**
      * This method forms a new subscription to diagnostic
      * messages published by the class.
@@ -53,13 +116,39 @@ public:
         size_t minLevel = 0
     );
 
+    /**
+     * Begin making transactions using the given client.
+     *
+     * @param[in] httpClient
+     *     This is the client to use to make requests.
+     *
+     * @param[in] metrics
+     *     This is where to keep the metrics measuring the transactions.
+     */
     void Mobilize(
-        const std::shared_ptr< Http::Client >& httpClient
+        const std::shared_ptr< Http::Client >& httpClient,
+        const std::shared_ptr< Metrics >& metrics
     );
 
+    /**
+     * Make the given request, and call the given function once the
+     * transaction is complete.
+     *
+     * @param[in,out] request
+     *     This is the request to make.  The port of its target is filled
+     *     in if it was left out.
+     *
+     * @param[in] completionDelegate
+     *     This is the function to call with the response.
+     *
+     * @param[in] upgradeDelegate
+     *     If not null, this is the function to call if the server
+     *     agrees to upgrade the connection to another protocol.
+     */
     void Post(
         Http::Request& request,
-        CompletionDelegate completionDelegate
+        CompletionDelegate completionDelegate,
+        UpgradeDelegate upgradeDelegate = nullptr
     );
 
     // Private properties
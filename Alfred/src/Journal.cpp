@@ -0,0 +1,456 @@
+/**
+ * @file Journal.cpp
+ *
+ * This module contains the implementation of the Journal class.
+ */
+
+#include "Journal.hpp"
+#include "SaveFile.hpp"
+
+#include <mutex>
+#include <stdio.h>
+
+namespace {
+
+    /**
+     * Read the whole of the file with the given path.  A file which
+     * doesn't exist is considered empty.
+     *
+     * @param[in] filePath
+     *     This is the path of the file to read.
+     *
+     * @param[out] contents
+     *     This is where to store the contents of the file.
+     *
+     * @return
+     *     An indication of whether or not the file was read
+     *     (or doesn't exist) is returned.
+     */
+    bool ReadFile(
+        const std::string& filePath,
+        std::string& contents
+    ) {
+        contents.clear();
+        const auto file = fopen(filePath.c_str(), "rb");
+        if (file == NULL) {
+            return true;
+        }
+        char buffer[65536];
+        for (;;) {
+            const auto amountRead = fread(buffer, 1, sizeof(buffer), file);
+            (void)contents.append(buffer, amountRead);
+            if (amountRead < sizeof(buffer)) {
+                break;
+            }
+        }
+        const auto ok = (ferror(file) == 0);
+        (void)fclose(file);
+        return ok;
+    }
+
+    /**
+     * Split the given journal contents into records, leaving out
+     * any empty lines.
+     *
+     * @param[in] contents
+     *     This is the contents of a journal.
+     *
+     * @param[in,out] records
+     *     This is where to add the records found.
+     */
+    void SplitRecords(
+        const std::string& contents,
+        std::vector< std::string >& records
+    ) {
+        size_t start = 0;
+        while (start < contents.length()) {
+            auto end = contents.find('\n', start);
+            if (end == std::string::npos) {
+                end = contents.length();
+            }
+            if (end > start) {
+                records.push_back(contents.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+    }
+
+}
+
+/**
+ * This contains the private properties of a Journal instance.
+ */
+struct Journal::Impl {
+    // Types
+
+    /**
+     * This is something queued to be done to the journal file.
+     */
+    struct Entry {
+        /**
+         * This identifies the entry.  Tickets are handed out in order.
+         */
+        uint64_t ticket = 0;
+
+        /**
+         * This indicates whether the entry is a rotation of the journal,
+         * rather than a record to append.
+         */
+        bool rotation = false;
+
+        /**
+         * This is the record to append.
+         */
+        std::string record;
+    };
+
+    // Properties
+
+    SystemAbstractions::DiagnosticsSender diagnosticsSender;
+
+    /**
+     * This indicates whether records are no longer being written, because
+     * one couldn't be stored, and the journal hasn't been rotated since.
+     */
+    bool broken = false;
+
+    /**
+     * This is the ticket of the first record which couldn't be stored,
+     * the last time any couldn't, or zero if there has been none.
+     */
+    uint64_t failedFrom = 0;
+
+    /**
+     * If the journal is no longer broken, this is the ticket of the last
+     * record which couldn't be stored, the last time any couldn't.
+     */
+    uint64_t failedThrough = 0;
+
+    FILE* file = NULL;
+
+    /**
+     * This is held while doing anything to the journal file.
+     */
+    std::mutex fileMutex;
+
+    std::string filePath;
+
+    /**
+     * This is the ticket of the last rotation carried out successfully.
+     */
+    uint64_t lastRotation = 0;
+
+    uint64_t nextTicket = 1;
+
+    /**
+     * These are the entries queued to be carried out, oldest first.
+     */
+    std::vector< Entry > queue;
+
+    /**
+     * This is held while using the queue.  It's never held while doing
+     * anything to the journal file, so queuing never waits for storage.
+     * If both this and the file mutex are held, the file mutex must be
+     * locked first.
+     */
+    std::mutex queueMutex;
+
+    std::string rotatedFilePath;
+
+    /**
+     * This is the ticket of the last entry carried out.
+     */
+    uint64_t writtenThrough = 0;
+
+    // Constructor
+
+    Impl()
+        : diagnosticsSender("Journal")
+    {
+    }
+
+    // Methods
+
+    void Close() {
+        if (file != NULL) {
+            (void)fclose(file);
+            file = NULL;
+        }
+    }
+
+    /**
+     * Determine whether or not the record with the given ticket
+     * couldn't be stored.  The file mutex must be held.
+     *
+     * @param[in] ticket
+     *     This identifies the record.
+     *
+     * @return
+     *     An indication of whether or not the record with the given
+     *     ticket couldn't be stored is returned.
+     */
+    bool IsFailed(uint64_t ticket) const {
+        return (
+            (failedFrom != 0)
+            && (ticket >= failedFrom)
+            && (
+                broken
+                || (ticket <= failedThrough)
+            )
+        );
+    }
+
+    bool OpenForAppend() {
+        file = fopen(filePath.c_str(), "ab");
+        if (file == NULL) {
+            diagnosticsSender.SendDiagnosticInformationFormatted(
+                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                "Unable to open journal file '%s' for writing",
+                filePath.c_str()
+            );
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Carry out every entry queued so far, in order, flushing the records
+     * appended to storage together.  The file mutex must be held.
+     */
+    void Flush() {
+        std::vector< Entry > entries;
+        {
+            std::lock_guard< decltype(queueMutex) > lock(queueMutex);
+            entries.swap(queue);
+        }
+        if (entries.empty()) {
+            return;
+        }
+        std::string lines;
+        uint64_t linesTicket = 0;
+        for (const auto& entry: entries) {
+            if (entry.rotation) {
+                WriteLines(lines, linesTicket);
+                lines.clear();
+                if (RotateFile()) {
+                    lastRotation = entry.ticket;
+                    if (broken) {
+                        // Every change not stored is in the new snapshot,
+                        // so it's safe to start writing records again.
+                        broken = false;
+                        failedThrough = entry.ticket;
+                    }
+                }
+            } else if (!broken) {
+                if (lines.empty()) {
+                    linesTicket = entry.ticket;
+                }
+                lines += entry.record;
+                lines += '\n';
+            }
+        }
+        WriteLines(lines, linesTicket);
+        writtenThrough = entries.back().ticket;
+    }
+
+    /**
+     * Move all the records in the journal file to the rotated journal
+     * file, and open a fresh journal file.  The file mutex must be held.
+     *
+     * @return
+     *     An indication of whether or not the journal was rotated
+     *     is returned.
+     */
+    bool RotateFile() {
+        Close();
+        const auto rotatedFile = fopen(rotatedFilePath.c_str(), "rb");
+        if (rotatedFile == NULL) {
+            if (rename(filePath.c_str(), rotatedFilePath.c_str()) != 0) {
+                (void)OpenForAppend();
+                return false;
+            }
+        } else {
+            // The last snapshot wasn't written, so its records are still
+            // needed.  Tack these records on to them.
+            (void)fclose(rotatedFile);
+            std::string contents;
+            auto ok = ReadFile(filePath, contents);
+            if (ok) {
+                const auto appendFile = fopen(rotatedFilePath.c_str(), "ab");
+                ok = (appendFile != NULL);
+                if (ok) {
+                    contents.insert(contents.begin(), '\n');
+                    ok = (
+                        (fwrite(contents.data(), 1, contents.length(), appendFile) == contents.length())
+                        && FlushFile(appendFile)
+                    );
+                    ok = ((fclose(appendFile) == 0) && ok);
+                }
+            }
+            if (
+                !ok
+                || (remove(filePath.c_str()) != 0)
+            ) {
+                diagnosticsSender.SendDiagnosticInformationFormatted(
+                    SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                    "Unable to rotate journal file '%s'",
+                    filePath.c_str()
+                );
+                (void)OpenForAppend();
+                return false;
+            }
+        }
+        if (!OpenForAppend()) {
+            return false;
+        }
+
+        // Make sure the renaming or removal of the old journal file, and
+        // the creation of the new one, are stored before anyone relies on
+        // the rotated journal file being complete.
+        if (!FlushDirectory(filePath)) {
+            diagnosticsSender.SendDiagnosticInformationFormatted(
+                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                "Unable to flush directory of journal file '%s'",
+                filePath.c_str()
+            );
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Write the given records to the journal file, and flush them to
+     * storage.  If they can't be stored, stop writing records until
+     * the journal is next rotated.  The file mutex must be held.
+     *
+     * @param[in] lines
+     *     These are the records to write, each terminated by a line break.
+     *
+     * @param[in] ticket
+     *     This is the ticket of the first record.
+     */
+    void WriteLines(
+        const std::string& lines,
+        uint64_t ticket
+    ) {
+        if (lines.empty()) {
+            return;
+        }
+        if (
+            (file == NULL)
+            || (fwrite(lines.data(), 1, lines.length(), file) != lines.length())
+            || !FlushFile(file)
+        ) {
+            diagnosticsSender.SendDiagnosticInformationFormatted(
+                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                "Unable to write journal file '%s'",
+                filePath.c_str()
+            );
+            broken = true;
+            failedFrom = ticket;
+        }
+    }
+};
+
+Journal::~Journal() noexcept {
+    Close();
+}
+
+Journal::Journal(Journal&&) noexcept = default;
+Journal& Journal::operator=(Journal&&) noexcept = default;
+
+Journal::Journal()
+    : impl_(new Impl())
+{
+}
+
+uint64_t Journal::Append(const std::string& record) {
+    std::lock_guard< decltype(impl_->queueMutex) > lock(impl_->queueMutex);
+    Impl::Entry entry;
+    entry.ticket = impl_->nextTicket++;
+    entry.record = record;
+    impl_->queue.push_back(std::move(entry));
+    return impl_->queue.back().ticket;
+}
+
+void Journal::Close() {
+    std::lock_guard< decltype(impl_->fileMutex) > lock(impl_->fileMutex);
+    impl_->Flush();
+    impl_->Close();
+}
+
+bool Journal::Commit(uint64_t ticket) {
+    std::lock_guard< decltype(impl_->fileMutex) > lock(impl_->fileMutex);
+    if (impl_->writtenThrough < ticket) {
+        impl_->Flush();
+    }
+    return !impl_->IsFailed(ticket);
+}
+
+void Journal::DiscardRotated(uint64_t rotation) {
+    std::lock_guard< decltype(impl_->fileMutex) > lock(impl_->fileMutex);
+    impl_->Flush();
+    if (impl_->lastRotation == rotation) {
+        (void)remove(impl_->rotatedFilePath.c_str());
+    }
+}
+
+bool Journal::Open(
+    const std::string& snapshotFilePath,
+    std::vector< std::string >& records
+) {
+    std::lock_guard< decltype(impl_->fileMutex) > lock(impl_->fileMutex);
+    impl_->Close();
+    {
+        std::lock_guard< decltype(impl_->queueMutex) > queueLock(impl_->queueMutex);
+        impl_->queue.clear();
+        impl_->writtenThrough = impl_->nextTicket - 1;
+    }
+    impl_->broken = false;
+    impl_->failedFrom = 0;
+    impl_->filePath = snapshotFilePath + ".journal";
+    impl_->rotatedFilePath = impl_->filePath + ".old";
+    records.clear();
+    std::string rotatedContents, contents;
+    if (
+        !ReadFile(impl_->rotatedFilePath, rotatedContents)
+        || !ReadFile(impl_->filePath, contents)
+    ) {
+        impl_->diagnosticsSender.SendDiagnosticInformationFormatted(
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "Unable to read journal file '%s'",
+            impl_->filePath.c_str()
+        );
+        return false;
+    }
+    SplitRecords(rotatedContents, records);
+    SplitRecords(contents, records);
+    if (!impl_->OpenForAppend()) {
+        return false;
+    }
+    if (
+        !contents.empty()
+        && (contents.back() != '\n')
+    ) {
+        // The last record was torn by a crash.  Terminate it so that
+        // it doesn't swallow the next record appended.
+        (void)fputc('\n', impl_->file);
+    }
+    return true;
+}
+
+uint64_t Journal::Rotate() {
+    std::lock_guard< decltype(impl_->queueMutex) > lock(impl_->queueMutex);
+    Impl::Entry entry;
+    entry.ticket = impl_->nextTicket++;
+    entry.rotation = true;
+    impl_->queue.push_back(std::move(entry));
+    return impl_->queue.back().ticket;
+}
+
+SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate Journal::SubscribeToDiagnostics(
+    SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+    size_t minLevel
+) {
+    return impl_->diagnosticsSender.SubscribeToDiagnostics(delegate, minLevel);
+}
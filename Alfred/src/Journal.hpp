@@ -0,0 +1,164 @@
+#pragma once
+
+/**
+ * @file Journal.hpp
+ *
+ * This module declares the Journal class.
+ */
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <SystemAbstractions/DiagnosticsSender.hpp>
+#include <vector>
+
+/**
+ * This manages the write-ahead journal kept beside a file holding a
+ * snapshot of some data.  Each change made to the data is recorded as one
+ * line appended to the journal and flushed to storage, before the change
+ * is acknowledged.  Replaying the journal on top of the last snapshot
+ * recovers every change made since.
+ *
+ * Appending a record only queues it, so that it can be done while the
+ * data is locked.  Committing writes every record queued so far and
+ * flushes them to storage together, so callers committing at the same
+ * time share one flush (a "group commit").  Commit is meant to be called
+ * without the data locked.
+ *
+ * When a new snapshot is taken, the journal is rotated, so that records
+ * made after the snapshot go into a fresh journal.  The rotated journal is
+ * kept until the new snapshot is safely written.
+ *
+ * If a record can't be stored, no more records are written until the
+ * next rotation, so that the journal always holds an unbroken sequence
+ * of changes.
+ */
+class Journal {
+    // Lifecycle
+public:
+    ~Journal() noexcept;
+    Journal(const Journal&) = delete;
+    Journal(Journal&&) noexcept;
+    Journal& operator=(const Journal&) = delete;
+    Journal& operator=(Journal&&) noexcept;
+
+    // Constructor
+public:
+    Journal();
+
+    // Methods
+public:
+    /**
+     * Queue a record to be appended to the journal.  The record isn't
+     * written until the journal is committed.
+     *
+     * @param[in] record
+     *     This is the record to append.  It must not contain
+     *     any line breaks.
+     *
+     * @return
+     *     A ticket identifying the record is returned.  This can be given
+     *     to Commit to wait for the record to be stored.
+     */
+    uint64_t Append(const std::string& record);
+
+    /**
+     * Close the journal, after writing any records still queued.
+     */
+    void Close();
+
+    /**
+     * Write every record queued so far, if the one with the given ticket
+     * hasn't already been written, and flush them to storage.  If another
+     * thread is already doing this, wait for it to finish first, since it
+     * may have stored the record already.
+     *
+     * @param[in] ticket
+     *     This identifies the record which needs to be stored.
+     *
+     * @return
+     *     An indication of whether or not the record was
+     *     safely stored is returned.
+     */
+    bool Commit(uint64_t ticket);
+
+    /**
+     * Delete the rotated journal, once the snapshot including all of its
+     * records has been safely written.  The rotated journal is kept if
+     * the journal has been rotated again since the given rotation, because
+     * then it also holds records the snapshot doesn't include.
+     *
+     * @param[in] rotation
+     *     This is the ticket returned by Rotate when the snapshot
+     *     was taken.
+     */
+    void DiscardRotated(uint64_t rotation);
+
+    /**
+     * Open the journal kept beside the given snapshot file, and return
+     * all the records found in it (and any rotated journal not yet
+     * discarded), oldest first.
+     *
+     * @param[in] snapshotFilePath
+     *     This is the path of the file holding the snapshot.
+     *
+     * @param[out] records
+     *     This is where to store the records found in the journal.
+     *
+     * @return
+     *     An indication of whether or not the journal was opened
+     *     is returned.
+     */
+    bool Open(
+        const std::string& snapshotFilePath,
+        std::vector< std::string >& records
+    );
+
+    /**
+     * Queue moving all the records in the journal to the rotated journal,
+     * leaving the journal empty.  This is done when a snapshot is taken.
+     * Records already queued go to the rotated journal, and records
+     * appended afterwards go to the fresh one.  Like records, the rotation
+     * itself is carried out when the journal is next committed.
+     *
+     * @return
+     *     A ticket identifying the rotation is returned.  This can be
+     *     given to DiscardRotated once the snapshot is written.
+     */
+    uint64_t Rotate();
+
+    /**
+     * This method forms a new subscription to diagnostic
+     * messages published by the class.
+     *
+     * @param[in] delegate
+     *     This is the function to call to deliver messages
+     *     to the subscriber.
+     *
+     * @param[in] minLevel
+     *     This is the minimum level of message that this subscriber
+     *     desires to receive.
+     *
+     * @return
+     *     A function is returned which may be called
+     *     to terminate the subscription.
+     */
+    SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate SubscribeToDiagnostics(
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+        size_t minLevel = 0
+    );
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::shared_ptr< Impl > impl_;
+};
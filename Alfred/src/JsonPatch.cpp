@@ -0,0 +1,129 @@
+/**
+ * @file JsonPatch.cpp
+ *
+ * This module contains the implementation of functions used to build JSON
+ * Patch and JSON Merge Patch documents.
+ */
+
+#include "JsonPatch.hpp"
+
+namespace {
+
+    bool ContainsNull(const Json::Value& value) {
+        switch (value.GetType()) {
+            case Json::Value::Type::Null: return true;
+
+            case Json::Value::Type::Array: {
+                const auto size = value.GetSize();
+                for (size_t i = 0; i < size; ++i) {
+                    if (ContainsNull(value[i])) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            case Json::Value::Type::Object: {
+                for (const auto entry: value) {
+                    if (ContainsNull(entry.value())) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            default: return false;
+        }
+    }
+
+}
+
+namespace JsonPatch {
+
+    std::string MakePointer(const std::vector< std::string >& segments) {
+        std::string pointer;
+        for (const auto& segment: segments) {
+            pointer += '/';
+            for (const auto c: segment) {
+                switch (c) {
+                    case '~': pointer += "~0"; break;
+                    case '/': pointer += "~1"; break;
+                    default: pointer += c; break;
+                }
+            }
+        }
+        return pointer;
+    }
+
+    Json::Value MakeOperation(
+        const std::string& op,
+        const std::vector< std::string >& segments,
+        const Json::Value& value
+    ) {
+        auto operation = Json::Object({
+            {"op", op},
+            {"path", MakePointer(segments)},
+        });
+        if (value.GetType() != Json::Value::Type::Invalid) {
+            operation["value"] = value;
+        }
+        return operation;
+    }
+
+    Json::Value MakeNestedMergePatch(
+        const std::vector< std::string >& segments,
+        Json::Value&& patch
+    ) {
+        for (auto segment = segments.rbegin(); segment != segments.rend(); ++segment) {
+            auto parent = Json::Object({});
+            parent[*segment] = std::move(patch);
+            patch = std::move(parent);
+        }
+        return std::move(patch);
+    }
+
+    bool MakeMergePatch(
+        const Json::Value& oldValue,
+        const Json::Value& newValue,
+        Json::Value& patch
+    ) {
+        if (
+            (oldValue.GetType() != Json::Value::Type::Object)
+            || (newValue.GetType() != Json::Value::Type::Object)
+        ) {
+            if (ContainsNull(newValue)) {
+                return false;
+            }
+            patch = newValue;
+            return true;
+        }
+        patch = Json::Object({});
+        for (const auto entry: oldValue) {
+            if (!newValue.Has(entry.key())) {
+                patch[entry.key()] = nullptr;
+            }
+        }
+        for (const auto entry: newValue) {
+            const auto& key = entry.key();
+            const auto& value = entry.value();
+            if (oldValue.Has(key)) {
+                const auto& previousValue = oldValue[key];
+                if (previousValue == value) {
+                    continue;
+                }
+                Json::Value childPatch;
+                if (!MakeMergePatch(previousValue, value, childPatch)) {
+                    return false;
+                }
+                patch[key] = std::move(childPatch);
+            } else {
+                if (ContainsNull(value)) {
+                    return false;
+                }
+                patch[key] = value;
+            }
+        }
+        return true;
+    }
+
+}
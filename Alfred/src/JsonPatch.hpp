@@ -0,0 +1,93 @@
+#pragma once
+
+/**
+ * @file JsonPatch.hpp
+ *
+ * This module declares functions used to build JSON Patch
+ * ([RFC 6902](https://tools.ietf.org/html/rfc6902)) and JSON Merge Patch
+ * ([RFC 7386](https://tools.ietf.org/html/rfc7386)) documents.
+ */
+
+#include <Json/Value.hpp>
+#include <string>
+#include <vector>
+
+namespace JsonPatch {
+
+    /**
+     * Return the JSON Pointer ([RFC 6901](https://tools.ietf.org/html/rfc6901))
+     * string form of the given sequence of keys.
+     *
+     * @param[in] segments
+     *     This is the sequence of keys identifying a value in a document.
+     *
+     * @return
+     *     The JSON Pointer string form of the given keys is returned.
+     */
+    std::string MakePointer(const std::vector< std::string >& segments);
+
+    /**
+     * Return a JSON Patch operation with the given properties.
+     *
+     * @param[in] op
+     *     This is the name of the operation ("add", "replace", "remove").
+     *
+     * @param[in] segments
+     *     This is the sequence of keys identifying the value targeted
+     *     by the operation.
+     *
+     * @param[in] value
+     *     This is the value to include in the operation, if any.
+     *
+     * @return
+     *     The JSON Patch operation is returned.
+     */
+    Json::Value MakeOperation(
+        const std::string& op,
+        const std::vector< std::string >& segments,
+        const Json::Value& value = Json::Value()
+    );
+
+    /**
+     * Return a JSON Merge Patch which, when applied to a document,
+     * changes only the value identified by the given keys, merging in
+     * the given patch for that value.
+     *
+     * @param[in] segments
+     *     This is the sequence of keys identifying the value to change.
+     *
+     * @param[in] patch
+     *     This is the merge patch to apply to the identified value.
+     *
+     * @return
+     *     The JSON Merge Patch is returned.
+     */
+    Json::Value MakeNestedMergePatch(
+        const std::vector< std::string >& segments,
+        Json::Value&& patch
+    );
+
+    /**
+     * Compute the JSON Merge Patch which turns one value into another.
+     *
+     * @param[in] oldValue
+     *     This is the value before the change.
+     *
+     * @param[in] newValue
+     *     This is the value after the change.
+     *
+     * @param[out] patch
+     *     This is where to store the merge patch.
+     *
+     * @return
+     *     An indication of whether or not the change can be expressed as a
+     *     merge patch is returned.  It can't be if the new value contains
+     *     nulls, since merge patches use null to mean removal.
+     */
+    bool MakeMergePatch(
+        const Json::Value& oldValue,
+        const Json::Value& newValue,
+        Json::Value& patch
+    );
+
+}
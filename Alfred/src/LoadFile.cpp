@@ -6,9 +6,8 @@
 
 #include "LoadFile.hpp"
 
-#include <stdint.h>
+#include <stdio.h>
 #include <SystemAbstractions/File.hpp>
-#include <vector>
 
 bool LoadFile(
     const std::string& filePath,
@@ -17,25 +16,11 @@ bool LoadFile(
     std::string& fileContents
 ) {
     SystemAbstractions::File file(filePath);
-    if (
-        !file.IsDirectory()
-        && file.OpenReadOnly()
-    ) {
-        std::vector< uint8_t > fileContentsAsVector(file.GetSize());
-        if (file.Read(fileContentsAsVector) != fileContentsAsVector.size()) {
-            diagnosticsSender.SendDiagnosticInformationFormatted(
-                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
-                "Unable to read %s file '%s'",
-                fileDescription.c_str(),
-                filePath.c_str()
-            );
-            return false;
-        }
-        (void)fileContents.assign(
-            (const char*)fileContentsAsVector.data(),
-            fileContentsAsVector.size()
-        );
-    } else {
+    FILE* handle = NULL;
+    if (!file.IsDirectory()) {
+        handle = fopen(filePath.c_str(), "rb");
+    }
+    if (handle == NULL) {
         diagnosticsSender.SendDiagnosticInformationFormatted(
             SystemAbstractions::DiagnosticsSender::Levels::ERROR,
             "Unable to open %s file '%s'",
@@ -44,5 +29,31 @@ bool LoadFile(
         );
         return false;
     }
+    // Read straight into the string, rather than into a buffer first and
+    // then copying it, since the file may be very large.
+    long size = -1;
+    if (fseek(handle, 0, SEEK_END) == 0) {
+        size = ftell(handle);
+        rewind(handle);
+    }
+    bool ok = (size >= 0);
+    if (ok) {
+        fileContents.resize((size_t)size);
+        ok = (
+            fileContents.empty()
+            || (fread(&fileContents[0], 1, fileContents.size(), handle) == fileContents.size())
+        );
+    }
+    (void)fclose(handle);
+    if (!ok) {
+        diagnosticsSender.SendDiagnosticInformationFormatted(
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "Unable to read %s file '%s'",
+            fileDescription.c_str(),
+            filePath.c_str()
+        );
+        fileContents.clear();
+        return false;
+    }
     return true;
 }
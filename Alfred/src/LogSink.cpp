@@ -0,0 +1,416 @@
+/**
+ * @file LogSink.cpp
+ *
+ * This module contains the implementation of the LogSink class.
+ */
+
+#include "LogSink.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <inttypes.h>
+#include <mutex>
+#include <stdint.h>
+#include <SystemAbstractions/DiagnosticsSender.hpp>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is one diagnostic message waiting to be written.
+     */
+    struct QueuedMessage {
+        double time = 0.0;
+        size_t level = 0;
+        std::string message;
+    };
+
+    /**
+     * Return the path to which the log file with the given path
+     * is moved when rotated the given number of times.
+     *
+     * @param[in] logFilePath
+     *     This is the path of the log file.
+     *
+     * @param[in] generation
+     *     This is the number of times the log file has been rotated.
+     *
+     * @return
+     *     The path of the rotated log file is returned.
+     */
+    std::string GetRotatedPath(
+        const std::string& logFilePath,
+        size_t generation
+    ) {
+        return logFilePath + "." + std::to_string(generation);
+    }
+
+}
+
+/**
+ * This contains the private properties of a LogSink class instance.
+ */
+struct LogSink::Impl {
+    // Properties
+
+    Configuration configuration;
+
+    /**
+     * This is the number of messages dropped since the last batch
+     * was written, because the queue was full.
+     */
+    size_t dropped = 0;
+
+    std::shared_ptr< FILE > errorOutputFile;
+
+    /**
+     * This is the day of the last message written, used to mark
+     * the start of each new day in the output.
+     */
+    intmax_t lastDay = 0;
+
+    /**
+     * This is the second of the last message written, along with that
+     * second formatted, since many messages are written each second.
+     */
+    intmax_t lastSecond = -1;
+    char lastSecondFormatted[20];
+
+    /**
+     * If messages are written to a log file, rather than the console,
+     * this is the path of the file.
+     */
+    std::string logFilePath;
+
+    /**
+     * This is the time of the first message written to the
+     * current log file.
+     */
+    double logFileStartTime = 0.0;
+
+    /**
+     * This is the size of the current log file.
+     */
+    size_t logFileSize = 0;
+
+    bool mobilized = false;
+    std::mutex mutex;
+    std::shared_ptr< FILE > normalOutputFile;
+    std::vector< QueuedMessage > queue;
+    bool stopWorker = false;
+    std::condition_variable wakeCondition;
+    std::thread worker;
+
+    // Methods
+
+    /**
+     * Add the given message to the given batch, formatted
+     * as it should be written.
+     *
+     * @param[in] queuedMessage
+     *     This is the message to format.
+     *
+     * @param[in,out] batch
+     *     This is the batch to which to add the message.
+     */
+    void Format(
+        const QueuedMessage& queuedMessage,
+        std::string& batch
+    ) {
+        const auto time = queuedMessage.time;
+        const auto day = (intmax_t)(time / 86400.0);
+        const auto timeSeconds = (time_t)time;
+        if (day != lastDay) {
+            lastDay = day;
+            char date[20];
+            (void)strftime(date, sizeof(date), "%Y-%m-%d", gmtime(&timeSeconds));
+            batch += "--- [";
+            batch += date;
+            batch += "] ---\n";
+        }
+        if ((intmax_t)timeSeconds != lastSecond) {
+            lastSecond = (intmax_t)timeSeconds;
+            (void)strftime(lastSecondFormatted, sizeof(lastSecondFormatted), "%H:%M:%S", gmtime(&timeSeconds));
+        }
+        char prefix[64];
+        (void)snprintf(
+            prefix,
+            sizeof(prefix),
+            "[%s.%06" PRIdMAX " (%zu)] ",
+            lastSecondFormatted,
+            (intmax_t)(time * 1000000.0) % 1000000,
+            queuedMessage.level
+        );
+        batch += prefix;
+        if (queuedMessage.level >= SystemAbstractions::DiagnosticsSender::Levels::ERROR) {
+            batch += "error: ";
+        } else if (queuedMessage.level >= SystemAbstractions::DiagnosticsSender::Levels::WARNING) {
+            batch += "warning: ";
+        }
+        batch += queuedMessage.message;
+        batch += '\n';
+    }
+
+    /**
+     * Write the given batch out to the given file.
+     *
+     * @param[in] file
+     *     This is the file to which to write the batch.
+     *
+     * @param[in] batch
+     *     This is the batch to write.
+     */
+    void Write(
+        FILE* file,
+        const std::string& batch
+    ) {
+        if (
+            (file == NULL)
+            || batch.empty()
+        ) {
+            return;
+        }
+        (void)fwrite(batch.data(), 1, batch.size(), file);
+        (void)fflush(file);
+    }
+
+    /**
+     * Open the log file, appending to it if it already exists.
+     *
+     * @return
+     *     An indication of whether or not the log file was opened
+     *     is returned.
+     */
+    bool OpenLogFile() {
+        const auto file = fopen(logFilePath.c_str(), "ab");
+        if (file == NULL) {
+            return false;
+        }
+        // Each batch is written with a single call, so the file needs
+        // no buffer of its own.
+        setbuf(file, NULL);
+        (void)fseek(file, 0, SEEK_END);
+        const auto position = ftell(file);
+        logFileSize = ((position < 0) ? 0 : (size_t)position);
+        logFileStartTime = 0.0;
+        normalOutputFile = std::shared_ptr< FILE >(
+            file,
+            [](FILE* p){ (void)fclose(p); }
+        );
+        errorOutputFile = normalOutputFile;
+        return true;
+    }
+
+    /**
+     * Rotate the log file, if it's time to do so.
+     *
+     * @param[in] now
+     *     This is the time of the last message written.
+     */
+    void RotateIfNeeded(double now) {
+        if (logFilePath.empty()) {
+            return;
+        }
+        if (logFileStartTime == 0.0) {
+            logFileStartTime = now;
+        }
+        if (
+            !(
+                (configuration.rotateSize > 0)
+                && (logFileSize >= configuration.rotateSize)
+            )
+            && !(
+                (configuration.rotateInterval > 0.0)
+                && (now - logFileStartTime >= configuration.rotateInterval)
+            )
+        ) {
+            return;
+        }
+        normalOutputFile = nullptr;
+        errorOutputFile = nullptr;
+        if (configuration.rotateKeep == 0) {
+            (void)remove(logFilePath.c_str());
+        } else {
+            (void)remove(GetRotatedPath(logFilePath, configuration.rotateKeep).c_str());
+            for (size_t generation = configuration.rotateKeep - 1; generation > 0; --generation) {
+                (void)rename(
+                    GetRotatedPath(logFilePath, generation).c_str(),
+                    GetRotatedPath(logFilePath, generation + 1).c_str()
+                );
+            }
+            (void)rename(
+                logFilePath.c_str(),
+                GetRotatedPath(logFilePath, 1).c_str()
+            );
+        }
+        (void)OpenLogFile();
+    }
+
+    /**
+     * Write out all the messages queued so far.
+     *
+     * @param[in,out] lock
+     *     This is the object holding the mutex protecting the queue.
+     *     It's released while the messages are written.
+     */
+    void Drain(std::unique_lock< decltype(mutex) >& lock) {
+        if (
+            queue.empty()
+            && (dropped == 0)
+        ) {
+            return;
+        }
+        std::vector< QueuedMessage > batchMessages;
+        batchMessages.swap(queue);
+        const auto droppedInBatch = dropped;
+        dropped = 0;
+        lock.unlock();
+        std::string normalBatch, errorBatch;
+        double lastTime = 0.0;
+        for (const auto& queuedMessage: batchMessages) {
+            auto& batch = (
+                (
+                    (errorOutputFile != normalOutputFile)
+                    && (queuedMessage.level >= SystemAbstractions::DiagnosticsSender::Levels::WARNING)
+                )
+                ? errorBatch
+                : normalBatch
+            );
+            Format(queuedMessage, batch);
+            lastTime = queuedMessage.time;
+        }
+        if (droppedInBatch > 0) {
+            QueuedMessage notice;
+            notice.time = lastTime;
+            notice.level = SystemAbstractions::DiagnosticsSender::Levels::WARNING;
+            notice.message = std::to_string(droppedInBatch) + " messages dropped; log output falling behind";
+            Format(notice, (errorOutputFile != normalOutputFile) ? errorBatch : normalBatch);
+        }
+        Write(normalOutputFile.get(), normalBatch);
+        Write(errorOutputFile.get(), errorBatch);
+        logFileSize += normalBatch.size() + errorBatch.size();
+        RotateIfNeeded(lastTime);
+        lock.lock();
+        // Give back the storage of the batch, so that the queue
+        // doesn't have to grow again.
+        if (queue.empty()) {
+            batchMessages.clear();
+            batchMessages.swap(queue);
+        }
+    }
+
+    /**
+     * This is run by the worker thread, writing out
+     * queued messages until told to stop.
+     */
+    void Worker() {
+        const auto flushInterval = std::chrono::milliseconds(
+            std::max(1, (int)(configuration.flushInterval * 1000.0))
+        );
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        while (!stopWorker) {
+            (void)wakeCondition.wait_for(lock, flushInterval);
+            Drain(lock);
+        }
+        Drain(lock);
+    }
+
+    /**
+     * Start the worker thread.
+     */
+    void StartWorker() {
+        stopWorker = false;
+        worker = std::thread(&Impl::Worker, this);
+        mobilized = true;
+    }
+};
+
+LogSink::~LogSink() noexcept {
+    Demobilize();
+}
+
+LogSink::LogSink(LogSink&&) noexcept = default;
+LogSink& LogSink::operator=(LogSink&&) noexcept = default;
+
+LogSink::LogSink()
+    : impl_(new Impl())
+{
+}
+
+void LogSink::Demobilize() {
+    if (impl_ == nullptr) {
+        return;
+    }
+    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (!impl_->mobilized) {
+        return;
+    }
+    impl_->stopWorker = true;
+    impl_->wakeCondition.notify_all();
+    lock.unlock();
+    impl_->worker.join();
+    lock.lock();
+    impl_->normalOutputFile = nullptr;
+    impl_->errorOutputFile = nullptr;
+    impl_->mobilized = false;
+}
+
+void LogSink::Mobilize(
+    std::shared_ptr< FILE > normalOutputFile,
+    std::shared_ptr< FILE > errorOutputFile,
+    const Configuration& configuration
+) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (impl_->mobilized) {
+        return;
+    }
+    impl_->configuration = configuration;
+    impl_->normalOutputFile = normalOutputFile;
+    impl_->errorOutputFile = errorOutputFile;
+    impl_->StartWorker();
+}
+
+bool LogSink::Mobilize(
+    const std::string& logFilePath,
+    const Configuration& configuration
+) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (impl_->mobilized) {
+        return true;
+    }
+    impl_->configuration = configuration;
+    impl_->logFilePath = logFilePath;
+    if (!impl_->OpenLogFile()) {
+        return false;
+    }
+    impl_->StartWorker();
+    return true;
+}
+
+void LogSink::Publish(
+    double time,
+    size_t level,
+    std::string&& message
+) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (!impl_->mobilized) {
+        return;
+    }
+    if (impl_->queue.size() >= impl_->configuration.maxQueuedMessages) {
+        ++impl_->dropped;
+        return;
+    }
+    QueuedMessage queuedMessage;
+    queuedMessage.time = time;
+    queuedMessage.level = level;
+    queuedMessage.message = std::move(message);
+    impl_->queue.push_back(std::move(queuedMessage));
+    if (level >= SystemAbstractions::DiagnosticsSender::Levels::WARNING) {
+        // Don't hold back warnings and errors, since they may come
+        // just before the program stops.
+        impl_->wakeCondition.notify_one();
+    }
+}
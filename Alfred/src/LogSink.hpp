@@ -0,0 +1,150 @@
+#pragma once
+
+/**
+ * @file LogSink.hpp
+ *
+ * This module declares the LogSink class.
+ */
+
+#include <memory>
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+
+/**
+ * This writes diagnostic messages out to the console or a log file.
+ * Messages are queued, and written by a worker thread in batches, with one
+ * write per batch, so that publishing a message costs little more than
+ * copying it.  A log file may be rotated once it reaches a given size or
+ * age, keeping a number of older logs beside it.
+ */
+class LogSink {
+    // Types
+public:
+    /**
+     * These are the settings which control how messages are written.
+     */
+    struct Configuration {
+        /**
+         * This is the most messages which may be queued to be written.
+         * Any more are dropped (and a count of them written instead),
+         * rather than hold up whoever is publishing them.
+         */
+        size_t maxQueuedMessages = 65536;
+
+        /**
+         * This is the longest time, in seconds, a message may wait in the
+         * queue before being written.
+         */
+        double flushInterval = 0.1;
+
+        /**
+         * If not zero, this is the size, in bytes, at which a log file
+         * is rotated.
+         */
+        size_t rotateSize = 0;
+
+        /**
+         * If not zero, this is the age, in seconds, at which a log file
+         * is rotated.
+         */
+        double rotateInterval = 0.0;
+
+        /**
+         * This is the number of rotated log files to keep.
+         */
+        size_t rotateKeep = 5;
+    };
+
+    // Lifecycle
+public:
+    ~LogSink() noexcept;
+    LogSink(const LogSink&) = delete;
+    LogSink(LogSink&&) noexcept;
+    LogSink& operator=(const LogSink&) = delete;
+    LogSink& operator=(LogSink&&) noexcept;
+
+    // Constructor
+public:
+    LogSink();
+
+    // Methods
+public:
+    /**
+     * Write any messages still queued, and stop writing messages.
+     */
+    void Demobilize();
+
+    /**
+     * Start writing messages to the given files.  Warnings and errors
+     * go to one, and all other messages go to the other.  The files
+     * are never rotated.
+     *
+     * @param[in] normalOutputFile
+     *     This is the file to which to write "normal" (not warning or error)
+     *     messages.
+     *
+     * @param[in] errorOutputFile
+     *     This is the file to which to write warning or error messages.
+     *
+     * @param[in] configuration
+     *     These are the settings which control how messages are written.
+     */
+    void Mobilize(
+        std::shared_ptr< FILE > normalOutputFile,
+        std::shared_ptr< FILE > errorOutputFile,
+        const Configuration& configuration
+    );
+
+    /**
+     * Start writing messages to the log file with the given path,
+     * appending to it if it already exists.
+     *
+     * @param[in] logFilePath
+     *     This is the path of the log file.
+     *
+     * @param[in] configuration
+     *     These are the settings which control how messages are written.
+     *
+     * @return
+     *     An indication of whether or not the log file was opened
+     *     is returned.
+     */
+    bool Mobilize(
+        const std::string& logFilePath,
+        const Configuration& configuration
+    );
+
+    /**
+     * Queue a diagnostic message to be written.
+     *
+     * @param[in] time
+     *     This is the time, in seconds since the UNIX epoch,
+     *     at which the message was published.
+     *
+     * @param[in] level
+     *     This is the level of importance of the message.
+     *
+     * @param[in] message
+     *     This is the message to write.
+     */
+    void Publish(
+        double time,
+        size_t level,
+        std::string&& message
+    );
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::shared_ptr< Impl > impl_;
+};
@@ -0,0 +1,257 @@
+/**
+ * @file Metrics.cpp
+ *
+ * This module contains the implementation of the Metrics class.
+ */
+
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <StringExtensions/StringExtensions.hpp>
+
+namespace {
+
+    /**
+     * This holds all the metrics of one name, which differ only
+     * in their labels.
+     */
+    struct Family {
+        std::string help;
+        std::map< std::string, std::shared_ptr< Metrics::Counter > > counters;
+        std::map< std::string, std::shared_ptr< Metrics::Gauge > > gauges;
+        std::map< std::string, std::shared_ptr< Metrics::Histogram > > histograms;
+    };
+
+    std::string FormatNumber(double value) {
+        return StringExtensions::sprintf("%.9g", value);
+    }
+
+    std::string WithLabels(
+        const std::string& name,
+        const std::string& labels
+    ) {
+        if (labels.empty()) {
+            return name;
+        }
+        return name + "{" + labels + "}";
+    }
+
+    std::string WithLabels(
+        const std::string& name,
+        const std::string& labels,
+        const std::string& extraLabel
+    ) {
+        if (labels.empty()) {
+            return name + "{" + extraLabel + "}";
+        }
+        return name + "{" + labels + "," + extraLabel + "}";
+    }
+
+    void RenderHeader(
+        const std::string& name,
+        const Family& family,
+        const char* type,
+        std::string& output
+    ) {
+        output += "# HELP " + name + " " + family.help + "\n";
+        output += "# TYPE " + name + " " + type + "\n";
+    }
+
+}
+
+void Metrics::Counter::Add(uint64_t amount) {
+    (void)value_.fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint64_t Metrics::Counter::GetValue() const {
+    return value_.load(std::memory_order_relaxed);
+}
+
+void Metrics::Gauge::Add(int64_t amount) {
+    (void)value_.fetch_add(amount, std::memory_order_relaxed);
+}
+
+void Metrics::Gauge::Set(int64_t value) {
+    value_.store(value, std::memory_order_relaxed);
+}
+
+int64_t Metrics::Gauge::GetValue() const {
+    return value_.load(std::memory_order_relaxed);
+}
+
+Metrics::Histogram::Histogram(const std::vector< double >& bounds)
+    : bounds_(bounds)
+    , counts_(new std::atomic< uint64_t >[bounds.size() + 1])
+{
+    for (size_t i = 0; i <= bounds_.size(); ++i) {
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::Histogram::Observe(double value) {
+    const auto bucket = (size_t)(
+        std::lower_bound(bounds_.begin(), bounds_.end(), value)
+        - bounds_.begin()
+    );
+    (void)counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+    auto sum = sum_.load(std::memory_order_relaxed);
+    while (!sum_.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed)) {
+    }
+}
+
+const std::vector< double >& Metrics::Histogram::GetBounds() const {
+    return bounds_;
+}
+
+std::vector< uint64_t > Metrics::Histogram::GetCounts() const {
+    std::vector< uint64_t > counts(bounds_.size() + 1);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        counts[i] = counts_[i].load(std::memory_order_relaxed);
+    }
+    return counts;
+}
+
+double Metrics::Histogram::GetSum() const {
+    return sum_.load(std::memory_order_relaxed);
+}
+
+/**
+ * This contains the private properties of a Metrics class instance.
+ */
+struct Metrics::Impl {
+    /**
+     * These are all the metrics, keyed by name.
+     */
+    std::map< std::string, Family > families;
+
+    /**
+     * This is used to synchronize access to this structure.
+     */
+    mutable std::mutex mutex;
+};
+
+Metrics::~Metrics() noexcept = default;
+Metrics::Metrics(Metrics&&) noexcept = default;
+Metrics& Metrics::operator=(Metrics&&) noexcept = default;
+
+Metrics::Metrics()
+    : impl_(new Impl())
+{
+}
+
+std::vector< double > Metrics::MakeExponentialBounds(
+    double start,
+    double factor,
+    size_t count
+) {
+    std::vector< double > bounds;
+    bounds.reserve(count);
+    auto bound = start;
+    for (size_t i = 0; i < count; ++i) {
+        bounds.push_back(bound);
+        bound *= factor;
+    }
+    return bounds;
+}
+
+std::vector< double > Metrics::MakeDurationBounds() {
+    return MakeExponentialBounds(0.000001, 4.0, 14);
+}
+
+std::vector< double > Metrics::MakeSizeBounds() {
+    return MakeExponentialBounds(64.0, 4.0, 12);
+}
+
+auto Metrics::GetCounter(
+    const std::string& name,
+    const std::string& help,
+    const std::string& labels
+) -> std::shared_ptr< Counter > {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    auto& family = impl_->families[name];
+    family.help = help;
+    auto& counter = family.counters[labels];
+    if (counter == nullptr) {
+        counter = std::make_shared< Counter >();
+    }
+    return counter;
+}
+
+auto Metrics::GetGauge(
+    const std::string& name,
+    const std::string& help,
+    const std::string& labels
+) -> std::shared_ptr< Gauge > {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    auto& family = impl_->families[name];
+    family.help = help;
+    auto& gauge = family.gauges[labels];
+    if (gauge == nullptr) {
+        gauge = std::make_shared< Gauge >();
+    }
+    return gauge;
+}
+
+auto Metrics::GetHistogram(
+    const std::string& name,
+    const std::string& help,
+    const std::vector< double >& bounds,
+    const std::string& labels
+) -> std::shared_ptr< Histogram > {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    auto& family = impl_->families[name];
+    family.help = help;
+    auto& histogram = family.histograms[labels];
+    if (histogram == nullptr) {
+        histogram = std::make_shared< Histogram >(bounds);
+    }
+    return histogram;
+}
+
+std::string Metrics::Render() const {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    std::string output;
+    for (const auto& familiesEntry: impl_->families) {
+        const auto& name = familiesEntry.first;
+        const auto& family = familiesEntry.second;
+        if (!family.counters.empty()) {
+            RenderHeader(name, family, "counter", output);
+            for (const auto& countersEntry: family.counters) {
+                output += WithLabels(name, countersEntry.first);
+                output += " " + std::to_string(countersEntry.second->GetValue()) + "\n";
+            }
+        } else if (!family.gauges.empty()) {
+            RenderHeader(name, family, "gauge", output);
+            for (const auto& gaugesEntry: family.gauges) {
+                output += WithLabels(name, gaugesEntry.first);
+                output += " " + std::to_string(gaugesEntry.second->GetValue()) + "\n";
+            }
+        } else if (!family.histograms.empty()) {
+            RenderHeader(name, family, "histogram", output);
+            for (const auto& histogramsEntry: family.histograms) {
+                const auto& labels = histogramsEntry.first;
+                const auto& histogram = *histogramsEntry.second;
+                const auto& bounds = histogram.GetBounds();
+                const auto counts = histogram.GetCounts();
+                uint64_t total = 0;
+                for (size_t i = 0; i < counts.size(); ++i) {
+                    total += counts[i];
+                    const auto bound = (
+                        (i < bounds.size())
+                        ? FormatNumber(bounds[i])
+                        : std::string("+Inf")
+                    );
+                    output += WithLabels(name + "_bucket", labels, "le=\"" + bound + "\"");
+                    output += " " + std::to_string(total) + "\n";
+                }
+                output += WithLabels(name + "_sum", labels);
+                output += " " + FormatNumber(histogram.GetSum()) + "\n";
+                output += WithLabels(name + "_count", labels);
+                output += " " + std::to_string(total) + "\n";
+            }
+        }
+    }
+    return output;
+}
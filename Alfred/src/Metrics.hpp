@@ -0,0 +1,299 @@
+#pragma once
+
+/**
+ * @file Metrics.hpp
+ *
+ * This module declares the Metrics class.
+ */
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * This holds counters, gauges, and histograms measuring what Alfred is
+ * doing, and renders them in the Prometheus text exposition format.
+ *
+ * Measuring is cheap: each measurement is a relaxed atomic update, and
+ * no lock is taken except when a metric is first made or when all the
+ * metrics are rendered.
+ */
+class Metrics {
+    // Types
+public:
+    /**
+     * This counts something which only ever increases.
+     */
+    class Counter {
+        // Methods
+    public:
+        /**
+         * Add the given amount to the counter.
+         *
+         * @param[in] amount
+         *     This is the amount to add to the counter.
+         */
+        void Add(uint64_t amount = 1);
+
+        /**
+         * Return the value of the counter.
+         *
+         * @return
+         *     The value of the counter is returned.
+         */
+        uint64_t GetValue() const;
+
+        // Private properties
+    private:
+        std::atomic< uint64_t > value_{0};
+    };
+
+    /**
+     * This measures something which may go up or down.
+     */
+    class Gauge {
+        // Methods
+    public:
+        /**
+         * Add the given amount (which may be negative) to the gauge.
+         *
+         * @param[in] amount
+         *     This is the amount to add to the gauge.
+         */
+        void Add(int64_t amount);
+
+        /**
+         * Set the value of the gauge.
+         *
+         * @param[in] value
+         *     This is the new value of the gauge.
+         */
+        void Set(int64_t value);
+
+        /**
+         * Return the value of the gauge.
+         *
+         * @return
+         *     The value of the gauge is returned.
+         */
+        int64_t GetValue() const;
+
+        // Private properties
+    private:
+        std::atomic< int64_t > value_{0};
+    };
+
+    /**
+     * This counts observations (such as durations or sizes) falling into
+     * each of a fixed set of buckets, along with their sum.
+     */
+    class Histogram {
+        // Constructor
+    public:
+        /**
+         * Make a histogram with the given bucket bounds.
+         *
+         * @param[in] bounds
+         *     These are the upper bounds (inclusive) of the buckets, in
+         *     increasing order.  There is also a last bucket with no
+         *     upper bound.
+         */
+        explicit Histogram(const std::vector< double >& bounds);
+
+        // Methods
+    public:
+        /**
+         * Record the given observation.
+         *
+         * @param[in] value
+         *     This is the value observed.
+         */
+        void Observe(double value);
+
+        /**
+         * Return the upper bounds of the buckets.
+         *
+         * @return
+         *     The upper bounds of the buckets, except the last one,
+         *     which has none, are returned.
+         */
+        const std::vector< double >& GetBounds() const;
+
+        /**
+         * Return the number of observations falling into each bucket.
+         *
+         * @return
+         *     The number of observations falling into each bucket,
+         *     including the last one, is returned.
+         */
+        std::vector< uint64_t > GetCounts() const;
+
+        /**
+         * Return the sum of all observations.
+         *
+         * @return
+         *     The sum of all observations is returned.
+         */
+        double GetSum() const;
+
+        // Private properties
+    private:
+        std::vector< double > bounds_;
+        std::unique_ptr< std::atomic< uint64_t >[] > counts_;
+        std::atomic< double > sum_{0.0};
+    };
+
+    // Lifecycle Methods
+public:
+    ~Metrics() noexcept;
+    Metrics(const Metrics&) = delete;
+    Metrics(Metrics&&) noexcept;
+    Metrics& operator=(const Metrics&) = delete;
+    Metrics& operator=(Metrics&&) noexcept;
+
+    // Constructor
+public:
+    Metrics();
+
+    // Methods
+public:
+    /**
+     * Return bucket bounds for a histogram, starting at the given bound
+     * and growing by the given factor from each bucket to the next.
+     *
+     * @param[in] start
+     *     This is the upper bound of the first bucket.
+     *
+     * @param[in] factor
+     *     This is the ratio between the upper bounds of
+     *     successive buckets.
+     *
+     * @param[in] count
+     *     This is the number of buckets with upper bounds.
+     *
+     * @return
+     *     The bucket bounds are returned.
+     */
+    static std::vector< double > MakeExponentialBounds(
+        double start,
+        double factor,
+        size_t count
+    );
+
+    /**
+     * Return the bucket bounds used for histograms of durations, in
+     * seconds, from a microsecond up to about a minute.
+     *
+     * @return
+     *     The bucket bounds used for histograms of durations are returned.
+     */
+    static std::vector< double > MakeDurationBounds();
+
+    /**
+     * Return the bucket bounds used for histograms of sizes, in bytes,
+     * from 64 bytes up to a quarter of a gigabyte.
+     *
+     * @return
+     *     The bucket bounds used for histograms of sizes are returned.
+     */
+    static std::vector< double > MakeSizeBounds();
+
+    /**
+     * Return the counter with the given name and labels, making it if
+     * it doesn't exist yet.
+     *
+     * @param[in] name
+     *     This is the name of the counter.
+     *
+     * @param[in] help
+     *     This describes what the counter counts.
+     *
+     * @param[in] labels
+     *     These are the labels distinguishing this counter from others of
+     *     the same name, in Prometheus form (for example, 'type="Set"').
+     *
+     * @return
+     *     The counter is returned.
+     */
+    std::shared_ptr< Counter > GetCounter(
+        const std::string& name,
+        const std::string& help,
+        const std::string& labels = ""
+    );
+
+    /**
+     * Return the gauge with the given name and labels, making it if
+     * it doesn't exist yet.
+     *
+     * @param[in] name
+     *     This is the name of the gauge.
+     *
+     * @param[in] help
+     *     This describes what the gauge measures.
+     *
+     * @param[in] labels
+     *     These are the labels distinguishing this gauge from others of
+     *     the same name, in Prometheus form.
+     *
+     * @return
+     *     The gauge is returned.
+     */
+    std::shared_ptr< Gauge > GetGauge(
+        const std::string& name,
+        const std::string& help,
+        const std::string& labels = ""
+    );
+
+    /**
+     * Return the histogram with the given name and labels, making it if
+     * it doesn't exist yet.
+     *
+     * @param[in] name
+     *     This is the name of the histogram.
+     *
+     * @param[in] help
+     *     This describes what the histogram measures.
+     *
+     * @param[in] bounds
+     *     These are the upper bounds of the buckets of the histogram,
+     *     used only if the histogram is made.
+     *
+     * @param[in] labels
+     *     These are the labels distinguishing this histogram from others
+     *     of the same name, in Prometheus form.
+     *
+     * @return
+     *     The histogram is returned.
+     */
+    std::shared_ptr< Histogram > GetHistogram(
+        const std::string& name,
+        const std::string& help,
+        const std::vector< double >& bounds,
+        const std::string& labels = ""
+    );
+
+    /**
+     * Render all the metrics in the Prometheus text exposition format.
+     *
+     * @return
+     *     The rendering of all the metrics is returned.
+     */
+    std::string Render() const;
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::shared_ptr< Impl > impl_;
+};
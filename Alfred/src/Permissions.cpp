@@ -0,0 +1,461 @@
+/**
+ * @file Permissions.cpp
+ *
+ * This module contains the implementation of the types and functions used by
+ * the Store to compile and evaluate permissions metadata.
+ */
+
+#include "Permissions.hpp"
+
+namespace {
+
+    using namespace Permissions;
+
+    /**
+     * This describes how one permission named in metadata affects the
+     * compiled form of the metadata.
+     */
+    struct PermissionSchema {
+        /**
+         * This is the rule for the operation governed by the permission.
+         */
+        Rule CompiledMeta::* rule;
+
+        /**
+         * If not null, this is the rule for an operation which roles
+         * allowed the permission are also allowed (for example, roles
+         * allowed to write data may also read it).
+         */
+        Rule CompiledMeta::* impliedRule;
+    };
+
+    /**
+     * These are the permissions which may be named in metadata,
+     * keyed by name.
+     */
+    const std::unordered_map< std::string, PermissionSchema > permissionsSchema{
+        {"read_data", {&CompiledMeta::readData, nullptr}},
+        {"read_meta", {&CompiledMeta::readMeta, nullptr}},
+        {"write_data", {&CompiledMeta::writeData, &CompiledMeta::readData}},
+        {"write_meta", {&CompiledMeta::writeMeta, &CompiledMeta::readMeta}},
+        {"create_data", {&CompiledMeta::createData, nullptr}},
+        {"delete_data", {&CompiledMeta::deleteData, nullptr}},
+    };
+
+    void AddRoles(
+        RoleBits& rolesSet,
+        const Json::Value& rolesArray,
+        const std::string& context,
+        RoleTable& roleTable,
+        Problems& problems
+    ) {
+        if (rolesArray.GetType() != Json::Value::Type::Array) {
+            problems.push_back(context + " is not an array of roles");
+            return;
+        }
+        for (const auto entry: rolesArray) {
+            const auto& role = entry.value();
+            if (role.GetType() != Json::Value::Type::String) {
+                problems.push_back(context + " names a role which is not a string");
+                continue;
+            }
+            size_t id;
+            if (roleTable.Intern(role, id)) {
+                (void)rolesSet.set(id);
+            }
+        }
+    }
+
+    /**
+     * Compile the "require" or "allow" part of a piece of metadata, in one
+     * pass over the permissions it names.
+     *
+     * @param[in,out] compiledMeta
+     *     This is the compiled form of the metadata.
+     *
+     * @param[in] permissions
+     *     This is the "require" or "allow" part of the metadata.
+     *
+     * @param[in] require
+     *     This indicates whether the permissions are those required,
+     *     rather than those allowed.
+     *
+     * @param[in,out] roleTable
+     *     This is used to assign identifiers to the roles named.
+     *
+     * @param[in,out] problems
+     *     This is where to describe anything wrong with the metadata.
+     */
+    void CompilePermissions(
+        CompiledMeta& compiledMeta,
+        const Json::Value& permissions,
+        bool require,
+        RoleTable& roleTable,
+        Problems& problems
+    ) {
+        const std::string part = (require ? "meta.require" : "meta.allow");
+        if (permissions.GetType() != Json::Value::Type::Object) {
+            problems.push_back(part + " is not an object");
+            return;
+        }
+        for (const auto entry: permissions) {
+            const auto& name = entry.key();
+            const auto schemaEntry = permissionsSchema.find(name);
+            if (schemaEntry == permissionsSchema.end()) {
+                problems.push_back(part + " names unknown permission '" + name + "'");
+                continue;
+            }
+            const auto& schema = schemaEntry->second;
+            RoleBits roles;
+            AddRoles(roles, entry.value(), part + "." + name, roleTable, problems);
+            auto& rule = compiledMeta.*schema.rule;
+            if (require) {
+                rule.replace = true;
+                rule.required |= roles;
+            } else {
+                rule.allowed |= roles;
+                if (schema.impliedRule != nullptr) {
+                    (compiledMeta.*schema.impliedRule).allowed |= roles;
+                }
+            }
+        }
+    }
+
+    CompiledMeta CompileMeta(
+        const Json::Value& meta,
+        RoleTable& roleTable,
+        Problems& problems
+    ) {
+        CompiledMeta compiledMeta;
+        if (meta.GetType() != Json::Value::Type::Object) {
+            return compiledMeta;
+        }
+        for (const auto entry: meta) {
+            const auto& key = entry.key();
+            if (key == "require") {
+                CompilePermissions(compiledMeta, entry.value(), true, roleTable, problems);
+            } else if (key == "allow") {
+                CompilePermissions(compiledMeta, entry.value(), false, roleTable, problems);
+            }
+        }
+        return compiledMeta;
+    }
+
+    /**
+     * Prefix the descriptions of problems found inside a value with the key
+     * of the value, so that they say where in the store they were found.
+     *
+     * @param[in,out] problems
+     *     These describe what was found wrong with metadata.
+     *
+     * @param[in] first
+     *     This is the position of the first problem found inside the value.
+     *
+     * @param[in] key
+     *     This is the key of the value.
+     */
+    void LocateProblems(
+        Problems& problems,
+        size_t first,
+        const std::string& key
+    ) {
+        for (size_t i = first; i < problems.size(); ++i) {
+            problems[i] = key + "/" + problems[i];
+        }
+    }
+
+    std::unique_ptr< IndexNode > CompileContents(
+        const Json::Value& root,
+        RoleTable& roleTable,
+        Problems& problems
+    ) {
+        std::unique_ptr< IndexNode > node;
+        switch (root.GetType()) {
+            case Json::Value::Type::Array: {
+                const auto size = root.GetSize();
+                for (size_t i = 0; i < size; ++i) {
+                    const auto first = problems.size();
+                    auto element = Compile(root[i], roleTable, problems);
+                    LocateProblems(problems, first, std::to_string(i));
+                    if (element == nullptr) {
+                        continue;
+                    }
+                    if (node == nullptr) {
+                        node.reset(new IndexNode());
+                        node->elements.resize(size);
+                    }
+                    node->elements[i] = std::move(element);
+                }
+            } break;
+
+            case Json::Value::Type::Object: {
+                for (const auto entry: root) {
+                    const auto first = problems.size();
+                    auto child = Compile(entry.value(), roleTable, problems);
+                    LocateProblems(problems, first, entry.key());
+                    if (child == nullptr) {
+                        continue;
+                    }
+                    if (node == nullptr) {
+                        node.reset(new IndexNode());
+                    }
+                    node->children[entry.key()] = std::move(child);
+                }
+            } break;
+
+            default: break;
+        }
+        return node;
+    }
+
+    bool IsEmpty(const IndexNode& index) {
+        if (
+            index.wrapper
+            || !index.children.empty()
+        ) {
+            return false;
+        }
+        for (const auto& element: index.elements) {
+            if (element != nullptr) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ParsePosition(const std::string& key, size_t& position) {
+        if (key.empty()) {
+            return false;
+        }
+        position = 0;
+        for (const auto c: key) {
+            if ((c < '0') || (c > '9')) {
+                return false;
+            }
+            position = position * 10 + (size_t)(c - '0');
+        }
+        return true;
+    }
+
+    void RecompileAt(
+        std::unique_ptr< IndexNode >& index,
+        const Json::Value& root,
+        const std::vector< std::string >& path,
+        RoleTable& roleTable,
+        Problems& problems,
+        size_t offset
+    );
+
+    void RecompileContents(
+        std::unique_ptr< IndexNode >& index,
+        const Json::Value& root,
+        const std::vector< std::string >& path,
+        RoleTable& roleTable,
+        Problems& problems,
+        size_t offset
+    ) {
+        const auto& key = path[offset];
+        std::unique_ptr< IndexNode > child;
+        if (root.GetType() == Json::Value::Type::Array) {
+            const auto size = root.GetSize();
+            size_t position;
+            if (
+                !ParsePosition(key, position)
+                || (position >= size)
+            ) {
+                if (
+                    (index != nullptr)
+                    && (index->elements.size() > size)
+                ) {
+                    index->elements.resize(size);
+                }
+            } else {
+                if (
+                    (index != nullptr)
+                    && (position < index->elements.size())
+                ) {
+                    child = std::move(index->elements[position]);
+                }
+                const auto first = problems.size();
+                RecompileAt(child, root[position], path, roleTable, problems, offset + 1);
+                LocateProblems(problems, first, key);
+                if (child != nullptr) {
+                    if (index == nullptr) {
+                        index.reset(new IndexNode());
+                    }
+                    if (index->elements.size() < size) {
+                        index->elements.resize(size);
+                    }
+                    index->elements[position] = std::move(child);
+                }
+            }
+        } else {
+            if (index != nullptr) {
+                const auto childrenEntry = index->children.find(key);
+                if (childrenEntry != index->children.end()) {
+                    child = std::move(childrenEntry->second);
+                    (void)index->children.erase(childrenEntry);
+                }
+            }
+            if (root.Has(key)) {
+                const auto first = problems.size();
+                RecompileAt(child, root[key], path, roleTable, problems, offset + 1);
+                LocateProblems(problems, first, key);
+            } else {
+                child.reset();
+            }
+            if (child != nullptr) {
+                if (index == nullptr) {
+                    index.reset(new IndexNode());
+                }
+                index->children[key] = std::move(child);
+            }
+        }
+        if (
+            (index != nullptr)
+            && IsEmpty(*index)
+        ) {
+            index.reset();
+        }
+    }
+
+    void RecompileAt(
+        std::unique_ptr< IndexNode >& index,
+        const Json::Value& root,
+        const std::vector< std::string >& path,
+        RoleTable& roleTable,
+        Problems& problems,
+        size_t offset
+    ) {
+        if (offset >= path.size()) {
+            index = Compile(root, roleTable, problems);
+        } else if (
+            (index != nullptr)
+            && index->wrapper
+        ) {
+            RecompileContents(index->data, root["data"], path, roleTable, problems, offset);
+        } else {
+            RecompileContents(index, root, path, roleTable, problems, offset);
+        }
+    }
+
+}
+
+namespace Permissions {
+
+    bool RoleTable::Intern(const std::string& role, size_t& id) {
+        const auto idsEntry = ids_.find(role);
+        if (idsEntry != ids_.end()) {
+            id = idsEntry->second;
+            return true;
+        }
+        if (ids_.size() >= maxRoles) {
+            overflowed_ = true;
+            return false;
+        }
+        id = ids_.size();
+        ids_[role] = id;
+        return true;
+    }
+
+    RoleBits RoleTable::Lookup(const std::unordered_set< std::string >& roles) const {
+        RoleBits bits;
+        for (const auto& role: roles) {
+            const auto idsEntry = ids_.find(role);
+            if (idsEntry != ids_.end()) {
+                (void)bits.set(idsEntry->second);
+            }
+        }
+        return bits;
+    }
+
+    size_t RoleTable::GetSize() const {
+        return ids_.size();
+    }
+
+    bool RoleTable::Overflowed() const {
+        return overflowed_;
+    }
+
+    void Rule::Apply(RoleBits& rolesPermitted) const {
+        if (replace) {
+            rolesPermitted = required;
+        }
+        rolesPermitted |= allowed;
+    }
+
+    void CompiledMeta::Apply(RolesPermitted& rolesPermitted) const {
+        readData.Apply(rolesPermitted.readData);
+        readMeta.Apply(rolesPermitted.readMeta);
+        writeData.Apply(rolesPermitted.writeData);
+        writeMeta.Apply(rolesPermitted.writeMeta);
+        createData.Apply(rolesPermitted.createData);
+        deleteData.Apply(rolesPermitted.deleteData);
+    }
+
+    const IndexNode* IndexNode::GetChild(const std::string& key) const {
+        const auto childrenEntry = children.find(key);
+        if (childrenEntry == children.end()) {
+            return nullptr;
+        }
+        return childrenEntry->second.get();
+    }
+
+    const IndexNode* IndexNode::GetElement(size_t index) const {
+        if (index >= elements.size()) {
+            return nullptr;
+        }
+        return elements[index].get();
+    }
+
+    std::unique_ptr< IndexNode > Compile(
+        const Json::Value& root,
+        RoleTable& roleTable,
+        Problems& problems
+    ) {
+        if (
+            (root.GetType() == Json::Value::Type::Object)
+            && root.Has("data")
+        ) {
+            std::unique_ptr< IndexNode > node(new IndexNode());
+            node->wrapper = true;
+            node->meta = CompileMeta(root["meta"], roleTable, problems);
+            node->data = CompileContents(root["data"], roleTable, problems);
+            const auto first = problems.size();
+            node->metaData = CompileContents(root["meta"], roleTable, problems);
+            LocateProblems(problems, first, "meta");
+            return node;
+        }
+        return CompileContents(root, roleTable, problems);
+    }
+
+    std::unique_ptr< IndexNode > Copy(const IndexNode* index) {
+        if (index == nullptr) {
+            return nullptr;
+        }
+        std::unique_ptr< IndexNode > copy(new IndexNode());
+        copy->wrapper = index->wrapper;
+        copy->meta = index->meta;
+        copy->data = Copy(index->data.get());
+        copy->metaData = Copy(index->metaData.get());
+        for (const auto& childrenEntry: index->children) {
+            copy->children[childrenEntry.first] = Copy(childrenEntry.second.get());
+        }
+        copy->elements.reserve(index->elements.size());
+        for (const auto& element: index->elements) {
+            copy->elements.push_back(Copy(element.get()));
+        }
+        return copy;
+    }
+
+    void Recompile(
+        std::unique_ptr< IndexNode >& index,
+        const Json::Value& root,
+        const std::vector< std::string >& path,
+        RoleTable& roleTable,
+        Problems& problems
+    ) {
+        RecompileAt(index, root, path, roleTable, problems, 0);
+    }
+
+}
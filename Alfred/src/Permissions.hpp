@@ -0,0 +1,348 @@
+#pragma once
+
+/**
+ * @file Permissions.hpp
+ *
+ * This module declares the types and functions used by the Store to compile
+ * the permissions metadata ("meta.require" and "meta.allow") attached to the
+ * data it holds, and to evaluate which roles are permitted which operations.
+ */
+
+#include <bitset>
+#include <Json/Value.hpp>
+#include <memory>
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Permissions {
+
+    /**
+     * This is the maximum number of distinct roles which can be
+     * named in permissions metadata.
+     */
+    constexpr size_t maxRoles = 256;
+
+    /**
+     * This is a set of roles, where each role is represented by the
+     * bit at the position of the small integer identifier assigned
+     * to it by a RoleTable.
+     */
+    using RoleBits = std::bitset< maxRoles >;
+
+    /**
+     * This collects descriptions of anything found wrong with metadata
+     * while compiling it, so that it can be reported.
+     */
+    using Problems = std::vector< std::string >;
+
+    /**
+     * This assigns small integer identifiers to role names, so that sets of
+     * roles can be represented as RoleBits.
+     */
+    class RoleTable {
+        // Methods
+    public:
+        /**
+         * Return the identifier of the given role, assigning a new one if the
+         * role hasn't been seen before.
+         *
+         * @param[in] role
+         *     This is the name of the role to look up.
+         *
+         * @param[out] id
+         *     This is where to store the identifier of the role.
+         *
+         * @return
+         *     An indication of whether or not the role has an identifier
+         *     is returned.  This is false only if the table is full.
+         */
+        bool Intern(const std::string& role, size_t& id);
+
+        /**
+         * Return the set of identifiers of the given roles.  Roles which have
+         * no identifier are left out, since no permissions can name them.
+         *
+         * @param[in] roles
+         *     These are the names of the roles to look up.
+         *
+         * @return
+         *     The set of identifiers of the given roles is returned.
+         */
+        RoleBits Lookup(const std::unordered_set< std::string >& roles) const;
+
+        /**
+         * Return the number of roles which have identifiers.
+         *
+         * @return
+         *     The number of roles which have identifiers is returned.
+         */
+        size_t GetSize() const;
+
+        /**
+         * Return an indication of whether or not any role was left out of the
+         * table because the table was full.
+         *
+         * @return
+         *     An indication of whether or not any role was left out of the
+         *     table because the table was full is returned.
+         */
+        bool Overflowed() const;
+
+        // Private properties
+    private:
+        /**
+         * This maps role names to their identifiers.
+         */
+        std::unordered_map< std::string, size_t > ids_;
+
+        /**
+         * This indicates whether or not any role was left out of the
+         * table because the table was full.
+         */
+        bool overflowed_ = false;
+    };
+
+    /**
+     * This represents the roles held by a client of the Store.
+     */
+    struct RolesHeld {
+        /**
+         * This indicates whether the holder is permitted every operation
+         * regardless of roles (used internally, for example to read the
+         * store configuration).
+         */
+        bool unrestricted = false;
+
+        /**
+         * These are the roles held.
+         */
+        RoleBits roles;
+    };
+
+    /**
+     * This tracks which roles are permitted which operations
+     * at some level of the JSON composition of the store.
+     */
+    struct RolesPermitted {
+        RoleBits readData;
+        RoleBits readMeta;
+        RoleBits writeData;
+        RoleBits writeMeta;
+        RoleBits createData;
+        RoleBits deleteData;
+    };
+
+    /**
+     * This is the compiled form of the effect a single piece of metadata
+     * has on the roles permitted a single operation.
+     */
+    struct Rule {
+        /**
+         * This indicates whether the metadata replaces the roles permitted
+         * the operation with the "required" set ("meta.require").
+         */
+        bool replace = false;
+
+        /**
+         * If "replace" is set, these are the only roles permitted the
+         * operation, before "allowed" is considered.
+         */
+        RoleBits required;
+
+        /**
+         * These are additional roles permitted the operation ("meta.allow").
+         */
+        RoleBits allowed;
+
+        /**
+         * Apply the rule to the given set of roles permitted the operation.
+         *
+         * @param[in,out] rolesPermitted
+         *     This is the set of roles permitted the operation.
+         */
+        void Apply(RoleBits& rolesPermitted) const;
+    };
+
+    /**
+     * This is the compiled form of the "meta" object of a node in the store.
+     */
+    struct CompiledMeta {
+        Rule readData;
+        Rule readMeta;
+        Rule writeData;
+        Rule writeMeta;
+        Rule createData;
+        Rule deleteData;
+
+        /**
+         * Apply the metadata to the given roles permitted.
+         *
+         * @param[in,out] rolesPermitted
+         *     This tracks which roles are permitted which operations.
+         */
+        void Apply(RolesPermitted& rolesPermitted) const;
+    };
+
+    /**
+     * This is one node of the permissions index, which mirrors the parts
+     * of the store which contain metadata.  Parts of the store which have no
+     * metadata anywhere inside them have no node in the index.
+     */
+    struct IndexNode {
+        /**
+         * This indicates whether the node is an object having "data" (and
+         * usually "meta") keys, rather than plain data.
+         */
+        bool wrapper = false;
+
+        /**
+         * For a wrapper, this is the compiled form of its metadata.
+         */
+        CompiledMeta meta;
+
+        /**
+         * For a wrapper, this is the index of its "data" value,
+         * if it contains any metadata.
+         */
+        std::unique_ptr< IndexNode > data;
+
+        /**
+         * For a wrapper, this is the index of its "meta" value,
+         * if it contains any metadata.
+         */
+        std::unique_ptr< IndexNode > metaData;
+
+        /**
+         * For an object, these are the indexes of its values
+         * which contain metadata, keyed by object key.
+         */
+        std::unordered_map< std::string, std::unique_ptr< IndexNode > > children;
+
+        /**
+         * For an array, these are the indexes of its elements.  Elements
+         * containing no metadata have a null index.
+         */
+        std::vector< std::unique_ptr< IndexNode > > elements;
+
+        /**
+         * Return the index of the object value with the given key,
+         * or null if that value contains no metadata.
+         *
+         * @param[in] key
+         *     This is the key of the object value to look up.
+         *
+         * @return
+         *     The index of the object value with the given key,
+         *     or null if that value contains no metadata, is returned.
+         */
+        const IndexNode* GetChild(const std::string& key) const;
+
+        /**
+         * Return the index of the array element at the given position,
+         * or null if that element contains no metadata.
+         *
+         * @param[in] index
+         *     This is the position of the array element to look up.
+         *
+         * @return
+         *     The index of the array element at the given position,
+         *     or null if that element contains no metadata, is returned.
+         */
+        const IndexNode* GetElement(size_t index) const;
+    };
+
+    /**
+     * Compile the metadata found anywhere in the given JSON value.
+     *
+     * @param[in] root
+     *     This is the JSON value to compile.
+     *
+     * @param[in,out] roleTable
+     *     This is used to assign identifiers to the roles named in the
+     *     metadata.
+     *
+     * @param[in,out] problems
+     *     This is where to describe anything found wrong with the metadata.
+     *     Whatever is wrong is left out of the index.
+     *
+     * @return
+     *     The index of the given value is returned, or null if the value
+     *     contains no metadata at all.
+     */
+    std::unique_ptr< IndexNode > Compile(
+        const Json::Value& root,
+        RoleTable& roleTable,
+        Problems& problems
+    );
+
+    /**
+     * Return a copy of the given index.
+     *
+     * @param[in] index
+     *     This is the index to copy.  It may be null.
+     *
+     * @return
+     *     A copy of the given index is returned.
+     */
+    std::unique_ptr< IndexNode > Copy(const IndexNode* index);
+
+    /**
+     * Update an index to reflect a change made to the store at the given
+     * path, recompiling only the part of the store which changed.
+     *
+     * @param[in,out] index
+     *     This is the index to update.  It is set to null if the store no
+     *     longer contains any metadata at all.
+     *
+     * @param[in] root
+     *     This is the top-level JSON value of the store, after the change.
+     *
+     * @param[in] path
+     *     This is the sequence of keys identifying the part of the store
+     *     which changed.  A key following an array is the decimal position
+     *     of the array element which changed.
+     *
+     * @param[in,out] roleTable
+     *     This is used to assign identifiers to the roles named in the
+     *     metadata.
+     *
+     * @param[in,out] problems
+     *     This is where to describe anything found wrong with the metadata
+     *     recompiled.  Whatever is wrong is left out of the index.
+     */
+    void Recompile(
+        std::unique_ptr< IndexNode >& index,
+        const Json::Value& root,
+        const std::vector< std::string >& path,
+        RoleTable& roleTable,
+        Problems& problems
+    );
+
+    /**
+     * Determine whether or not any of the given roles held
+     * is among the given roles permitted.
+     *
+     * @param[in] rolesPermitted
+     *     These are the roles permitted an operation.
+     *
+     * @param[in] rolesHeld
+     *     These are the roles held by a client.
+     *
+     * @return
+     *     An indication of whether or not the client is permitted
+     *     the operation is returned.
+     */
+    inline bool RolePermitted(
+        const RoleBits& rolesPermitted,
+        const RolesHeld& rolesHeld
+    ) {
+        return (
+            rolesHeld.unrestricted
+            || (rolesPermitted & rolesHeld.roles).any()
+        );
+    }
+
+}
@@ -0,0 +1,493 @@
+/**
+ * @file Replica.cpp
+ *
+ * This module contains the implementation of the Replica class which keeps
+ * the store up to date with the store of another instance of the service
+ * (the "leader"), over a WebSocket connected to the leader, and forwards
+ * to the leader the changes clients ask to make.
+ */
+
+#include "Diagnostics.hpp"
+#include "Replica.hpp"
+
+#include <Http/Client.hpp>
+#include <memory>
+#include <mutex>
+#include <Timekeeping/Scheduler.hpp>
+#include <unordered_map>
+#include <WebSockets/WebSocket.hpp>
+
+namespace {
+
+    /**
+     * This is how long, in seconds, to wait before reconnecting to the
+     * leader, if the configuration doesn't say.
+     */
+    constexpr double defaultRetryInterval = 5.0;
+
+    /**
+     * Encode one change to make to the store, in the same form as
+     * the operations of a "Batch" message.
+     *
+     * @param[in] mutation
+     *     This is the change to encode.
+     *
+     * @return
+     *     The encoded change is returned.
+     */
+    Json::Value EncodeMutation(const Store::Mutation& mutation) {
+        auto path = Json::Array({});
+        for (const auto& key: mutation.path) {
+            path.Add(key);
+        }
+        auto operation = Json::Object({
+            {"path", std::move(path)},
+        });
+        switch (mutation.type) {
+            case Store::Mutation::Type::Set: {
+                operation["type"] = "Set";
+                operation["value"] = mutation.value;
+            } break;
+
+            case Store::Mutation::Type::Add: {
+                operation["type"] = "Add";
+                operation["value"] = mutation.value;
+            } break;
+
+            case Store::Mutation::Type::Remove: {
+                operation["type"] = "Remove";
+            } break;
+        }
+        return operation;
+    }
+
+}
+
+/**
+ * This contains the private properties of a Replica class instance.
+ */
+struct Replica::Impl
+    : public std::enable_shared_from_this< Replica::Impl >
+{
+    // Properties
+
+    /**
+     * This is incremented every time the replica connects to the leader,
+     * so that anything still happening with an earlier connection can be
+     * recognized and ignored.
+     */
+    size_t connection = 0;
+
+    SystemAbstractions::DiagnosticsSender diagnosticsSender;
+
+    /**
+     * These are the functions to call once the leader responds to
+     * changes forwarded to it, keyed by the identifiers of the "Forward"
+     * messages sent.
+     */
+    std::unordered_map< int, ForwardCompletionDelegate > forwards;
+
+    std::shared_ptr< HttpClientTransactions > httpClientTransactions;
+    std::string key;
+    std::string leader;
+    bool mobilized = false;
+    std::mutex mutex;
+    int nextForwardId = 1;
+
+    /**
+     * This indicates whether the leader has sent the first image of its
+     * store over the current connection, so that the store is in step
+     * with it.
+     */
+    bool replicating = false;
+
+    double retryInterval = defaultRetryInterval;
+    int retryToken = 0;
+    Timekeeping::Scheduler scheduler;
+    std::shared_ptr< Store > store;
+    std::shared_ptr< WebSockets::WebSocket > ws;
+
+    // Constructor
+
+    Impl()
+        : diagnosticsSender("Replica")
+    {
+    }
+
+    // Methods
+
+    /**
+     * Begin connecting to the leader.
+     *
+     * @param[in,out] lock
+     *     This is the object holding the mutex of the replica.
+     *     It's released before returning.
+     */
+    void Connect(std::unique_lock< decltype(mutex) >& lock) {
+        Http::Request request;
+        request.method = "GET";
+        if (!request.target.ParseFromString(leader)) {
+            diagnosticsSender.SendDiagnosticInformationFormatted(
+                SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                "Bad leader URL: \"%s\"",
+                leader.c_str()
+            );
+            lock.unlock();
+            return;
+        }
+        const auto newWs = std::make_shared< WebSockets::WebSocket >();
+        (void)newWs->SubscribeToDiagnostics(diagnosticsSender.Chain());
+        newWs->StartOpenAsClient(request);
+        const auto thisConnection = ++connection;
+        diagnosticsSender.SendDiagnosticInformationFormatted(
+            2,
+            "Connecting to leader at %s",
+            leader.c_str()
+        );
+        std::weak_ptr< Impl > selfWeak(shared_from_this());
+        const auto transactions = httpClientTransactions;
+        lock.unlock();
+        transactions->Post(
+            request,
+            [selfWeak, thisConnection](Http::Response& response){
+                const auto self = selfWeak.lock();
+                if (self == nullptr) {
+                    return;
+                }
+                self->OnConnectionResponse(thisConnection, response);
+            },
+            [newWs, selfWeak, thisConnection](
+                const Http::Response& response,
+                std::shared_ptr< Http::Connection > connection,
+                const std::string& trailer
+            ){
+                const auto self = selfWeak.lock();
+                if (self == nullptr) {
+                    return;
+                }
+                self->OnUpgraded(thisConnection, newWs, response, connection);
+            }
+        );
+    }
+
+    /**
+     * Stop using the current connection to the leader, if any, and tell
+     * everyone still waiting for forwarded changes that they weren't made.
+     *
+     * @param[in,out] lock
+     *     This is the object holding the mutex of the replica.
+     *     It's released before returning.
+     */
+    void Disconnect(std::unique_lock< decltype(mutex) >& lock) {
+        ++connection;
+        replicating = false;
+        const auto oldWs = std::move(ws);
+        auto abandoned = std::move(forwards);
+        forwards.clear();
+        lock.unlock();
+        if (oldWs != nullptr) {
+            oldWs->Close();
+        }
+        for (const auto& forwardsEntry: abandoned) {
+            forwardsEntry.second(false);
+        }
+    }
+
+    /**
+     * Arrange to connect to the leader again after the retry interval.
+     */
+    void ScheduleRetry() {
+        if (
+            !mobilized
+            || (retryToken != 0)
+        ) {
+            return;
+        }
+        std::weak_ptr< Impl > selfWeak(shared_from_this());
+        retryToken = scheduler.Schedule(
+            [selfWeak]{
+                const auto self = selfWeak.lock();
+                if (self == nullptr) {
+                    return;
+                }
+                std::unique_lock< decltype(self->mutex) > lock(self->mutex);
+                self->retryToken = 0;
+                if (!self->mobilized) {
+                    return;
+                }
+                self->Connect(lock);
+            },
+            scheduler.GetClock()->GetCurrentTime() + retryInterval
+        );
+    }
+
+    /**
+     * Drop the current connection to the leader and arrange to
+     * connect again later.
+     *
+     * @param[in,out] lock
+     *     This is the object holding the mutex of the replica.
+     *     It's released before returning.
+     */
+    void Reconnect(std::unique_lock< decltype(mutex) >& lock) {
+        ScheduleRetry();
+        Disconnect(lock);
+    }
+
+    void OnConnectionResponse(
+        size_t thisConnection,
+        const Http::Response& response
+    ) {
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        if (
+            (thisConnection != connection)
+            || (response.statusCode == 101)
+        ) {
+            return;
+        }
+        diagnosticsSender.SendDiagnosticInformationFormatted(
+            SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+            "Unable to connect to leader (%u %s)",
+            response.statusCode,
+            response.reasonPhrase.c_str()
+        );
+        Reconnect(lock);
+    }
+
+    void OnUpgraded(
+        size_t thisConnection,
+        const std::shared_ptr< WebSockets::WebSocket >& newWs,
+        const Http::Response& response,
+        const std::shared_ptr< Http::Connection >& httpConnection
+    ) {
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        if (thisConnection != connection) {
+            return;
+        }
+        if (!newWs->FinishOpenAsClient(httpConnection, response)) {
+            diagnosticsSender.SendDiagnosticInformationString(
+                SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                "Leader refused WebSocket"
+            );
+            Reconnect(lock);
+            return;
+        }
+        std::weak_ptr< Impl > selfWeak(shared_from_this());
+        WebSockets::WebSocket::Delegates delegates;
+        delegates.close = [selfWeak, thisConnection](
+            unsigned int code,
+            const std::string& reason
+        ){
+            const auto self = selfWeak.lock();
+            if (self == nullptr) {
+                return;
+            }
+            self->OnClosed(thisConnection, code, reason);
+        };
+        delegates.text = [selfWeak, thisConnection](const std::string& data){
+            const auto self = selfWeak.lock();
+            if (self == nullptr) {
+                return;
+            }
+            self->OnText(thisConnection, data);
+        };
+        newWs->SetDelegates(std::move(delegates));
+        ws = newWs;
+        diagnosticsSender.SendDiagnosticInformationString(
+            2,
+            "Connected to leader; authenticating"
+        );
+        ws->SendText(
+            Json::Object({
+                {"type", "Authenticate"},
+                {"key", key},
+            }).ToEncoding()
+        );
+    }
+
+    void OnClosed(
+        size_t thisConnection,
+        unsigned int code,
+        const std::string& reason
+    ) {
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        if (thisConnection != connection) {
+            return;
+        }
+        diagnosticsSender.SendDiagnosticInformationFormatted(
+            SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+            "Leader closed connection (code %u, reason: \"%s\")",
+            code,
+            reason.c_str()
+        );
+        Reconnect(lock);
+    }
+
+    void OnText(
+        size_t thisConnection,
+        const std::string& data
+    ) {
+        const auto message = Json::Value::FromEncoding(data);
+        const std::string type = message["type"];
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        if (
+            (thisConnection != connection)
+            || (ws == nullptr)
+        ) {
+            return;
+        }
+        if (type == "Replication") {
+            const bool whole = message["whole"];
+            if (
+                !whole
+                && !replicating
+            ) {
+                return;
+            }
+            // The store is left to deliver updates to its subscribers
+            // without the replica locked.
+            lock.unlock();
+            const auto applied = store->ApplyReplicated(whole, message["data"]);
+            lock.lock();
+            if (thisConnection != connection) {
+                return;
+            }
+            if (!applied) {
+                diagnosticsSender.SendDiagnosticInformationString(
+                    SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                    "Store out of step with leader; reconnecting to catch up"
+                );
+                Reconnect(lock);
+                return;
+            }
+            if (whole) {
+                if (!replicating) {
+                    diagnosticsSender.SendDiagnosticInformationFormatted(
+                        3,
+                        "Replicating leader (revision %zu)",
+                        (size_t)message["revision"]
+                    );
+                }
+                replicating = true;
+            }
+        } else if (type == "Forwarded") {
+            const int id = message["id"];
+            const auto forwardsEntry = forwards.find(id);
+            if (forwardsEntry == forwards.end()) {
+                return;
+            }
+            const auto onCompletion = std::move(forwardsEntry->second);
+            (void)forwards.erase(forwardsEntry);
+            lock.unlock();
+            const bool applied = message["applied"];
+            onCompletion(applied);
+        } else if (type == "Authenticated") {
+            ws->SendText(
+                Json::Object({
+                    {"type", "Replicate"},
+                }).ToEncoding()
+            );
+        } else if (type == "Error") {
+            diagnosticsSender.SendDiagnosticInformationFormatted(
+                SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                "Error from leader: %s",
+                ((std::string)message["message"]).c_str()
+            );
+        }
+    }
+
+};
+
+Replica::~Replica() noexcept {
+    Demobilize();
+}
+
+Replica::Replica(Replica&&) noexcept = default;
+Replica& Replica::operator=(Replica&&) noexcept = default;
+
+Replica::Replica()
+    : impl_(new Impl())
+{
+}
+
+void Replica::Demobilize() {
+    if (impl_ == nullptr) {
+        return;
+    }
+    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (!impl_->mobilized) {
+        return;
+    }
+    impl_->mobilized = false;
+    if (impl_->retryToken != 0) {
+        impl_->scheduler.Cancel(impl_->retryToken);
+        impl_->retryToken = 0;
+    }
+    impl_->scheduler.SetClock(nullptr);
+    impl_->Disconnect(lock);
+}
+
+bool Replica::Forward(
+    const std::vector< Store::Mutation >& mutations,
+    const std::unordered_set< std::string >& identifiers,
+    ForwardCompletionDelegate onCompletion
+) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (
+        (impl_->ws == nullptr)
+        || !impl_->replicating
+    ) {
+        return false;
+    }
+    const auto id = impl_->nextForwardId++;
+    impl_->forwards[id] = onCompletion;
+    auto encodedIdentifiers = Json::Array({});
+    for (const auto& identifier: identifiers) {
+        encodedIdentifiers.Add(identifier);
+    }
+    auto operations = Json::Array({});
+    for (const auto& mutation: mutations) {
+        operations.Add(EncodeMutation(mutation));
+    }
+    impl_->ws->SendText(
+        Json::Object({
+            {"type", "Forward"},
+            {"id", id},
+            {"identifiers", std::move(encodedIdentifiers)},
+            {"operations", std::move(operations)},
+        }).ToEncoding()
+    );
+    return true;
+}
+
+SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate Replica::SubscribeToDiagnostics(
+    SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+    size_t minLevel
+) {
+    return impl_->diagnosticsSender.SubscribeToDiagnostics(delegate, minLevel);
+}
+
+void Replica::Mobilize(
+    const std::shared_ptr< Store >& store,
+    const std::shared_ptr< HttpClientTransactions >& httpClientTransactions,
+    const std::shared_ptr< Timekeeping::Clock >& clock,
+    const Json::Value& configuration
+) {
+    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (impl_->mobilized) {
+        return;
+    }
+    impl_->store = store;
+    impl_->httpClientTransactions = httpClientTransactions;
+    impl_->leader = (std::string)configuration["Leader"];
+    impl_->key = (std::string)configuration["Key"];
+    if (configuration.Has("RetryInterval")) {
+        impl_->retryInterval = configuration["RetryInterval"];
+    } else {
+        impl_->retryInterval = defaultRetryInterval;
+    }
+    impl_->scheduler.SetClock(clock);
+    impl_->mobilized = true;
+    store->SetReadOnly(true);
+    impl_->Connect(lock);
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+/**
+ * @file Replica.hpp
+ *
+ * This module declares the Replica class which keeps the store up to date
+ * with the store of another instance of the service (the "leader"), over
+ * a WebSocket connected to the leader, and forwards to the leader the
+ * changes clients ask to make.
+ */
+
+#include "HttpClientTransactions.hpp"
+#include "Store.hpp"
+
+#include <functional>
+#include <Json/Value.hpp>
+#include <memory>
+#include <string>
+#include <SystemAbstractions/DiagnosticsSender.hpp>
+#include <Timekeeping/Clock.hpp>
+#include <unordered_set>
+#include <vector>
+
+class Replica {
+    // Types
+public:
+    /**
+     * This is the type of function called once the leader has
+     * responded to changes forwarded to it.
+     *
+     * @param[in] applied
+     *     This indicates whether or not the leader made the changes.
+     */
+    using ForwardCompletionDelegate = std::function< void(bool applied) >;
+
+    // Lifecycle
+public:
+    ~Replica() noexcept;
+    Replica(const Replica&) = delete;
+    Replica(Replica&&) noexcept;
+    Replica& operator=(const Replica&) = delete;
+    Replica& operator=(Replica&&) noexcept;
+
+    // Constructor
+public:
+    Replica();
+
+    // Methods
+public:
+    void Demobilize();
+
+    /**
+     * Ask the leader to make the given changes to its store on behalf of a
+     * client having the given identifiers.  The leader decides for itself
+     * which roles the client holds.  The changes reach the store of the
+     * replica the same way as any others made to the leader, so they may
+     * not yet be seen in it when the leader responds.
+     *
+     * @param[in] mutations
+     *     These are the changes to make, in order.
+     *
+     * @param[in] identifiers
+     *     These are the identifiers of the client.
+     *
+     * @param[in] onCompletion
+     *     This is the function to call once the leader has responded,
+     *     or the connection to the leader is lost.
+     *
+     * @return
+     *     An indication of whether or not the changes were forwarded
+     *     is returned.  They aren't if the replica isn't in step with
+     *     the leader, in which case the completion function is
+     *     never called.
+     */
+    bool Forward(
+        const std::vector< Store::Mutation >& mutations,
+        const std::unordered_set< std::string >& identifiers,
+        ForwardCompletionDelegate onCompletion
+    );
+
+    /**
+     * This method forms a new subscription to diagnostic
+     * messages published by the class.
+     *
+     * @param[in] delegate
+     *     This is the function to call to deliver messages
+     *     to the subscriber.
+     *
+     * @param[in] minLevel
+     *     This is the minimum level of message that this subscriber
+     *     desires to receive.
+     *
+     * @return
+     *     A function is returned which may be called
+     *     to terminate the subscription.
+     */
+    SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate SubscribeToDiagnostics(
+        SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+        size_t minLevel = 0
+    );
+
+    /**
+     * Connect to the leader and begin keeping the given store up to date
+     * with it.  The store is made read-only.  The replica reconnects to
+     * the leader whenever the connection is lost.
+     *
+     * @param[in] store
+     *     This is the store to keep up to date.
+     *
+     * @param[in] httpClientTransactions
+     *     This is used to connect to the leader.
+     *
+     * @param[in] clock
+     *     This is used to schedule reconnecting to the leader.
+     *
+     * @param[in] configuration
+     *     This holds the settings found under "Replication" in the
+     *     configuration of the service:
+     *     - "Leader": the URL of the WebSocket resource of the leader
+     *     - "Key": the access key with which to authenticate to the leader,
+     *       whose identifier must be granted the "replica" role there
+     *     - "RetryInterval": how long, in seconds, to wait before
+     *       reconnecting to the leader
+     */
+    void Mobilize(
+        const std::shared_ptr< Store >& store,
+        const std::shared_ptr< HttpClientTransactions >& httpClientTransactions,
+        const std::shared_ptr< Timekeeping::Clock >& clock,
+        const Json::Value& configuration
+    );
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::shared_ptr< Impl > impl_;
+};
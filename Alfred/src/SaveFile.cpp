@@ -0,0 +1,142 @@
+/**
+ * @file SaveFile.cpp
+ *
+ * This module contains the implementation of the SaveFile, FlushFile,
+ * and FlushDirectory functions.
+ */
+
+#include "SaveFile.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#include <Windows.h>
+#else /* POSIX */
+#include <fcntl.h>
+#include <unistd.h>
+#endif /* _WIN32 or POSIX */
+
+namespace {
+
+    /**
+     * Rename a file, replacing any file already having the new name.
+     *
+     * @param[in] oldPath
+     *     This is the path of the file to rename.
+     *
+     * @param[in] newPath
+     *     This is the new path to give the file.
+     *
+     * @return
+     *     An indication of whether or not the function succeeded is returned.
+     */
+    bool RenameOver(
+        const std::string& oldPath,
+        const std::string& newPath
+    ) {
+#ifdef _WIN32
+        return (
+            MoveFileExA(
+                oldPath.c_str(),
+                newPath.c_str(),
+                MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH
+            ) != 0
+        );
+#else /* POSIX */
+        return (rename(oldPath.c_str(), newPath.c_str()) == 0);
+#endif /* _WIN32 or POSIX */
+    }
+
+}
+
+bool FlushFile(FILE* file) {
+    if (fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return (_commit(_fileno(file)) == 0);
+#else /* POSIX */
+    return (fsync(fileno(file)) == 0);
+#endif /* _WIN32 or POSIX */
+}
+
+bool FlushDirectory(const std::string& filePath) {
+#ifdef _WIN32
+    // Windows has no way to flush a directory, but doesn't need one,
+    // since files are renamed with MOVEFILE_WRITE_THROUGH, which doesn't
+    // return until the new name is stored.
+    (void)filePath;
+    return true;
+#else /* POSIX */
+    const auto delimiter = filePath.find_last_of('/');
+    std::string directoryPath;
+    if (delimiter == std::string::npos) {
+        directoryPath = ".";
+    } else if (delimiter == 0) {
+        directoryPath = "/";
+    } else {
+        directoryPath = filePath.substr(0, delimiter);
+    }
+    const auto directory = open(directoryPath.c_str(), O_RDONLY);
+    if (directory < 0) {
+        return false;
+    }
+    const auto flushed = (fsync(directory) == 0);
+    return ((close(directory) == 0) && flushed);
+#endif /* _WIN32 or POSIX */
+}
+
+bool SaveFile(
+    const std::string& filePath,
+    const std::string& fileDescription,
+    const SystemAbstractions::DiagnosticsSender& diagnosticsSender,
+    const std::string& fileContents
+) {
+    const auto tempFilePath = filePath + ".tmp";
+    const auto file = fopen(tempFilePath.c_str(), "wb");
+    if (file == NULL) {
+        diagnosticsSender.SendDiagnosticInformationFormatted(
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "Unable to open %s file '%s' for writing",
+            fileDescription.c_str(),
+            tempFilePath.c_str()
+        );
+        return false;
+    }
+    const auto written = fwrite(fileContents.data(), 1, fileContents.size(), file);
+    const auto flushed = FlushFile(file);
+    const auto closed = (fclose(file) == 0);
+    if (
+        (written != fileContents.size())
+        || !flushed
+        || !closed
+    ) {
+        diagnosticsSender.SendDiagnosticInformationFormatted(
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "Unable to write %s file '%s'",
+            fileDescription.c_str(),
+            tempFilePath.c_str()
+        );
+        (void)remove(tempFilePath.c_str());
+        return false;
+    }
+    if (!RenameOver(tempFilePath, filePath)) {
+        diagnosticsSender.SendDiagnosticInformationFormatted(
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "Unable to replace %s file '%s'",
+            fileDescription.c_str(),
+            filePath.c_str()
+        );
+        (void)remove(tempFilePath.c_str());
+        return false;
+    }
+    if (!FlushDirectory(filePath)) {
+        diagnosticsSender.SendDiagnosticInformationFormatted(
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "Unable to flush directory of %s file '%s'",
+            fileDescription.c_str(),
+            filePath.c_str()
+        );
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+/**
+ * @file SaveFile.hpp
+ *
+ * This module declares the SaveFile, FlushFile, and FlushDirectory
+ * functions.
+ */
+
+#include <stdio.h>
+#include <string>
+#include <SystemAbstractions/DiagnosticsSender.hpp>
+
+/**
+ * This function flushes to storage everything written to the given file,
+ * so that it survives the program or the system crashing.
+ *
+ * @param[in] file
+ *     This is the file to flush.
+ *
+ * @return
+ *     An indication of whether or not the function succeeded is returned.
+ */
+bool FlushFile(FILE* file);
+
+/**
+ * This function flushes to storage the directory holding the file with
+ * the given path, so that the file being created, renamed, or removed
+ * there survives the system crashing.  Flushing a file doesn't do this,
+ * since the names of files are part of the directory rather than
+ * the file.
+ *
+ * @param[in] filePath
+ *     This is the path of a file in the directory to flush.
+ *
+ * @return
+ *     An indication of whether or not the function succeeded is returned.
+ */
+bool FlushDirectory(const std::string& filePath);
+
+/**
+ * This function replaces the contents of the file with the given path
+ * with the given string.  The contents are first written to a temporary
+ * file beside it, and flushed to storage, before the temporary file is
+ * renamed over the original, so that the file is never left partly
+ * written, even if the program or the system crashes.
+ *
+ * @param[in] filePath
+ *     This is the path of the file to save.
+ *
+ * @param[in] fileDescription
+ *     This is a description of the file being saved, used in any
+ *     diagnostic messages published by the function.
+ *
+ * @param[in] diagnosticsSender
+ *     This is the object to use to publish any diagnostic messages.
+ *
+ * @param[in] fileContents
+ *     This is what to store in the file.
+ *
+ * @return
+ *     An indication of whether or not the function succeeded is returned.
+ */
+bool SaveFile(
+    const std::string& filePath,
+    const std::string& fileDescription,
+    const SystemAbstractions::DiagnosticsSender& diagnosticsSender,
+    const std::string& fileContents
+);
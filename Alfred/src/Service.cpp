@@ -8,19 +8,23 @@
 #include "ApiWs.hpp"
 #include "HttpClientTransactions.hpp"
 #include "LoadFile.hpp"
+#include "LogSink.hpp"
+#include "Metrics.hpp"
+#include "Replica.hpp"
 #include "Service.hpp"
 #include "Store.hpp"
 #include "TimeKeeper.hpp"
 
-#include <AsyncData/Dispatcher.hpp>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <future>
 #include <Http/Client.hpp>
 #include <Http/Server.hpp>
 #include <HttpNetworkTransport/HttpClientNetworkTransport.hpp>
 #include <HttpNetworkTransport/HttpServerNetworkTransport.hpp>
-#include <inttypes.h>
 #include <Json/Value.hpp>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <signal.h>
@@ -28,7 +32,6 @@
 #include <SystemAbstractions/DiagnosticsStreamReporter.hpp>
 #include <SystemAbstractions/File.hpp>
 #include <SystemAbstractions/NetworkConnection.hpp>
-#include <time.h>
 #include <TlsDecorator/TlsDecorator.hpp>
 
 namespace {
@@ -43,6 +46,18 @@ namespace {
          */
         std::string storeFilePath;
 
+        /**
+         * This is the path to the file holding the "Configuration" and
+         * "Roles" settings which override those in the store.
+         */
+        std::string settingsFilePath = SystemAbstractions::File::GetExeParentDirectory() + "/AlfredSettings.json";
+
+        /**
+         * This flag indicates whether or not the settings file
+         * path was given on the command line.
+         */
+        bool settingsFilePathGiven = false;
+
         /**
          * This is the path to the file to which to write diagnostic messages
          * when running as a daemon.
@@ -56,20 +71,6 @@ namespace {
         bool daemon = false;
     };
 
-    std::string FormatDate(double time) {
-        char buffer[20];
-        auto timeSeconds = (time_t)time;
-        (void)strftime(buffer, sizeof(buffer), "%Y-%m-%d", gmtime(&timeSeconds));
-        return buffer;
-    }
-
-    std::string FormatTime(double time) {
-        char buffer[20];
-        auto timeSeconds = (time_t)time;
-        (void)strftime(buffer, sizeof(buffer), "%H:%M:%S", gmtime(&timeSeconds));
-        return buffer;
-    }
-
     /**
      * Encode the given JSON value and write it out to the given file.
      *
@@ -139,6 +140,9 @@ namespace {
                 "Options:\n"
                 "  -s|--store PATH\n"
                 "    Use configuration saved in the file at the given PATH.\n"
+                "  -c|--settings PATH\n"
+                "    Apply settings from the file at the given PATH at startup\n"
+                "    and on SIGHUP, overriding what's in the store.\n"
                 "  -d|--daemon\n"
                 "    Run Alfred as a daemon, rather than directly\n"
                 "    in the terminal.  (NOTE: requires separate OS-specific installation steps.)\n"
@@ -152,6 +156,12 @@ namespace {
      */
     bool shutDown = false;
 
+    /**
+     * This flag indicates whether or not the settings should be
+     * reloaded from the settings file.
+     */
+    volatile sig_atomic_t reloadSettings = 0;
+
     /**
      * This function is used when the service is attached to a terminal.
      * It is set up to be called when the SIGINT signal is
@@ -166,6 +176,53 @@ namespace {
         shutDown = true;
     }
 
+#ifdef SIGHUP
+    /**
+     * This function is set up to be called when the SIGHUP signal is
+     * received by the program.  It just sets the "reloadSettings" flag
+     * and relies on the program to be polling the flag to detect
+     * when it's been set.
+     *
+     * @param[in] sig
+     *     This is the signal for which this function was called.
+     */
+    void HangUpHandler(int) {
+        reloadSettings = 1;
+    }
+#endif /* SIGHUP */
+
+    /**
+     * This holds onto the subscription of the service to the diagnostic
+     * messages of one of its components, so that it can be formed again
+     * when the reporting threshold for the component is changed.
+     */
+    struct DiagnosticsSubscription {
+        /**
+         * This is the type of function which forms the subscription,
+         * given the minimum level of message to receive.
+         */
+        using Subscribe = std::function<
+            SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate(
+                size_t minLevel
+            )
+        >;
+
+        /**
+         * This is the function which forms the subscription.
+         */
+        Subscribe subscribe;
+
+        /**
+         * This is the minimum level of message currently received.
+         */
+        size_t minLevel = 0;
+
+        /**
+         * This is the function to call to terminate the subscription.
+         */
+        SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate unsubscribe;
+    };
+
 }
 
 /**
@@ -178,16 +235,32 @@ struct Service::Impl
 
     std::shared_ptr< ApiWs > apiWs;
 
+    /**
+     * This is set by the store whenever the "Configuration" part of
+     * the store changes, so that the new settings can be applied
+     * to the components of the service.
+     */
+    std::atomic< bool > configurationChanged{false};
+
+    /**
+     * This holds the minimum levels of diagnostic messages to report from
+     * each component, keyed by component name.  It's guarded by the
+     * mutex, since connections read it as they're made.
+     */
     Json::Value diagnosticReportingThresholds;
 
+    /**
+     * These are the subscriptions of the service to the diagnostic
+     * messages of its components, keyed by component name.
+     */
+    std::map< std::string, DiagnosticsSubscription > diagnosticsSubscriptions;
+
     /**
      * This is used to publish diagnostic messages generated by the service
      * or one of its components.
      */
     SystemAbstractions::DiagnosticsSender diagnosticsSender;
 
-    AsyncData::Dispatcher dispatcher;
-
     /**
      * This contains variables set through the operating system environment or
      * the command-line arguments.
@@ -206,11 +279,23 @@ struct Service::Impl
      */
     std::shared_ptr< Http::Server > httpServer;
 
+    /**
+     * This holds the metrics measuring the service and its components,
+     * which are published via HTTP.
+     */
+    const std::shared_ptr< Metrics > metrics = std::make_shared< Metrics >();
+
     /**
      * This is used to synchronize access to this structure.
      */
     std::mutex mutex;
 
+    /**
+     * If the service is configured to replicate another instance
+     * of the service, this keeps the store up to date with the other.
+     */
+    std::shared_ptr< Replica > replica;
+
     /**
      * This is used to signal the service to stop.
      */
@@ -228,6 +313,12 @@ struct Service::Impl
      */
     std::shared_ptr< Store > store = std::make_shared< Store >();
 
+    /**
+     * This is the function to call to stop receiving updates when
+     * the "Configuration" part of the store changes.
+     */
+    std::function< void() > unsubscribeFromConfiguration;
+
     /**
      * This is used to track time.
      */
@@ -242,18 +333,79 @@ struct Service::Impl
 
     // Methods
 
+    /**
+     * Apply the settings found under "Configuration" in the store to the
+     * components of the service which are already running.  Settings which
+     * are read only when the service starts, such as those of the log and
+     * of TLS, stay as they were until the service is restarted.
+     */
+    void ApplyConfiguration() {
+        const auto configuration = store->GetData({"Configuration"}, {});
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            diagnosticReportingThresholds = configuration["DiagnosticReportingThresholds"];
+        }
+        for (auto& diagnosticsSubscriptionsEntry: diagnosticsSubscriptions) {
+            const auto& name = diagnosticsSubscriptionsEntry.first;
+            auto& subscription = diagnosticsSubscriptionsEntry.second;
+            const auto minLevel = GetDiagnosticReportingThreshold(name);
+            if (minLevel == subscription.minLevel) {
+                continue;
+            }
+            subscription.unsubscribe();
+            subscription.minLevel = minLevel;
+            subscription.unsubscribe = subscription.subscribe(minLevel);
+            diagnosticsSender.SendDiagnosticInformationFormatted(
+                3,
+                "Diagnostic reporting threshold for %s is now %zu",
+                name.c_str(),
+                minLevel
+            );
+        }
+        ApplyHttpServerConfiguration(configuration);
+    }
+
+    /**
+     * Give the web server the settings found under "Http"
+     * in the given configuration.
+     *
+     * @param[in] configuration
+     *     This holds all of the configuration items for the entire system.
+     */
+    void ApplyHttpServerConfiguration(const Json::Value& configuration) {
+        const auto& httpConfig = configuration["Http"];
+        if (httpConfig.GetType() == Json::Value::Type::Object) {
+            for (const auto keyValue: httpConfig) {
+                const auto& key = keyValue.key();
+                const auto& value = keyValue.value();
+                httpServer->SetConfigurationItem(key, value);
+            }
+        }
+    }
+
     /**
      * This function configures and starts the web client.
      */
     bool ConfigureAndStartHttpClient(const Json::Value& configuration) {
-        (void)httpClient->SubscribeToDiagnostics(
-            diagnosticsSender.Chain(),
-            diagnosticReportingThresholds["HttpClient"]
+        const auto client = httpClient;
+        SubscribeToComponentDiagnostics(
+            "HttpClient",
+            [this, client](size_t minLevel){
+                return client->SubscribeToDiagnostics(
+                    diagnosticsSender.Chain(),
+                    minLevel
+                );
+            }
         );
         auto clientTransport = std::make_shared< HttpNetworkTransport::HttpClientNetworkTransport >();
-        (void)clientTransport->SubscribeToDiagnostics(
-            diagnosticsSender.Chain(),
-            diagnosticReportingThresholds["HttpClientNetworkTransport"]
+        SubscribeToComponentDiagnostics(
+            "HttpClientNetworkTransport",
+            [this, clientTransport](size_t minLevel){
+                return clientTransport->SubscribeToDiagnostics(
+                    diagnosticsSender.Chain(),
+                    minLevel
+                );
+            }
         );
         std::string caCerts;
         auto cacertsPath = (std::string)configuration["CaCertificates"];
@@ -263,18 +415,24 @@ struct Service::Impl
         if (!LoadFile(cacertsPath, "CA certificates", diagnosticsSender, caCerts)) {
             return false;
         }
+        std::weak_ptr< HttpClientTransactions > httpClientTransactionsWeak(httpClientTransactions);
         clientTransport->SetConnectionFactory(
             [
                 caCerts,
+                httpClientTransactionsWeak,
                 this
             ](
                 const std::string& scheme,
                 const std::string& serverName
             ) -> std::shared_ptr< SystemAbstractions::INetworkConnection > {
+                const auto httpClientTransactions = httpClientTransactionsWeak.lock();
+                if (httpClientTransactions != nullptr) {
+                    httpClientTransactions->OnConnectionOpened(scheme, serverName);
+                }
                 const auto connection = std::make_shared< SystemAbstractions::NetworkConnection >();
                 (void)connection->SubscribeToDiagnostics(
                     diagnosticsSender.Chain(),
-                    diagnosticReportingThresholds["NetworkConnection"]
+                    GetDiagnosticReportingThreshold("NetworkConnection")
                 );
                 if (
                     (scheme == "https")
@@ -283,7 +441,7 @@ struct Service::Impl
                     const auto tlsDecorator = std::make_shared< TlsDecorator::TlsDecorator >();
                     (void)tlsDecorator->SubscribeToDiagnostics(
                         diagnosticsSender.Chain(),
-                        diagnosticReportingThresholds["TlsDecorator"]
+                        GetDiagnosticReportingThreshold("TlsDecorator")
                     );
                     tlsDecorator->ConfigureAsClient(connection, caCerts, serverName);
                     return tlsDecorator;
@@ -324,14 +482,25 @@ struct Service::Impl
     bool ConfigureAndStartHttpServer(const Json::Value& configuration) {
         Http::Server::MobilizationDependencies httpDeps;
         httpDeps.timeKeeper = std::make_shared< TimeKeeper >();
-        (void)httpServer->SubscribeToDiagnostics(
-            diagnosticsSender.Chain(),
-            diagnosticReportingThresholds["HttpServer"]
+        const auto server = httpServer;
+        SubscribeToComponentDiagnostics(
+            "HttpServer",
+            [this, server](size_t minLevel){
+                return server->SubscribeToDiagnostics(
+                    diagnosticsSender.Chain(),
+                    minLevel
+                );
+            }
         );
         auto transport = std::make_shared< HttpNetworkTransport::HttpServerNetworkTransport >();
-        (void)transport->SubscribeToDiagnostics(
-            diagnosticsSender.Chain(),
-            diagnosticReportingThresholds["HttpServerNetworkTransport"]
+        SubscribeToComponentDiagnostics(
+            "HttpServerNetworkTransport",
+            [this, transport](size_t minLevel){
+                return transport->SubscribeToDiagnostics(
+                    diagnosticsSender.Chain(),
+                    minLevel
+                );
+            }
         );
         std::string cert, key;
         auto certPath = (std::string)configuration["SslCertificate"];
@@ -360,7 +529,7 @@ struct Service::Impl
             const auto tlsDecorator = std::make_shared< TlsDecorator::TlsDecorator >();
             (void)tlsDecorator->SubscribeToDiagnostics(
                 diagnosticsSender.Chain(),
-                diagnosticReportingThresholds["TlsDecorator"]
+                GetDiagnosticReportingThreshold("TlsDecorator")
             );
             tlsDecorator->ConfigureAsServer(
                 connection,
@@ -372,17 +541,27 @@ struct Service::Impl
         };
         transport->SetConnectionDecoratorFactory(connectionDecoratorFactory);
         httpDeps.transport = transport;
-        const auto& httpConfig = configuration["Http"];
-        if (httpConfig.GetType() == Json::Value::Type::Object) {
-            for (const auto keyValue: httpConfig) {
-                const auto& key = keyValue.key();
-                const auto& value = keyValue.value();
-                httpServer->SetConfigurationItem(key, value);
-            }
-        }
+        ApplyHttpServerConfiguration(configuration);
         return httpServer->Mobilize(httpDeps);
     }
 
+    /**
+     * Return the minimum level of diagnostic messages to report from
+     * the component with the given name.
+     *
+     * @param[in] name
+     *     This is the name of the component.
+     *
+     * @return
+     *     The minimum level of diagnostic messages to report from
+     *     the component is returned.
+     */
+    size_t GetDiagnosticReportingThreshold(const std::string& name) {
+        std::lock_guard< decltype(mutex) > lock(mutex);
+        const size_t minLevel = diagnosticReportingThresholds[name];
+        return minLevel;
+    }
+
     bool LoadStore() {
         std::vector< std::string > possibleStoreFilePaths = {
             SystemAbstractions::File::GetExeParentDirectory() + "/Alfred.json",
@@ -395,40 +574,50 @@ struct Service::Impl
             );
         }
         for (const auto& possibleStoreFilePath: possibleStoreFilePaths) {
-            if (store->Mobilize(possibleStoreFilePath, timeKeeper)) {
-                return true;
+            if (store->Mobilize(possibleStoreFilePath, timeKeeper, metrics)) {
+                return ApplySettings();
             }
         }
         return false;
     }
 
     /**
-     * Create and return a delegate that will publish diagnostic messages
-     * to the console.
+     * Apply the settings file, if there is one, over the store, so that
+     * edits made to it while Alfred wasn't running take effect.  A
+     * settings file given on the command line must exist.
      *
-     * @param[in] normalOutputFile
-     *     This is the file to which to write "normal" (not warning or error)
-     *     messages.
+     * @return
+     *     An indication of whether or not the settings were applied
+     *     (or there were none to apply) is returned.
+     */
+    bool ApplySettings() {
+        SystemAbstractions::File settingsFile(environment.settingsFilePath);
+        if (
+            !environment.settingsFilePathGiven
+            && !settingsFile.IsExisting()
+        ) {
+            return true;
+        }
+        return store->ReloadSettings(environment.settingsFilePath);
+    }
+
+    /**
+     * Create and return a delegate that will publish diagnostic messages
+     * through the given log sink.
      *
-     * @param[in] errorOutputFile
-     *     This is the file to which to write warning or error messages.
+     * @param[in] logSink
+     *     This is the object which writes out the diagnostic messages.
      *
      * @return
      *     A delegate that will publish diagnostic messages
-     *     to the console is returned.
+     *     through the given log sink is returned.
      */
     SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate MakeDiagnosticPublisher(
-        std::shared_ptr< FILE > normalOutputFile,
-        std::shared_ptr< FILE > errorOutputFile
+        std::shared_ptr< LogSink > logSink
     ) {
-        const auto lastDay = std::make_shared< intmax_t >(0);
-        auto mutex = std::make_shared< std::mutex >();
         std::weak_ptr< Service::Impl > selfWeak(shared_from_this());
         return [
-            errorOutputFile,
-            lastDay,
-            mutex,
-            normalOutputFile,
+            logSink,
             selfWeak
         ](
             std::string senderName,
@@ -439,49 +628,10 @@ struct Service::Impl
             if (self == nullptr) {
                 return;
             }
-            const auto now = self->timeKeeper->GetCurrentTime();
-            self->dispatcher.Post(
-                [
-                    errorOutputFile,
-                    lastDay,
-                    level,
-                    mutex,
-                    message,
-                    normalOutputFile,
-                    now,
-                    senderName
-                ]{
-                    FILE* destination;
-                    std::string prefix;
-                    if (level >= SystemAbstractions::DiagnosticsSender::Levels::ERROR) {
-                        destination = errorOutputFile.get();
-                        prefix = "error: ";
-                    } else if (level >= SystemAbstractions::DiagnosticsSender::Levels::WARNING) {
-                        destination = errorOutputFile.get();
-                        prefix = "warning: ";
-                    } else {
-                        destination = normalOutputFile.get();
-                    }
-                    std::lock_guard< decltype(*mutex) > lock(*mutex);
-                    const auto day = (intmax_t)(now / 86400.0);
-                    if (day != *lastDay) {
-                        *lastDay = day;
-                        fprintf(
-                            destination,
-                            "--- [%s] ---\n",
-                            FormatDate(now).c_str()
-                        );
-                    }
-                    fprintf(
-                        destination,
-                        "[%s.%06" PRIdMAX " (%zu)] %s%s\n",
-                        FormatTime(now).c_str(),
-                        (intmax_t)(now * 1000000.0) % 1000000,
-                        level,
-                        prefix.c_str(),
-                        message.c_str()
-                    );
-                }
+            logSink->Publish(
+                self->timeKeeper->GetCurrentTime(),
+                level,
+                std::move(message)
             );
         };
     }
@@ -510,6 +660,8 @@ struct Service::Impl
                 case 0: { // next option
                     if ((arg == "-s") || (arg == "--store")) {
                         state = 1;
+                    } else if ((arg == "-c") || (arg == "--settings")) {
+                        state = 2;
                     } else if ((arg == "-d") || (arg == "--daemon")) {
                         environment.daemon = true;
                     } else if (arg.substr(0, 1) == "-") {
@@ -538,6 +690,19 @@ struct Service::Impl
                     state = 0;
                 } break;
 
+                case 2: { // -c|--settings
+                    if (environment.settingsFilePathGiven) {
+                        diagnosticsSender.SendDiagnosticInformationString(
+                            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                            "multiple settings file paths given"
+                        );
+                        return false;
+                    }
+                    environment.settingsFilePath = arg;
+                    environment.settingsFilePathGiven = true;
+                    state = 0;
+                } break;
+
                 default: break;
             }
         }
@@ -549,6 +714,13 @@ struct Service::Impl
                 );
             } return false;
 
+            case 2: { // -c|--settings
+                diagnosticsSender.SendDiagnosticInformationString(
+                    SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+                    "settings file path expected"
+                );
+            } return false;
+
             default: return true;
         }
     }
@@ -566,6 +738,9 @@ struct Service::Impl
             return EXIT_FAILURE;
         }
         const auto serviceToldToStop = stopService.get_future();
+#ifdef SIGHUP
+        const auto previousHangUpHandler = signal(SIGHUP, HangUpHandler);
+#endif /* SIGHUP */
         while (!shutDown) {
             if (
                 serviceToldToStop.wait_for(std::chrono::milliseconds(100))
@@ -573,7 +748,21 @@ struct Service::Impl
             ) {
                 break;
             }
+            if (reloadSettings) {
+                reloadSettings = 0;
+                diagnosticsSender.SendDiagnosticInformationString(
+                    3,
+                    "Reloading settings..."
+                );
+                (void)store->ReloadSettings(environment.settingsFilePath);
+            }
+            if (configurationChanged.exchange(false)) {
+                ApplyConfiguration();
+            }
         }
+#ifdef SIGHUP
+        (void)signal(SIGHUP, previousHangUpHandler);
+#endif /* SIGHUP */
         ShutDown();
         return EXIT_SUCCESS;
     }
@@ -592,25 +781,68 @@ struct Service::Impl
             httpServer = nullptr;
             return false;
         }
+        httpClientTransactions = std::make_shared< HttpClientTransactions >();
+        const auto transactions = httpClientTransactions;
+        SubscribeToComponentDiagnostics(
+            "HttpClientTransactions",
+            [this, transactions](size_t minLevel){
+                return transactions->SubscribeToDiagnostics(
+                    diagnosticsSender.Chain(),
+                    minLevel
+                );
+            }
+        );
         httpClient = std::make_shared< Http::Client >();
         if (!ConfigureAndStartHttpClient(configuration)) {
             httpClient = nullptr;
+            httpClientTransactions = nullptr;
             httpServer = nullptr;
             return false;
         }
-        httpClientTransactions = std::make_shared< HttpClientTransactions >();
-        (void)httpClientTransactions->SubscribeToDiagnostics(
-            diagnosticsSender.Chain(),
-            diagnosticReportingThresholds["HttpClientTransactions"]
-        );
-        httpClientTransactions->Mobilize(httpClient);
-        ApiHttp::RegisterResources(store, *httpServer);
+        httpClientTransactions->Mobilize(httpClient, metrics);
+        if (configuration.Has("Replication")) {
+            replica = std::make_shared< Replica >();
+            const auto replicaForDiagnostics = replica;
+            SubscribeToComponentDiagnostics(
+                "Replica",
+                [this, replicaForDiagnostics](size_t minLevel){
+                    return replicaForDiagnostics->SubscribeToDiagnostics(
+                        diagnosticsSender.Chain(),
+                        minLevel
+                    );
+                }
+            );
+            replica->Mobilize(store, httpClientTransactions, timeKeeper, configuration["Replication"]);
+        }
+        ApiHttp::RegisterResources(store, metrics, *httpServer);
         apiWs = std::make_shared< ApiWs >();
-        (void)apiWs->SubscribeToDiagnostics(
-            diagnosticsSender.Chain(),
-            diagnosticReportingThresholds["ApiWs"]
+        const auto api = apiWs;
+        SubscribeToComponentDiagnostics(
+            "ApiWs",
+            [this, api](size_t minLevel){
+                return api->SubscribeToDiagnostics(
+                    diagnosticsSender.Chain(),
+                    minLevel
+                );
+            }
+        );
+        apiWs->Mobilize(store, httpClientTransactions, replica, httpServer, timeKeeper, metrics);
+        std::weak_ptr< Impl > selfWeak(shared_from_this());
+        unsubscribeFromConfiguration = store->SubscribeToData(
+            {"Configuration"},
+            {},
+            [selfWeak](const Store::Update& update){
+                // This may be called by a component changing the
+                // configuration while holding its own locks (such as a
+                // WebSocket client), so just note the change, and apply
+                // it from Run.
+                const auto self = selfWeak.lock();
+                if (self == nullptr) {
+                    return;
+                }
+                self->configurationChanged = true;
+            }
         );
-        apiWs->Mobilize(store, httpClientTransactions, httpServer, timeKeeper, configuration);
         diagnosticsSender.SendDiagnosticInformationString(
             3,
             "Alfred up and running."
@@ -626,14 +858,21 @@ struct Service::Impl
             3,
             "Exiting..."
         );
+        unsubscribeFromConfiguration();
+        unsubscribeFromConfiguration = nullptr;
         apiWs->Demobilize();
         apiWs = nullptr;
+        if (replica != nullptr) {
+            replica->Demobilize();
+            replica = nullptr;
+        }
         httpClientTransactions->Demobilize();
         httpClientTransactions = nullptr;
         httpClient->Demobilize();
         httpClient = nullptr;
         httpServer->Demobilize();
         httpServer = nullptr;
+        diagnosticsSubscriptions.clear();
     }
 
     /**
@@ -646,6 +885,30 @@ struct Service::Impl
         }
     }
 
+    /**
+     * Subscribe to the diagnostic messages of the component with the given
+     * name, at its reporting threshold, and arrange for the subscription
+     * to be formed again whenever the threshold is changed.
+     *
+     * @param[in] name
+     *     This is the name of the component.
+     *
+     * @param[in] subscribe
+     *     This is the function to call to form the subscription.
+     */
+    void SubscribeToComponentDiagnostics(
+        const std::string& name,
+        DiagnosticsSubscription::Subscribe subscribe
+    ) {
+        auto& subscription = diagnosticsSubscriptions[name];
+        if (subscription.unsubscribe != nullptr) {
+            subscription.unsubscribe();
+        }
+        subscription.subscribe = std::move(subscribe);
+        subscription.minLevel = GetDiagnosticReportingThreshold(name);
+        subscription.unsubscribe = subscription.subscribe(subscription.minLevel);
+    }
+
 };
 
 Service::~Service() noexcept = default;
@@ -659,10 +922,14 @@ Service::Service()
 
 int Service::Main(int argc, char* argv[]) {
     setbuf(stdout, NULL);
-    auto diagnosticsReporter = impl_->MakeDiagnosticPublisher(
+    LogSink::Configuration logSinkConfiguration;
+    auto logSink = std::make_shared< LogSink >();
+    logSink->Mobilize(
         std::shared_ptr< FILE >(stdout, [](FILE*){}),
-        std::shared_ptr< FILE >(stderr, [](FILE*){})
+        std::shared_ptr< FILE >(stderr, [](FILE*){}),
+        logSinkConfiguration
     );
+    auto diagnosticsReporter = impl_->MakeDiagnosticPublisher(logSink);
     auto unsubscribeDiagnosticsDelegate = impl_->diagnosticsSender.SubscribeToDiagnostics(
         diagnosticsReporter
     );
@@ -682,21 +949,35 @@ int Service::Main(int argc, char* argv[]) {
     if (configuration.Has("LogFile")) {
         impl_->environment.logFilePath = (std::string)configuration["LogFile"];
     }
+    if (configuration.Has("LogRotateSize")) {
+        logSinkConfiguration.rotateSize = configuration["LogRotateSize"];
+    }
+    if (configuration.Has("LogRotateInterval")) {
+        logSinkConfiguration.rotateInterval = configuration["LogRotateInterval"];
+    }
+    if (configuration.Has("LogRotateKeep")) {
+        logSinkConfiguration.rotateKeep = configuration["LogRotateKeep"];
+    }
     impl_->diagnosticReportingThresholds = configuration["DiagnosticReportingThresholds"];
-    (void)impl_->store->SubscribeToDiagnostics(
-        impl_->diagnosticsSender.Chain(),
-        impl_->diagnosticReportingThresholds["Store"]
+    const auto store = impl_->store;
+    const auto diagnosticsDelegate = impl_->diagnosticsSender.Chain();
+    impl_->SubscribeToComponentDiagnostics(
+        "Store",
+        [store, diagnosticsDelegate](size_t minLevel){
+            return store->SubscribeToDiagnostics(
+                diagnosticsDelegate,
+                minLevel
+            );
+        }
     );
     if (impl_->environment.daemon) {
-        std::shared_ptr< FILE > logFile(
-            fopen(impl_->environment.logFilePath.c_str(), "a"),
-            [](FILE* p){ (void)fclose(p); }
-        );
-        setbuf(logFile.get(), NULL);
-        diagnosticsReporter = impl_->MakeDiagnosticPublisher(
-            logFile,
-            logFile
+        logSink->Demobilize();
+        logSink = std::make_shared< LogSink >();
+        (void)logSink->Mobilize(
+            impl_->environment.logFilePath,
+            logSinkConfiguration
         );
+        diagnosticsReporter = impl_->MakeDiagnosticPublisher(logSink);
     }
     unsubscribeDiagnosticsDelegate = impl_->diagnosticsSender.SubscribeToDiagnostics(
         diagnosticsReporter,
@@ -711,6 +992,8 @@ int Service::Main(int argc, char* argv[]) {
         (void)signal(SIGINT, previousInterruptHandler);
     }
     shutDown = true;
+    unsubscribeDiagnosticsDelegate();
+    logSink->Demobilize();
     return result;
 }
 
@@ -4,64 +4,81 @@
  * This module contains the implementation of the Store class.
  */
 
+#include "AccessKeys.hpp"
+#include "Journal.hpp"
+#include "JsonPatch.hpp"
 #include "LoadFile.hpp"
+#include "Permissions.hpp"
+#include "SaveFile.hpp"
 #include "Store.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <Json/Value.hpp>
 #include <mutex>
 #include <Timekeeping/Scheduler.hpp>
 #include <StringExtensions/StringExtensions.hpp>
 #include <SystemAbstractions/DiagnosticsSender.hpp>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace {
 
+    constexpr size_t defaultMaxCachedViews = 1024;
     constexpr double defaultMinSaveInterval = 60.0;
+    constexpr double defaultTwitchTokenValidationCacheTime = 300.0;
+    constexpr size_t defaultWebSocketMaxOverflows = 10;
+    constexpr size_t defaultWebSocketMaxPendingUpdates = 64;
+    constexpr double defaultWebSocketOverflowWindow = 60.0;
 
-    struct RolesPermitted {
-        std::unordered_set< std::string > readData;
-        std::unordered_set< std::string > readMeta;
-        std::unordered_set< std::string > writeData;
-        std::unordered_set< std::string > writeMeta;
-        std::unordered_set< std::string > createData;
-        std::unordered_set< std::string > deleteData;
+    /**
+     * This is the top-level key of the part of the store holding settings
+     * which belong to one node only, so that it's never replicated.
+     */
+    constexpr const char* nodeLocalKey = "Configuration";
+
+    /**
+     * This is the most changes remembered for bringing the spare snapshot
+     * of the store up to date.  If more changes are made before the next
+     * snapshot, the whole store is copied for it instead.
+     */
+    constexpr size_t maxSnapshotLogMutations = 1024;
+
+    /**
+     * These are the top-level keys of the parts of the store which are
+     * loaded from the settings file when the settings are reloaded.
+     */
+    const std::vector< std::string > reloadableKeys{
+        "Configuration",
+        "Roles",
     };
 
+    using Permissions::IndexNode;
+    using Permissions::RolePermitted;
+    using Permissions::RolesHeld;
+    using Permissions::RolesPermitted;
+
     // Forward declaractions
     Json::Value ExtractData(
+        const IndexNode* index,
         const RolesPermitted& rolesPermitted,
         const Json::Value& root,
-        const std::unordered_set< std::string >& rolesHeld
-    );
-    bool RolePermitted(
-        const std::unordered_set< std::string >& lhs,
-        const std::unordered_set< std::string >& rhs
-    );
-    void UpdateRoles(
-        RolesPermitted& rolesPermitted,
-        const Json::Value& meta
+        const RolesHeld& rolesHeld
     );
 
-    void AddRoles(
-        std::unordered_set< std::string >& rolesSet,
-        const Json::Value& rolesArray
-    ) {
-        if (rolesArray.GetType() != Json::Value::Type::Array) {
-            return;
-        }
-        for (const auto entry: rolesArray) {
-            const auto& role = entry.value();
-            (void)rolesSet.insert(role);
-        }
-    }
-
     /**
      * Return a reference to the JSON object containing the key at
      * the given "path".  The path consists of JSON object keys.
      *
+     * @param[in,out] index
+     *     On input, this is the permissions index of the given root.
+     *     On output, this is the permissions index of the descendant node.
+     *
      * @param[in,out] rolesPermitted
-     *     This tracks which roles are permitted to which operations
+     *     This tracks which roles are permitted which operations
      *     at the current level of the JSON composition.
      *
      * @param[in] root
@@ -80,6 +97,7 @@ namespace {
      *     last key in the given sequence is returned.
      */
     const Json::Value& DescendTree(
+        const IndexNode*& index,
         RolesPermitted& rolesPermitted,
         const Json::Value& root,
         const std::vector< std::string >& path,
@@ -89,25 +107,49 @@ namespace {
             return root;
         }
         const auto& key = path[offset];
-        if (root.Has("data")) {
-            UpdateRoles(rolesPermitted, root["meta"]);
-            return DescendTree(rolesPermitted, root["data"][key], path, offset + 1);
+        if (
+            (index != nullptr)
+            && index->wrapper
+        ) {
+            index->meta.Apply(rolesPermitted);
+            index = (
+                (index->data == nullptr)
+                ? nullptr
+                : index->data->GetChild(key)
+            );
+            return DescendTree(index, rolesPermitted, root["data"][key], path, offset + 1);
         } else {
-            return DescendTree(rolesPermitted, root[key], path, offset + 1);
+            index = (
+                (index == nullptr)
+                ? nullptr
+                : index->GetChild(key)
+            );
+            return DescendTree(index, rolesPermitted, root[key], path, offset + 1);
         }
     }
 
     Json::Value ExtractDataNoMeta(
+        const IndexNode* index,
         const RolesPermitted& rolesPermitted,
         const Json::Value& root,
-        const std::unordered_set< std::string >& rolesHeld
+        const RolesHeld& rolesHeld
     ) {
+        if (index == nullptr) {
+            // There is no metadata anywhere inside this part of the store,
+            // so the same permissions hold for all of it.
+            if (RolePermitted(rolesPermitted.readData, rolesHeld)) {
+                return root;
+            } else {
+                return Json::Value();
+            }
+        }
         switch (root.GetType()) {
             case Json::Value::Type::Array: {
                 if (RolePermitted(rolesPermitted.readData, rolesHeld)) {
                     auto data = Json::Array({});
-                    for (const auto entry: root) {
-                        auto element = ExtractData(rolesPermitted, entry.value(), rolesHeld);
+                    const auto size = root.GetSize();
+                    for (size_t i = 0; i < size; ++i) {
+                        auto element = ExtractData(index->GetElement(i), rolesPermitted, root[i], rolesHeld);
                         if (element.GetType() != Json::Value::Type::Invalid) {
                             data.Add(std::move(element));
                         }
@@ -122,7 +164,7 @@ namespace {
                 auto data = Json::Object({});
                 bool empty = true;
                 for (const auto entry: root) {
-                    auto element = ExtractData(rolesPermitted, entry.value(), rolesHeld);
+                    auto element = ExtractData(index->GetChild(entry.key()), rolesPermitted, entry.value(), rolesHeld);
                     if (element.GetType() != Json::Value::Type::Invalid) {
                         data[entry.key()] = std::move(element);
                         empty = false;
@@ -149,143 +191,81 @@ namespace {
     }
 
     Json::Value ExtractData(
+        const IndexNode* index,
         const RolesPermitted& rolesPermitted,
         const Json::Value& root,
-        const std::unordered_set< std::string >& rolesHeld
+        const RolesHeld& rolesHeld
     ) {
         if (
-            (root.GetType() == Json::Value::Type::Object)
-            && root.Has("data")
+            (index != nullptr)
+            && index->wrapper
         ) {
             auto innerRolesPermitted = rolesPermitted;
-            UpdateRoles(innerRolesPermitted, root["meta"]);
+            index->meta.Apply(innerRolesPermitted);
             if (RolePermitted(innerRolesPermitted.readMeta, rolesHeld)) {
                 return Json::Object({
-                    {"data", ExtractDataNoMeta(innerRolesPermitted, root["data"], rolesHeld)},
-                    {"meta", ExtractDataNoMeta(innerRolesPermitted, root["meta"], rolesHeld)},
+                    {"data", ExtractDataNoMeta(index->data.get(), innerRolesPermitted, root["data"], rolesHeld)},
+                    {"meta", ExtractDataNoMeta(index->metaData.get(), innerRolesPermitted, root["meta"], rolesHeld)},
                 });
             } else {
-                return ExtractDataNoMeta(innerRolesPermitted, root["data"], rolesHeld);
+                return ExtractDataNoMeta(index->data.get(), innerRolesPermitted, root["data"], rolesHeld);
             }
         }
-        return ExtractDataNoMeta(rolesPermitted, root, rolesHeld);
+        return ExtractDataNoMeta(index, rolesPermitted, root, rolesHeld);
     }
 
-    bool RolePermitted(
-        const std::unordered_set< std::string >& rolesPermitted,
-        const std::unordered_set< std::string >& rolesHeld
-    ) {
-        if (rolesHeld.empty()) {
-            return true;
-        }
-        for (const auto& role: rolesPermitted) {
-            if (rolesHeld.find(role) != rolesHeld.end()) {
-                return true;
-            }
-        }
-        return false;
-    }
+    /**
+     * This identifies a cached view of the store.  Roles which are not named
+     * anywhere in the store's metadata make no difference to what a reader
+     * can see, so they are left out, and readers holding equivalent roles
+     * share the same views.
+     */
+    struct ViewKey {
+        std::vector< std::string > path;
+        RolesHeld rolesHeld;
 
-    void UpdateRoles(
-        RolesPermitted& rolesPermitted,
-        const Json::Value& meta
-    ) {
-        if (meta.Has("require")) {
-            const auto& require = meta["require"];
-            if (require.Has("read_data")) {
-                rolesPermitted.readData.clear();
-                AddRoles(rolesPermitted.readData, require["read_data"]);
-            }
-            if (require.Has("read_meta")) {
-                rolesPermitted.readMeta.clear();
-                AddRoles(rolesPermitted.readMeta, require["read_meta"]);
-            }
-            if (require.Has("write_data")) {
-                rolesPermitted.writeData.clear();
-                AddRoles(rolesPermitted.writeData, require["write_data"]);
-            }
-            if (require.Has("write_meta")) {
-                rolesPermitted.writeMeta.clear();
-                AddRoles(rolesPermitted.writeMeta, require["write_meta"]);
-            }
-            if (require.Has("create_data")) {
-                rolesPermitted.createData.clear();
-                AddRoles(rolesPermitted.createData, require["create"]);
-            }
-            if (require.Has("delete_data")) {
-                rolesPermitted.deleteData.clear();
-                AddRoles(rolesPermitted.deleteData, require["delete"]);
-            }
+        bool operator==(const ViewKey& other) const {
+            return (
+                (rolesHeld.unrestricted == other.rolesHeld.unrestricted)
+                && (rolesHeld.roles == other.rolesHeld.roles)
+                && (path == other.path)
+            );
         }
-        if (meta.Has("allow")) {
-            const auto& allow = meta["allow"];
-            if (allow.Has("read_data")) {
-                AddRoles(rolesPermitted.readData, allow["read_data"]);
-            }
-            if (allow.Has("read_meta")) {
-                AddRoles(rolesPermitted.readMeta, allow["read_meta"]);
-            }
-            if (allow.Has("write_data")) {
-                AddRoles(rolesPermitted.readData, allow["write_data"]);
-                AddRoles(rolesPermitted.writeData, allow["write_data"]);
-            }
-            if (allow.Has("write_meta")) {
-                AddRoles(rolesPermitted.readMeta, allow["write_meta"]);
-                AddRoles(rolesPermitted.writeMeta, allow["write_meta"]);
-            }
-            if (allow.Has("create_data")) {
-                AddRoles(rolesPermitted.createData, allow["create"]);
+    };
+
+    struct ViewKeyHash {
+        size_t operator()(const ViewKey& key) const {
+            std::hash< std::string > stringHash;
+            auto hash = std::hash< Permissions::RoleBits >()(key.rolesHeld.roles);
+            if (key.rolesHeld.unrestricted) {
+                hash = ~hash;
             }
-            if (allow.Has("delete_data")) {
-                AddRoles(rolesPermitted.deleteData, allow["delete"]);
+            for (const auto& pathElement: key.path) {
+                hash ^= stringHash(pathElement) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
             }
+            return hash;
         }
-    }
-}
-
-struct Store::Impl
-    : public std::enable_shared_from_this< Store::Impl >
-{
-    // Types
-
-    struct Subscription {
-        std::vector< std::string > path;
-        std::unordered_set< std::string > rolesHeld;
-        OnUpdate onUpdate;
     };
 
-    // Properties
-
-    SystemAbstractions::DiagnosticsSender diagnosticsSender;
-    bool dirty = false;
-    double minSaveInterval = 0.0;
-    size_t generation = 0;
-    bool mobilized = false;
-    std::mutex mutex;
-    double nextSaveTime = 0.0;
-    int nextSaveToken = 0;
-    int nextSubscriptionToken = 1;
-    bool saving = false;
-    Json::Value store;
-    Timekeeping::Scheduler scheduler;
-    std::unordered_map< int, Subscription > subscribers;
-
-    // Constructor
-
-    Impl()
-        : diagnosticsSender("Store")
-    {
+    RolesHeld MakeRolesHeld(
+        const Permissions::RoleTable& roleTable,
+        const std::unordered_set< std::string >& rolesHeld
+    ) {
+        RolesHeld rolesHeldBits;
+        rolesHeldBits.unrestricted = rolesHeld.empty();
+        rolesHeldBits.roles = roleTable.Lookup(rolesHeld);
+        return rolesHeldBits;
     }
 
-    // Methods
-
-    Json::Value GetData(
+    Json::Value GetFilteredData(
+        const IndexNode* index,
+        const Json::Value& store,
         const std::vector< std::string >& path,
-        const std::unordered_set< std::string >& rolesHeld
+        const RolesHeld& rolesHeld
     ) {
         RolesPermitted rolesPermitted;
-        const auto& root = DescendTree(rolesPermitted, store, path);
-        auto data = ExtractData(rolesPermitted, root, rolesHeld);
+        const auto& root = DescendTree(index, rolesPermitted, store, path);
+        auto data = ExtractData(index, rolesPermitted, root, rolesHeld);
         if (data.GetType() == Json::Value::Type::Invalid) {
             return nullptr;
         } else {
@@ -293,161 +273,2717 @@ struct Store::Impl
         }
     }
 
-    void Save() {
-        saving = false;
-        if (dirty) {
-            ScheduleSave();
-        }
-    }
+    bool EncodeData(
+        const IndexNode* index,
+        const RolesPermitted& rolesPermitted,
+        const Json::Value& root,
+        const RolesHeld& rolesHeld,
+        std::string& output
+    );
 
-    void ScheduleSave() {
-        if (saving) {
-            dirty = true;
-            return;
+    /**
+     * Append to the given output the encoding of what ExtractDataNoMeta
+     * would return, without making a copy of the data.
+     *
+     * @return
+     *     An indication of whether or not anything was visible (and so
+     *     appended to the output) is returned.
+     */
+    bool EncodeDataNoMeta(
+        const IndexNode* index,
+        const RolesPermitted& rolesPermitted,
+        const Json::Value& root,
+        const RolesHeld& rolesHeld,
+        std::string& output
+    ) {
+        if (root.GetType() == Json::Value::Type::Invalid) {
+            return false;
         }
-        saving = true;
-        dirty = false;
-        const auto now = scheduler.GetClock()->GetCurrentTime();
-        if (nextSaveTime < now) {
-            nextSaveTime = now;
+        const auto permitted = RolePermitted(rolesPermitted.readData, rolesHeld);
+        if (index == nullptr) {
+            // There is no metadata anywhere inside this part of the store,
+            // so the same permissions hold for all of it.
+            if (permitted) {
+                output += root.ToEncoding();
+            }
+            return permitted;
         }
-        std::weak_ptr< Impl > selfWeak(shared_from_this());
-        const auto thisGeneration = generation;
-        nextSaveToken = scheduler.Schedule(
-            [selfWeak, thisGeneration]{
-                const auto self = selfWeak.lock();
-                if (self == nullptr) {
-                    return;
+        switch (root.GetType()) {
+            case Json::Value::Type::Array: {
+                if (!permitted) {
+                    return false;
                 }
-                std::lock_guard< decltype(self->mutex) > lock(self->mutex);
+                output += '[';
+                bool empty = true;
+                const auto size = root.GetSize();
+                for (size_t i = 0; i < size; ++i) {
+                    const auto mark = output.size();
+                    if (!empty) {
+                        output += ',';
+                    }
+                    if (EncodeData(index->GetElement(i), rolesPermitted, root[i], rolesHeld, output)) {
+                        empty = false;
+                    } else {
+                        output.resize(mark);
+                    }
+                }
+                output += ']';
+                return true;
+            }
+
+            case Json::Value::Type::Object: {
+                const auto start = output.size();
+                output += '{';
+                bool empty = true;
+                for (const auto entry: root) {
+                    const auto mark = output.size();
+                    if (!empty) {
+                        output += ',';
+                    }
+                    output += Json::Value(entry.key()).ToEncoding();
+                    output += ':';
+                    if (EncodeData(index->GetChild(entry.key()), rolesPermitted, entry.value(), rolesHeld, output)) {
+                        empty = false;
+                    } else {
+                        output.resize(mark);
+                    }
+                }
+                output += '}';
                 if (
-                    !self->mobilized
-                    || (self->generation != thisGeneration)
+                    permitted
+                    || !empty
                 ) {
-                    return;
+                    return true;
                 }
-                self->Save();
-            },
-            nextSaveTime
-        );
-        nextSaveTime += minSaveInterval;
+                output.resize(start);
+                return false;
+            }
+
+            default: {
+                if (permitted) {
+                    output += root.ToEncoding();
+                }
+                return permitted;
+            }
+        }
     }
 
-    std::function< void() > SubscribeToData(
-        const std::vector< std::string >& path,
-        const std::unordered_set< std::string >& rolesHeld,
-        OnUpdate onUpdate,
-        std::unique_lock< std::mutex >& lock
+    /**
+     * Append to the given output the encoding of what ExtractData would
+     * return, without making a copy of the data.
+     *
+     * @return
+     *     An indication of whether or not anything was visible (and so
+     *     appended to the output) is returned.
+     */
+    bool EncodeData(
+        const IndexNode* index,
+        const RolesPermitted& rolesPermitted,
+        const Json::Value& root,
+        const RolesHeld& rolesHeld,
+        std::string& output
     ) {
-        const auto subscriptionToken = nextSubscriptionToken++;
-        subscribers[subscriptionToken] = { path, rolesHeld, onUpdate };
-        auto data = GetData(path, rolesHeld);
-        lock.unlock();
-        onUpdate(std::move(data));
-        lock.lock();
-        std::weak_ptr< Impl > selfWeak(shared_from_this());
-        return [selfWeak, subscriptionToken]{
-            const auto self = selfWeak.lock();
-            if (self == nullptr) {
-                return;
+        if (
+            (index != nullptr)
+            && index->wrapper
+        ) {
+            auto innerRolesPermitted = rolesPermitted;
+            index->meta.Apply(innerRolesPermitted);
+            if (RolePermitted(innerRolesPermitted.readMeta, rolesHeld)) {
+                output += "{\"data\":";
+                if (!EncodeDataNoMeta(index->data.get(), innerRolesPermitted, root["data"], rolesHeld, output)) {
+                    output += "null";
+                }
+                output += ",\"meta\":";
+                if (!EncodeDataNoMeta(index->metaData.get(), innerRolesPermitted, root["meta"], rolesHeld, output)) {
+                    output += "null";
+                }
+                output += '}';
+                return true;
+            } else {
+                return EncodeDataNoMeta(index->data.get(), innerRolesPermitted, root["data"], rolesHeld, output);
             }
-            std::lock_guard< decltype(self->mutex) > lock(self->mutex);
-            (void)self->subscribers.erase(subscriptionToken);
-        };
+        }
+        return EncodeDataNoMeta(index, rolesPermitted, root, rolesHeld, output);
     }
-};
 
-Store::~Store() noexcept {
-    Demobilize();
-}
+    /**
+     * Return the encoding of what GetFilteredData would return, made
+     * straight from the store rather than from a filtered copy of it.
+     */
+    std::string EncodeFilteredData(
+        const IndexNode* index,
+        const Json::Value& store,
+        const std::vector< std::string >& path,
+        const RolesHeld& rolesHeld
+    ) {
+        RolesPermitted rolesPermitted;
+        const auto& root = DescendTree(index, rolesPermitted, store, path);
+        std::string output;
+        if (!EncodeData(index, rolesPermitted, root, rolesHeld, output)) {
+            output = "null";
+        }
+        return output;
+    }
 
-Store::Store(Store&&) noexcept = default;
-Store& Store::operator=(Store&&) noexcept = default;
+    /**
+     * These are the metrics measuring the store.
+     */
+    struct StoreMetrics {
+        std::shared_ptr< Metrics::Histogram > lockWaitTime;
+        std::shared_ptr< Metrics::Histogram > lockHoldTime;
+        std::shared_ptr< Metrics::Counter > mutations;
+        std::shared_ptr< Metrics::Gauge > subscribers;
+        std::shared_ptr< Metrics::Histogram > viewBuildTime;
+        std::shared_ptr< Metrics::Histogram > viewSize;
 
-Store::Store()
-    : impl_(new Impl())
-{
-}
+        explicit StoreMetrics(Metrics& metrics)
+            : lockWaitTime(
+                metrics.GetHistogram(
+                    "alfred_store_lock_wait_seconds",
+                    "Time spent by writers waiting to lock the store",
+                    Metrics::MakeDurationBounds()
+                )
+            )
+            , lockHoldTime(
+                metrics.GetHistogram(
+                    "alfred_store_lock_hold_seconds",
+                    "Time spent by writers holding the store locked",
+                    Metrics::MakeDurationBounds()
+                )
+            )
+            , mutations(
+                metrics.GetCounter(
+                    "alfred_store_mutations_total",
+                    "Changes made to the store"
+                )
+            )
+            , subscribers(
+                metrics.GetGauge(
+                    "alfred_store_subscribers",
+                    "Subscriptions to data in the store"
+                )
+            )
+            , viewBuildTime(
+                metrics.GetHistogram(
+                    "alfred_store_view_build_seconds",
+                    "Time spent making views of the store for readers",
+                    Metrics::MakeDurationBounds()
+                )
+            )
+            , viewSize(
+                metrics.GetHistogram(
+                    "alfred_store_view_bytes",
+                    "Sizes of the encodings of views of the store made for readers",
+                    Metrics::MakeSizeBounds()
+                )
+            )
+        {
+        }
+    };
 
-void Store::Demobilize() {
-    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
-    if (!impl_->mobilized) {
-        return;
-    }
-    if (impl_->saving) {
-        impl_->scheduler.Cancel(impl_->nextSaveToken);
-        impl_->saving = false;
-    }
-    impl_->dirty = false;
-    impl_->scheduler.SetClock(nullptr);
-    impl_->mobilized = false;
-}
+    /**
+     * This is an immutable copy of the store, published for readers to use
+     * without locking the store.  Whenever the store is modified, a new
+     * snapshot is made, the first time a reader needs one, and published
+     * in place of the old one.  Readers still holding the old one may keep
+     * using it for as long as they like.
+     *
+     * Once no reader holds the snapshot published before the current one,
+     * it's brought up to date by making the changes made since, rather
+     * than copying the whole store again, and published as the next one.
+     */
+    struct Snapshot {
+        // Properties
 
-Json::Value Store::GetData(
-    const std::vector< std::string >& path,
-    const std::unordered_set< std::string >& rolesHeld
-) {
-    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
-    return impl_->GetData(path, rolesHeld);
-}
+        /**
+         * This is the generation of the store which was copied.
+         */
+        size_t generation = 0;
 
-std::function< void() > Store::SubscribeToData(
-    const std::vector< std::string >& path,
-    const std::unordered_set< std::string >& rolesHeld,
-    std::function< void(Json::Value&& data) > onUpdate
-) {
-    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
-    return impl_->SubscribeToData(path, rolesHeld, onUpdate, lock);
-}
+        Json::Value store;
+        std::unique_ptr< IndexNode > permissionsIndex;
+        Permissions::RoleTable roleTable;
+        size_t maxCachedViews = defaultMaxCachedViews;
+        std::shared_ptr< const StoreMetrics > metrics;
 
-SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate Store::SubscribeToDiagnostics(
-    SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
-    size_t minLevel
-) {
-    return impl_->diagnosticsSender.SubscribeToDiagnostics(delegate, minLevel);
-}
+        /**
+         * These are the views made from the snapshot so far.  They are all
+         * retired along with the snapshot.
+         */
+        mutable std::unordered_map< ViewKey, std::shared_ptr< const Store::View >, ViewKeyHash > views;
 
-bool Store::Mobilize(
-    const std::string& filePath,
-    std::shared_ptr< Timekeeping::Clock > clock
-) {
-    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
-    if (impl_->mobilized) {
-        return true;
-    }
-    std::string encodedStore;
-    if (
-        !LoadFile(
-            filePath,
-            "store",
-            impl_->diagnosticsSender,
-            encodedStore
-        )
-    ) {
-        return false;
-    }
-    impl_->store = Json::Value::FromEncoding(encodedStore);
-    if (impl_->store.GetType() == Json::Value::Type::Invalid) {
-        impl_->diagnosticsSender.SendDiagnosticInformationFormatted(
-            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
-            "Unable to parse from file '%s'",
-            filePath.c_str()
+        /**
+         * This is used to synchronize access to the views.
+         */
+        mutable std::mutex viewsMutex;
+
+        // Methods
+
+        Json::Value GetData(
+            const std::vector< std::string >& path,
+            const std::unordered_set< std::string >& rolesHeld
+        ) const {
+            return GetFilteredData(permissionsIndex.get(), store, path, MakeRolesHeld(roleTable, rolesHeld));
+        }
+
+        std::shared_ptr< const Store::View > GetView(
+            const std::vector< std::string >& path,
+            const std::unordered_set< std::string >& rolesHeld
+        ) const {
+            ViewKey key{path, MakeRolesHeld(roleTable, rolesHeld)};
+            {
+                std::lock_guard< decltype(viewsMutex) > lock(viewsMutex);
+                const auto viewsEntry = views.find(key);
+                if (viewsEntry != views.end()) {
+                    return viewsEntry->second;
+                }
+            }
+            const auto buildStartTime = std::chrono::steady_clock::now();
+            auto encoding = EncodeFilteredData(permissionsIndex.get(), store, path, key.rolesHeld);
+            metrics->viewBuildTime->Observe(
+                std::chrono::duration< double >(std::chrono::steady_clock::now() - buildStartTime).count()
+            );
+            metrics->viewSize->Observe((double)encoding.size());
+            const auto view = std::make_shared< const Store::View >(
+                std::move(encoding),
+                generation
+            );
+            std::lock_guard< decltype(viewsMutex) > lock(viewsMutex);
+            if (views.size() < maxCachedViews) {
+                // If another reader beat us to it, share the view it made.
+                const auto viewsEntry = views.insert({std::move(key), view});
+                return viewsEntry.first->second;
+            }
+            return view;
+        }
+    };
+
+    bool IsVisible(
+        const IndexNode* index,
+        const RolesPermitted& rolesPermitted,
+        const Json::Value& root,
+        const RolesHeld& rolesHeld
+    );
+
+    /**
+     * Determine whether or not ExtractDataNoMeta would return anything,
+     * without making a copy of the data.
+     */
+    bool IsVisibleNoMeta(
+        const IndexNode* index,
+        const RolesPermitted& rolesPermitted,
+        const Json::Value& root,
+        const RolesHeld& rolesHeld
+    ) {
+        if (root.GetType() == Json::Value::Type::Invalid) {
+            return false;
+        }
+        if (RolePermitted(rolesPermitted.readData, rolesHeld)) {
+            return true;
+        }
+        if (
+            (index == nullptr)
+            || (root.GetType() != Json::Value::Type::Object)
+        ) {
+            return false;
+        }
+        for (const auto entry: root) {
+            if (IsVisible(index->GetChild(entry.key()), rolesPermitted, entry.value(), rolesHeld)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Determine whether or not ExtractData would return anything,
+     * without making a copy of the data.
+     */
+    bool IsVisible(
+        const IndexNode* index,
+        const RolesPermitted& rolesPermitted,
+        const Json::Value& root,
+        const RolesHeld& rolesHeld
+    ) {
+        if (
+            (index != nullptr)
+            && index->wrapper
+        ) {
+            auto innerRolesPermitted = rolesPermitted;
+            index->meta.Apply(innerRolesPermitted);
+            if (RolePermitted(innerRolesPermitted.readMeta, rolesHeld)) {
+                return true;
+            }
+            return IsVisibleNoMeta(index->data.get(), innerRolesPermitted, root["data"], rolesHeld);
+        }
+        return IsVisibleNoMeta(index, rolesPermitted, root, rolesHeld);
+    }
+
+    bool IsWrapper(const Json::Value& value) {
+        return (
+            (value.GetType() == Json::Value::Type::Object)
+            && value.Has("data")
+        );
+    }
+
+    /**
+     * Return a pointer to the contents of the node at the given "path"
+     * (the "data" of the node, if it has metadata).
+     *
+     * @param[in] root
+     *     This is the top-level JSON object in which to find a
+     *     descendant node.
+     *
+     * @param[in] path
+     *     This is the sequence of keys to use to descend the tree.
+     *
+     * @param[in] depth
+     *     This is the number of keys of the path to use.
+     *
+     * @return
+     *     A pointer to the contents of the descendant node is returned,
+     *     or null if there is no such node.
+     */
+    Json::Value* FindContents(
+        Json::Value& root,
+        const std::vector< std::string >& path,
+        size_t depth
+    ) {
+        auto node = &root;
+        for (size_t i = 0; i < depth; ++i) {
+            if (IsWrapper(*node)) {
+                node = &(*node)["data"];
+            }
+            if (
+                (node->GetType() != Json::Value::Type::Object)
+                || !node->Has(path[i])
+            ) {
+                return nullptr;
+            }
+            node = &(*node)[path[i]];
+        }
+        if (IsWrapper(*node)) {
+            node = &(*node)["data"];
+        }
+        return node;
+    }
+
+    /**
+     * Return which roles are permitted which operations on the node at the
+     * given "path", taking into account the metadata of the node itself.
+     *
+     * @param[in] index
+     *     This is the permissions index of the store.
+     *
+     * @param[in] path
+     *     This is the sequence of keys identifying the node.
+     *
+     * @param[in] depth
+     *     This is the number of keys of the path to use.
+     *
+     * @return
+     *     Which roles are permitted which operations on the node
+     *     is returned.
+     */
+    RolesPermitted FindRolesPermitted(
+        const IndexNode* index,
+        const std::vector< std::string >& path,
+        size_t depth
+    ) {
+        RolesPermitted rolesPermitted;
+        for (size_t i = 0; index != nullptr; ++i) {
+            if (index->wrapper) {
+                index->meta.Apply(rolesPermitted);
+                index = index->data.get();
+                if (index == nullptr) {
+                    break;
+                }
+            }
+            if (i >= depth) {
+                break;
+            }
+            index = index->GetChild(path[i]);
+        }
+        return rolesPermitted;
+    }
+
+    /**
+     * Determine whether or not the given value holds metadata anywhere
+     * within it, or looks as though it might.
+     *
+     * @param[in] value
+     *     This is the value to check.
+     *
+     * @return
+     *     An indication of whether or not the value holds
+     *     metadata is returned.
+     */
+    bool HoldsMetadata(const Json::Value& value) {
+        if (value.GetType() == Json::Value::Type::Object) {
+            if (
+                value.Has("data")
+                || value.Has("meta")
+            ) {
+                return true;
+            }
+        } else if (value.GetType() != Json::Value::Type::Array) {
+            return false;
+        }
+        for (const auto entry: value) {
+            if (HoldsMetadata(entry.value())) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Determine whether or not a client holding the given roles is
+     * permitted to make the given change to the store.  Replacing a value
+     * requires "write_data" on it, storing a new value requires
+     * "create_data" on the object to hold it, appending to an array
+     * requires "create_data" on the array, and removing a value requires
+     * "delete_data" on it.  Any change which stores or throws away
+     * metadata also requires "write_meta" on the value changed, since
+     * metadata decides who may do what with the data.
+     *
+     * @param[in] index
+     *     This is the permissions index of the store.
+     *
+     * @param[in] root
+     *     This is the top-level JSON object of the store.
+     *
+     * @param[in] mutation
+     *     This describes the change to make.
+     *
+     * @param[in] rolesHeld
+     *     These are the roles held by the client.
+     *
+     * @return
+     *     An indication of whether or not the change is permitted
+     *     is returned.
+     */
+    bool IsMutationPermitted(
+        const IndexNode* index,
+        Json::Value& root,
+        const Store::Mutation& mutation,
+        const RolesHeld& rolesHeld
+    ) {
+        if (rolesHeld.unrestricted) {
+            return true;
+        }
+        const auto& path = mutation.path;
+        if (path.empty()) {
+            return false;
+        }
+        const auto rolesPermitted = FindRolesPermitted(index, path, path.size());
+        switch (mutation.type) {
+            case Store::Mutation::Type::Add: {
+                return (
+                    RolePermitted(rolesPermitted.createData, rolesHeld)
+                    && (
+                        !HoldsMetadata(mutation.value)
+                        || RolePermitted(rolesPermitted.writeMeta, rolesHeld)
+                    )
+                );
+            }
+
+            case Store::Mutation::Type::Remove: {
+                if (!RolePermitted(rolesPermitted.deleteData, rolesHeld)) {
+                    return false;
+                }
+                const auto parent = FindContents(root, path, path.size() - 1);
+                return (
+                    (parent == nullptr)
+                    || (parent->GetType() != Json::Value::Type::Object)
+                    || !parent->Has(path.back())
+                    || !HoldsMetadata((*parent)[path.back()])
+                    || RolePermitted(rolesPermitted.writeMeta, rolesHeld)
+                );
+            }
+
+            default: {
+                const auto parent = FindContents(root, path, path.size() - 1);
+                bool permitted;
+                bool changesMetadata = HoldsMetadata(mutation.value);
+                if (
+                    (parent != nullptr)
+                    && (parent->GetType() == Json::Value::Type::Object)
+                    && parent->Has(path.back())
+                ) {
+                    permitted = RolePermitted(rolesPermitted.writeData, rolesHeld);
+                    const auto target = FindContents(root, path, path.size());
+                    if (
+                        (target != nullptr)
+                        && HoldsMetadata(*target)
+                    ) {
+                        changesMetadata = true;
+                    }
+                } else {
+                    permitted = RolePermitted(FindRolesPermitted(index, path, path.size() - 1).createData, rolesHeld);
+                }
+                return (
+                    permitted
+                    && (
+                        !changesMetadata
+                        || RolePermitted(rolesPermitted.writeMeta, rolesHeld)
+                    )
+                );
+            }
+        }
+    }
+
+    /**
+     * This holds what's needed to undo a change made to the store.
+     */
+    struct Undo {
+        const Store::Mutation* mutation = nullptr;
+        bool existed = false;
+        bool wrapped = false;
+        Json::Value oldValue;
+        size_t position = 0;
+        std::vector< std::string > recompilePath;
+    };
+
+    /**
+     * Make the given change to the store.
+     *
+     * @param[in,out] root
+     *     This is the top-level JSON object of the store.
+     *
+     * @param[in] mutation
+     *     This describes the change to make.
+     *
+     * @param[out] undo
+     *     This is where to store what's needed to undo the change.
+     *
+     * @return
+     *     An indication of whether or not the change was made is returned.
+     */
+    bool Mutate(
+        Json::Value& root,
+        const Store::Mutation& mutation,
+        Undo& undo
+    ) {
+        const auto& path = mutation.path;
+        if (path.empty()) {
+            return false;
+        }
+        undo.mutation = &mutation;
+        undo.recompilePath = path;
+        if (mutation.type == Store::Mutation::Type::Add) {
+            const auto target = FindContents(root, path, path.size());
+            if (
+                (target == nullptr)
+                || (target->GetType() != Json::Value::Type::Array)
+            ) {
+                return false;
+            }
+            undo.position = target->GetSize();
+            undo.recompilePath.push_back(std::to_string(undo.position));
+            target->Add(mutation.value);
+            return true;
+        }
+        const auto parent = FindContents(root, path, path.size() - 1);
+        if (
+            (parent == nullptr)
+            || (parent->GetType() != Json::Value::Type::Object)
+        ) {
+            return false;
+        }
+        const auto& key = path.back();
+        undo.existed = parent->Has(key);
+        if (mutation.type == Store::Mutation::Type::Remove) {
+            if (!undo.existed) {
+                return false;
+            }
+            undo.oldValue = std::move((*parent)[key]);
+            parent->Remove(key);
+            return true;
+        }
+        auto& target = (*parent)[key];
+        if (
+            undo.existed
+            && IsWrapper(target)
+        ) {
+            undo.wrapped = true;
+            undo.oldValue = std::move(target["data"]);
+            target["data"] = mutation.value;
+        } else {
+            undo.oldValue = std::move(target);
+            target = mutation.value;
+        }
+        return true;
+    }
+
+    /**
+     * Undo a change made to the store.
+     *
+     * @param[in,out] root
+     *     This is the top-level JSON object of the store.
+     *
+     * @param[in,out] undo
+     *     This holds what's needed to undo the change.
+     */
+    void Unmutate(
+        Json::Value& root,
+        Undo& undo
+    ) {
+        const auto& mutation = *undo.mutation;
+        const auto& path = mutation.path;
+        if (mutation.type == Store::Mutation::Type::Add) {
+            const auto target = FindContents(root, path, path.size());
+            target->Remove(target->GetSize() - 1);
+            return;
+        }
+        const auto parent = FindContents(root, path, path.size() - 1);
+        const auto& key = path.back();
+        if (!undo.existed) {
+            parent->Remove(key);
+        } else if (undo.wrapped) {
+            (*parent)[key]["data"] = std::move(undo.oldValue);
+        } else {
+            (*parent)[key] = std::move(undo.oldValue);
+        }
+    }
+
+    /**
+     * Determine whether or not the given path is in the part of the store
+     * holding settings which belong to one node only.
+     *
+     * @param[in] path
+     *     This is the sequence of keys identifying part of the store.
+     *
+     * @return
+     *     An indication of whether or not the path is in the part of the
+     *     store which is never replicated is returned.
+     */
+    bool IsNodeLocal(const std::vector< std::string >& path) {
+        return (
+            !path.empty()
+            && (path[0] == nodeLocalKey)
+        );
+    }
+
+    /**
+     * Return the JSON encoding of everything in the store
+     * which is replicated.
+     *
+     * @param[in] root
+     *     This is the top-level JSON object of the store.
+     *
+     * @return
+     *     The JSON encoding of everything in the store, except the
+     *     settings belonging to this node only, is returned.  Access keys
+     *     granted roles are replaced by their hashes.
+     */
+    std::string EncodeReplicationImage(const Json::Value& root) {
+        std::string encoding = "{";
+        bool first = true;
+        for (const auto entry: root) {
+            const auto& key = entry.key();
+            if (key == nodeLocalKey) {
+                continue;
+            }
+            if (!first) {
+                encoding += ',';
+            }
+            first = false;
+            encoding += Json::Value(key).ToEncoding();
+            encoding += ':';
+            if (key == "Roles") {
+                encoding += AccessKeys::HideRoles(entry.value()).ToEncoding();
+            } else {
+                encoding += entry.value().ToEncoding();
+            }
+        }
+        encoding += '}';
+        return encoding;
+    }
+
+    /**
+     * Return the journal record of the given changes made to the store.
+     * Records capture the state resulting from each change, rather than the
+     * operation, so that replaying a record already reflected in the last
+     * snapshot is harmless.  In particular, appending to an array is
+     * recorded along with the position of the new element.
+     *
+     * @param[in] undos
+     *     These hold the changes made, in order.
+     *
+     * @param[in] forReplicas
+     *     This indicates whether or not the record is to be passed along to
+     *     replicas, which leaves out changes made to the settings belonging
+     *     to this node only, and replaces access keys granted roles by
+     *     their hashes.
+     *
+     * @return
+     *     The journal record of the changes is returned.
+     */
+    std::string EncodeJournalRecord(
+        const std::vector< Undo >& undos,
+        bool forReplicas = false
+    ) {
+        auto record = Json::Array({});
+        for (const auto& undo: undos) {
+            const auto& mutation = *undo.mutation;
+            if (
+                forReplicas
+                && IsNodeLocal(mutation.path)
+            ) {
+                continue;
+            }
+            const auto hideAccessKeys = (
+                forReplicas
+                && (mutation.path[0] == "Roles")
+            );
+            auto path = Json::Array({});
+            for (const auto& key: mutation.path) {
+                if (
+                    hideAccessKeys
+                    && (path.GetSize() == 1)
+                ) {
+                    path.Add(AccessKeys::HideIdentifier(key));
+                } else {
+                    path.Add(key);
+                }
+            }
+            auto entry = Json::Object({
+                {"path", std::move(path)},
+            });
+            switch (mutation.type) {
+                case Store::Mutation::Type::Set: {
+                    entry["op"] = "set";
+                    if (
+                        hideAccessKeys
+                        && (mutation.path.size() == 1)
+                    ) {
+                        entry["value"] = AccessKeys::HideRoles(mutation.value);
+                    } else {
+                        entry["value"] = mutation.value;
+                    }
+                } break;
+
+                case Store::Mutation::Type::Add: {
+                    entry["op"] = "add";
+                    entry["index"] = undo.position;
+                    entry["value"] = mutation.value;
+                } break;
+
+                case Store::Mutation::Type::Remove: {
+                    entry["op"] = "remove";
+                } break;
+            }
+            record.Add(std::move(entry));
+        }
+        return record.ToEncoding();
+    }
+
+    /**
+     * Redo the changes recorded in the given journal record.  Changes which
+     * can no longer be made are skipped, since they were overtaken by later
+     * changes already reflected in the store.
+     *
+     * @param[in,out] root
+     *     This is the top-level JSON object of the store.
+     *
+     * @param[in] encodedRecord
+     *     This is the journal record to replay.
+     *
+     * @return
+     *     An indication of whether or not the record could be decoded
+     *     is returned.
+     */
+    bool ReplayJournalRecord(
+        Json::Value& root,
+        const std::string& encodedRecord
+    ) {
+        const auto record = Json::Value::FromEncoding(encodedRecord);
+        if (record.GetType() != Json::Value::Type::Array) {
+            return false;
+        }
+        for (const auto recordEntry: record) {
+            const auto& entry = recordEntry.value();
+            Store::Mutation mutation;
+            for (const auto pathEntry: entry["path"]) {
+                mutation.path.push_back(pathEntry.value());
+            }
+            mutation.value = entry["value"];
+            const std::string op = entry["op"];
+            if (op == "set") {
+                mutation.type = Store::Mutation::Type::Set;
+            } else if (op == "remove") {
+                mutation.type = Store::Mutation::Type::Remove;
+            } else if (op == "add") {
+                const auto target = FindContents(root, mutation.path, mutation.path.size());
+                if (
+                    (target == nullptr)
+                    || (target->GetType() != Json::Value::Type::Array)
+                ) {
+                    continue;
+                }
+                const size_t index = entry["index"];
+                const auto size = target->GetSize();
+                if (index < size) {
+                    (*target)[index] = std::move(mutation.value);
+                } else if (index == size) {
+                    target->Add(std::move(mutation.value));
+                }
+                continue;
+            } else {
+                continue;
+            }
+            Undo undo;
+            (void)Mutate(root, mutation, undo);
+        }
+        return true;
+    }
+
+    /**
+     * Decode the changes recorded in the given record received from the
+     * store of which this one is a replica.  Changes made to the
+     * settings belonging to this node only are left out.
+     *
+     * @param[in] record
+     *     This is the record received.  It's in the same form as
+     *     a journal record.
+     *
+     * @param[out] mutations
+     *     This is where to store the changes recorded.
+     *
+     * @return
+     *     An indication of whether or not the record could be decoded
+     *     is returned.
+     */
+    bool DecodeReplicationRecord(
+        const Json::Value& record,
+        std::vector< Store::Mutation >& mutations
+    ) {
+        if (record.GetType() != Json::Value::Type::Array) {
+            return false;
+        }
+        for (const auto recordEntry: record) {
+            const auto& entry = recordEntry.value();
+            Store::Mutation mutation;
+            for (const auto pathEntry: entry["path"]) {
+                mutation.path.push_back(pathEntry.value());
+            }
+            if (IsNodeLocal(mutation.path)) {
+                continue;
+            }
+            mutation.value = entry["value"];
+            const std::string op = entry["op"];
+            if (op == "set") {
+                mutation.type = Store::Mutation::Type::Set;
+            } else if (op == "add") {
+                // The replica is in step with the original, so the
+                // recorded position is always the end of the array.
+                mutation.type = Store::Mutation::Type::Add;
+            } else if (op == "remove") {
+                mutation.type = Store::Mutation::Type::Remove;
+            } else {
+                return false;
+            }
+            mutations.push_back(std::move(mutation));
+        }
+        return true;
+    }
+
+    /**
+     * This describes where, in a subscriber's view of the store,
+     * a change made to the store shows up.
+     */
+    struct PatchTarget {
+        /**
+         * This indicates whether the change can be described in a patch
+         * at all.  If not, the subscriber needs a whole new snapshot.
+         */
+        bool supported = false;
+
+        /**
+         * This is the sequence of keys identifying the changed value
+         * in the subscriber's view.
+         */
+        std::vector< std::string > pointer;
+
+        /**
+         * This indicates whether the subscriber can see the object or
+         * array containing the changed value whether or not it is empty,
+         * so that the value can be added to it or removed from it.
+         */
+        bool parentReadable = false;
+
+        /**
+         * This indicates whether the subscriber can see the value.
+         */
+        bool visible = false;
+
+        /**
+         * If asked for, this is the value as seen by the subscriber.
+         */
+        Json::Value value;
+    };
+
+    /**
+     * Find where, in the view of a subscriber, the value affected by the
+     * given change to the store is found, and what it looks like.
+     *
+     * @param[in] index
+     *     This is the permissions index of the store.
+     *
+     * @param[in] root
+     *     This is the top-level JSON object of the store.
+     *
+     * @param[in] subscriptionPath
+     *     This is the path of the data to which the subscriber subscribed.
+     *     It must be a prefix of the path of the change.
+     *
+     * @param[in] mutation
+     *     This describes the change.
+     *
+     * @param[in] rolesHeld
+     *     These are the roles held by the subscriber.
+     *
+     * @param[in] extractValue
+     *     This indicates whether or not to make a copy of the value,
+     *     as seen by the subscriber.
+     *
+     * @return
+     *     A description of where the affected value appears in the
+     *     subscriber's view is returned.
+     */
+    PatchTarget FindPatchTarget(
+        const IndexNode* index,
+        const Json::Value& root,
+        const std::vector< std::string >& subscriptionPath,
+        const Store::Mutation& mutation,
+        const RolesHeld& rolesHeld,
+        bool extractValue
+    ) {
+        PatchTarget target;
+        const auto& path = mutation.path;
+        const auto add = (mutation.type == Store::Mutation::Type::Add);
+        if (
+            !add
+            && (path.size() <= subscriptionPath.size())
+        ) {
+            return target;
+        }
+        RolesPermitted rolesPermitted;
+        auto node = &DescendTree(index, rolesPermitted, root, subscriptionPath);
+        const auto depth = (add ? path.size() : path.size() - 1);
+        for (size_t i = subscriptionPath.size(); ; ++i) {
+            if (
+                (index != nullptr)
+                && index->wrapper
+            ) {
+                index->meta.Apply(rolesPermitted);
+                if (RolePermitted(rolesPermitted.readMeta, rolesHeld)) {
+                    target.pointer.push_back("data");
+                }
+                index = index->data.get();
+                node = &(*node)["data"];
+            }
+            if (i >= depth) {
+                break;
+            }
+            if (node->GetType() != Json::Value::Type::Object) {
+                return target;
+            }
+            const auto& key = path[i];
+            index = ((index == nullptr) ? nullptr : index->GetChild(key));
+            node = &(*node)[key];
+            target.pointer.push_back(key);
+        }
+        target.parentReadable = RolePermitted(rolesPermitted.readData, rolesHeld);
+        if (add) {
+            if (node->GetType() != Json::Value::Type::Array) {
+                return target;
+            }
+            target.supported = true;
+            target.pointer.push_back("-");
+            const auto size = node->GetSize();
+            if (
+                !target.parentReadable
+                || (size == 0)
+            ) {
+                return target;
+            }
+            const auto elementIndex = ((index == nullptr) ? nullptr : index->GetElement(size - 1));
+            target.value = ExtractData(elementIndex, rolesPermitted, (*node)[size - 1], rolesHeld);
+            target.visible = (target.value.GetType() != Json::Value::Type::Invalid);
+            return target;
+        }
+        if (node->GetType() != Json::Value::Type::Object) {
+            return target;
+        }
+        target.supported = true;
+        const auto& key = path.back();
+        target.pointer.push_back(key);
+        if (!node->Has(key)) {
+            return target;
+        }
+        const auto& child = (*node)[key];
+        const auto childIndex = ((index == nullptr) ? nullptr : index->GetChild(key));
+        if (
+            (mutation.type == Store::Mutation::Type::Set)
+            && (childIndex != nullptr)
+            && childIndex->wrapper
+        ) {
+            // Only the data of the child is being replaced.  If the
+            // subscriber can see the metadata too, the data appears
+            // under "data" in their view.
+            auto innerRolesPermitted = rolesPermitted;
+            childIndex->meta.Apply(innerRolesPermitted);
+            if (RolePermitted(innerRolesPermitted.readMeta, rolesHeld)) {
+                target.pointer.push_back("data");
+                target.parentReadable = false;
+                if (extractValue) {
+                    target.value = ExtractDataNoMeta(childIndex->data.get(), innerRolesPermitted, child["data"], rolesHeld);
+                    target.visible = (target.value.GetType() != Json::Value::Type::Invalid);
+                } else {
+                    target.visible = IsVisibleNoMeta(childIndex->data.get(), innerRolesPermitted, child["data"], rolesHeld);
+                }
+                return target;
+            }
+        }
+        if (extractValue) {
+            target.value = ExtractData(childIndex, rolesPermitted, child, rolesHeld);
+            target.visible = (target.value.GetType() != Json::Value::Type::Invalid);
+        } else {
+            target.visible = IsVisible(childIndex, rolesPermitted, child, rolesHeld);
+        }
+        return target;
+    }
+
+    /**
+     * Determine whether or not one path is a prefix of another.
+     */
+    bool IsPrefix(
+        const std::vector< std::string >& prefix,
+        const std::vector< std::string >& path
+    ) {
+        if (prefix.size() > path.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < prefix.size(); ++i) {
+            if (prefix[i] != path[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * This is one node of the tree of subscriptions, which mirrors the
+     * paths of the store to which there are subscriptions, so that the
+     * subscriptions affected by a change can be found without looking at
+     * any of the others.
+     */
+    struct SubscriptionNode {
+        /**
+         * These are the tokens of the subscriptions to the path
+         * leading to this node.
+         */
+        std::unordered_set< int > subscriptionTokens;
+
+        /**
+         * These are the nodes for the paths which extend the path
+         * leading to this node by one more key.
+         */
+        std::unordered_map< std::string, std::unique_ptr< SubscriptionNode > > children;
+    };
+
+    /**
+     * This describes how a change made to the store
+     * relates to a subscription.
+     */
+    struct Relation {
+        /**
+         * This indicates whether the change was made to the subscribed
+         * data, or something inside it.
+         */
+        bool inside = false;
+
+        /**
+         * This indicates whether the change was made to something
+         * containing the subscribed data.
+         */
+        bool above = false;
+    };
+
+    void AddSubscription(
+        SubscriptionNode& root,
+        const std::vector< std::string >& path,
+        int subscriptionToken
+    ) {
+        auto node = &root;
+        for (const auto& key: path) {
+            auto& child = node->children[key];
+            if (child == nullptr) {
+                child.reset(new SubscriptionNode());
+            }
+            node = child.get();
+        }
+        (void)node->subscriptionTokens.insert(subscriptionToken);
+    }
+
+    /**
+     * Remove a subscription from the tree of subscriptions,
+     * along with any nodes left with no subscriptions under them.
+     *
+     * @param[in,out] node
+     *     This is the node of the tree from which to remove
+     *     the subscription.
+     *
+     * @param[in] path
+     *     This is the path of the subscription.
+     *
+     * @param[in] subscriptionToken
+     *     This is the token of the subscription.
+     *
+     * @param[in] offset
+     *     This is the index of the next path element.
+     *
+     * @return
+     *     An indication of whether or not the given node was left
+     *     with no subscriptions under it is returned.
+     */
+    bool RemoveSubscription(
+        SubscriptionNode& node,
+        const std::vector< std::string >& path,
+        int subscriptionToken,
+        size_t offset = 0
+    ) {
+        if (offset >= path.size()) {
+            (void)node.subscriptionTokens.erase(subscriptionToken);
+        } else {
+            const auto childrenEntry = node.children.find(path[offset]);
+            if (
+                (childrenEntry != node.children.end())
+                && RemoveSubscription(*childrenEntry->second, path, subscriptionToken, offset + 1)
+            ) {
+                (void)node.children.erase(childrenEntry);
+            }
+        }
+        return (
+            node.subscriptionTokens.empty()
+            && node.children.empty()
+        );
+    }
+
+    void MarkAbove(
+        const SubscriptionNode& node,
+        std::unordered_map< int, Relation >& relations
+    ) {
+        for (const auto& childrenEntry: node.children) {
+            const auto& child = *childrenEntry.second;
+            for (const auto subscriptionToken: child.subscriptionTokens) {
+                relations[subscriptionToken].above = true;
+            }
+            MarkAbove(child, relations);
+        }
+    }
+
+    /**
+     * Find the subscriptions affected by a change made to the store
+     * at the given path.
+     *
+     * @param[in] root
+     *     This is the root of the tree of subscriptions.
+     *
+     * @param[in] path
+     *     This is the path of the change.
+     *
+     * @param[in,out] relations
+     *     This is where to record how the change relates to each
+     *     subscription it affects, keyed by subscription token.
+     */
+    void FindAffectedSubscriptions(
+        const SubscriptionNode& root,
+        const std::vector< std::string >& path,
+        std::unordered_map< int, Relation >& relations
+    ) {
+        auto node = &root;
+        for (size_t i = 0; ; ++i) {
+            for (const auto subscriptionToken: node->subscriptionTokens) {
+                relations[subscriptionToken].inside = true;
+            }
+            if (i >= path.size()) {
+                break;
+            }
+            const auto childrenEntry = node->children.find(path[i]);
+            if (childrenEntry == node->children.end()) {
+                return;
+            }
+            node = childrenEntry->second.get();
+        }
+        MarkAbove(*node, relations);
+    }
+
+    /**
+     * This holds the patch being built for all subscribers to the same
+     * path holding equivalent roles and wanting the same form of updates.
+     */
+    struct PatchGroup {
+        std::vector< std::string > path;
+        RolesHeld rolesHeld;
+        Store::UpdateMode mode = Store::UpdateMode::JsonPatch;
+
+        /**
+         * This indicates whether the changes can't be described in a patch,
+         * so that subscribers need a whole new snapshot instead.
+         */
+        bool snapshot = false;
+
+        /**
+         * This is the number of changes which made a difference to what
+         * subscribers can see.
+         */
+        size_t changes = 0;
+
+        Json::Value patch;
+        std::shared_ptr< const Store::View > view;
+    };
+
+    /**
+     * Add to the given patch whatever is needed to describe
+     * one change made to the store.
+     *
+     * @param[in,out] group
+     *     This holds the patch to which to add.
+     *
+     * @param[in] before
+     *     This describes the affected value before the change.
+     *
+     * @param[in] after
+     *     This describes the affected value after the change.
+     */
+    void AddToPatch(
+        PatchGroup& group,
+        const PatchTarget& before,
+        const PatchTarget& after
+    ) {
+        if (group.snapshot) {
+            return;
+        }
+        if (
+            !before.supported
+            || !after.supported
+        ) {
+            group.snapshot = true;
+            return;
+        }
+        if (
+            !before.visible
+            && !after.visible
+        ) {
+            return;
+        }
+        if (
+            (before.visible != after.visible)
+            && !after.parentReadable
+        ) {
+            // The value appearing or disappearing may make the object
+            // containing it appear or disappear too.
+            group.snapshot = true;
+            return;
+        }
+        ++group.changes;
+        if (group.mode == Store::UpdateMode::JsonPatch) {
+            if (!after.visible) {
+                group.patch.Add(JsonPatch::MakeOperation("remove", after.pointer));
+            } else if (before.visible) {
+                group.patch.Add(JsonPatch::MakeOperation("replace", after.pointer, after.value));
+            } else {
+                group.patch.Add(JsonPatch::MakeOperation("add", after.pointer, after.value));
+            }
+            return;
+        }
+        if (
+            (group.changes > 1)
+            || (after.pointer.back() == "-")
+        ) {
+            // Merge patches can't append to arrays, and combining merge
+            // patches isn't worth the trouble.
+            group.snapshot = true;
+            return;
+        }
+        Json::Value patch(nullptr);
+        if (
+            after.visible
+            && !JsonPatch::MakeMergePatch(
+                (before.visible ? before.value : Json::Value()),
+                after.value,
+                patch
+            )
+        ) {
+            group.snapshot = true;
+            return;
+        }
+        group.patch = JsonPatch::MakeNestedMergePatch(after.pointer, std::move(patch));
+    }
+}
+
+struct Store::Impl
+    : public std::enable_shared_from_this< Store::Impl >
+{
+    // Types
+
+    struct Subscription {
+        std::vector< std::string > path;
+        std::unordered_set< std::string > rolesHeld;
+        OnUpdate onUpdate;
+        UpdateMode mode = UpdateMode::Snapshot;
+
+        /**
+         * This indicates whether the subscriber is a replica of the store,
+         * receiving every change made to it, rather than a reader of
+         * some part of it.
+         */
+        bool replication = false;
+    };
+
+    struct Delivery {
+        int subscriptionToken = 0;
+        Update update;
+    };
+
+    // Properties
+
+    SystemAbstractions::DiagnosticsSender diagnosticsSender;
+    std::atomic< size_t > dataGeneration{0};
+    std::deque< Delivery > deliveries;
+    bool delivering = false;
+    std::string filePath;
+    Journal journal;
+
+    /**
+     * This is the ticket of the journal record of the last changes made
+     * to the store, which writers commit once they unlock the store.
+     */
+    uint64_t journalTicket = 0;
+
+    size_t maxCachedViews = defaultMaxCachedViews;
+    double minSaveInterval = 0.0;
+    size_t generation = 0;
+    bool mobilized = false;
+    std::unique_ptr< Permissions::IndexNode > permissionsIndex;
+    std::shared_ptr< const StoreMetrics > metrics;
+    std::mutex mutex;
+    double nextSaveTime = 0.0;
+    int nextSaveToken = 0;
+    int nextSubscriptionToken = 1;
+    Permissions::RoleTable roleTable;
+    std::shared_ptr< const Snapshot > pendingSave;
+
+    /**
+     * This is the ticket of the journal rotation made when the snapshot
+     * waiting to be saved was taken.
+     */
+    uint64_t pendingSaveRotation = 0;
+
+    bool prettySave = false;
+
+    /**
+     * This indicates whether the store is a replica of another, so that
+     * clients may not change it directly.
+     */
+    bool readOnly = false;
+
+    std::unordered_set< int > replicationSubscribers;
+    bool saving = false;
+    std::thread saveThread;
+    std::condition_variable saveWakeCondition;
+    bool stopSaveThread = false;
+    Json::Value store;
+    Timekeeping::Scheduler scheduler;
+    std::unordered_map< int, Subscription > subscribers;
+    SubscriptionNode subscriptionTree;
+    std::shared_ptr< const Snapshot > snapshot;
+
+    /**
+     * This is the snapshot published last, which is kept so that it can
+     * be modified once it's retired to become the spare snapshot.
+     */
+    std::shared_ptr< Snapshot > lastSnapshot;
+
+    /**
+     * This is the snapshot published before the last one, which is reused
+     * for the next snapshot if no reader still holds it.
+     */
+    std::shared_ptr< Snapshot > spareSnapshot;
+
+    /**
+     * These are the sets of changes made to the store since the spare
+     * snapshot was taken, each with the generation of the store it made,
+     * oldest first.
+     */
+    std::deque< std::pair< size_t, std::vector< Mutation > > > snapshotLog;
+
+    /**
+     * This is the generation of the store from which the snapshot log
+     * holds every change made.  Older snapshots can't be brought up to
+     * date from the log.
+     */
+    size_t snapshotLogStart = 0;
+
+    /**
+     * This is the total number of changes in the snapshot log.
+     */
+    size_t snapshotLogMutations = 0;
+    std::shared_ptr< const Configuration > configuration = std::make_shared< const Configuration >();
+    std::shared_ptr< const IdentifierRoles > identifierRoles = std::make_shared< const IdentifierRoles >();
+
+    // Constructor
+
+    Impl()
+        : diagnosticsSender("Store")
+    {
+        (void)journal.SubscribeToDiagnostics(diagnosticsSender.Chain());
+
+        // Until mobilized, keep metrics nobody will see.
+        Metrics unpublishedMetrics;
+        metrics = std::make_shared< const StoreMetrics >(unpublishedMetrics);
+    }
+
+    // Methods
+
+    /**
+     * Make the given changes to the store, all together or not at all, and
+     * queue updates for the subscribers whose data changed.
+     *
+     * @param[in] mutations
+     *     These are the changes to make, in order.
+     *
+     * @param[in] rolesHeld
+     *     These are the roles held by whoever asked for the changes.  Each
+     *     change must be permitted, given the state of the store left by
+     *     the changes before it.
+     *
+     * @return
+     *     An indication of whether or not the changes were made is returned.
+     */
+    bool ApplyMutations(
+        const std::vector< Mutation >& mutations,
+        const RolesHeld& rolesHeld
+    ) {
+        // Find which subscribers are affected by the changes.  Those wanting
+        // patches are grouped so that each patch is made only once.
+        std::unordered_map< int, PatchGroup* > affected;
+        std::unordered_map< ViewKey, PatchGroup, ViewKeyHash > jsonPatchGroups;
+        std::unordered_map< ViewKey, PatchGroup, ViewKeyHash > mergePatchGroups;
+        std::unordered_map< int, Relation > relations;
+        bool configurationChanged = false;
+        bool identifierRolesChanged = false;
+        for (const auto& mutation: mutations) {
+            FindAffectedSubscriptions(subscriptionTree, mutation.path, relations);
+            if (
+                mutation.path.empty()
+                || (mutation.path[0] == "Configuration")
+            ) {
+                configurationChanged = true;
+            }
+            if (
+                mutation.path.empty()
+                || (mutation.path[0] == "Roles")
+            ) {
+                identifierRolesChanged = true;
+            }
+        }
+        for (const auto& relationsEntry: relations) {
+            const auto subscriptionToken = relationsEntry.first;
+            const auto& subscription = subscribers[subscriptionToken];
+            if (
+                relationsEntry.second.above
+                || (subscription.mode == UpdateMode::Snapshot)
+            ) {
+                affected[subscriptionToken] = nullptr;
+                continue;
+            }
+            ViewKey key{subscription.path, MakeRolesHeld(roleTable, subscription.rolesHeld)};
+            auto& groups = (
+                (subscription.mode == UpdateMode::JsonPatch)
+                ? jsonPatchGroups
+                : mergePatchGroups
+            );
+            auto& group = groups[key];
+            group.path = key.path;
+            group.rolesHeld = key.rolesHeld;
+            group.mode = subscription.mode;
+            if (
+                (subscription.mode == UpdateMode::JsonPatch)
+                && (group.patch.GetType() != Json::Value::Type::Array)
+            ) {
+                group.patch = Json::Array({});
+            }
+            affected[subscriptionToken] = &group;
+        }
+        std::vector< PatchGroup* > groups;
+        for (auto& groupsEntry: jsonPatchGroups) {
+            groups.push_back(&groupsEntry.second);
+        }
+        for (auto& groupsEntry: mergePatchGroups) {
+            groups.push_back(&groupsEntry.second);
+        }
+
+        // Make the changes, building patches as we go along.
+        const auto roleTableSize = roleTable.GetSize();
+        std::vector< Undo > undos;
+        undos.reserve(mutations.size());
+        Permissions::Problems problems;
+        std::vector< std::pair< PatchGroup*, PatchTarget > > befores;
+        for (const auto& mutation: mutations) {
+            befores.clear();
+            for (const auto group: groups) {
+                if (
+                    group->snapshot
+                    || !IsPrefix(group->path, mutation.path)
+                ) {
+                    continue;
+                }
+                PatchTarget before;
+                if (mutation.type == Mutation::Type::Add) {
+                    before.supported = true;
+                } else {
+                    before = FindPatchTarget(
+                        permissionsIndex.get(),
+                        store,
+                        group->path,
+                        mutation,
+                        group->rolesHeld,
+                        (group->mode == UpdateMode::MergePatch)
+                    );
+                }
+                befores.emplace_back(group, std::move(before));
+            }
+            Undo undo;
+            if (
+                !IsMutationPermitted(permissionsIndex.get(), store, mutation, rolesHeld)
+                || !Mutate(store, mutation, undo)
+            ) {
+                Rollback(undos);
+                return false;
+            }
+            Permissions::Recompile(permissionsIndex, store, undo.recompilePath, roleTable, problems);
+            undos.push_back(std::move(undo));
+            for (const auto& beforesEntry: befores) {
+                const auto group = beforesEntry.first;
+                const auto after = FindPatchTarget(
+                    permissionsIndex.get(),
+                    store,
+                    group->path,
+                    mutation,
+                    group->rolesHeld,
+                    true
+                );
+                AddToPatch(*group, beforesEntry.second, after);
+            }
+        }
+        journalTicket = journal.Append(EncodeJournalRecord(undos));
+        ReportPermissionsProblems(problems);
+        if (roleTable.GetSize() != roleTableSize) {
+            // New roles named in the metadata may change which subscribers
+            // hold equivalent roles, so every patch made is suspect.
+            for (const auto group: groups) {
+                group->snapshot = true;
+            }
+        }
+        ++dataGeneration;
+        LogForSnapshots(mutations);
+        metrics->mutations->Add(mutations.size());
+        ScheduleSave();
+        if (configurationChanged) {
+            RefreshConfiguration();
+        }
+        if (identifierRolesChanged) {
+            RefreshIdentifierRoles();
+        }
+
+        // Queue updates for the affected subscribers.
+        std::unordered_map< ViewKey, std::shared_ptr< const View >, ViewKeyHash > views;
+        for (const auto& affectedEntry: affected) {
+            const auto subscriptionToken = affectedEntry.first;
+            const auto group = affectedEntry.second;
+            const auto& subscription = subscribers[subscriptionToken];
+            Delivery delivery;
+            delivery.subscriptionToken = subscriptionToken;
+            if (
+                (group == nullptr)
+                || group->snapshot
+            ) {
+                auto& view = views[ViewKey{subscription.path, MakeRolesHeld(roleTable, subscription.rolesHeld)}];
+                if (view == nullptr) {
+                    view = std::make_shared< const View >(
+                        EncodeFilteredData(permissionsIndex.get(), store, subscription.path, MakeRolesHeld(roleTable, subscription.rolesHeld)),
+                        dataGeneration
+                    );
+                }
+                delivery.update.view = view;
+            } else if (group->changes == 0) {
+                continue;
+            } else {
+                if (group->view == nullptr) {
+                    group->view = std::make_shared< const View >(std::move(group->patch), dataGeneration);
+                }
+                delivery.update.patch = true;
+                delivery.update.view = group->view;
+            }
+            deliveries.push_back(std::move(delivery));
+        }
+        QueueReplicationRecord(undos);
+        return true;
+    }
+
+    /**
+     * Queue for every replica of the store the record of the given changes
+     * made to the store, unless all of them were made to the settings
+     * belonging to this node only.
+     *
+     * @param[in] undos
+     *     These hold the changes made, in order.
+     */
+    void QueueReplicationRecord(const std::vector< Undo >& undos) {
+        if (replicationSubscribers.empty()) {
+            return;
+        }
+        bool replicated = false;
+        for (const auto& undo: undos) {
+            if (!IsNodeLocal(undo.mutation->path)) {
+                replicated = true;
+                break;
+            }
+        }
+        if (!replicated) {
+            return;
+        }
+        const auto view = std::make_shared< const View >(
+            EncodeJournalRecord(undos, true),
+            dataGeneration
+        );
+        for (const auto subscriptionToken: replicationSubscribers) {
+            Delivery delivery;
+            delivery.subscriptionToken = subscriptionToken;
+            delivery.update.patch = true;
+            delivery.update.view = view;
+            deliveries.push_back(std::move(delivery));
+        }
+    }
+
+    /**
+     * Replace everything in the store except the settings belonging to
+     * this node only with the given image of the store of which this one
+     * is a replica, and queue snapshots for every subscriber.
+     *
+     * @param[in] image
+     *     This is the image of the store of which this one is a replica.
+     */
+    void ReplaceWithReplicationImage(Json::Value&& image) {
+        if (store.Has(nodeLocalKey)) {
+            image[nodeLocalKey] = std::move(store[nodeLocalKey]);
+        } else if (image.Has(nodeLocalKey)) {
+            image.Remove(nodeLocalKey);
+        }
+        store = std::move(image);
+        CompilePermissions();
+        RefreshIdentifierRoles();
+        Save();
+        const auto current = GetSnapshot();
+        std::shared_ptr< const View > replicationView;
+        for (const auto& subscribersEntry: subscribers) {
+            const auto& subscription = subscribersEntry.second;
+            Delivery delivery;
+            delivery.subscriptionToken = subscribersEntry.first;
+            if (subscription.replication) {
+                if (replicationView == nullptr) {
+                    replicationView = std::make_shared< const View >(
+                        EncodeReplicationImage(store),
+                        dataGeneration
+                    );
+                }
+                delivery.update.view = replicationView;
+            } else {
+                delivery.update.view = current->GetView(subscription.path, subscription.rolesHeld);
+            }
+            deliveries.push_back(std::move(delivery));
+        }
+    }
+
+    /**
+     * Undo the given changes made to the store, in reverse order.
+     *
+     * @param[in,out] undos
+     *     These hold what's needed to undo the changes.
+     */
+    void Rollback(std::vector< Undo >& undos) {
+        for (auto undosEntry = undos.rbegin(); undosEntry != undos.rend(); ++undosEntry) {
+            Unmutate(store, *undosEntry);
+            Permissions::Problems problems;
+            Permissions::Recompile(permissionsIndex, store, undosEntry->recompilePath, roleTable, problems);
+        }
+    }
+
+    /**
+     * Rebuild the permissions index and the role table from the metadata
+     * in the store, and retire all views of the store made before now.
+     * This must be called whenever the store is loaded or replaced.
+     */
+    void CompilePermissions() {
+        ++dataGeneration;
+        ClearSnapshotLog();
+
+        // Changes made since the last full compile only ever add roles to
+        // the table, so start it afresh, to let go of roles no longer
+        // named anywhere.  This numbers the roles differently, so views
+        // kept by the spare snapshot are no good anymore either.
+        roleTable = Permissions::RoleTable();
+        spareSnapshot = nullptr;
+        Permissions::Problems problems;
+        permissionsIndex = Permissions::Compile(store, roleTable, problems);
+        ReportPermissionsProblems(problems);
+    }
+
+    /**
+     * Publish warnings about anything found wrong with the metadata
+     * in the store while compiling it.
+     *
+     * @param[in] problems
+     *     These describe what was found wrong with the metadata.
+     */
+    void ReportPermissionsProblems(const Permissions::Problems& problems) {
+        for (const auto& problem: problems) {
+            diagnosticsSender.SendDiagnosticInformationFormatted(
+                SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                "Bad metadata ignored: %s",
+                problem.c_str()
+            );
+        }
+        if (roleTable.Overflowed()) {
+            diagnosticsSender.SendDiagnosticInformationFormatted(
+                SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                "More than %zu distinct roles named in metadata; excess roles ignored",
+                Permissions::maxRoles
+            );
+        }
+    }
+
+    Json::Value GetData(
+        const std::vector< std::string >& path,
+        const std::unordered_set< std::string >& rolesHeld
+    ) {
+        return GetFilteredData(permissionsIndex.get(), store, path, MakeRolesHeld(roleTable, rolesHeld));
+    }
+
+    /**
+     * Remake the configuration from the settings in the store,
+     * and publish it.
+     */
+    void RefreshConfiguration() {
+        std::shared_ptr< Configuration > newConfiguration(new Configuration());
+        newConfiguration->revision = dataGeneration;
+        newConfiguration->settings = GetData({"Configuration"}, {});
+        const auto& settings = newConfiguration->settings;
+        if (settings.Has("MinSaveInterval")) {
+            minSaveInterval = settings["MinSaveInterval"];
+        } else {
+            minSaveInterval = defaultMinSaveInterval;
+        }
+        if (settings.Has("MaxCachedViews")) {
+            maxCachedViews = settings["MaxCachedViews"];
+        } else {
+            maxCachedViews = defaultMaxCachedViews;
+        }
+        if (settings.Has("PrettySave")) {
+            prettySave = settings["PrettySave"];
+        } else {
+            prettySave = false;
+        }
+        newConfiguration->webSocketAuthenticationTimeout = settings["WebSocketAuthenticationTimeout"];
+        newConfiguration->webSocketCloseLinger = settings["WebSocketCloseLinger"];
+        newConfiguration->webSocketMaxUpdateRate = settings["WebSocketMaxUpdateRate"];
+        if (settings.Has("WebSocketMaxPendingUpdates")) {
+            newConfiguration->webSocketMaxPendingUpdates = settings["WebSocketMaxPendingUpdates"];
+        } else {
+            newConfiguration->webSocketMaxPendingUpdates = defaultWebSocketMaxPendingUpdates;
+        }
+        if (settings.Has("WebSocketMaxOverflows")) {
+            newConfiguration->webSocketMaxOverflows = settings["WebSocketMaxOverflows"];
+        } else {
+            newConfiguration->webSocketMaxOverflows = defaultWebSocketMaxOverflows;
+        }
+        if (settings.Has("WebSocketOverflowWindow")) {
+            newConfiguration->webSocketOverflowWindow = settings["WebSocketOverflowWindow"];
+        } else {
+            newConfiguration->webSocketOverflowWindow = defaultWebSocketOverflowWindow;
+        }
+        if (settings.Has("TwitchTokenValidationCacheTime")) {
+            newConfiguration->twitchTokenValidationCacheTime = settings["TwitchTokenValidationCacheTime"];
+        } else {
+            newConfiguration->twitchTokenValidationCacheTime = defaultTwitchTokenValidationCacheTime;
+        }
+        std::atomic_store(&configuration, std::shared_ptr< const Configuration >(newConfiguration));
+    }
+
+    /**
+     * Remake the index of roles granted to client identifiers from the
+     * roles in the store, and publish it.
+     */
+    void RefreshIdentifierRoles() {
+        std::shared_ptr< IdentifierRoles > newIdentifierRoles(new IdentifierRoles());
+        newIdentifierRoles->revision = dataGeneration;
+        const auto roles = GetData({"Roles"}, {});
+        if (roles.GetType() == Json::Value::Type::Object) {
+            for (const auto rolesEntry: roles) {
+                auto& identifierRoles = newIdentifierRoles->roles[rolesEntry.key()];
+                for (const auto identifierRolesEntry: rolesEntry.value()) {
+                    identifierRoles.push_back(identifierRolesEntry.value());
+                }
+
+                // Replicas know clients presenting access keys only by the
+                // hashes of the keys, so list the roles under those too.
+                const auto hiddenIdentifier = AccessKeys::HideIdentifier(rolesEntry.key());
+                if (hiddenIdentifier != rolesEntry.key()) {
+                    newIdentifierRoles->roles[hiddenIdentifier] = identifierRoles;
+                }
+            }
+        }
+        std::atomic_store(&identifierRoles, std::shared_ptr< const IdentifierRoles >(newIdentifierRoles));
+    }
+
+    /**
+     * Bring the given snapshot, formerly the spare, up to date by making
+     * the changes made to the store since the snapshot was taken.
+     *
+     * @param[in,out] spare
+     *     This is the snapshot to bring up to date.  No reader may hold it.
+     *
+     * @return
+     *     An indication of whether or not the snapshot was brought up to
+     *     date is returned.  If not, it must not be used.
+     */
+    bool CatchUpSnapshot(Snapshot& spare) {
+        spare.roleTable = roleTable;
+        Permissions::Problems problems;
+        for (const auto& snapshotLogEntry: snapshotLog) {
+            if (snapshotLogEntry.first <= spare.generation) {
+                continue;
+            }
+            for (const auto& mutation: snapshotLogEntry.second) {
+                Undo undo;
+                if (!Mutate(spare.store, mutation, undo)) {
+                    return false;
+                }
+                Permissions::Recompile(spare.permissionsIndex, spare.store, undo.recompilePath, spare.roleTable, problems);
+            }
+        }
+        std::lock_guard< decltype(spare.viewsMutex) > lock(spare.viewsMutex);
+        spare.views.clear();
+        return true;
+    }
+
+    /**
+     * Forget the changes remembered for bringing the spare snapshot up to
+     * date, so that every snapshot already taken has to be copied afresh.
+     * This is done when the store is changed other than by mutations.
+     */
+    void ClearSnapshotLog() {
+        snapshotLog.clear();
+        snapshotLogMutations = 0;
+        snapshotLogStart = dataGeneration;
+    }
+
+    /**
+     * Remember the given changes just made to the store, so that they can
+     * be made to the spare snapshot when it's next brought up to date.
+     *
+     * @param[in] mutations
+     *     These are the changes made.
+     */
+    void LogForSnapshots(const std::vector< Mutation >& mutations) {
+        if (
+            (lastSnapshot == nullptr)
+            || (snapshotLogMutations + mutations.size() > maxSnapshotLogMutations)
+        ) {
+            ClearSnapshotLog();
+            return;
+        }
+        snapshotLog.emplace_back(dataGeneration, mutations);
+        snapshotLogMutations += mutations.size();
+    }
+
+    /**
+     * Forget the changes which every snapshot still kept already includes.
+     */
+    void TrimSnapshotLog() {
+        const auto oldest = (
+            (spareSnapshot == nullptr)
+            ? lastSnapshot->generation
+            : spareSnapshot->generation
+        );
+        while (
+            !snapshotLog.empty()
+            && (snapshotLog.front().first <= oldest)
+        ) {
+            snapshotLogMutations -= snapshotLog.front().second.size();
+            snapshotLog.pop_front();
+        }
+    }
+
+    /**
+     * Return the published snapshot of the store, first making and
+     * publishing a new one if the store has been modified since the
+     * last one was made.  The store must be locked.
+     *
+     * @return
+     *     The snapshot of the store is returned.
+     */
+    std::shared_ptr< const Snapshot > GetSnapshot() {
+        auto current = std::atomic_load(&snapshot);
+        if (
+            (current != nullptr)
+            && (current->generation == dataGeneration)
+        ) {
+            return current;
+        }
+        std::shared_ptr< Snapshot > newSnapshot;
+        if (
+            (spareSnapshot != nullptr)
+            && (spareSnapshot.use_count() == 1)
+            && (spareSnapshot->generation >= snapshotLogStart)
+        ) {
+            // Readers let go of the spare with release semantics, so make
+            // sure everything they did with it is done before reusing it.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            newSnapshot = std::move(spareSnapshot);
+            if (!CatchUpSnapshot(*newSnapshot)) {
+                newSnapshot = nullptr;
+            }
+        }
+        if (newSnapshot == nullptr) {
+            newSnapshot = std::make_shared< Snapshot >();
+            newSnapshot->store = store;
+            newSnapshot->permissionsIndex = Permissions::Copy(permissionsIndex.get());
+            newSnapshot->roleTable = roleTable;
+        }
+        newSnapshot->generation = dataGeneration;
+        newSnapshot->maxCachedViews = maxCachedViews;
+        newSnapshot->metrics = metrics;
+        spareSnapshot = std::move(lastSnapshot);
+        lastSnapshot = newSnapshot;
+        TrimSnapshotLog();
+        current = newSnapshot;
+        std::atomic_store(&snapshot, current);
+        return current;
+    }
+
+    /**
+     * Return the published snapshot of the store, without locking the store
+     * unless the store has been modified since the last one was made.
+     *
+     * @return
+     *     The snapshot of the store is returned.
+     */
+    std::shared_ptr< const Snapshot > GetSnapshotUnlocked() {
+        const auto current = std::atomic_load(&snapshot);
+        if (
+            (current != nullptr)
+            && (current->generation == dataGeneration)
+        ) {
+            return current;
+        }
+        std::lock_guard< decltype(mutex) > lock(mutex);
+        return GetSnapshot();
+    }
+
+    /**
+     * Hand the published snapshot of the store to the save thread to write
+     * to the store file.  The snapshot is shared with readers rather than
+     * copied, so a snapshot already made since the last change costs
+     * nothing more.  If the save thread is still busy writing an earlier
+     * snapshot, the newer one replaces any other snapshot still waiting
+     * to be written.
+     */
+    void Save() {
+        saving = false;
+        pendingSaveRotation = journal.Rotate();
+        pendingSave = GetSnapshot();
+        saveWakeCondition.notify_one();
+    }
+
+    /**
+     * This is the body of the thread which encodes snapshots of the store
+     * and writes them to the store file, so that this is never done while
+     * the store is locked.  The thread writes any last snapshot handed to
+     * it before stopping.
+     */
+    void SaveThread() {
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        for (;;) {
+            saveWakeCondition.wait(
+                lock,
+                [this]{
+                    return (
+                        stopSaveThread
+                        || (pendingSave != nullptr)
+                    );
+                }
+            );
+            if (pendingSave == nullptr) {
+                break;
+            }
+            auto snapshot = std::move(pendingSave);
+            pendingSave = nullptr;
+            const auto rotation = pendingSaveRotation;
+            const auto saveFilePath = filePath;
+            Json::EncodingOptions jsonEncodingOptions;
+            jsonEncodingOptions.pretty = prettySave;
+            jsonEncodingOptions.reencode = true;
+            lock.unlock();
+            const auto encoding = snapshot->store.ToEncoding(jsonEncodingOptions);
+            snapshot.reset();
+            const auto saved = SaveFile(
+                saveFilePath,
+                "store",
+                diagnosticsSender,
+                encoding
+            );
+            if (saved) {
+                diagnosticsSender.SendDiagnosticInformationFormatted(
+                    2,
+                    "Saved to file '%s'",
+                    saveFilePath.c_str()
+                );
+
+                // Every record in the rotated journal is now in the
+                // store file.  If the journal was rotated again for
+                // another snapshot, though, the rotated journal also holds
+                // records made after this one, and the journal keeps it
+                // until that one is saved.
+                journal.DiscardRotated(rotation);
+            }
+            lock.lock();
+        }
+    }
+
+    /**
+     * Arrange for a snapshot of the store to be saved, no sooner than the
+     * minimum save interval after the last one.  Changes made before then
+     * are all picked up by the same snapshot.
+     */
+    void ScheduleSave() {
+        if (saving) {
+            return;
+        }
+        saving = true;
+        const auto now = scheduler.GetClock()->GetCurrentTime();
+        if (nextSaveTime < now) {
+            nextSaveTime = now;
+        }
+        std::weak_ptr< Impl > selfWeak(shared_from_this());
+        const auto thisGeneration = generation;
+        nextSaveToken = scheduler.Schedule(
+            [selfWeak, thisGeneration]{
+                const auto self = selfWeak.lock();
+                if (self == nullptr) {
+                    return;
+                }
+                std::lock_guard< decltype(self->mutex) > lock(self->mutex);
+                if (
+                    !self->mobilized
+                    || (self->generation != thisGeneration)
+                ) {
+                    return;
+                }
+                self->Save();
+            },
+            nextSaveTime
+        );
+        nextSaveTime += minSaveInterval;
+    }
+
+    /**
+     * Record how long a writer waited to lock the store,
+     * and how long it has held it since.
+     *
+     * @param[in] lockStartTime
+     *     This is when the writer began waiting to lock the store.
+     *
+     * @param[in] lockedTime
+     *     This is when the writer locked the store.
+     */
+    void ObserveLockTimes(
+        std::chrono::steady_clock::time_point lockStartTime,
+        std::chrono::steady_clock::time_point lockedTime
+    ) {
+        const auto now = std::chrono::steady_clock::now();
+        metrics->lockWaitTime->Observe(std::chrono::duration< double >(lockedTime - lockStartTime).count());
+        metrics->lockHoldTime->Observe(std::chrono::duration< double >(now - lockedTime).count());
+    }
+
+    /**
+     * Wait for the journal record of the last changes made to the store
+     * to be flushed to storage, without holding the store lock meanwhile,
+     * so that other writers can queue their records to be flushed along
+     * with it.  If the record couldn't be stored, save a snapshot of the
+     * store right away instead, since the changes have already been made.
+     *
+     * @param[in,out] lock
+     *     This is the object holding the mutex protecting the store.
+     */
+    void CommitJournal(std::unique_lock< std::mutex >& lock) {
+        const auto ticket = journalTicket;
+        lock.unlock();
+        const auto committed = journal.Commit(ticket);
+        lock.lock();
+        if (
+            committed
+            || !mobilized
+        ) {
+            return;
+        }
+        diagnosticsSender.SendDiagnosticInformationString(
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "Changes not journaled; saving a snapshot instead"
+        );
+        if (saving) {
+            scheduler.Cancel(nextSaveToken);
+        }
+        Save();
+    }
+
+    /**
+     * Deliver all queued updates to their subscribers, one at a time,
+     * without the store locked.  If some other thread is already delivering
+     * updates, it's left to deliver the queued updates too, so that updates
+     * are always delivered in order.
+     *
+     * Updates are taken from the queue in batches, so that fanning out one
+     * change to many subscribers unlocks and relocks the store only once.
+     * A subscription terminated while a batch is being delivered may
+     * still receive an update from that batch.
+     *
+     * @param[in,out] lock
+     *     This is the lock held on the store.
+     */
+    void Deliver(std::unique_lock< std::mutex >& lock) {
+        if (delivering) {
+            return;
+        }
+        delivering = true;
+        std::vector< std::pair< OnUpdate, Update > > batch;
+        while (!deliveries.empty()) {
+            batch.clear();
+            for (auto& delivery: deliveries) {
+                const auto subscribersEntry = subscribers.find(delivery.subscriptionToken);
+                if (subscribersEntry == subscribers.end()) {
+                    continue;
+                }
+                batch.emplace_back(subscribersEntry->second.onUpdate, std::move(delivery.update));
+            }
+            deliveries.clear();
+            lock.unlock();
+            for (const auto& batchEntry: batch) {
+                batchEntry.first(batchEntry.second);
+            }
+            lock.lock();
+        }
+        delivering = false;
+    }
+
+    std::function< void() > SubscribeToData(
+        const std::vector< std::string >& path,
+        const std::unordered_set< std::string >& rolesHeld,
+        OnUpdate onUpdate,
+        UpdateMode mode,
+        std::unique_lock< std::mutex >& lock
+    ) {
+        const auto subscriptionToken = nextSubscriptionToken++;
+        auto& subscription = subscribers[subscriptionToken];
+        subscription.path = path;
+        subscription.rolesHeld = rolesHeld;
+        subscription.onUpdate = onUpdate;
+        subscription.mode = mode;
+        AddSubscription(subscriptionTree, path, subscriptionToken);
+        metrics->subscribers->Set((int64_t)subscribers.size());
+        Delivery delivery;
+        delivery.subscriptionToken = subscriptionToken;
+        delivery.update.view = GetSnapshot()->GetView(path, rolesHeld);
+        deliveries.push_back(std::move(delivery));
+        Deliver(lock);
+        return MakeUnsubscribeDelegate(subscriptionToken);
+    }
+
+    std::function< void() > SubscribeToReplication(
+        OnUpdate onUpdate,
+        std::unique_lock< std::mutex >& lock
+    ) {
+        const auto subscriptionToken = nextSubscriptionToken++;
+        auto& subscription = subscribers[subscriptionToken];
+        subscription.onUpdate = onUpdate;
+        subscription.replication = true;
+        (void)replicationSubscribers.insert(subscriptionToken);
+        metrics->subscribers->Set((int64_t)subscribers.size());
+        Delivery delivery;
+        delivery.subscriptionToken = subscriptionToken;
+        delivery.update.view = std::make_shared< const View >(
+            EncodeReplicationImage(store),
+            dataGeneration
+        );
+        deliveries.push_back(std::move(delivery));
+        Deliver(lock);
+        return MakeUnsubscribeDelegate(subscriptionToken);
+    }
+
+    /**
+     * Return a function which may be called to terminate
+     * the subscription with the given token.
+     *
+     * @param[in] subscriptionToken
+     *     This identifies the subscription.
+     *
+     * @return
+     *     A function which may be called to terminate
+     *     the subscription is returned.
+     */
+    std::function< void() > MakeUnsubscribeDelegate(int subscriptionToken) {
+        std::weak_ptr< Impl > selfWeak(shared_from_this());
+        return [selfWeak, subscriptionToken]{
+            const auto self = selfWeak.lock();
+            if (self == nullptr) {
+                return;
+            }
+            std::lock_guard< decltype(self->mutex) > lock(self->mutex);
+            const auto subscribersEntry = self->subscribers.find(subscriptionToken);
+            if (subscribersEntry == self->subscribers.end()) {
+                return;
+            }
+            if (subscribersEntry->second.replication) {
+                (void)self->replicationSubscribers.erase(subscriptionToken);
+            } else {
+                (void)RemoveSubscription(self->subscriptionTree, subscribersEntry->second.path, subscriptionToken);
+            }
+            (void)self->subscribers.erase(subscribersEntry);
+            self->metrics->subscribers->Set((int64_t)self->subscribers.size());
+        };
+    }
+};
+
+/**
+ * This holds one encoding of a view, made only once.
+ */
+struct Store::View::Encoding {
+    std::once_flag once;
+    std::shared_ptr< const std::string > value;
+};
+
+Store::View::View(
+    Json::Value&& data,
+    size_t revision
+)
+    : data_(std::move(data))
+    , revision_(revision)
+{
+}
+
+Store::View::View(
+    std::string&& dataEncoding,
+    size_t revision
+)
+    : dataEncoding_(std::move(dataEncoding))
+    , revision_(revision)
+{
+}
+
+const Json::Value& Store::View::GetData() const {
+    std::call_once(
+        dataOnce_,
+        [this]{
+            if (data_.GetType() == Json::Value::Type::Invalid) {
+                data_ = Json::Value::FromEncoding(dataEncoding_);
+            }
+        }
+    );
+    return data_;
+}
+
+const std::string& Store::View::GetDataEncoding() const {
+    std::call_once(
+        dataEncodingOnce_,
+        [this]{
+            if (dataEncoding_.empty()) {
+                dataEncoding_ = data_.ToEncoding();
+            }
+        }
+    );
+    return dataEncoding_;
+}
+
+size_t Store::View::GetRevision() const {
+    return revision_;
+}
+
+std::shared_ptr< const std::string > Store::View::GetEncoding(
+    const std::string& format,
+    const Encoder& encoder
+) const {
+    std::shared_ptr< Encoding > encoding;
+    {
+        std::lock_guard< decltype(mutex_) > lock(mutex_);
+        auto& encodingsEntry = encodings_[format];
+        if (encodingsEntry == nullptr) {
+            encodingsEntry = std::make_shared< Encoding >();
+        }
+        encoding = encodingsEntry;
+    }
+    // Encode without holding up readers of other formats, while every
+    // reader of this format waits for the one encoding made for them all.
+    std::call_once(
+        encoding->once,
+        [this, &encoder, &encoding]{
+            encoding->value = std::make_shared< const std::string >(encoder(*this));
+        }
+    );
+    return encoding->value;
+}
+
+Store::~Store() noexcept {
+    Demobilize();
+}
+
+Store::Store(Store&&) noexcept = default;
+Store& Store::operator=(Store&&) noexcept = default;
+
+Store::Store()
+    : impl_(new Impl())
+{
+}
+
+bool Store::ApplyMutations(const std::vector< Mutation >& mutations) {
+    const auto lockStartTime = std::chrono::steady_clock::now();
+    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+    const auto lockedTime = std::chrono::steady_clock::now();
+    if (!impl_->mobilized) {
+        return false;
+    }
+    RolesHeld rolesHeld;
+    rolesHeld.unrestricted = true;
+    const auto applied = impl_->ApplyMutations(mutations, rolesHeld);
+    impl_->ObserveLockTimes(lockStartTime, lockedTime);
+    if (!applied) {
+        return false;
+    }
+    impl_->CommitJournal(lock);
+    impl_->Deliver(lock);
+    return true;
+}
+
+bool Store::ApplyMutations(
+    const std::vector< Mutation >& mutations,
+    const std::unordered_set< std::string >& rolesHeld
+) {
+    const auto lockStartTime = std::chrono::steady_clock::now();
+    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+    const auto lockedTime = std::chrono::steady_clock::now();
+    if (!impl_->mobilized) {
+        return false;
+    }
+    // Unlike readers, writers holding no roles at all
+    // are permitted nothing special.
+    if (impl_->readOnly) {
+        return false;
+    }
+    auto rolesHeldBits = MakeRolesHeld(impl_->roleTable, rolesHeld);
+    rolesHeldBits.unrestricted = false;
+    const auto applied = impl_->ApplyMutations(mutations, rolesHeldBits);
+    impl_->ObserveLockTimes(lockStartTime, lockedTime);
+    if (!applied) {
+        return false;
+    }
+    impl_->CommitJournal(lock);
+    impl_->Deliver(lock);
+    return true;
+}
+
+bool Store::ApplyReplicated(
+    bool whole,
+    const Json::Value& data
+) {
+    std::vector< Mutation > mutations;
+    if (whole) {
+        if (data.GetType() != Json::Value::Type::Object) {
+            return false;
+        }
+    } else if (!DecodeReplicationRecord(data, mutations)) {
+        return false;
+    }
+    const auto lockStartTime = std::chrono::steady_clock::now();
+    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+    const auto lockedTime = std::chrono::steady_clock::now();
+    if (!impl_->mobilized) {
+        return false;
+    }
+    if (whole) {
+        impl_->ReplaceWithReplicationImage(Json::Value(data));
+    } else if (!mutations.empty()) {
+        RolesHeld rolesHeld;
+        rolesHeld.unrestricted = true;
+        if (!impl_->ApplyMutations(mutations, rolesHeld)) {
+            impl_->ObserveLockTimes(lockStartTime, lockedTime);
+            return false;
+        }
+        impl_->ObserveLockTimes(lockStartTime, lockedTime);
+        impl_->CommitJournal(lock);
+    } else {
+        impl_->ObserveLockTimes(lockStartTime, lockedTime);
+    }
+    impl_->Deliver(lock);
+    return true;
+}
+
+void Store::Demobilize() {
+    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (!impl_->mobilized) {
+        return;
+    }
+    if (impl_->saving) {
+        // Don't wait for the minimum save interval to pass;
+        // save any changes not yet saved now.
+        impl_->scheduler.Cancel(impl_->nextSaveToken);
+        impl_->Save();
+    }
+    impl_->stopSaveThread = true;
+    impl_->saveWakeCondition.notify_one();
+    impl_->scheduler.SetClock(nullptr);
+    impl_->mobilized = false;
+    lock.unlock();
+    impl_->saveThread.join();
+    impl_->journal.Close();
+}
+
+std::shared_ptr< const Store::Configuration > Store::GetConfiguration() {
+    return std::atomic_load(&impl_->configuration);
+}
+
+Json::Value Store::GetData(
+    const std::vector< std::string >& path,
+    const std::unordered_set< std::string >& rolesHeld
+) {
+    return impl_->GetSnapshotUnlocked()->GetData(path, rolesHeld);
+}
+
+std::shared_ptr< const Store::IdentifierRoles > Store::GetIdentifierRoles() {
+    return std::atomic_load(&impl_->identifierRoles);
+}
+
+std::shared_ptr< const Store::View > Store::GetView(
+    const std::vector< std::string >& path,
+    const std::unordered_set< std::string >& rolesHeld
+) {
+    return impl_->GetSnapshotUnlocked()->GetView(path, rolesHeld);
+}
+
+bool Store::ReloadSettings(const std::string& settingsFilePath) {
+    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (!impl_->mobilized) {
+        return false;
+    }
+    lock.unlock();
+    const auto& filePath = settingsFilePath;
+    std::string encodedSettings;
+    if (
+        !LoadFile(
+            filePath,
+            "settings",
+            impl_->diagnosticsSender,
+            encodedSettings
+        )
+    ) {
+        return false;
+    }
+    const auto settings = Json::Value::FromEncoding(encodedSettings);
+    if (settings.GetType() != Json::Value::Type::Object) {
+        impl_->diagnosticsSender.SendDiagnosticInformationFormatted(
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "Unable to parse from file '%s'",
+            filePath.c_str()
+        );
+        return false;
+    }
+    const auto lockStartTime = std::chrono::steady_clock::now();
+    lock.lock();
+    const auto lockedTime = std::chrono::steady_clock::now();
+    if (!impl_->mobilized) {
+        return false;
+    }
+    std::vector< Mutation > mutations;
+    std::vector< std::string > reloadedKeys;
+    for (const auto& key: reloadableKeys) {
+        if (
+            !settings.Has(key)
+            || (
+                impl_->readOnly
+                && !IsNodeLocal({key})
+            )
+        ) {
+            // A replica's roles come from the store it replicates.
+            continue;
+        }
+        const auto& value = settings[key];
+        if (impl_->store.Has(key)) {
+            if (impl_->store[key] == value) {
+                continue;
+            }
+
+            // Remove the old value first, so that its metadata
+            // is replaced along with its data.
+            Mutation removal;
+            removal.type = Mutation::Type::Remove;
+            removal.path = {key};
+            mutations.push_back(std::move(removal));
+        }
+        Mutation mutation;
+        mutation.type = Mutation::Type::Set;
+        mutation.path = {key};
+        mutation.value = value;
+        mutations.push_back(std::move(mutation));
+        reloadedKeys.push_back(key);
+    }
+    if (mutations.empty()) {
+        impl_->diagnosticsSender.SendDiagnosticInformationFormatted(
+            3,
+            "No settings changed in file '%s'",
+            filePath.c_str()
         );
+        return true;
+    }
+    RolesHeld rolesHeld;
+    rolesHeld.unrestricted = true;
+    const auto applied = impl_->ApplyMutations(mutations, rolesHeld);
+    impl_->ObserveLockTimes(lockStartTime, lockedTime);
+    if (!applied) {
         return false;
     }
     impl_->diagnosticsSender.SendDiagnosticInformationFormatted(
         3,
-        "Loaded from file '%s'",
-        filePath.c_str()
+        "Reloaded from file '%s': %s",
+        filePath.c_str(),
+        StringExtensions::Join(reloadedKeys, ", ").c_str()
     );
-    const auto configuration = impl_->GetData({"Configuration"}, {});
-    if (configuration.Has("MinSaveInterval")){
-        impl_->minSaveInterval = configuration["MinSaveInterval"];
-    } else {
-        impl_->minSaveInterval = defaultMinSaveInterval;
+    impl_->CommitJournal(lock);
+    impl_->Deliver(lock);
+    return true;
+}
+
+void Store::SetReadOnly(bool readOnly) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    impl_->readOnly = readOnly;
+}
+
+std::function< void() > Store::SubscribeToData(
+    const std::vector< std::string >& path,
+    const std::unordered_set< std::string >& rolesHeld,
+    OnUpdate onUpdate,
+    UpdateMode mode
+) {
+    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->SubscribeToData(path, rolesHeld, onUpdate, mode, lock);
+}
+
+SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate Store::SubscribeToDiagnostics(
+    SystemAbstractions::DiagnosticsSender::DiagnosticMessageDelegate delegate,
+    size_t minLevel
+) {
+    return impl_->diagnosticsSender.SubscribeToDiagnostics(delegate, minLevel);
+}
+
+std::function< void() > Store::SubscribeToReplication(OnUpdate onUpdate) {
+    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+    return impl_->SubscribeToReplication(onUpdate, lock);
+}
+
+bool Store::Mobilize(
+    const std::string& filePath,
+    std::shared_ptr< Timekeeping::Clock > clock,
+    const std::shared_ptr< Metrics >& metrics
+) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (impl_->mobilized) {
+        return true;
+    }
+    impl_->metrics = std::make_shared< const StoreMetrics >(*metrics);
+    const auto loadStartTime = std::chrono::steady_clock::now();
+    size_t encodedStoreSize;
+    std::chrono::steady_clock::time_point parseStartTime;
+    {
+        std::string encodedStore;
+        if (
+            !LoadFile(
+                filePath,
+                "store",
+                impl_->diagnosticsSender,
+                encodedStore
+            )
+        ) {
+            return false;
+        }
+        encodedStoreSize = encodedStore.size();
+        parseStartTime = std::chrono::steady_clock::now();
+        impl_->store = Json::Value::FromEncoding(encodedStore);
+
+        // The encoding is released here, rather than at the end of
+        // mobilization, so that it isn't held while replaying the journal
+        // and compiling permissions.
+    }
+    if (impl_->store.GetType() == Json::Value::Type::Invalid) {
+        impl_->diagnosticsSender.SendDiagnosticInformationFormatted(
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR,
+            "Unable to parse from file '%s'",
+            filePath.c_str()
+        );
+        return false;
+    }
+    const auto loadEndTime = std::chrono::steady_clock::now();
+    impl_->diagnosticsSender.SendDiagnosticInformationFormatted(
+        3,
+        "Loaded %zu bytes from file '%s' in %.3lf seconds (read: %.3lf, parse: %.3lf)",
+        encodedStoreSize,
+        filePath.c_str(),
+        std::chrono::duration< double >(loadEndTime - loadStartTime).count(),
+        std::chrono::duration< double >(parseStartTime - loadStartTime).count(),
+        std::chrono::duration< double >(loadEndTime - parseStartTime).count()
+    );
+    std::vector< std::string > journalRecords;
+    if (!impl_->journal.Open(filePath, journalRecords)) {
+        return false;
+    }
+    for (const auto& journalRecord: journalRecords) {
+        if (!ReplayJournalRecord(impl_->store, journalRecord)) {
+            impl_->diagnosticsSender.SendDiagnosticInformationString(
+                SystemAbstractions::DiagnosticsSender::Levels::WARNING,
+                "Skipped unreadable journal record"
+            );
+        }
     }
+    if (!journalRecords.empty()) {
+        impl_->diagnosticsSender.SendDiagnosticInformationFormatted(
+            3,
+            "Replayed %zu journal records",
+            journalRecords.size()
+        );
+    }
+    impl_->CompilePermissions();
+    impl_->RefreshConfiguration();
+    impl_->RefreshIdentifierRoles();
+    impl_->filePath = filePath;
+    impl_->stopSaveThread = false;
+    impl_->saveThread = std::thread(&Impl::SaveThread, impl_.get());
     impl_->scheduler.SetClock(clock);
     impl_->mobilized = true;
     ++impl_->generation;
+    if (!journalRecords.empty()) {
+        // Fold the replayed journal into a new snapshot.
+        impl_->ScheduleSave();
+    }
     return true;
 }
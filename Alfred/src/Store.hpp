@@ -6,12 +6,16 @@
  * This module declares the Store implementation.
  */
 
+#include "Metrics.hpp"
+
 #include <functional>
 #include <Json/Value.hpp>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <SystemAbstractions/DiagnosticsSender.hpp>
 #include <Timekeeping/Clock.hpp>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -22,7 +26,311 @@
 class Store {
     // Types
 public:
-    using OnUpdate = std::function< void(Json::Value&& data) >;
+    /**
+     * This holds a copy of part of the store, filtered according to the
+     * roles held by whoever asked for it, or a patch to such a copy.  Views
+     * are immutable and shared between all readers of the same path holding
+     * equivalent roles, until the store is next modified.
+     *
+     * A view may be made from either the data or its JSON encoding.  The
+     * other is made only if and when it's first asked for, so that views
+     * of large parts of the store which are only ever sent as JSON never
+     * hold a copy of the data.
+     */
+    class View {
+        // Types
+    public:
+        /**
+         * This is the type of function used to encode a view
+         * in some particular format.
+         */
+        using Encoder = std::function< std::string(const View& view) >;
+
+        // Constructor
+    public:
+        /**
+         * Make a view holding the given data.
+         *
+         * @param[in] data
+         *     This is the data of the view.
+         *
+         * @param[in] revision
+         *     This is the revision of the store from which the view was made.
+         */
+        View(
+            Json::Value&& data,
+            size_t revision
+        );
+
+        /**
+         * Make a view holding data with the given JSON encoding.
+         *
+         * @param[in] dataEncoding
+         *     This is the JSON encoding of the data of the view.
+         *
+         * @param[in] revision
+         *     This is the revision of the store from which the view was made.
+         */
+        View(
+            std::string&& dataEncoding,
+            size_t revision
+        );
+
+        // Methods
+    public:
+        /**
+         * Return the data of the view.
+         *
+         * @return
+         *     The data of the view is returned.
+         */
+        const Json::Value& GetData() const;
+
+        /**
+         * Return the JSON encoding of the data of the view.
+         *
+         * @return
+         *     The JSON encoding of the data of the view is returned.
+         */
+        const std::string& GetDataEncoding() const;
+
+        /**
+         * Return the revision of the store from which the view was made.
+         * Revisions increase every time the store is modified.
+         *
+         * @return
+         *     The revision of the store from which the view was made
+         *     is returned.
+         */
+        size_t GetRevision() const;
+
+        /**
+         * Return the encoding of the view in the given format, using the
+         * given encoder to make it if this is the first time the encoding
+         * in that format has been asked for.
+         *
+         * @param[in] format
+         *     This is the name of the format of the encoding.  Every reader
+         *     asking for the same format must supply an equivalent encoder.
+         *
+         * @param[in] encoder
+         *     This is the function to call to make the encoding,
+         *     if it hasn't been made already.
+         *
+         * @return
+         *     The encoding of the view in the given format is returned.
+         */
+        std::shared_ptr< const std::string > GetEncoding(
+            const std::string& format,
+            const Encoder& encoder
+        ) const;
+
+        // Private types
+    private:
+        struct Encoding;
+
+        // Private properties
+    private:
+        /**
+         * This is the data of the view, if the view was made from the data,
+         * or has been decoded from its encoding.
+         */
+        mutable Json::Value data_;
+
+        /**
+         * This is used to decode the data of the view only once.
+         */
+        mutable std::once_flag dataOnce_;
+
+        /**
+         * This is the JSON encoding of the data of the view, if the view was
+         * made from the encoding, or the data has been encoded.
+         */
+        mutable std::string dataEncoding_;
+
+        /**
+         * This is used to encode the data of the view only once.
+         */
+        mutable std::once_flag dataEncodingOnce_;
+
+        /**
+         * These are the encodings of the view asked for so far,
+         * keyed by format.
+         */
+        mutable std::unordered_map< std::string, std::shared_ptr< Encoding > > encodings_;
+
+        /**
+         * This is used to synchronize access to the encodings of the view.
+         */
+        mutable std::mutex mutex_;
+
+        /**
+         * This is the revision of the store from which the view was made.
+         */
+        size_t revision_;
+    };
+
+    /**
+     * This describes one change to make to the store.
+     */
+    struct Mutation {
+        enum class Type {
+            /**
+             * Store the value under the last key of the path, replacing
+             * whatever was there.  If that is data with metadata, only the
+             * data is replaced.
+             */
+            Set,
+
+            /**
+             * Append the value to the array at the path.
+             */
+            Add,
+
+            /**
+             * Remove the last key of the path, and whatever is under it.
+             */
+            Remove,
+        };
+
+        /**
+         * This is the kind of change to make.
+         */
+        Type type = Type::Set;
+
+        /**
+         * This is the sequence of keys identifying where in the store
+         * to make the change.
+         */
+        std::vector< std::string > path;
+
+        /**
+         * This is the value to store, for changes which store a value.
+         */
+        Json::Value value;
+    };
+
+    /**
+     * These are the forms in which subscribers can receive updates.
+     */
+    enum class UpdateMode {
+        /**
+         * Every update carries the whole of the subscribed data.
+         */
+        Snapshot,
+
+        /**
+         * After the first, updates carry JSON Patches
+         * ([RFC 6902](https://tools.ietf.org/html/rfc6902))
+         * wherever possible.
+         */
+        JsonPatch,
+
+        /**
+         * After the first, updates carry JSON Merge Patches
+         * ([RFC 7386](https://tools.ietf.org/html/rfc7386))
+         * wherever possible.
+         */
+        MergePatch,
+    };
+
+    /**
+     * This is delivered to subscribers whenever the data they subscribed
+     * to may have changed.
+     */
+    struct Update {
+        /**
+         * This indicates whether the view holds a patch, in the form
+         * requested by the subscriber, to apply to the data last delivered,
+         * rather than the whole of the subscribed data.
+         */
+        bool patch = false;
+
+        /**
+         * This holds either the whole of the subscribed data or a patch to it.
+         */
+        std::shared_ptr< const View > view;
+    };
+
+    using OnUpdate = std::function< void(const Update& update) >;
+
+    /**
+     * This holds the settings found under "Configuration" in the store,
+     * as of some revision of the store.  It's remade only when those
+     * settings change.
+     */
+    struct Configuration {
+        /**
+         * This is the revision of the store from which the
+         * configuration was made.
+         */
+        size_t revision = 0;
+
+        double webSocketAuthenticationTimeout = 0.0;
+        double webSocketCloseLinger = 0.0;
+
+        /**
+         * This is the most updates per second a WebSocket client receives
+         * for any one subscription, unless it asks for fewer.  Zero means
+         * there is no limit.
+         */
+        double webSocketMaxUpdateRate = 0.0;
+
+        /**
+         * This is the most updates which may be waiting to be sent for any
+         * one subscription of a WebSocket client.  Any more, and the waiting
+         * updates are replaced by one snapshot of the subscribed data.
+         * Zero means there is no limit.
+         */
+        size_t webSocketMaxPendingUpdates = 0;
+
+        /**
+         * This is the number of times a WebSocket client may fall so far
+         * behind that its waiting updates are replaced, within one
+         * overflow window, before it's disconnected.
+         */
+        size_t webSocketMaxOverflows = 0;
+
+        /**
+         * This is the length, in seconds, of the window over which a
+         * WebSocket client's overflows are counted.  The count starts again
+         * from zero with the first overflow after the window has passed.
+         */
+        double webSocketOverflowWindow = 0.0;
+
+        /**
+         * This is how long, in seconds, to remember that a Twitch OAuth
+         * token was found valid, before validating it again.  Zero means
+         * every use of a token is validated.
+         */
+        double twitchTokenValidationCacheTime = 0.0;
+
+        /**
+         * This holds all the settings, including those
+         * not broken out above.
+         */
+        Json::Value settings;
+    };
+
+    /**
+     * This holds the roles granted to each client identifier, as found
+     * under "Roles" in the store, as of some revision of the store.  It's
+     * remade only when the roles granted change.
+     */
+    struct IdentifierRoles {
+        /**
+         * This is the revision of the store from which the
+         * index was made.
+         */
+        size_t revision = 0;
+
+        /**
+         * These are the roles granted, keyed by client identifier.
+         * Roles granted to access keys are also listed under the
+         * hashes of the keys.
+         */
+        std::unordered_map< std::string, std::vector< std::string > > roles;
+    };
 
     // Lifecycle Methods
 public:
@@ -38,17 +346,190 @@ public:
 
     // Methods
 public:
+    /**
+     * Make the given changes to the store, all together or not at all.
+     * Subscribers are notified once for all the changes.
+     *
+     * @param[in] mutations
+     *     These are the changes to make, in order.
+     *
+     * @return
+     *     An indication of whether or not the changes were made is returned.
+     *     They are not if any of them can't be made, for example because the
+     *     path of the change doesn't exist.
+     */
+    bool ApplyMutations(const std::vector< Mutation >& mutations);
+
+    /**
+     * Make the given changes to the store on behalf of a client holding
+     * the given roles, all together or not at all.  Subscribers are
+     * notified once for all the changes.
+     *
+     * @param[in] mutations
+     *     These are the changes to make, in order.
+     *
+     * @param[in] rolesHeld
+     *     These are the roles held by the client.
+     *
+     * @return
+     *     An indication of whether or not the changes were made is returned.
+     *     They are not if any of them can't be made, or if the client isn't
+     *     permitted to make any of them.
+     */
+    bool ApplyMutations(
+        const std::vector< Mutation >& mutations,
+        const std::unordered_set< std::string >& rolesHeld
+    );
+
+    /**
+     * Bring the store up to date with another, of which it's a replica,
+     * using what was received from a subscription to replication of the
+     * other store (see SubscribeToReplication).  Subscribers are notified
+     * as for any other changes.
+     *
+     * @param[in] whole
+     *     This indicates whether the data is an image of everything
+     *     replicated from the other store, rather than a record of
+     *     changes made to it.
+     *
+     * @param[in] data
+     *     This is the image of the other store, or the record of
+     *     changes made to it.
+     *
+     * @return
+     *     An indication of whether or not the store was brought up to date
+     *     is returned.  If not, the store may no longer match the other,
+     *     and must be brought up to date with a new image of it.
+     */
+    bool ApplyReplicated(
+        bool whole,
+        const Json::Value& data
+    );
+
     void Demobilize();
 
+    /**
+     * Return the configuration found in the store.  This is cheap;
+     * the configuration is shared until it next changes.
+     *
+     * @return
+     *     The configuration found in the store is returned.
+     */
+    std::shared_ptr< const Configuration > GetConfiguration();
+
+    /**
+     * Return a copy of the data at the given path, filtered according
+     * to the given roles held.  The data is copied from an immutable
+     * snapshot of the store, so that readers don't hold up each other,
+     * or writers.
+     *
+     * @param[in] path
+     *     This is the sequence of keys identifying the data to return.
+     *
+     * @param[in] rolesHeld
+     *     These are the roles held by the reader.
+     *
+     * @return
+     *     The data at the given path is returned.
+     */
     Json::Value GetData(
         const std::vector< std::string >& path,
         const std::unordered_set< std::string >& rolesHeld
     );
 
+    /**
+     * Return the roles granted to each client identifier, as found in the
+     * store.  This is cheap; the index is shared until it next changes.
+     *
+     * @return
+     *     The roles granted to each client identifier are returned.
+     */
+    std::shared_ptr< const IdentifierRoles > GetIdentifierRoles();
+
+    /**
+     * Return a shared view of the data at the given path, filtered according
+     * to the given roles held.  Views are cached, so that readers of the same
+     * path holding equivalent roles share one copy of the data (and of any
+     * encodings of it) until the store is next modified.  Views are made
+     * from an immutable snapshot of the store, so that readers don't hold
+     * up each other, or writers.
+     *
+     * @param[in] path
+     *     This is the sequence of keys identifying the data to view.
+     *
+     * @param[in] rolesHeld
+     *     These are the roles held by the reader.
+     *
+     * @return
+     *     The view of the data at the given path is returned.
+     */
+    std::shared_ptr< const View > GetView(
+        const std::vector< std::string >& path,
+        const std::unordered_set< std::string >& rolesHeld
+    );
+
+    /**
+     * Load the given settings file, and replace the "Configuration" and
+     * "Roles" parts of the store with what's in the file, wherever they
+     * differ.  Subscribers are told about the changes as with any others,
+     * and the changes are journaled, so they last across restarts.
+     *
+     * The settings file is separate from the store file, and the store
+     * never writes to it.  Where the settings file and the store disagree,
+     * the settings file wins: any change made to a part it holds (for
+     * example, over WebSocket) lasts only until the settings are next
+     * reloaded.  Parts the settings file doesn't hold are left alone,
+     * as is everything else in the store, and the roles of a read-only
+     * store (a replica) are left as they were replicated.
+     *
+     * @param[in] settingsFilePath
+     *     This is the path to the settings file to load.
+     *
+     * @return
+     *     An indication of whether or not the file was loaded and
+     *     any changes made is returned.
+     */
+    bool ReloadSettings(const std::string& settingsFilePath);
+
+    /**
+     * Set whether or not clients may make changes to the store directly.
+     * This is set for a replica of another store, whose changes are
+     * made only through ApplyReplicated.
+     *
+     * @param[in] readOnly
+     *     This indicates whether or not the direct changes clients ask
+     *     for are refused.
+     */
+    void SetReadOnly(bool readOnly);
+
+    /**
+     * Form a new subscription to the data at the given path.  The first
+     * update delivered carries the whole of the subscribed data.  Later
+     * ones are delivered whenever the data might have changed.
+     *
+     * @param[in] path
+     *     This is the sequence of keys identifying the data to subscribe to.
+     *
+     * @param[in] rolesHeld
+     *     These are the roles held by the subscriber.
+     *
+     * @param[in] onUpdate
+     *     This is the function to call to deliver updates.  It's never
+     *     called while the store is locked, and it's called for one update
+     *     at a time, in the order in which the store was modified.
+     *
+     * @param[in] mode
+     *     This is the form in which the subscriber wants updates.
+     *
+     * @return
+     *     A function is returned which may be called
+     *     to terminate the subscription.
+     */
     std::function< void() > SubscribeToData(
         const std::vector< std::string >& path,
         const std::unordered_set< std::string >& rolesHeld,
-        OnUpdate onUpdate
+        OnUpdate onUpdate,
+        UpdateMode mode = UpdateMode::Snapshot
     );
 
     /**
@@ -72,9 +553,51 @@ public:
         size_t minLevel = 0
     );
 
+    /**
+     * Form a new subscription to every change made to the store, so that
+     * the subscriber can keep a replica of it.  The settings under
+     * "Configuration" belong to each node, and are never replicated.
+     * Access keys granted roles under "Roles" aren't either; replicas
+     * are given their hashes instead, with the "keyhash:" prefix, which
+     * are enough to check a key presented by a client.
+     *
+     * The first update delivered carries a view of the whole of the
+     * replicated data, including metadata.  Later ones are patches which
+     * carry the record of each set of changes made, in the same form as
+     * the store's journal.  Updates are delivered in the order in which
+     * the store was modified, and none are ever skipped, so the subscriber
+     * should take care to consume them promptly.
+     *
+     * @param[in] onUpdate
+     *     This is the function to call to deliver updates.  It's never
+     *     called while the store is locked.
+     *
+     * @return
+     *     A function is returned which may be called
+     *     to terminate the subscription.
+     */
+    std::function< void() > SubscribeToReplication(OnUpdate onUpdate);
+
+    /**
+     * Load the store from the given file and begin serving it.
+     *
+     * @param[in] filePath
+     *     This is the path to the file holding the store.
+     *
+     * @param[in] clock
+     *     This is used to schedule saving the store.
+     *
+     * @param[in] metrics
+     *     This is where to keep the metrics measuring the store.
+     *
+     * @return
+     *     An indication of whether or not the store was loaded
+     *     is returned.
+     */
     bool Mobilize(
         const std::string& filePath,
-        std::shared_ptr< Timekeeping::Clock > clock
+        std::shared_ptr< Timekeeping::Clock > clock,
+        const std::shared_ptr< Metrics >& metrics
     );
 
     // Private properties
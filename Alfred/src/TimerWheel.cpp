@@ -0,0 +1,246 @@
+/**
+ * @file TimerWheel.cpp
+ *
+ * This module contains the implementation of the TimerWheel class which
+ * keeps track of many coarse timeouts (such as one or two per connection)
+ * using a single recurring job of a Timekeeping::Scheduler.
+ */
+
+#include "TimerWheel.hpp"
+
+#include <list>
+#include <math.h>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is the number of slots in the wheel.  Timeouts due further ahead
+     * than one turn of the wheel wait in their slot for the wheel to come
+     * around again as many times as needed.
+     */
+    constexpr size_t numSlots = 256;
+
+    /**
+     * This holds onto a single timeout waiting in a slot of the wheel.
+     */
+    struct Timeout {
+        /**
+         * This is the token returned by Schedule for the timeout.
+         */
+        int token = 0;
+
+        /**
+         * This is the number of times the wheel must come around again
+         * before the timeout expires.
+         */
+        size_t rounds = 0;
+
+        /**
+         * This is the function to call when the timeout expires.
+         */
+        TimerWheel::Callback callback;
+    };
+
+    /**
+     * This is the type of each slot of the wheel.
+     */
+    using Slot = std::list< Timeout >;
+
+    /**
+     * This locates a timeout in the wheel, so that it can be canceled
+     * without searching for it.
+     */
+    struct TimeoutLocation {
+        size_t slot = 0;
+        Slot::iterator timeout;
+    };
+
+}
+
+/**
+ * This contains the private properties of a TimerWheel class instance.
+ */
+struct TimerWheel::Impl
+    : public std::enable_shared_from_this< TimerWheel::Impl >
+{
+    // Properties
+
+    /**
+     * This is the slot whose timeouts expire next.
+     */
+    size_t currentSlot = 0;
+
+    std::mutex mutex;
+
+    /**
+     * This is the time at which the timeouts in the current slot expire.
+     */
+    double nextTickTime = 0.0;
+
+    int nextToken = 1;
+    double resolution = 1.0;
+    std::shared_ptr< Timekeeping::Scheduler > scheduler;
+    std::vector< Slot > slots;
+
+    /**
+     * This is the token of the scheduler job which advances the wheel,
+     * or zero if the wheel is idle because it holds no timeouts.
+     */
+    int tickToken = 0;
+
+    std::unordered_map< int, TimeoutLocation > timeouts;
+
+    // Constructor
+
+    Impl()
+        : slots(numSlots)
+    {
+    }
+
+    // Methods
+
+    void ScheduleTick() {
+        std::weak_ptr< Impl > selfWeak(shared_from_this());
+        tickToken = scheduler->Schedule(
+            [selfWeak]{
+                const auto self = selfWeak.lock();
+                if (self == nullptr) {
+                    return;
+                }
+                self->Tick();
+            },
+            nextTickTime
+        );
+    }
+
+    void Tick() {
+        std::vector< Callback > expired;
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        if (scheduler == nullptr) {
+            return;
+        }
+        const auto now = scheduler->GetClock()->GetCurrentTime();
+        while (
+            (nextTickTime <= now)
+            && !timeouts.empty()
+        ) {
+            auto& slot = slots[currentSlot];
+            for (auto timeout = slot.begin(); timeout != slot.end(); ) {
+                if (timeout->rounds == 0) {
+                    expired.push_back(std::move(timeout->callback));
+                    (void)timeouts.erase(timeout->token);
+                    timeout = slot.erase(timeout);
+                } else {
+                    --timeout->rounds;
+                    ++timeout;
+                }
+            }
+            currentSlot = (currentSlot + 1) % numSlots;
+            nextTickTime += resolution;
+        }
+        if (timeouts.empty()) {
+            tickToken = 0;
+        } else {
+            ScheduleTick();
+        }
+        lock.unlock();
+        for (const auto& callback: expired) {
+            callback();
+        }
+    }
+
+};
+
+TimerWheel::~TimerWheel() noexcept {
+    Demobilize();
+}
+
+TimerWheel::TimerWheel(TimerWheel&&) noexcept = default;
+TimerWheel& TimerWheel::operator=(TimerWheel&&) noexcept = default;
+
+TimerWheel::TimerWheel()
+    : impl_(new Impl())
+{
+}
+
+void TimerWheel::Demobilize() {
+    if (impl_ == nullptr) {
+        return;
+    }
+    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+    const auto scheduler = std::move(impl_->scheduler);
+    const auto tickToken = impl_->tickToken;
+    impl_->tickToken = 0;
+    for (auto& slot: impl_->slots) {
+        slot.clear();
+    }
+    impl_->timeouts.clear();
+    lock.unlock();
+    if (
+        (scheduler != nullptr)
+        && (tickToken != 0)
+    ) {
+        scheduler->Cancel(tickToken);
+    }
+}
+
+void TimerWheel::Mobilize(
+    const std::shared_ptr< Timekeeping::Scheduler >& scheduler,
+    double resolution
+) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    impl_->scheduler = scheduler;
+    impl_->resolution = resolution;
+}
+
+int TimerWheel::Schedule(Callback callback, double due) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (impl_->scheduler == nullptr) {
+        return 0;
+    }
+    const bool idle = (impl_->tickToken == 0);
+    if (idle) {
+        impl_->nextTickTime = (
+            impl_->scheduler->GetClock()->GetCurrentTime()
+            + impl_->resolution
+        );
+    }
+    size_t ticksAhead = 0;
+    if (due > impl_->nextTickTime) {
+        ticksAhead = (size_t)ceil((due - impl_->nextTickTime) / impl_->resolution);
+    }
+    const auto slotIndex = (impl_->currentSlot + ticksAhead) % numSlots;
+    auto& slot = impl_->slots[slotIndex];
+    Timeout timeout;
+    timeout.token = impl_->nextToken++;
+    if (impl_->nextToken <= 0) {
+        impl_->nextToken = 1;
+    }
+    timeout.rounds = ticksAhead / numSlots;
+    timeout.callback = std::move(callback);
+    TimeoutLocation location;
+    location.slot = slotIndex;
+    location.timeout = slot.insert(slot.end(), std::move(timeout));
+    const auto token = location.timeout->token;
+    impl_->timeouts[token] = location;
+    if (idle) {
+        impl_->ScheduleTick();
+    }
+    return token;
+}
+
+void TimerWheel::Cancel(int token) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    const auto timeoutsEntry = impl_->timeouts.find(token);
+    if (timeoutsEntry == impl_->timeouts.end()) {
+        return;
+    }
+    const auto& location = timeoutsEntry->second;
+    (void)impl_->slots[location.slot].erase(location.timeout);
+    (void)impl_->timeouts.erase(timeoutsEntry);
+}
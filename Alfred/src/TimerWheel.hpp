@@ -0,0 +1,102 @@
+#pragma once
+
+/**
+ * @file TimerWheel.hpp
+ *
+ * This module declares the TimerWheel class which keeps track of many
+ * coarse timeouts (such as one or two per connection) using a single
+ * recurring job of a Timekeeping::Scheduler.
+ */
+
+#include <functional>
+#include <memory>
+#include <Timekeeping/Scheduler.hpp>
+
+class TimerWheel {
+    // Types
+public:
+    /**
+     * This is the type of function called when a timeout expires.
+     */
+    using Callback = std::function< void() >;
+
+    // Lifecycle
+public:
+    ~TimerWheel() noexcept;
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel(TimerWheel&&) noexcept;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+    TimerWheel& operator=(TimerWheel&&) noexcept;
+
+    // Constructor
+public:
+    TimerWheel();
+
+    // Methods
+public:
+    /**
+     * Stop keeping track of time, discarding all timeouts still pending.
+     */
+    void Demobilize();
+
+    /**
+     * Begin keeping track of time.
+     *
+     * @param[in] scheduler
+     *     This is used to advance the wheel.  Its clock is the one
+     *     against which due times are measured.
+     *
+     * @param[in] resolution
+     *     This is the number of seconds covered by each slot of the wheel.
+     *     Timeouts expire no earlier than their due times, and no later
+     *     than this long after them.
+     */
+    void Mobilize(
+        const std::shared_ptr< Timekeeping::Scheduler >& scheduler,
+        double resolution
+    );
+
+    /**
+     * Arrange for the given function to be called at the given time.
+     *
+     * @note
+     *     The function is called without any lock of the wheel held,
+     *     so it may schedule or cancel timeouts itself.
+     *
+     * @param[in] callback
+     *     This is the function to call when the timeout expires.
+     *
+     * @param[in] due
+     *     This is the time, according to the clock of the scheduler,
+     *     at which to call the function.
+     *
+     * @return
+     *     A token which may be passed to Cancel is returned.  It is never
+     *     zero, so zero may be used to indicate no timeout.  Zero is
+     *     returned if the wheel is not mobilized.
+     */
+    int Schedule(Callback callback, double due);
+
+    /**
+     * Cancel a timeout which has not yet expired.  Nothing happens if
+     * the timeout has already expired or been canceled.
+     *
+     * @param[in] token
+     *     This is the token returned by Schedule for the timeout.
+     */
+    void Cancel(int token);
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::shared_ptr< Impl > impl_;
+};
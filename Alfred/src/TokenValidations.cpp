@@ -0,0 +1,237 @@
+/**
+ * @file TokenValidations.cpp
+ *
+ * This module contains the implementation of the TokenValidations class
+ * which validates Twitch OAuth tokens, sharing requests and remembering
+ * results.
+ */
+
+#include "TokenValidations.hpp"
+
+#include <algorithm>
+#include <Hash/Sha2.hpp>
+#include <Hash/Templates.hpp>
+#include <inttypes.h>
+#include <Json/Value.hpp>
+#include <mutex>
+#include <stdio.h>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is how long, in seconds, to wait for a Twitch OAuth token
+     * validation request to complete before making another one
+     * for the same token.
+     */
+    constexpr double tokenValidationTimeout = 30.0;
+
+    /**
+     * This is the result of validating one token,
+     * or the validation still in progress.
+     */
+    struct Validation {
+        /**
+         * This indicates whether the token was found valid, rather
+         * than still being validated.
+         */
+        bool complete = false;
+
+        /**
+         * This is the time at which the result of the validation
+         * is no longer to be trusted, or, for a validation still in
+         * progress, the time at which to give up waiting for it and
+         * try again.
+         */
+        double expiration = 0.0;
+
+        intmax_t twitchId = 0;
+
+        /**
+         * These are the functions to call once the validation
+         * in progress is complete.
+         */
+        std::vector< TokenValidations::Callback > callbacks;
+    };
+
+}
+
+/**
+ * This contains the private properties of a TokenValidations class instance.
+ */
+struct TokenValidations::Impl {
+    // Properties
+
+    CacheTimeDelegate getCacheTime;
+    std::mutex mutex;
+    PostDelegate post;
+    std::shared_ptr< Timekeeping::Scheduler > scheduler;
+    std::unordered_map< std::string, Validation > validations;
+
+    // Methods
+
+    /**
+     * Deliver the result of validating a token to everyone waiting for
+     * it, and remember the result if the token was found valid.
+     *
+     * @param[in] key
+     *     This is the digest of the token validated.
+     *
+     * @param[in] response
+     *     This is the response received to the validation request.
+     */
+    void OnCompletion(
+        const std::string& key,
+        const Http::Response& response
+    ) {
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        if (scheduler == nullptr) {
+            return;
+        }
+        const auto getCacheTime = this->getCacheTime;
+        lock.unlock();
+        bool valid = false;
+        intmax_t twitchId = 0;
+        double lifetime = 0.0;
+        if (response.statusCode == 200) {
+            const auto data = Json::Value::FromEncoding(response.body);
+            if (
+                sscanf(
+                    ((std::string)data["user_id"]).c_str(),
+                    "%" SCNdMAX,
+                    &twitchId
+                ) == 1
+            ) {
+                valid = true;
+                lifetime = getCacheTime();
+                if (data.Has("expires_in")) {
+                    // Never trust a token longer than Twitch does.
+                    lifetime = std::min(lifetime, (double)(int)data["expires_in"]);
+                }
+            }
+        }
+        lock.lock();
+        if (scheduler == nullptr) {
+            return;
+        }
+        const auto now = scheduler->GetClock()->GetCurrentTime();
+        for (
+            auto validationsEntry = validations.begin();
+            validationsEntry != validations.end();
+        ) {
+            const auto& validation = validationsEntry->second;
+            if (
+                validation.complete
+                && (now >= validation.expiration)
+            ) {
+                validationsEntry = validations.erase(validationsEntry);
+            } else {
+                ++validationsEntry;
+            }
+        }
+        const auto validationsEntry = validations.find(key);
+        if (validationsEntry == validations.end()) {
+            return;
+        }
+        auto callbacks = std::move(validationsEntry->second.callbacks);
+        if (
+            valid
+            && (lifetime > 0.0)
+        ) {
+            auto& validation = validationsEntry->second;
+            validation.complete = true;
+            validation.expiration = now + lifetime;
+            validation.twitchId = twitchId;
+            validation.callbacks.clear();
+        } else {
+            (void)validations.erase(validationsEntry);
+        }
+        lock.unlock();
+        for (const auto& callback: callbacks) {
+            callback(valid, twitchId);
+        }
+    }
+};
+
+TokenValidations::~TokenValidations() noexcept = default;
+TokenValidations::TokenValidations(TokenValidations&&) noexcept = default;
+TokenValidations& TokenValidations::operator=(TokenValidations&&) noexcept = default;
+
+TokenValidations::TokenValidations()
+    : impl_(new Impl())
+{
+}
+
+void TokenValidations::Demobilize() {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    impl_->getCacheTime = nullptr;
+    impl_->post = nullptr;
+    impl_->scheduler = nullptr;
+    impl_->validations.clear();
+}
+
+void TokenValidations::Mobilize(
+    PostDelegate post,
+    const std::shared_ptr< Timekeeping::Scheduler >& scheduler,
+    CacheTimeDelegate getCacheTime
+) {
+    std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+    impl_->getCacheTime = std::move(getCacheTime);
+    impl_->post = std::move(post);
+    impl_->scheduler = scheduler;
+}
+
+void TokenValidations::Validate(
+    const std::string& token,
+    Callback callback
+) {
+    const auto key = Hash::StringToString< Hash::Sha256 >(token);
+    std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+    if (impl_->scheduler == nullptr) {
+        return;
+    }
+    const auto now = impl_->scheduler->GetClock()->GetCurrentTime();
+    auto& validation = impl_->validations[key];
+    if (validation.complete) {
+        if (now < validation.expiration) {
+            const auto twitchId = validation.twitchId;
+            (void)impl_->scheduler->Schedule(
+                [callback, twitchId]{
+                    callback(true, twitchId);
+                },
+                now
+            );
+            return;
+        }
+        validation = Validation();
+    }
+    validation.callbacks.push_back(callback);
+    if (
+        (validation.callbacks.size() > 1)
+        && (now < validation.expiration)
+    ) {
+        return;
+    }
+    validation.expiration = now + tokenValidationTimeout;
+    const auto post = impl_->post;
+    lock.unlock();
+    Http::Request request;
+    request.method = "GET";
+    request.target.ParseFromString("https://id.twitch.tv/oauth2/validate");
+    request.headers.SetHeader(
+        "Authorization",
+        std::string("OAuth ") + token
+    );
+    std::weak_ptr< Impl > implWeak(impl_);
+    post(
+        request,
+        [key, implWeak](Http::Response& response){
+            const auto impl = implWeak.lock();
+            if (impl == nullptr) {
+                return;
+            }
+            impl->OnCompletion(key, response);
+        }
+    );
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+/**
+ * @file TokenValidations.hpp
+ *
+ * This module declares the TokenValidations class which validates Twitch
+ * OAuth tokens, sharing requests and remembering results.
+ */
+
+#include <functional>
+#include <Http/Client.hpp>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <Timekeeping/Scheduler.hpp>
+
+/**
+ * This remembers which Twitch OAuth tokens were recently found valid,
+ * and which are being validated now, so that clients presenting the
+ * same token (for example, all reconnecting at once) share one
+ * validation request, and don't make another until the remembered
+ * result expires.  Tokens are keyed by their SHA-256 digest, so that
+ * the tokens themselves aren't kept.
+ */
+class TokenValidations {
+    // Types
+public:
+    /**
+     * This is the type of function called to deliver the result
+     * of validating a token.
+     *
+     * @param[in] valid
+     *     This indicates whether or not the token is valid.
+     *
+     * @param[in] twitchId
+     *     If the token is valid, this is the Twitch user ID
+     *     of its owner.
+     */
+    using Callback = std::function< void(bool valid, intmax_t twitchId) >;
+
+    /**
+     * This is the type of function called with the response
+     * to a validation request.
+     *
+     * @param[in] response
+     *     This is the response to the validation request.
+     */
+    using CompletionDelegate = std::function< void(Http::Response& response) >;
+
+    /**
+     * This is the type of function called to make a validation request.
+     *
+     * @param[in,out] request
+     *     This is the request to make.
+     *
+     * @param[in] completionDelegate
+     *     This is the function to call with the response.
+     */
+    using PostDelegate = std::function<
+        void(
+            Http::Request& request,
+            CompletionDelegate completionDelegate
+        )
+    >;
+
+    /**
+     * This is the type of function called to find out how long, in
+     * seconds, to remember that a token is valid.
+     *
+     * @return
+     *     The number of seconds to remember that a token is valid
+     *     is returned.  Zero means not to remember at all.
+     */
+    using CacheTimeDelegate = std::function< double() >;
+
+    // Lifecycle
+public:
+    ~TokenValidations() noexcept;
+    TokenValidations(const TokenValidations&) = delete;
+    TokenValidations(TokenValidations&&) noexcept;
+    TokenValidations& operator=(const TokenValidations&) = delete;
+    TokenValidations& operator=(TokenValidations&&) noexcept;
+
+    // Constructor
+public:
+    TokenValidations();
+
+    // Methods
+public:
+    /**
+     * Stop validating tokens, forgetting all results and discarding
+     * all validations still in progress.
+     */
+    void Demobilize();
+
+    /**
+     * Begin validating tokens.
+     *
+     * @param[in] post
+     *     This is the function to call to make validation requests.
+     *
+     * @param[in] scheduler
+     *     This is used to deliver results already known.  Its clock
+     *     is the one against which remembered results expire.
+     *
+     * @param[in] getCacheTime
+     *     This is the function to call to find out how long to remember
+     *     that a token is valid.
+     */
+    void Mobilize(
+        PostDelegate post,
+        const std::shared_ptr< Timekeeping::Scheduler >& scheduler,
+        CacheTimeDelegate getCacheTime
+    );
+
+    /**
+     * Determine whether or not the given Twitch OAuth token is valid.
+     * The result is always delivered asynchronously, even when it's
+     * already known.  Nothing happens if not mobilized.
+     *
+     * @param[in] token
+     *     This is the token to validate.
+     *
+     * @param[in] callback
+     *     This is the function to call to deliver the result.
+     */
+    void Validate(
+        const std::string& token,
+        Callback callback
+    );
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::shared_ptr< Impl > impl_;
+};
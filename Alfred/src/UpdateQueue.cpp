@@ -0,0 +1,186 @@
+/**
+ * @file UpdateQueue.cpp
+ *
+ * This module contains the implementation of the UpdateQueue class, which
+ * holds the updates received from the store waiting to be sent to one
+ * WebSocket client, and decides when they may be sent under the rate limits
+ * of the client's subscriptions.
+ */
+
+#include "UpdateQueue.hpp"
+
+#include <memory>
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    /**
+     * This holds the updates waiting to be sent for one subscription.
+     */
+    struct PendingUpdates {
+        int subscriptionNumber = 0;
+
+        /**
+         * This is the least amount of time, in seconds, to leave between
+         * sending updates for the subscription.
+         */
+        double minInterval = 0.0;
+
+        /**
+         * This is the earliest time the next updates
+         * for the subscription may be sent.
+         */
+        double nextSendTime = 0.0;
+
+        /**
+         * This indicates whether the client fell so far behind that
+         * the waiting updates were thrown away, so that a new snapshot
+         * of the subscribed data must be sent instead.
+         */
+        bool overflowed = false;
+
+        std::vector< Store::Update > updates;
+    };
+
+}
+
+/**
+ * This contains the private properties of an UpdateQueue class instance.
+ */
+struct UpdateQueue::Impl {
+    // Properties
+
+    /**
+     * This is the number of overflows counted since the current
+     * overflow window began.
+     */
+    size_t overflows = 0;
+
+    /**
+     * This is the time at which the current overflow window began.
+     */
+    double overflowWindowStart = 0.0;
+
+    std::unordered_map< std::string, PendingUpdates > pendingUpdates;
+};
+
+UpdateQueue::~UpdateQueue() noexcept = default;
+UpdateQueue::UpdateQueue(UpdateQueue&&) noexcept = default;
+UpdateQueue& UpdateQueue::operator=(UpdateQueue&&) noexcept = default;
+
+UpdateQueue::UpdateQueue()
+    : impl_(new Impl())
+{
+}
+
+void UpdateQueue::Close(const std::string& subscriptionId) {
+    (void)impl_->pendingUpdates.erase(subscriptionId);
+}
+
+bool UpdateQueue::GetNextFlushTime(double& flushTime) const {
+    bool any = false;
+    for (const auto& pendingUpdatesEntry: impl_->pendingUpdates) {
+        const auto& pending = pendingUpdatesEntry.second;
+        if (
+            pending.updates.empty()
+            && !pending.overflowed
+        ) {
+            continue;
+        }
+        if (
+            !any
+            || (pending.nextSendTime < flushTime)
+        ) {
+            flushTime = pending.nextSendTime;
+        }
+        any = true;
+    }
+    return any;
+}
+
+size_t UpdateQueue::GetOverflows() const {
+    return impl_->overflows;
+}
+
+void UpdateQueue::Open(
+    const std::string& subscriptionId,
+    int subscriptionNumber,
+    double minInterval
+) {
+    auto& pending = impl_->pendingUpdates[subscriptionId];
+    pending = PendingUpdates();
+    pending.subscriptionNumber = subscriptionNumber;
+    pending.minInterval = minInterval;
+}
+
+bool UpdateQueue::Queue(
+    const std::string& subscriptionId,
+    int subscriptionNumber,
+    const Store::Update& update,
+    size_t maxPendingUpdates,
+    double overflowWindow,
+    double now
+) {
+    const auto pendingUpdatesEntry = impl_->pendingUpdates.find(subscriptionId);
+    if (
+        (pendingUpdatesEntry == impl_->pendingUpdates.end())
+        || (pendingUpdatesEntry->second.subscriptionNumber != subscriptionNumber)
+    ) {
+        return false;
+    }
+    auto& pending = pendingUpdatesEntry->second;
+    if (!update.patch) {
+        // A whole snapshot makes everything before it obsolete.
+        pending.updates.clear();
+        pending.overflowed = false;
+    } else if (pending.overflowed) {
+        return false;
+    }
+    if (
+        (maxPendingUpdates > 0)
+        && (pending.updates.size() >= maxPendingUpdates)
+    ) {
+        // The client isn't keeping up.  Rather than let updates pile
+        // up, throw them away and send a new snapshot instead.
+        pending.updates.clear();
+        pending.overflowed = true;
+        if (now >= impl_->overflowWindowStart + overflowWindow) {
+            impl_->overflows = 0;
+            impl_->overflowWindowStart = now;
+        }
+        ++impl_->overflows;
+        return true;
+    }
+    pending.updates.push_back(update);
+    return false;
+}
+
+auto UpdateQueue::TakeDue(double now) -> std::vector< Due > {
+    std::vector< Due > due;
+    for (auto& pendingUpdatesEntry: impl_->pendingUpdates) {
+        auto& pending = pendingUpdatesEntry.second;
+        if (
+            (
+                pending.updates.empty()
+                && !pending.overflowed
+            )
+            || (now < pending.nextSendTime)
+        ) {
+            continue;
+        }
+        Due dueEntry;
+        dueEntry.subscriptionId = pendingUpdatesEntry.first;
+        dueEntry.subscriptionNumber = pending.subscriptionNumber;
+        dueEntry.minInterval = pending.minInterval;
+        dueEntry.overflowed = pending.overflowed;
+        dueEntry.updates = std::move(pending.updates);
+        due.push_back(std::move(dueEntry));
+        pending.updates.clear();
+        pending.overflowed = false;
+        pending.nextSendTime = now + pending.minInterval;
+    }
+    return due;
+}
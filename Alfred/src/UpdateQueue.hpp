@@ -0,0 +1,194 @@
+#pragma once
+
+/**
+ * @file UpdateQueue.hpp
+ *
+ * This module declares the UpdateQueue class, which holds the updates
+ * received from the store waiting to be sent to one WebSocket client, and
+ * decides when they may be sent under the rate limits of the client's
+ * subscriptions.
+ */
+
+#include "Store.hpp"
+
+#include <memory>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/**
+ * This holds the updates received from the store waiting to be sent to
+ * one client, for each of the client's subscriptions.  It also keeps count
+ * of how often the client fell so far behind that its waiting updates were
+ * thrown away.
+ *
+ * The queue doesn't synchronize access to itself; its owner must.
+ */
+class UpdateQueue {
+    // Types
+public:
+    /**
+     * This holds the updates waiting for one subscription which are
+     * due to be sent.
+     */
+    struct Due {
+        std::string subscriptionId;
+
+        /**
+         * This distinguishes the subscription from any earlier one
+         * with the same identifier.
+         */
+        int subscriptionNumber = 0;
+
+        /**
+         * This is the least amount of time, in seconds, to leave between
+         * sending updates for the subscription.
+         */
+        double minInterval = 0.0;
+
+        /**
+         * This indicates whether the client fell so far behind that
+         * the waiting updates were thrown away, so that a new snapshot
+         * of the subscribed data must be sent instead.
+         */
+        bool overflowed = false;
+
+        std::vector< Store::Update > updates;
+    };
+
+    // Lifecycle
+public:
+    ~UpdateQueue() noexcept;
+    UpdateQueue(const UpdateQueue&) = delete;
+    UpdateQueue(UpdateQueue&&) noexcept;
+    UpdateQueue& operator=(const UpdateQueue&) = delete;
+    UpdateQueue& operator=(UpdateQueue&&) noexcept;
+
+    // Constructor
+public:
+    UpdateQueue();
+
+    // Methods
+public:
+    /**
+     * Stop holding updates for the subscription with the given identifier,
+     * throwing away any still waiting.
+     *
+     * @param[in] subscriptionId
+     *     This identifies the subscription.
+     */
+    void Close(const std::string& subscriptionId);
+
+    /**
+     * Find the earliest time at which any updates waiting are due
+     * to be sent.
+     *
+     * @param[out] flushTime
+     *     This is where to store the time at which updates are
+     *     next due to be sent.
+     *
+     * @return
+     *     An indication of whether or not any updates are waiting
+     *     is returned.
+     */
+    bool GetNextFlushTime(double& flushTime) const;
+
+    /**
+     * Return the number of times the client fell so far behind that its
+     * waiting updates were thrown away, in the current overflow window.
+     *
+     * @return
+     *     The number of overflows in the current window is returned.
+     */
+    size_t GetOverflows() const;
+
+    /**
+     * Begin holding updates for a subscription, replacing any earlier
+     * subscription with the same identifier, and throwing away any updates
+     * still waiting for it.
+     *
+     * @param[in] subscriptionId
+     *     This identifies the subscription.
+     *
+     * @param[in] subscriptionNumber
+     *     This distinguishes the subscription from any earlier one
+     *     with the same identifier.
+     *
+     * @param[in] minInterval
+     *     This is the least amount of time, in seconds, to leave between
+     *     sending updates for the subscription.  Zero means updates are
+     *     due as soon as they're queued.
+     */
+    void Open(
+        const std::string& subscriptionId,
+        int subscriptionNumber,
+        double minInterval
+    );
+
+    /**
+     * Queue an update received from the store for a subscription.  Updates
+     * for subscriptions which aren't open (including earlier subscriptions
+     * since replaced) are ignored.
+     *
+     * @param[in] subscriptionId
+     *     This identifies the subscription.
+     *
+     * @param[in] subscriptionNumber
+     *     This distinguishes the subscription from any earlier one
+     *     with the same identifier.
+     *
+     * @param[in] update
+     *     This is the update to queue.
+     *
+     * @param[in] maxPendingUpdates
+     *     This is the most updates which may be waiting for the
+     *     subscription.  Any more, and they're all thrown away, and
+     *     counted as an overflow.  Zero means there is no limit.
+     *
+     * @param[in] overflowWindow
+     *     This is the length, in seconds, of the window over which
+     *     overflows are counted.  The count starts again from zero with
+     *     the first overflow after the window has passed.
+     *
+     * @param[in] now
+     *     This is the current time.
+     *
+     * @return
+     *     An indication of whether or not the updates waiting for the
+     *     subscription were thrown away is returned.
+     */
+    bool Queue(
+        const std::string& subscriptionId,
+        int subscriptionNumber,
+        const Store::Update& update,
+        size_t maxPendingUpdates,
+        double overflowWindow,
+        double now
+    );
+
+    /**
+     * Take out all the updates which are due to be sent.  Each subscription
+     * then isn't due again until its minimum interval has passed.
+     *
+     * @param[in] now
+     *     This is the current time.
+     *
+     * @return
+     *     The updates due to be sent are returned, grouped by subscription.
+     */
+    std::vector< Due > TakeDue(double now);
+
+    // Private properties
+private:
+    /**
+     * This is the type of structure that contains the private
+     * properties of the instance.  It is defined in the implementation
+     * and declared here to ensure that it is scoped inside the class.
+     */
+    struct Impl;
+
+    /**
+     * This contains the private properties of the instance.
+     */
+    std::shared_ptr< Impl > impl_;
+};
@@ -0,0 +1,63 @@
+/**
+ * @file AccessKeysTests.cpp
+ *
+ * This module contains the unit tests of the AccessKeys functions.
+ */
+
+#include <AccessKeys.hpp>
+#include <gtest/gtest.h>
+#include <Json/Value.hpp>
+
+namespace {
+
+    /**
+     * This is the SHA-256 digest of "secret", in hexadecimal.
+     */
+    constexpr const char* secretHash = "2bb80d537b1da3e38bd30361aa855686bde0eacd7162fef6a25fe97bf527a25b";
+
+}
+
+TEST(AccessKeysTests, HideIdentifier) {
+    EXPECT_EQ(std::string("keyhash:") + secretHash, AccessKeys::HideIdentifier("key:secret"));
+    EXPECT_EQ("twitch:42", AccessKeys::HideIdentifier("twitch:42"));
+    EXPECT_EQ("keyhash:abc", AccessKeys::HideIdentifier("keyhash:abc"));
+}
+
+TEST(AccessKeysTests, HideRoles) {
+    EXPECT_EQ(
+        Json::Object({
+            {std::string("keyhash:") + secretHash, Json::Array({"admin"})},
+            {"twitch:42", Json::Array({"user"})},
+        }),
+        AccessKeys::HideRoles(
+            Json::Object({
+                {"key:secret", Json::Array({"admin"})},
+                {"twitch:42", Json::Array({"user"})},
+            })
+        )
+    );
+}
+
+TEST(AccessKeysTests, HideRolesWrappedWithMetadata) {
+    const auto meta = Json::Object({
+        {"require", Json::Object({
+            {"read_data", Json::Array({"admin"})},
+        })},
+    });
+    EXPECT_EQ(
+        Json::Object({
+            {"data", Json::Object({
+                {std::string("keyhash:") + secretHash, Json::Array({"admin"})},
+            })},
+            {"meta", meta},
+        }),
+        AccessKeys::HideRoles(
+            Json::Object({
+                {"data", Json::Object({
+                    {"key:secret", Json::Array({"admin"})},
+                })},
+                {"meta", meta},
+            })
+        )
+    );
+}
@@ -0,0 +1,148 @@
+/**
+ * @file CborTests.cpp
+ *
+ * This module contains the unit tests of the Cbor functions.
+ */
+
+#include <Cbor.hpp>
+#include <gtest/gtest.h>
+#include <initializer_list>
+#include <Json/Value.hpp>
+#include <math.h>
+#include <stdint.h>
+#include <string>
+
+namespace {
+
+    /**
+     * Return a string holding the given bytes.
+     *
+     * @param[in] bytes
+     *     These are the bytes to put in the string.
+     *
+     * @return
+     *     A string holding the given bytes is returned.
+     */
+    std::string Bytes(std::initializer_list< uint8_t > bytes) {
+        return std::string(bytes.begin(), bytes.end());
+    }
+
+}
+
+TEST(CborTests, EncodeIntegers) {
+    EXPECT_EQ(Bytes({0x00}), Cbor::Encode(0));
+    EXPECT_EQ(Bytes({0x17}), Cbor::Encode(23));
+    EXPECT_EQ(Bytes({0x18, 0x18}), Cbor::Encode(24));
+    EXPECT_EQ(Bytes({0x18, 0x64}), Cbor::Encode(100));
+    EXPECT_EQ(Bytes({0x19, 0x03, 0xe8}), Cbor::Encode(1000));
+    EXPECT_EQ(Bytes({0x1a, 0x00, 0x0f, 0x42, 0x40}), Cbor::Encode(1000000));
+    EXPECT_EQ(
+        Bytes({0x1b, 0x00, 0x00, 0x00, 0xe8, 0xd4, 0xa5, 0x10, 0x00}),
+        Cbor::Encode((intmax_t)1000000000000)
+    );
+    EXPECT_EQ(Bytes({0x20}), Cbor::Encode(-1));
+    EXPECT_EQ(Bytes({0x38, 0x63}), Cbor::Encode(-100));
+    EXPECT_EQ(Bytes({0x39, 0x03, 0xe7}), Cbor::Encode(-1000));
+}
+
+TEST(CborTests, EncodeFloatingPoint) {
+    EXPECT_EQ(Bytes({0xfa, 0x3f, 0xc0, 0x00, 0x00}), Cbor::Encode(1.5));
+    EXPECT_EQ(
+        Bytes({0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a}),
+        Cbor::Encode(1.1)
+    );
+}
+
+TEST(CborTests, EncodeSimpleValuesAndStrings) {
+    EXPECT_EQ(Bytes({0xf4}), Cbor::Encode(false));
+    EXPECT_EQ(Bytes({0xf5}), Cbor::Encode(true));
+    EXPECT_EQ(Bytes({0xf6}), Cbor::Encode(nullptr));
+    EXPECT_EQ(Bytes({0x60}), Cbor::Encode(""));
+    EXPECT_EQ(Bytes({0x64, 0x49, 0x45, 0x54, 0x46}), Cbor::Encode("IETF"));
+}
+
+TEST(CborTests, EncodeArraysAndMaps) {
+    EXPECT_EQ(Bytes({0x80}), Cbor::Encode(Json::Array({})));
+    EXPECT_EQ(
+        Bytes({0x82, 0x01, 0x82, 0x02, 0x03}),
+        Cbor::Encode(Json::Array({1, Json::Array({2, 3})}))
+    );
+    EXPECT_EQ(Bytes({0xa0}), Cbor::Encode(Json::Object({})));
+    EXPECT_EQ(
+        Bytes({0xa1, 0x61, 0x61, 0x82, 0x02, 0x03}),
+        Cbor::Encode(Json::Object({{"a", Json::Array({2, 3})}}))
+    );
+}
+
+TEST(CborTests, RoundTrip) {
+    const auto value = Json::Object({
+        {"name", "Alfred"},
+        {"count", 42},
+        {"negative", -100000},
+        {"ratio", 0.25},
+        {"pi", 3.141592653589793},
+        {"flags", Json::Array({true, false, nullptr})},
+        {"nested", Json::Object({
+            {"empty", Json::Object({})},
+            {"list", Json::Array({})},
+        })},
+    });
+    EXPECT_EQ(value, Cbor::Decode(Cbor::Encode(value)));
+}
+
+TEST(CborTests, DecodeHalfFloats) {
+    EXPECT_EQ(1.0, (double)Cbor::Decode(Bytes({0xf9, 0x3c, 0x00})));
+    EXPECT_EQ(-4.0, (double)Cbor::Decode(Bytes({0xf9, 0xc4, 0x00})));
+    EXPECT_EQ(65504.0, (double)Cbor::Decode(Bytes({0xf9, 0x7b, 0xff})));
+    EXPECT_EQ(5.960464477539063e-8, (double)Cbor::Decode(Bytes({0xf9, 0x00, 0x01})));
+    EXPECT_EQ(-INFINITY, (double)Cbor::Decode(Bytes({0xf9, 0xfc, 0x00})));
+    EXPECT_TRUE(isnan((double)Cbor::Decode(Bytes({0xf9, 0x7e, 0x00}))));
+}
+
+TEST(CborTests, DecodeItemsNeverEncoded) {
+    EXPECT_EQ(
+        Json::Value(1363896240),
+        Cbor::Decode(Bytes({0xc1, 0x1a, 0x51, 0x4b, 0x67, 0xb0}))
+    );
+    EXPECT_EQ(
+        Json::Value(Bytes({0x01, 0x02, 0x03, 0x04})),
+        Cbor::Decode(Bytes({0x44, 0x01, 0x02, 0x03, 0x04}))
+    );
+    EXPECT_EQ(Json::Value(nullptr), Cbor::Decode(Bytes({0xf7})));
+    const auto big = Cbor::Decode(
+        Bytes({0x1b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff})
+    );
+    EXPECT_EQ(Json::Value::Type::FloatingPoint, big.GetType());
+    EXPECT_EQ(18446744073709551615.0, (double)big);
+}
+
+TEST(CborTests, DecodeMalformed) {
+    const std::string malformed[] = {
+        "",
+        Bytes({0x19, 0x03}),
+        Bytes({0x00, 0x00}),
+        Bytes({0x62, 0x61}),
+        Bytes({0x82, 0x01}),
+        Bytes({0x9f, 0x01, 0xff}),
+        Bytes({0x7f, 0x61, 0x61, 0xff}),
+        Bytes({0xa1, 0x01, 0x02}),
+        Bytes({0xa1, 0x61, 0x61}),
+        Bytes({0xf0}),
+        Bytes({0x1c}),
+    };
+    for (const auto& encoding: malformed) {
+        EXPECT_EQ(
+            Json::Value::Type::Invalid,
+            Cbor::Decode(encoding).GetType()
+        ) << Json::Value(encoding).ToEncoding();
+    }
+}
+
+TEST(CborTests, DecodeNestingLimited) {
+    std::string encoding(64, (char)0x81);
+    encoding += (char)0x00;
+    EXPECT_EQ(Json::Value::Type::Array, Cbor::Decode(encoding).GetType());
+    encoding = std::string(100000, (char)0x81);
+    encoding += (char)0x00;
+    EXPECT_EQ(Json::Value::Type::Invalid, Cbor::Decode(encoding).GetType());
+}
@@ -0,0 +1,261 @@
+/**
+ * @file HttpCachingTests.cpp
+ *
+ * This module contains the unit tests of the HttpCaching functions.
+ */
+
+#include <gtest/gtest.h>
+#include <Http/Server.hpp>
+#include <HttpCaching.hpp>
+#include <Json/Value.hpp>
+#include <memory>
+#include <Store.hpp>
+#include <string>
+
+namespace {
+
+    /**
+     * This is the run tag used in these tests, unless they're testing
+     * what happens with another one.
+     */
+    constexpr const char* testRunTag = "0123456789abcdef";
+
+    /**
+     * Make a request for a view of the store.
+     *
+     * @param[in] acceptEncoding
+     *     If not empty, this is the value of the "Accept-Encoding" header
+     *     to put in the request.
+     *
+     * @param[in] ifNoneMatch
+     *     If not empty, this is the value of the "If-None-Match" header
+     *     to put in the request.
+     *
+     * @return
+     *     The request is returned.
+     */
+    Http::Request MakeRequest(
+        const std::string& acceptEncoding,
+        const std::string& ifNoneMatch = ""
+    ) {
+        Http::Request request;
+        request.method = "GET";
+        if (!acceptEncoding.empty()) {
+            request.headers.SetHeader("Accept-Encoding", acceptEncoding);
+        }
+        if (!ifNoneMatch.empty()) {
+            request.headers.SetHeader("If-None-Match", ifNoneMatch);
+        }
+        return request;
+    }
+
+    /**
+     * Make a view of the store with enough data in it to be worth
+     * compressing.
+     *
+     * @param[in] revision
+     *     This is the revision of the store from which the view is made.
+     *
+     * @return
+     *     The view is returned.
+     */
+    std::shared_ptr< const Store::View > MakeView(size_t revision) {
+        return std::make_shared< const Store::View >(
+            Json::Object({
+                {"text", std::string(1000, 'x')},
+            }),
+            revision
+        );
+    }
+
+}
+
+TEST(HttpCachingTests, EntityTagIdentifiesRunRevisionAndCoding) {
+    const auto view = MakeView(42);
+    EXPECT_EQ(
+        "\"0123456789abcdef-42\"",
+        HttpCaching::MakeEntityTag(*view, testRunTag, nullptr)
+    );
+    EXPECT_EQ(
+        "\"0123456789abcdef-42-gzip\"",
+        HttpCaching::MakeEntityTag(*view, testRunTag, "gzip")
+    );
+}
+
+TEST(HttpCachingTests, BodyInCodingClientPrefers) {
+    const auto viewPointer = MakeView(1);
+    const auto& view = *viewPointer;
+    struct TestVector {
+        const char* acceptEncoding;
+        const char* expectedCoding;
+    };
+    const TestVector testVectors[] = {
+        {"", nullptr},
+        {"identity", nullptr},
+        {"gzip", "gzip"},
+        {"deflate", "deflate"},
+        {"gzip, deflate", "gzip"},
+        {"gzip;q=0.5, deflate", "deflate"},
+        {"gzip;q=0, deflate;q=0", nullptr},
+        {"*", "gzip"},
+        {"*;q=0.5, deflate", "deflate"},
+    };
+    for (const auto& testVector: testVectors) {
+        Http::Response response;
+        const auto coding = HttpCaching::SetBody(
+            MakeRequest(testVector.acceptEncoding),
+            view,
+            response
+        );
+        if (testVector.expectedCoding == nullptr) {
+            EXPECT_TRUE(coding == nullptr) << testVector.acceptEncoding;
+            EXPECT_FALSE(response.headers.HasHeader("Content-Encoding")) << testVector.acceptEncoding;
+            EXPECT_EQ(view.GetDataEncoding(), response.body) << testVector.acceptEncoding;
+        } else {
+            ASSERT_FALSE(coding == nullptr) << testVector.acceptEncoding;
+            EXPECT_EQ(std::string(testVector.expectedCoding), coding) << testVector.acceptEncoding;
+            EXPECT_EQ(
+                testVector.expectedCoding,
+                response.headers.GetHeaderValue("Content-Encoding")
+            ) << testVector.acceptEncoding;
+            EXPECT_LT(response.body.size(), view.GetDataEncoding().size()) << testVector.acceptEncoding;
+        }
+    }
+}
+
+TEST(HttpCachingTests, SmallBodyNotCompressed) {
+    const Store::View view(Json::Object({{"answer", 42}}), 1);
+    Http::Response response;
+    EXPECT_TRUE(HttpCaching::SetBody(MakeRequest("gzip"), view, response) == nullptr);
+    EXPECT_FALSE(response.headers.HasHeader("Content-Encoding"));
+    EXPECT_EQ(view.GetDataEncoding(), response.body);
+}
+
+TEST(HttpCachingTests, ResponseWithoutMatchDeliversView) {
+    const auto viewPointer = MakeView(1);
+    const auto& view = *viewPointer;
+    Http::Response response;
+    EXPECT_FALSE(HttpCaching::RespondWithView(MakeRequest(""), view, testRunTag, response));
+    EXPECT_EQ(200, response.statusCode);
+    EXPECT_EQ(view.GetDataEncoding(), response.body);
+    EXPECT_EQ(
+        HttpCaching::MakeEntityTag(view, testRunTag, nullptr),
+        response.headers.GetHeaderValue("ETag")
+    );
+    EXPECT_EQ("no-cache", response.headers.GetHeaderValue("Cache-Control"));
+    EXPECT_EQ("Accept-Encoding", response.headers.GetHeaderValue("Vary"));
+}
+
+TEST(HttpCachingTests, MatchingEntityTagGivesNotModified) {
+    const auto viewPointer = MakeView(1);
+    const auto& view = *viewPointer;
+    Http::Response first;
+    (void)HttpCaching::RespondWithView(MakeRequest("gzip"), view, testRunTag, first);
+    const auto entityTag = first.headers.GetHeaderValue("ETag");
+    ASSERT_FALSE(entityTag.empty());
+    for (const auto& ifNoneMatch: {
+        entityTag,
+        "W/" + entityTag,
+        "\"something-else\", " + entityTag,
+        std::string("*"),
+    }) {
+        Http::Response response;
+        EXPECT_TRUE(
+            HttpCaching::RespondWithView(
+                MakeRequest("gzip", ifNoneMatch),
+                view,
+                testRunTag,
+                response
+            )
+        ) << ifNoneMatch;
+        EXPECT_EQ(304, response.statusCode) << ifNoneMatch;
+        EXPECT_TRUE(response.body.empty()) << ifNoneMatch;
+        EXPECT_FALSE(response.headers.HasHeader("Content-Encoding")) << ifNoneMatch;
+        EXPECT_EQ(entityTag, response.headers.GetHeaderValue("ETag")) << ifNoneMatch;
+    }
+}
+
+TEST(HttpCachingTests, EntityTagOfOtherCodingDoesNotMatch) {
+    const auto viewPointer = MakeView(1);
+    const auto& view = *viewPointer;
+    Http::Response compressed;
+    (void)HttpCaching::RespondWithView(MakeRequest("gzip"), view, testRunTag, compressed);
+    Http::Response uncompressed;
+    (void)HttpCaching::RespondWithView(MakeRequest(""), view, testRunTag, uncompressed);
+    const auto compressedEntityTag = compressed.headers.GetHeaderValue("ETag");
+    const auto uncompressedEntityTag = uncompressed.headers.GetHeaderValue("ETag");
+    EXPECT_NE(compressedEntityTag, uncompressedEntityTag);
+    Http::Response response;
+    EXPECT_FALSE(
+        HttpCaching::RespondWithView(
+            MakeRequest("", compressedEntityTag),
+            view,
+            testRunTag,
+            response
+        )
+    );
+    EXPECT_EQ(200, response.statusCode);
+    EXPECT_EQ(view.GetDataEncoding(), response.body);
+    response = Http::Response();
+    EXPECT_FALSE(
+        HttpCaching::RespondWithView(
+            MakeRequest("deflate", compressedEntityTag),
+            view,
+            testRunTag,
+            response
+        )
+    );
+    EXPECT_EQ(200, response.statusCode);
+    EXPECT_EQ("deflate", response.headers.GetHeaderValue("Content-Encoding"));
+    response = Http::Response();
+    EXPECT_FALSE(
+        HttpCaching::RespondWithView(
+            MakeRequest("gzip", uncompressedEntityTag),
+            view,
+            testRunTag,
+            response
+        )
+    );
+    EXPECT_EQ(200, response.statusCode);
+    EXPECT_EQ("gzip", response.headers.GetHeaderValue("Content-Encoding"));
+}
+
+TEST(HttpCachingTests, EntityTagOfOtherRevisionDoesNotMatch) {
+    Http::Response first;
+    (void)HttpCaching::RespondWithView(MakeRequest(""), *MakeView(1), testRunTag, first);
+    Http::Response response;
+    EXPECT_FALSE(
+        HttpCaching::RespondWithView(
+            MakeRequest("", first.headers.GetHeaderValue("ETag")),
+            *MakeView(2),
+            testRunTag,
+            response
+        )
+    );
+    EXPECT_EQ(200, response.statusCode);
+}
+
+TEST(HttpCachingTests, RunTagChangesAcrossRestarts) {
+    const auto firstRunTag = HttpCaching::MakeRunTag();
+    const auto secondRunTag = HttpCaching::MakeRunTag();
+    EXPECT_EQ(16, firstRunTag.length());
+    EXPECT_NE(firstRunTag, secondRunTag);
+
+    // Revisions start over every run, so the same revision seen by a
+    // client in an earlier run must not match.
+    const auto viewPointer = MakeView(1);
+    const auto& view = *viewPointer;
+    Http::Response first;
+    (void)HttpCaching::RespondWithView(MakeRequest(""), view, firstRunTag, first);
+    Http::Response response;
+    EXPECT_FALSE(
+        HttpCaching::RespondWithView(
+            MakeRequest("", first.headers.GetHeaderValue("ETag")),
+            view,
+            secondRunTag,
+            response
+        )
+    );
+    EXPECT_EQ(200, response.statusCode);
+    EXPECT_EQ(view.GetDataEncoding(), response.body);
+}
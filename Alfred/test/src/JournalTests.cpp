@@ -0,0 +1,244 @@
+/**
+ * @file JournalTests.cpp
+ *
+ * This module contains the unit tests of the Journal class.
+ */
+
+#include <gtest/gtest.h>
+#include <Journal.hpp>
+#include <stdio.h>
+#include <string>
+#include <SystemAbstractions/File.hpp>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    /**
+     * Read the whole of the file with the given path.
+     *
+     * @param[in] filePath
+     *     This is the path of the file to read.
+     *
+     * @return
+     *     The contents of the file are returned, or an empty string
+     *     if the file doesn't exist.
+     */
+    std::string ReadFile(const std::string& filePath) {
+        std::string contents;
+        const auto file = fopen(filePath.c_str(), "rb");
+        if (file == NULL) {
+            return contents;
+        }
+        char buffer[4096];
+        for (;;) {
+            const auto amountRead = fread(buffer, 1, sizeof(buffer), file);
+            (void)contents.append(buffer, amountRead);
+            if (amountRead < sizeof(buffer)) {
+                break;
+            }
+        }
+        (void)fclose(file);
+        return contents;
+    }
+
+    /**
+     * Replace the contents of the file with the given path.
+     *
+     * @param[in] filePath
+     *     This is the path of the file to write.
+     *
+     * @param[in] contents
+     *     This is what to put in the file.
+     */
+    void WriteFile(
+        const std::string& filePath,
+        const std::string& contents
+    ) {
+        const auto file = fopen(filePath.c_str(), "wb");
+        ASSERT_FALSE(file == NULL);
+        (void)fwrite(contents.data(), 1, contents.length(), file);
+        (void)fclose(file);
+    }
+
+}
+
+/**
+ * This is the test fixture for these tests, providing common
+ * setup and teardown for each test.
+ */
+struct JournalTests
+    : public ::testing::Test
+{
+    // Properties
+
+    std::string snapshotFilePath = SystemAbstractions::File::GetExeParentDirectory() + "/JournalTests.json";
+    std::string journalFilePath = snapshotFilePath + ".journal";
+    std::string rotatedFilePath = journalFilePath + ".old";
+    Journal journal;
+    std::vector< std::string > records;
+
+    // Methods
+
+    void RemoveFiles() {
+        (void)remove(journalFilePath.c_str());
+        (void)remove(rotatedFilePath.c_str());
+    }
+
+    // ::testing::Test
+
+    virtual void SetUp() override {
+        RemoveFiles();
+    }
+
+    virtual void TearDown() override {
+        journal.Close();
+        RemoveFiles();
+    }
+};
+
+TEST_F(JournalTests, OpenNewJournal) {
+    records.push_back("left over");
+    EXPECT_TRUE(journal.Open(snapshotFilePath, records));
+    EXPECT_TRUE(records.empty());
+}
+
+TEST_F(JournalTests, RecordsWrittenOnlyWhenCommitted) {
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    const auto first = journal.Append("first");
+    const auto second = journal.Append("second");
+    EXPECT_LT(first, second);
+    EXPECT_EQ("", ReadFile(journalFilePath));
+    EXPECT_TRUE(journal.Commit(first));
+    EXPECT_EQ("first\nsecond\n", ReadFile(journalFilePath));
+    EXPECT_TRUE(journal.Commit(second));
+    EXPECT_EQ("first\nsecond\n", ReadFile(journalFilePath));
+}
+
+TEST_F(JournalTests, ReopenReplaysRecords) {
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    (void)journal.Append("first");
+    EXPECT_TRUE(journal.Commit(journal.Append("second")));
+    journal.Close();
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    EXPECT_EQ(std::vector< std::string >({"first", "second"}), records);
+}
+
+TEST_F(JournalTests, ConcurrentCommitsStoreEveryRecord) {
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    constexpr size_t numThreads = 8;
+    constexpr size_t numRecordsPerThread = 50;
+    std::vector< std::thread > threads;
+    for (size_t i = 0; i < numThreads; ++i) {
+        threads.emplace_back(
+            [this, i]{
+                for (size_t j = 0; j < numRecordsPerThread; ++j) {
+                    const auto ticket = journal.Append(
+                        std::to_string(i) + ":" + std::to_string(j)
+                    );
+                    EXPECT_TRUE(journal.Commit(ticket));
+                }
+            }
+        );
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    journal.Close();
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    EXPECT_EQ(numThreads * numRecordsPerThread, records.size());
+}
+
+TEST_F(JournalTests, CloseWritesQueuedRecords) {
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    (void)journal.Append("first");
+    journal.Close();
+    EXPECT_EQ("first\n", ReadFile(journalFilePath));
+}
+
+TEST_F(JournalTests, TornRecordTerminatedWhenOpened) {
+    WriteFile(journalFilePath, "first\nsec");
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    EXPECT_EQ(std::vector< std::string >({"first", "sec"}), records);
+    EXPECT_TRUE(journal.Commit(journal.Append("third")));
+    EXPECT_EQ("first\nsec\nthird\n", ReadFile(journalFilePath));
+}
+
+TEST_F(JournalTests, RotateSeparatesRecordsQueuedBeforeAndAfter) {
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    EXPECT_TRUE(journal.Commit(journal.Append("first")));
+    (void)journal.Append("second");
+    const auto rotation = journal.Rotate();
+    const auto third = journal.Append("third");
+    EXPECT_EQ("first\n", ReadFile(journalFilePath));
+    EXPECT_TRUE(journal.Commit(third));
+    EXPECT_EQ("first\nsecond\n", ReadFile(rotatedFilePath));
+    EXPECT_EQ("third\n", ReadFile(journalFilePath));
+    journal.Close();
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    EXPECT_EQ(std::vector< std::string >({"first", "second", "third"}), records);
+    (void)rotation;
+}
+
+TEST_F(JournalTests, DiscardRotated) {
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    (void)journal.Append("first");
+    const auto rotation = journal.Rotate();
+    (void)journal.Append("second");
+    journal.DiscardRotated(rotation);
+    EXPECT_EQ("", ReadFile(rotatedFilePath));
+    EXPECT_EQ("second\n", ReadFile(journalFilePath));
+    journal.Close();
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    EXPECT_EQ(std::vector< std::string >({"second"}), records);
+}
+
+TEST_F(JournalTests, RotatedJournalKeptIfRotatedAgain) {
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    (void)journal.Append("first");
+    const auto firstRotation = journal.Rotate();
+    (void)journal.Append("second");
+    (void)journal.Rotate();
+    (void)journal.Append("third");
+
+    // The snapshot taken at the first rotation doesn't include the second
+    // record, so the rotated journal holding it has to stay.
+    journal.DiscardRotated(firstRotation);
+    journal.Close();
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    EXPECT_EQ(std::vector< std::string >({"first", "second", "third"}), records);
+}
+
+TEST_F(JournalTests, CommitFailsIfRecordNotStored) {
+    std::vector< std::string > errors;
+    const auto unsubscribe = journal.SubscribeToDiagnostics(
+        [&errors](
+            std::string senderName,
+            size_t level,
+            std::string message
+        ){
+            errors.push_back(message);
+        },
+        SystemAbstractions::DiagnosticsSender::Levels::ERROR
+    );
+    EXPECT_FALSE(journal.Commit(journal.Append("first")));
+    EXPECT_FALSE(errors.empty());
+    unsubscribe();
+}
+
+TEST_F(JournalTests, NoRecordsWrittenAfterFailureUntilRotated) {
+    // Closing the journal makes it unwritable until it's rotated,
+    // which opens a fresh journal file.
+    ASSERT_TRUE(journal.Open(snapshotFilePath, records));
+    journal.Close();
+    const auto first = journal.Append("first");
+    EXPECT_FALSE(journal.Commit(first));
+    const auto second = journal.Append("second");
+    (void)journal.Rotate();
+    const auto third = journal.Append("third");
+    EXPECT_TRUE(journal.Commit(third));
+    EXPECT_FALSE(journal.Commit(first));
+    EXPECT_FALSE(journal.Commit(second));
+    EXPECT_EQ("", ReadFile(rotatedFilePath));
+    EXPECT_EQ("third\n", ReadFile(journalFilePath));
+}
@@ -0,0 +1,146 @@
+/**
+ * @file JsonPatchTests.cpp
+ *
+ * This module contains the unit tests of the JsonPatch functions.
+ */
+
+#include <gtest/gtest.h>
+#include <Json/Value.hpp>
+#include <JsonPatch.hpp>
+
+TEST(JsonPatchTests, MakePointer) {
+    EXPECT_EQ("", JsonPatch::MakePointer({}));
+    EXPECT_EQ("/foo/0", JsonPatch::MakePointer({"foo", "0"}));
+    EXPECT_EQ("/a~1b/m~0n/", JsonPatch::MakePointer({"a/b", "m~n", ""}));
+}
+
+TEST(JsonPatchTests, MakeOperation) {
+    EXPECT_EQ(
+        Json::Object({
+            {"op", "replace"},
+            {"path", "/foo/bar"},
+            {"value", 42},
+        }),
+        JsonPatch::MakeOperation("replace", {"foo", "bar"}, 42)
+    );
+    EXPECT_EQ(
+        Json::Object({
+            {"op", "add"},
+            {"path", "/foo"},
+            {"value", nullptr},
+        }),
+        JsonPatch::MakeOperation("add", {"foo"}, nullptr)
+    );
+    EXPECT_EQ(
+        Json::Object({
+            {"op", "remove"},
+            {"path", "/foo"},
+        }),
+        JsonPatch::MakeOperation("remove", {"foo"})
+    );
+}
+
+TEST(JsonPatchTests, MakeNestedMergePatch) {
+    EXPECT_EQ(
+        Json::Object({
+            {"a", Json::Object({
+                {"b", Json::Object({{"c", 1}})},
+            })},
+        }),
+        JsonPatch::MakeNestedMergePatch({"a", "b"}, Json::Object({{"c", 1}}))
+    );
+    EXPECT_EQ(
+        Json::Value(42),
+        JsonPatch::MakeNestedMergePatch({}, 42)
+    );
+}
+
+TEST(JsonPatchTests, MakeMergePatchBetweenObjects) {
+    Json::Value patch;
+    ASSERT_TRUE(
+        JsonPatch::MakeMergePatch(
+            Json::Object({
+                {"same", 1},
+                {"changed", 2},
+                {"removed", 3},
+                {"nested", Json::Object({
+                    {"same", 4},
+                    {"changed", 5},
+                })},
+            }),
+            Json::Object({
+                {"same", 1},
+                {"changed", 20},
+                {"added", 6},
+                {"nested", Json::Object({
+                    {"same", 4},
+                    {"changed", 50},
+                })},
+            }),
+            patch
+        )
+    );
+    EXPECT_EQ(
+        Json::Object({
+            {"changed", 20},
+            {"removed", nullptr},
+            {"added", 6},
+            {"nested", Json::Object({
+                {"changed", 50},
+            })},
+        }),
+        patch
+    );
+}
+
+TEST(JsonPatchTests, MakeMergePatchNoChange) {
+    Json::Value patch;
+    const auto value = Json::Object({{"a", Json::Array({1, 2})}});
+    ASSERT_TRUE(JsonPatch::MakeMergePatch(value, value, patch));
+    EXPECT_EQ(Json::Object({}), patch);
+}
+
+TEST(JsonPatchTests, MakeMergePatchReplacesNonObjects) {
+    Json::Value patch;
+    ASSERT_TRUE(
+        JsonPatch::MakeMergePatch(
+            Json::Array({1, 2}),
+            Json::Array({1, 2, 3}),
+            patch
+        )
+    );
+    EXPECT_EQ(Json::Array({1, 2, 3}), patch);
+    ASSERT_TRUE(
+        JsonPatch::MakeMergePatch(
+            Json::Object({{"a", 1}}),
+            "hello",
+            patch
+        )
+    );
+    EXPECT_EQ(Json::Value("hello"), patch);
+}
+
+TEST(JsonPatchTests, MakeMergePatchFailsWhenNewValueHoldsNull) {
+    Json::Value patch;
+    EXPECT_FALSE(
+        JsonPatch::MakeMergePatch(
+            Json::Object({{"a", 1}}),
+            Json::Object({{"a", nullptr}}),
+            patch
+        )
+    );
+    EXPECT_FALSE(
+        JsonPatch::MakeMergePatch(
+            Json::Object({}),
+            Json::Object({{"a", Json::Array({nullptr})}}),
+            patch
+        )
+    );
+    EXPECT_FALSE(
+        JsonPatch::MakeMergePatch(
+            1,
+            Json::Object({{"a", Json::Object({{"b", nullptr}})}}),
+            patch
+        )
+    );
+}
@@ -0,0 +1,107 @@
+/**
+ * @file MetricsTests.cpp
+ *
+ * This module contains the unit tests of the Metrics class.
+ */
+
+#include <gtest/gtest.h>
+#include <Metrics.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+TEST(MetricsTests, CounterAndGauge) {
+    Metrics metrics;
+    const auto counter = metrics.GetCounter("things_total", "Things counted");
+    counter->Add();
+    counter->Add(41);
+    EXPECT_EQ(42, counter->GetValue());
+    const auto gauge = metrics.GetGauge("level", "Current level");
+    gauge->Set(10);
+    gauge->Add(-15);
+    EXPECT_EQ(-5, gauge->GetValue());
+}
+
+TEST(MetricsTests, SameNameAndLabelsGiveSameMetric) {
+    Metrics metrics;
+    const auto first = metrics.GetCounter("things_total", "Things counted", "type=\"a\"");
+    const auto second = metrics.GetCounter("things_total", "Things counted", "type=\"a\"");
+    const auto other = metrics.GetCounter("things_total", "Things counted", "type=\"b\"");
+    EXPECT_EQ(first, second);
+    EXPECT_NE(first, other);
+}
+
+TEST(MetricsTests, HistogramBucketsIncludeUpperBounds) {
+    Metrics::Histogram histogram({1.0, 2.0, 4.0});
+    for (const auto value: {0.5, 1.0, 1.5, 4.0, 100.0}) {
+        histogram.Observe(value);
+    }
+    EXPECT_EQ(std::vector< uint64_t >({2, 1, 1, 1}), histogram.GetCounts());
+    EXPECT_EQ(107.0, histogram.GetSum());
+}
+
+TEST(MetricsTests, MakeBounds) {
+    EXPECT_EQ(
+        std::vector< double >({1.0, 3.0, 9.0, 27.0}),
+        Metrics::MakeExponentialBounds(1.0, 3.0, 4)
+    );
+    const auto durationBounds = Metrics::MakeDurationBounds();
+    ASSERT_FALSE(durationBounds.empty());
+    EXPECT_EQ(0.000001, durationBounds.front());
+    EXPECT_GT(durationBounds.back(), 60.0);
+    const auto sizeBounds = Metrics::MakeSizeBounds();
+    ASSERT_FALSE(sizeBounds.empty());
+    EXPECT_EQ(64.0, sizeBounds.front());
+    EXPECT_EQ(268435456.0, sizeBounds.back());
+}
+
+TEST(MetricsTests, Render) {
+    Metrics metrics;
+    metrics.GetCounter("requests_total", "Requests received", "method=\"GET\"")->Add(3);
+    metrics.GetCounter("requests_total", "Requests received", "method=\"PUT\"")->Add();
+    metrics.GetGauge("connections", "Connections open")->Set(7);
+    const auto histogram = metrics.GetHistogram(
+        "latency_seconds",
+        "Time taken",
+        {0.5, 1.0},
+        "path=\"/\""
+    );
+    histogram->Observe(0.25);
+    histogram->Observe(0.75);
+    histogram->Observe(2.0);
+    EXPECT_EQ(
+        (
+            "# HELP connections Connections open\n"
+            "# TYPE connections gauge\n"
+            "connections 7\n"
+            "# HELP latency_seconds Time taken\n"
+            "# TYPE latency_seconds histogram\n"
+            "latency_seconds_bucket{path=\"/\",le=\"0.5\"} 1\n"
+            "latency_seconds_bucket{path=\"/\",le=\"1\"} 2\n"
+            "latency_seconds_bucket{path=\"/\",le=\"+Inf\"} 3\n"
+            "latency_seconds_sum{path=\"/\"} 3\n"
+            "latency_seconds_count{path=\"/\"} 3\n"
+            "# HELP requests_total Requests received\n"
+            "# TYPE requests_total counter\n"
+            "requests_total{method=\"GET\"} 3\n"
+            "requests_total{method=\"PUT\"} 1\n"
+        ),
+        metrics.Render()
+    );
+}
+
+TEST(MetricsTests, RenderHistogramWithoutLabels) {
+    Metrics metrics;
+    metrics.GetHistogram("size_bytes", "Sizes", {64.0})->Observe(100.0);
+    EXPECT_EQ(
+        (
+            "# HELP size_bytes Sizes\n"
+            "# TYPE size_bytes histogram\n"
+            "size_bytes_bucket{le=\"64\"} 0\n"
+            "size_bytes_bucket{le=\"+Inf\"} 1\n"
+            "size_bytes_sum 100\n"
+            "size_bytes_count 1\n"
+        ),
+        metrics.Render()
+    );
+}
@@ -0,0 +1,262 @@
+/**
+ * @file PermissionsTests.cpp
+ *
+ * This module contains the unit tests of the functions which compile
+ * and evaluate permissions metadata.
+ */
+
+#include <gtest/gtest.h>
+#include <Json/Value.hpp>
+#include <Permissions.hpp>
+
+namespace {
+
+    /**
+     * Look up the identifier of the given role, which the test expects
+     * the role table to already have.
+     *
+     * @param[in,out] roleTable
+     *     This is the table in which to look up the role.
+     *
+     * @param[in] role
+     *     This is the name of the role to look up.
+     *
+     * @return
+     *     The identifier of the role is returned.
+     */
+    size_t RoleId(Permissions::RoleTable& roleTable, const std::string& role) {
+        const auto size = roleTable.GetSize();
+        size_t id = 0;
+        EXPECT_TRUE(roleTable.Intern(role, id));
+        EXPECT_EQ(size, roleTable.GetSize()) << "role '" << role << "' was not interned";
+        return id;
+    }
+
+}
+
+TEST(PermissionsTests, RoleTableAssignsStableIdentifiers) {
+    Permissions::RoleTable roleTable;
+    size_t admin, user, adminAgain;
+    EXPECT_TRUE(roleTable.Intern("admin", admin));
+    EXPECT_TRUE(roleTable.Intern("user", user));
+    EXPECT_TRUE(roleTable.Intern("admin", adminAgain));
+    EXPECT_NE(admin, user);
+    EXPECT_EQ(admin, adminAgain);
+    EXPECT_EQ(2, roleTable.GetSize());
+    const auto bits = roleTable.Lookup({"user", "stranger"});
+    EXPECT_EQ(1, bits.count());
+    EXPECT_TRUE(bits.test(user));
+}
+
+TEST(PermissionsTests, RoleTableOverflows) {
+    Permissions::RoleTable roleTable;
+    size_t id;
+    for (size_t i = 0; i < Permissions::maxRoles; ++i) {
+        ASSERT_TRUE(roleTable.Intern("role" + std::to_string(i), id));
+    }
+    EXPECT_FALSE(roleTable.Overflowed());
+    EXPECT_FALSE(roleTable.Intern("one-too-many", id));
+    EXPECT_TRUE(roleTable.Overflowed());
+    EXPECT_TRUE(roleTable.Intern("role0", id));
+    EXPECT_EQ(0, id);
+}
+
+TEST(PermissionsTests, CompilePlainDataHasNoIndex) {
+    Permissions::RoleTable roleTable;
+    Permissions::Problems problems;
+    const auto index = Permissions::Compile(
+        Json::Object({
+            {"foo", Json::Array({1, 2, "three"})},
+            {"bar", Json::Object({{"baz", true}})},
+        }),
+        roleTable,
+        problems
+    );
+    EXPECT_TRUE(index == nullptr);
+    EXPECT_TRUE(problems.empty());
+    EXPECT_EQ(0, roleTable.GetSize());
+}
+
+TEST(PermissionsTests, CompileRequireAndAllow) {
+    Permissions::RoleTable roleTable;
+    Permissions::Problems problems;
+    const auto index = Permissions::Compile(
+        Json::Object({
+            {"secret", Json::Object({
+                {"data", 42},
+                {"meta", Json::Object({
+                    {"require", Json::Object({
+                        {"read_data", Json::Array({"admin"})},
+                    })},
+                    {"allow", Json::Object({
+                        {"write_data", Json::Array({"editor"})},
+                        {"write_meta", Json::Array({"owner"})},
+                    })},
+                })},
+            })},
+        }),
+        roleTable,
+        problems
+    );
+    EXPECT_TRUE(problems.empty());
+    ASSERT_FALSE(index == nullptr);
+    EXPECT_FALSE(index->wrapper);
+    const auto secret = index->GetChild("secret");
+    ASSERT_FALSE(secret == nullptr);
+    EXPECT_TRUE(secret->wrapper);
+    EXPECT_TRUE(secret->data == nullptr);
+    const auto admin = RoleId(roleTable, "admin");
+    const auto editor = RoleId(roleTable, "editor");
+    const auto owner = RoleId(roleTable, "owner");
+    Permissions::RolesPermitted rolesPermitted;
+    rolesPermitted.readData.set();
+    rolesPermitted.writeData.set(owner);
+    secret->meta.Apply(rolesPermitted);
+    Permissions::RoleBits expectedReadData;
+    expectedReadData.set(admin);
+    expectedReadData.set(editor);
+    EXPECT_EQ(expectedReadData, rolesPermitted.readData);
+    Permissions::RoleBits expectedWriteData;
+    expectedWriteData.set(owner);
+    expectedWriteData.set(editor);
+    EXPECT_EQ(expectedWriteData, rolesPermitted.writeData);
+    EXPECT_TRUE(rolesPermitted.writeMeta.test(owner));
+    EXPECT_TRUE(rolesPermitted.readMeta.test(owner));
+    EXPECT_EQ(1, rolesPermitted.readMeta.count());
+    EXPECT_TRUE(rolesPermitted.createData.none());
+    EXPECT_TRUE(rolesPermitted.deleteData.none());
+}
+
+TEST(PermissionsTests, CompileReportsProblemsWhereFound) {
+    Permissions::RoleTable roleTable;
+    Permissions::Problems problems;
+    const auto index = Permissions::Compile(
+        Json::Object({
+            {"list", Json::Array({
+                1,
+                Json::Object({
+                    {"data", nullptr},
+                    {"meta", Json::Object({
+                        {"allow", Json::Object({
+                            {"fly", Json::Array({"bird"})},
+                            {"read_data", "nobody"},
+                            {"write_data", Json::Array({7, "editor"})},
+                        })},
+                    })},
+                }),
+            })},
+        }),
+        roleTable,
+        problems
+    );
+    ASSERT_FALSE(index == nullptr);
+    const auto list = index->GetChild("list");
+    ASSERT_FALSE(list == nullptr);
+    EXPECT_TRUE(list->GetElement(0) == nullptr);
+    ASSERT_FALSE(list->GetElement(1) == nullptr);
+    EXPECT_TRUE(list->GetElement(1)->wrapper);
+    EXPECT_EQ(
+        Permissions::Problems({
+            "list/1/meta.allow names unknown permission 'fly'",
+            "list/1/meta.allow.read_data is not an array of roles",
+            "list/1/meta.allow.write_data names a role which is not a string",
+        }),
+        problems
+    );
+    EXPECT_EQ(1, roleTable.GetSize());
+}
+
+TEST(PermissionsTests, CopyIsIndependentOfOriginal) {
+    Permissions::RoleTable roleTable;
+    Permissions::Problems problems;
+    auto index = Permissions::Compile(
+        Json::Object({
+            {"a", Json::Object({
+                {"data", Json::Array({
+                    Json::Object({{"data", 1}, {"meta", Json::Object()}}),
+                })},
+                {"meta", Json::Object()},
+            })},
+        }),
+        roleTable,
+        problems
+    );
+    ASSERT_FALSE(index == nullptr);
+    const auto copy = Permissions::Copy(index.get());
+    index.reset();
+    ASSERT_FALSE(copy == nullptr);
+    const auto a = copy->GetChild("a");
+    ASSERT_FALSE(a == nullptr);
+    EXPECT_TRUE(a->wrapper);
+    ASSERT_FALSE(a->data == nullptr);
+    ASSERT_FALSE(a->data->GetElement(0) == nullptr);
+    EXPECT_TRUE(a->data->GetElement(0)->wrapper);
+    EXPECT_TRUE(Permissions::Copy(nullptr) == nullptr);
+}
+
+TEST(PermissionsTests, RecompileAddsAndRemovesNodes) {
+    Permissions::RoleTable roleTable;
+    Permissions::Problems problems;
+    auto root = Json::Object({
+        {"a", Json::Object({{"b", 1}})},
+        {"c", 2},
+    });
+    auto index = Permissions::Compile(root, roleTable, problems);
+    EXPECT_TRUE(index == nullptr);
+
+    // Wrap a value inside a plain object.
+    root["a"]["b"] = Json::Object({
+        {"data", 1},
+        {"meta", Json::Object({
+            {"require", Json::Object({{"read_data", Json::Array({"admin"})}})},
+        })},
+    });
+    Permissions::Recompile(index, root, {"a", "b"}, roleTable, problems);
+    EXPECT_TRUE(problems.empty());
+    ASSERT_FALSE(index == nullptr);
+    ASSERT_FALSE(index->GetChild("a") == nullptr);
+    ASSERT_FALSE(index->GetChild("a")->GetChild("b") == nullptr);
+    EXPECT_TRUE(index->GetChild("a")->GetChild("b")->wrapper);
+    EXPECT_TRUE(index->GetChild("c") == nullptr);
+
+    // Changing data elsewhere leaves the index alone.
+    root["c"] = 3;
+    Permissions::Recompile(index, root, {"c"}, roleTable, problems);
+    ASSERT_FALSE(index == nullptr);
+    EXPECT_FALSE(index->GetChild("a")->GetChild("b") == nullptr);
+
+    // Removing the wrapper removes the whole index.
+    root["a"].Remove("b");
+    Permissions::Recompile(index, root, {"a", "b"}, roleTable, problems);
+    EXPECT_TRUE(index == nullptr);
+}
+
+TEST(PermissionsTests, RecompileInsideWrapperAndArray) {
+    Permissions::RoleTable roleTable;
+    Permissions::Problems problems;
+    auto root = Json::Object({
+        {"list", Json::Object({
+            {"data", Json::Array({1, 2})},
+            {"meta", Json::Object()},
+        })},
+    });
+    auto index = Permissions::Compile(root, roleTable, problems);
+    ASSERT_FALSE(index == nullptr);
+    const auto list = index->GetChild("list");
+    ASSERT_FALSE(list == nullptr);
+    EXPECT_TRUE(list->data == nullptr);
+
+    // Paths skip over the "data" of wrappers.
+    root["list"]["data"][1] = Json::Object({{"data", 2}, {"meta", Json::Object()}});
+    Permissions::Recompile(index, root, {"list", "1"}, roleTable, problems);
+    ASSERT_FALSE(list->data == nullptr);
+    EXPECT_TRUE(list->data->GetElement(0) == nullptr);
+    ASSERT_FALSE(list->data->GetElement(1) == nullptr);
+    EXPECT_TRUE(list->data->GetElement(1)->wrapper);
+
+    // Shrinking the array drops the index of elements no longer there.
+    root["list"]["data"].Remove(1);
+    Permissions::Recompile(index, root, {"list", "1"}, roleTable, problems);
+    EXPECT_TRUE(list->data == nullptr);
+    EXPECT_TRUE(index->GetChild("list") == list);
+}
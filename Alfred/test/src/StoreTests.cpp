@@ -0,0 +1,676 @@
+/**
+ * @file StoreTests.cpp
+ *
+ * This module contains the unit tests of the Store class.
+ */
+
+#include <AccessKeys.hpp>
+#include <algorithm>
+#include <functional>
+#include <gtest/gtest.h>
+#include <Json/Value.hpp>
+#include <memory>
+#include <Metrics.hpp>
+#include <Permissions.hpp>
+#include <stdio.h>
+#include <Store.hpp>
+#include <string>
+#include <SystemAbstractions/File.hpp>
+#include <Timekeeping/Clock.hpp>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is a fake time-keeping object which is used to test the Store.
+     */
+    struct MockClock
+        : public Timekeeping::Clock
+    {
+        // Properties
+
+        double currentTime = 0.0;
+
+        // Timekeeping::Clock
+
+        virtual double GetCurrentTime() override {
+            return currentTime;
+        }
+    };
+
+    /**
+     * Make a mutation which sets the value at the given path.
+     *
+     * @param[in] path
+     *     This is the sequence of keys identifying where to set the value.
+     *
+     * @param[in] value
+     *     This is the value to set.
+     *
+     * @return
+     *     The mutation is returned.
+     */
+    Store::Mutation MakeSet(
+        const std::vector< std::string >& path,
+        const Json::Value& value
+    ) {
+        Store::Mutation mutation;
+        mutation.type = Store::Mutation::Type::Set;
+        mutation.path = path;
+        mutation.value = value;
+        return mutation;
+    }
+
+    /**
+     * Make a mutation which appends a value to the array at the given path.
+     *
+     * @param[in] path
+     *     This is the sequence of keys identifying the array.
+     *
+     * @param[in] value
+     *     This is the value to append.
+     *
+     * @return
+     *     The mutation is returned.
+     */
+    Store::Mutation MakeAdd(
+        const std::vector< std::string >& path,
+        const Json::Value& value
+    ) {
+        Store::Mutation mutation;
+        mutation.type = Store::Mutation::Type::Add;
+        mutation.path = path;
+        mutation.value = value;
+        return mutation;
+    }
+
+    /**
+     * Make a mutation which removes the value at the given path.
+     *
+     * @param[in] path
+     *     This is the sequence of keys identifying the value to remove.
+     *
+     * @return
+     *     The mutation is returned.
+     */
+    Store::Mutation MakeRemove(const std::vector< std::string >& path) {
+        Store::Mutation mutation;
+        mutation.type = Store::Mutation::Type::Remove;
+        mutation.path = path;
+        return mutation;
+    }
+
+}
+
+/**
+ * This is the test fixture for these tests, providing common
+ * setup and teardown for each test.
+ */
+struct StoreTests
+    : public ::testing::Test
+{
+    // Properties
+
+    std::string filePath = SystemAbstractions::File::GetExeParentDirectory() + "/StoreTests.json";
+    std::string settingsFilePath = SystemAbstractions::File::GetExeParentDirectory() + "/StoreTestsSettings.json";
+    std::shared_ptr< MockClock > clock = std::make_shared< MockClock >();
+    std::shared_ptr< Metrics > metrics = std::make_shared< Metrics >();
+    Store store;
+    std::vector< std::string > errors;
+    SystemAbstractions::DiagnosticsSender::UnsubscribeDelegate diagnosticsUnsubscribeDelegate;
+
+    // Methods
+
+    /**
+     * Write the given JSON value to the file at the given path.
+     *
+     * @param[in] path
+     *     This is the path of the file to write.
+     *
+     * @param[in] contents
+     *     This is what to put in the file.
+     */
+    void WriteFile(
+        const std::string& path,
+        const Json::Value& contents
+    ) {
+        const auto encoding = contents.ToEncoding();
+        const auto file = fopen(path.c_str(), "wb");
+        ASSERT_FALSE(file == NULL);
+        (void)fwrite(encoding.data(), 1, encoding.length(), file);
+        (void)fclose(file);
+    }
+
+    /**
+     * Write the given store file, and mobilize the store with it.
+     *
+     * @param[in] contents
+     *     This is what to put in the store file.
+     */
+    void MobilizeWith(const Json::Value& contents) {
+        WriteFile(filePath, contents);
+        ASSERT_TRUE(store.Mobilize(filePath, clock, metrics));
+    }
+
+    /**
+     * Subscribe to the data at the given path, recording every update
+     * delivered.
+     *
+     * @param[in] path
+     *     This is the path of the data to subscribe to.
+     *
+     * @param[out] updates
+     *     This is where to record the updates delivered.
+     *
+     * @return
+     *     A function is returned which may be called
+     *     to terminate the subscription.
+     */
+    std::function< void() > Subscribe(
+        const std::vector< std::string >& path,
+        std::vector< Store::Update >& updates
+    ) {
+        return store.SubscribeToData(
+            path,
+            {},
+            [&updates](const Store::Update& update){
+                updates.push_back(update);
+            }
+        );
+    }
+
+    void RemoveFiles() {
+        (void)remove(filePath.c_str());
+        (void)remove(settingsFilePath.c_str());
+        (void)remove((filePath + ".journal").c_str());
+        (void)remove((filePath + ".journal.old").c_str());
+    }
+
+    // ::testing::Test
+
+    virtual void SetUp() override {
+        RemoveFiles();
+        diagnosticsUnsubscribeDelegate = store.SubscribeToDiagnostics(
+            [this](
+                std::string senderName,
+                size_t level,
+                std::string message
+            ){
+                errors.push_back(message);
+            },
+            SystemAbstractions::DiagnosticsSender::Levels::ERROR
+        );
+    }
+
+    virtual void TearDown() override {
+        store.Demobilize();
+        diagnosticsUnsubscribeDelegate();
+        RemoveFiles();
+        EXPECT_TRUE(errors.empty());
+    }
+};
+
+TEST_F(StoreTests, ChangeWakesSubscribersAboveAndBelowButNotBeside) {
+    MobilizeWith(
+        Json::Object({
+            {"a", Json::Object({
+                {"b", Json::Object({
+                    {"c", Json::Object({
+                        {"d", 1},
+                    })},
+                })},
+                {"x", 2},
+            })},
+        })
+    );
+    std::vector< Store::Update > rootUpdates, aUpdates, cUpdates, dUpdates, xUpdates;
+    const std::vector< std::function< void() > > unsubscribeDelegates{
+        Subscribe({}, rootUpdates),
+        Subscribe({"a"}, aUpdates),
+        Subscribe({"a", "b", "c"}, cUpdates),
+        Subscribe({"a", "b", "c", "d"}, dUpdates),
+        Subscribe({"a", "x"}, xUpdates),
+    };
+    ASSERT_TRUE(store.ApplyMutations({MakeSet({"a", "b", "c"}, Json::Object({{"d", 5}}))}));
+    for (const auto& unsubscribe: unsubscribeDelegates) {
+        unsubscribe();
+    }
+    EXPECT_EQ(2, rootUpdates.size());
+    ASSERT_EQ(2, aUpdates.size());
+    EXPECT_EQ(
+        Json::Object({
+            {"b", Json::Object({
+                {"c", Json::Object({
+                    {"d", 5},
+                })},
+            })},
+            {"x", 2},
+        }),
+        aUpdates[1].view->GetData()
+    );
+    ASSERT_EQ(2, cUpdates.size());
+    EXPECT_EQ(Json::Object({{"d", 5}}), cUpdates[1].view->GetData());
+    ASSERT_EQ(2, dUpdates.size());
+    EXPECT_EQ(Json::Value(1), dUpdates[0].view->GetData());
+    EXPECT_EQ(Json::Value(5), dUpdates[1].view->GetData());
+    EXPECT_EQ(1, xUpdates.size());
+}
+
+TEST_F(StoreTests, BatchWakesSubscribersOfEveryBranchTouchedOnce) {
+    MobilizeWith(
+        Json::Object({
+            {"a", Json::Object({
+                {"b", 1},
+                {"x", 2},
+            })},
+            {"y", 3},
+            {"z", 4},
+        })
+    );
+    std::vector< Store::Update > rootUpdates, aUpdates, bUpdates, xUpdates, yUpdates, zUpdates;
+    const std::vector< std::function< void() > > unsubscribeDelegates{
+        Subscribe({}, rootUpdates),
+        Subscribe({"a"}, aUpdates),
+        Subscribe({"a", "b"}, bUpdates),
+        Subscribe({"a", "x"}, xUpdates),
+        Subscribe({"y"}, yUpdates),
+        Subscribe({"z"}, zUpdates),
+    };
+    ASSERT_TRUE(
+        store.ApplyMutations({
+            MakeSet({"a", "b"}, 10),
+            MakeSet({"y"}, 30),
+            MakeSet({"a", "b"}, 11),
+        })
+    );
+    for (const auto& unsubscribe: unsubscribeDelegates) {
+        unsubscribe();
+    }
+    ASSERT_EQ(2, rootUpdates.size());
+    EXPECT_EQ(
+        Json::Object({
+            {"a", Json::Object({
+                {"b", 11},
+                {"x", 2},
+            })},
+            {"y", 30},
+            {"z", 4},
+        }),
+        rootUpdates[1].view->GetData()
+    );
+    EXPECT_EQ(2, aUpdates.size());
+    ASSERT_EQ(2, bUpdates.size());
+    EXPECT_EQ(Json::Value(11), bUpdates[1].view->GetData());
+    EXPECT_EQ(1, xUpdates.size());
+    ASSERT_EQ(2, yUpdates.size());
+    EXPECT_EQ(Json::Value(30), yUpdates[1].view->GetData());
+    EXPECT_EQ(1, zUpdates.size());
+}
+
+TEST_F(StoreTests, SnapshotsKeepUpWithChanges) {
+    MobilizeWith(
+        Json::Object({
+            {"count", 0},
+            {"list", Json::Array({0})},
+        })
+    );
+    for (int i = 1; i <= 100; ++i) {
+        ASSERT_TRUE(
+            store.ApplyMutations({
+                MakeSet({"count"}, i),
+                MakeAdd({"list"}, i),
+            })
+        );
+        if ((i % 10) == 0) {
+            ASSERT_TRUE(store.ApplyMutations({MakeSet({"list"}, Json::Array({i}))}));
+        }
+
+        // Every read lets go of its snapshot, so that the one before it
+        // is reused for the next.
+        const auto data = store.GetData({}, {});
+        ASSERT_EQ(Json::Value(i), data["count"]) << i;
+        ASSERT_EQ((size_t)((i % 10) + 1), data["list"].GetSize()) << i;
+        EXPECT_EQ(Json::Value(i), data["list"][data["list"].GetSize() - 1]) << i;
+    }
+}
+
+TEST_F(StoreTests, SnapshotHeldByReaderNotChanged) {
+    MobilizeWith(Json::Object({{"count", 0}}));
+    const auto oldView = store.GetView({"count"}, {});
+    for (int i = 1; i <= 3; ++i) {
+        ASSERT_TRUE(store.ApplyMutations({MakeSet({"count"}, i)}));
+        EXPECT_EQ(Json::Value(i), store.GetData({"count"}, {}));
+    }
+    EXPECT_EQ(Json::Value(0), oldView->GetData());
+    const auto newView = store.GetView({"count"}, {});
+    EXPECT_EQ(Json::Value(3), newView->GetData());
+    EXPECT_GT(newView->GetRevision(), oldView->GetRevision());
+}
+
+TEST_F(StoreTests, SnapshotsKeepUpWithMetadataChanges) {
+    MobilizeWith(
+        Json::Object({
+            {"secret", Json::Object({
+                {"data", 42},
+                {"meta", Json::Object({
+                    {"require", Json::Object({
+                        {"read_data", Json::Array({"admin"})},
+                    })},
+                })},
+            })},
+        })
+    );
+    for (int i = 0; i < 10; ++i) {
+        const auto reader = ((i % 2) == 0) ? "admin" : "user";
+        ASSERT_TRUE(
+            store.ApplyMutations({
+                MakeRemove({"secret"}),
+                MakeSet(
+                    {"secret"},
+                    Json::Object({
+                        {"data", i},
+                        {"meta", Json::Object({
+                            {"require", Json::Object({
+                                {"read_data", Json::Array({reader})},
+                            })},
+                        })},
+                    })
+                ),
+            })
+        );
+        EXPECT_EQ(Json::Value(i), store.GetData({"secret"}, {reader})) << i;
+        EXPECT_EQ(
+            Json::Value(nullptr),
+            store.GetData({"secret"}, {((i % 2) == 0) ? "user" : "admin"})
+        ) << i;
+    }
+}
+
+TEST_F(StoreTests, ChangesNeedPermission) {
+    MobilizeWith(Json::Object({}));
+    const std::vector< std::string > permissions{
+        "read_data",
+        "write_data",
+        "create_data",
+        "delete_data",
+        "write_meta",
+    };
+    const auto wrapper = Json::Object({
+        {"data", 42},
+        {"meta", Json::Object({
+            {"require", Json::Object({
+                {"read_data", Json::Array({"admin"})},
+            })},
+        })},
+    });
+    const auto nestedWrapper = Json::Object({{"inner", wrapper}});
+    struct TestVector {
+        const char* description;
+        Store::Mutation mutation;
+        std::vector< std::string > permissionsNeeded;
+    };
+    const std::vector< TestVector > testVectors{
+        {"replace value", MakeSet({"box", "value"}, 2), {"write_data"}},
+        {"create value", MakeSet({"box", "new"}, 2), {"create_data"}},
+        {"append value", MakeAdd({"box", "list"}, 2), {"create_data"}},
+        {"remove value", MakeRemove({"box", "value"}), {"delete_data"}},
+        {"replace value with metadata", MakeSet({"box", "value"}, wrapper), {"write_data", "write_meta"}},
+        {"create value with metadata", MakeSet({"box", "new"}, wrapper), {"create_data", "write_meta"}},
+        {"create value with nested metadata", MakeSet({"box", "new"}, nestedWrapper), {"create_data", "write_meta"}},
+        {"append value with metadata", MakeAdd({"box", "list"}, wrapper), {"create_data", "write_meta"}},
+        {"replace value holding metadata", MakeSet({"box", "nested"}, 2), {"write_data", "write_meta"}},
+        {"remove value with metadata", MakeRemove({"box", "wrapped"}), {"delete_data", "write_meta"}},
+        {"remove value holding metadata", MakeRemove({"box", "nested"}), {"delete_data", "write_meta"}},
+    };
+    for (const auto& testVector: testVectors) {
+        std::vector< std::vector< std::string > > permissionsGranted;
+        for (const auto& permission: permissions) {
+            permissionsGranted.push_back({permission});
+        }
+        permissionsGranted.push_back(testVector.permissionsNeeded);
+        for (const auto& granted: permissionsGranted) {
+            auto allow = Json::Object({});
+            for (const auto& permission: granted) {
+                allow[permission] = Json::Array({"user"});
+            }
+            const auto box = Json::Object({
+                {"data", Json::Object({
+                    {"value", 1},
+                    {"list", Json::Array({1})},
+                    {"wrapped", wrapper},
+                    {"nested", nestedWrapper},
+                })},
+                {"meta", Json::Object({
+                    {"allow", allow},
+                })},
+            });
+            ASSERT_TRUE(
+                store.ApplyMutations({
+                    MakeSet({"box"}, nullptr),
+                    MakeRemove({"box"}),
+                    MakeSet({"box"}, box),
+                })
+            );
+            const auto before = store.GetData({"box"}, {});
+            bool permitted = true;
+            for (const auto& permission: testVector.permissionsNeeded) {
+                if (std::find(granted.begin(), granted.end(), permission) == granted.end()) {
+                    permitted = false;
+                }
+            }
+            const auto granting = allow.ToEncoding();
+            EXPECT_EQ(
+                permitted,
+                store.ApplyMutations({testVector.mutation}, {"user"})
+            ) << testVector.description << " with " << granting;
+            if (!permitted) {
+                EXPECT_EQ(before, store.GetData({"box"}, {})) << testVector.description << " with " << granting;
+            }
+        }
+    }
+}
+
+TEST_F(StoreTests, MetadataAddedByClientTakesEffect) {
+    MobilizeWith(
+        Json::Object({
+            {"box", Json::Object({
+                {"data", Json::Object({})},
+                {"meta", Json::Object({
+                    {"allow", Json::Object({
+                        {"read_data", Json::Array({"user"})},
+                        {"create_data", Json::Array({"admin"})},
+                        {"write_meta", Json::Array({"admin"})},
+                    })},
+                })},
+            })},
+        })
+    );
+    const auto secret = Json::Object({
+        {"data", 42},
+        {"meta", Json::Object({
+            {"require", Json::Object({
+                {"read_data", Json::Array({"admin"})},
+            })},
+        })},
+    });
+    ASSERT_TRUE(store.ApplyMutations({MakeSet({"box", "secret"}, secret)}, {"admin"}));
+
+    // Roles permitted to write metadata may also read it.
+    EXPECT_EQ(secret, store.GetData({"box", "secret"}, {"admin"}));
+    EXPECT_EQ(Json::Value(nullptr), store.GetData({"box", "secret"}, {"user"}));
+}
+
+TEST_F(StoreTests, RolesNoLongerNamedLetGoWhenStoreLoaded) {
+    const auto MakeSecret = [](const std::string& role){
+        return Json::Object({
+            {"data", 42},
+            {"meta", Json::Object({
+                {"require", Json::Object({
+                    {"read_data", Json::Array({role})},
+                })},
+            })},
+        });
+    };
+    MobilizeWith(Json::Object({{"secret", MakeSecret("role0")}}));
+    const auto roles = Permissions::maxRoles + 10;
+    for (size_t i = 1; i < roles; ++i) {
+        ASSERT_TRUE(
+            store.ApplyMutations({
+                MakeRemove({"secret"}),
+                MakeSet({"secret"}, MakeSecret("role" + std::to_string(i))),
+            })
+        );
+    }
+    const auto lastRole = "role" + std::to_string(roles - 1);
+    store.Demobilize();
+
+    // Only the last role is named in the store now, so once the store is
+    // loaded again, it's the only one with a place in the role table.
+    ASSERT_TRUE(store.Mobilize(filePath, clock, metrics));
+    EXPECT_EQ(Json::Value(42), store.GetData({"secret"}, {lastRole}));
+    EXPECT_EQ(Json::Value(nullptr), store.GetData({"secret"}, {"role0"}));
+    ASSERT_TRUE(
+        store.ApplyMutations({
+            MakeRemove({"secret"}),
+            MakeSet({"secret"}, MakeSecret("newRole")),
+        })
+    );
+    EXPECT_EQ(Json::Value(42), store.GetData({"secret"}, {"newRole"}));
+    EXPECT_EQ(Json::Value(nullptr), store.GetData({"secret"}, {lastRole}));
+}
+
+TEST_F(StoreTests, ReplicationHidesAccessKeys) {
+    MobilizeWith(
+        Json::Object({
+            {"Roles", Json::Object({
+                {"key:secret", Json::Array({"admin"})},
+                {"twitch:42", Json::Array({"user"})},
+            })},
+        })
+    );
+    std::vector< std::string > replicated;
+    const auto unsubscribe = store.SubscribeToReplication(
+        [&replicated](const Store::Update& update){
+            replicated.push_back(update.view->GetDataEncoding());
+        }
+    );
+    ASSERT_TRUE(
+        store.ApplyMutations({
+            MakeSet({"Roles", "key:hunter2"}, Json::Array({"user"})),
+            MakeAdd({"Roles", "key:secret"}, "user"),
+            MakeSet({"Roles"}, Json::Object({{"key:swordfish", Json::Array({"admin"})}})),
+        })
+    );
+    unsubscribe();
+    ASSERT_EQ(2, replicated.size());
+    for (const auto& encoding: replicated) {
+        EXPECT_EQ(std::string::npos, encoding.find("key:")) << encoding;
+        EXPECT_EQ(std::string::npos, encoding.find("secret")) << encoding;
+        EXPECT_EQ(std::string::npos, encoding.find("hunter2")) << encoding;
+        EXPECT_EQ(std::string::npos, encoding.find("swordfish")) << encoding;
+    }
+    const auto image = Json::Value::FromEncoding(replicated[0]);
+    EXPECT_EQ(
+        Json::Array({"admin"}),
+        image["Roles"][AccessKeys::HideIdentifier("key:secret")]
+    );
+    EXPECT_EQ(Json::Array({"user"}), image["Roles"]["twitch:42"]);
+    const auto record = Json::Value::FromEncoding(replicated[1]);
+    ASSERT_EQ(3, record.GetSize());
+    EXPECT_EQ(
+        Json::Array({"Roles", AccessKeys::HideIdentifier("key:hunter2")}),
+        record[0]["path"]
+    );
+    EXPECT_EQ(
+        Json::Array({"Roles", AccessKeys::HideIdentifier("key:secret")}),
+        record[1]["path"]
+    );
+    EXPECT_EQ(
+        Json::Object({{AccessKeys::HideIdentifier("key:swordfish"), Json::Array({"admin"})}}),
+        record[2]["value"]
+    );
+
+    // Only the store itself keeps the access keys.
+    EXPECT_EQ(
+        Json::Array({"admin"}),
+        store.GetData({"Roles", "key:swordfish"}, {})
+    );
+}
+
+TEST_F(StoreTests, IdentifierRolesListAccessKeysByHashToo) {
+    MobilizeWith(
+        Json::Object({
+            {"Roles", Json::Object({
+                {"key:secret", Json::Array({"admin"})},
+                {"twitch:42", Json::Array({"user"})},
+            })},
+        })
+    );
+    const auto identifierRoles = store.GetIdentifierRoles();
+    EXPECT_EQ(3, identifierRoles->roles.size());
+    EXPECT_EQ(
+        std::vector< std::string >({"admin"}),
+        identifierRoles->roles.at("key:secret")
+    );
+    EXPECT_EQ(
+        std::vector< std::string >({"admin"}),
+        identifierRoles->roles.at(AccessKeys::HideIdentifier("key:secret"))
+    );
+    EXPECT_EQ(
+        std::vector< std::string >({"user"}),
+        identifierRoles->roles.at("twitch:42")
+    );
+}
+
+TEST_F(StoreTests, SettingsFileWinsOverChangesInStore) {
+    MobilizeWith(
+        Json::Object({
+            {"Configuration", Json::Object({{"Port", 8080}})},
+            {"Roles", Json::Object({{"key:secret", Json::Array({"admin"})}})},
+            {"count", 0},
+        })
+    );
+    ASSERT_TRUE(
+        store.ApplyMutations({
+            MakeSet({"Configuration", "Port"}, 8081),
+            MakeSet({"Roles", "key:hunter2"}, Json::Array({"user"})),
+            MakeSet({"count"}, 1),
+        })
+    );
+    WriteFile(
+        settingsFilePath,
+        Json::Object({
+            {"Configuration", Json::Object({{"Port", 8082}})},
+        })
+    );
+    ASSERT_TRUE(store.ReloadSettings(settingsFilePath));
+    EXPECT_EQ(Json::Object({{"Port", 8082}}), store.GetData({"Configuration"}, {}));
+
+    // Parts of the store not in the settings file are left alone.
+    EXPECT_EQ(
+        Json::Object({
+            {"key:secret", Json::Array({"admin"})},
+            {"key:hunter2", Json::Array({"user"})},
+        }),
+        store.GetData({"Roles"}, {})
+    );
+    EXPECT_EQ(Json::Value(1), store.GetData({"count"}, {}));
+
+    // The settings applied are journaled like any other change.
+    store.Demobilize();
+    ASSERT_TRUE(store.Mobilize(filePath, clock, metrics));
+    EXPECT_EQ(Json::Object({{"Port", 8082}}), store.GetData({"Configuration"}, {}));
+    EXPECT_EQ(Json::Value(1), store.GetData({"count"}, {}));
+}
+
+TEST_F(StoreTests, ReloadSettingsWithoutSettingsFile) {
+    MobilizeWith(
+        Json::Object({
+            {"Configuration", Json::Object({{"Port", 8080}})},
+        })
+    );
+    EXPECT_FALSE(store.ReloadSettings(settingsFilePath));
+    EXPECT_FALSE(errors.empty());
+    errors.clear();
+    EXPECT_EQ(Json::Object({{"Port", 8080}}), store.GetData({"Configuration"}, {}));
+}
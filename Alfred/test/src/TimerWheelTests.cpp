@@ -0,0 +1,235 @@
+/**
+ * @file TimerWheelTests.cpp
+ *
+ * This module contains the unit tests of the TimerWheel class.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stddef.h>
+#include <Timekeeping/Clock.hpp>
+#include <Timekeeping/Scheduler.hpp>
+#include <TimerWheel.hpp>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is the number of seconds covered by each slot of the wheel
+     * in these tests.  It's kept small, since the scheduler may wait
+     * this long in real time before it looks at the mock clock again.
+     */
+    constexpr double resolution = 0.01;
+
+    /**
+     * This is how long to wait, in real time, for timeouts
+     * which should expire.
+     */
+    constexpr auto expiryWaitLimit = std::chrono::seconds(1);
+
+    /**
+     * This is how long to wait, in real time, to be reasonably sure
+     * that timeouts which shouldn't expire haven't.
+     */
+    constexpr auto noExpiryWaitTime = std::chrono::milliseconds(50);
+
+    /**
+     * This is a fake time-keeping object which is used to test the
+     * TimerWheel.
+     */
+    struct MockClock
+        : public Timekeeping::Clock
+    {
+        // Properties
+
+        std::mutex mutex;
+        double currentTime = 0.0;
+
+        // Methods
+
+        void SetTime(double time) {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            currentTime = time;
+        }
+
+        // Timekeeping::Clock
+
+        virtual double GetCurrentTime() override {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            return currentTime;
+        }
+    };
+
+}
+
+/**
+ * This is the test fixture for these tests, providing common
+ * setup and teardown for each test.
+ */
+struct TimerWheelTests
+    : public ::testing::Test
+{
+    // Properties
+
+    std::mutex mutex;
+    std::condition_variable expiredCondition;
+    std::vector< int > expired;
+    std::shared_ptr< MockClock > clock = std::make_shared< MockClock >();
+    std::shared_ptr< Timekeeping::Scheduler > scheduler = std::make_shared< Timekeeping::Scheduler >();
+    TimerWheel wheel;
+
+    // Methods
+
+    /**
+     * Return a callback which records that the timeout with the given
+     * identifier expired.
+     *
+     * @param[in] id
+     *     This is the identifier to record.
+     *
+     * @return
+     *     The callback is returned.
+     */
+    TimerWheel::Callback MakeCallback(int id) {
+        return [this, id]{
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            expired.push_back(id);
+            expiredCondition.notify_all();
+        };
+    }
+
+    /**
+     * Wait for the given number of timeouts to have expired.
+     *
+     * @param[in] count
+     *     This is the number of timeouts expected to have expired.
+     *
+     * @return
+     *     An indication of whether or not the number of timeouts
+     *     expired reached the given number in time is returned.
+     */
+    bool AwaitExpired(size_t count) {
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        return expiredCondition.wait_for(
+            lock,
+            expiryWaitLimit,
+            [this, count]{ return expired.size() >= count; }
+        );
+    }
+
+    /**
+     * Give the wheel time to expire timeouts it shouldn't, and return
+     * the identifiers of those which expired so far.
+     *
+     * @return
+     *     The identifiers of the timeouts which expired are returned.
+     */
+    std::vector< int > ExpiredAfterPause() {
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        (void)expiredCondition.wait_for(lock, noExpiryWaitTime);
+        return expired;
+    }
+
+    // ::testing::Test
+
+    virtual void SetUp() override {
+        scheduler->SetClock(clock);
+        wheel.Mobilize(scheduler, resolution);
+    }
+
+    virtual void TearDown() override {
+        wheel.Demobilize();
+    }
+};
+
+TEST_F(TimerWheelTests, ScheduleNeedsMobilizedWheel) {
+    TimerWheel otherWheel;
+    EXPECT_EQ(0, otherWheel.Schedule(MakeCallback(1), 0.0));
+    wheel.Demobilize();
+    EXPECT_EQ(0, wheel.Schedule(MakeCallback(1), 0.0));
+}
+
+TEST_F(TimerWheelTests, TokensNonZeroAndUnique) {
+    std::set< int > tokens;
+    for (int i = 0; i < 100; ++i) {
+        const auto token = wheel.Schedule(MakeCallback(i), 1000.0);
+        EXPECT_NE(0, token);
+        EXPECT_TRUE(tokens.insert(token).second) << token;
+    }
+}
+
+TEST_F(TimerWheelTests, TimeoutExpiresNoEarlierThanDue) {
+    (void)wheel.Schedule(MakeCallback(1), 0.05);
+    (void)wheel.Schedule(MakeCallback(2), 0.1);
+    clock->SetTime(0.04);
+    EXPECT_EQ(std::vector< int >({}), ExpiredAfterPause());
+    clock->SetTime(0.05 + resolution);
+    ASSERT_TRUE(AwaitExpired(1));
+    EXPECT_EQ(std::vector< int >({1}), ExpiredAfterPause());
+    clock->SetTime(0.1 + resolution);
+    ASSERT_TRUE(AwaitExpired(2));
+    EXPECT_EQ(std::vector< int >({1, 2}), expired);
+}
+
+TEST_F(TimerWheelTests, TimeoutAlreadyDueExpiresOnNextTick) {
+    clock->SetTime(10.0);
+    (void)wheel.Schedule(MakeCallback(1), 5.0);
+    clock->SetTime(10.0 + resolution);
+    ASSERT_TRUE(AwaitExpired(1));
+}
+
+TEST_F(TimerWheelTests, TimeoutMoreThanOneTurnAhead) {
+    const double due = 300 * resolution;
+    (void)wheel.Schedule(MakeCallback(1), due);
+    clock->SetTime(257 * resolution);
+    EXPECT_EQ(std::vector< int >({}), ExpiredAfterPause());
+    clock->SetTime(due + resolution);
+    ASSERT_TRUE(AwaitExpired(1));
+}
+
+TEST_F(TimerWheelTests, CanceledTimeoutDoesNotExpire) {
+    const auto token = wheel.Schedule(MakeCallback(1), 0.05);
+    (void)wheel.Schedule(MakeCallback(2), 0.05);
+    wheel.Cancel(token);
+    clock->SetTime(0.05 + resolution);
+    ASSERT_TRUE(AwaitExpired(1));
+    EXPECT_EQ(std::vector< int >({2}), ExpiredAfterPause());
+    wheel.Cancel(token);
+}
+
+TEST_F(TimerWheelTests, CallbackMayScheduleAnotherTimeout) {
+    (void)wheel.Schedule(
+        [this]{
+            (void)wheel.Schedule(MakeCallback(2), 0.1);
+            MakeCallback(1)();
+        },
+        0.05
+    );
+    clock->SetTime(0.05 + resolution);
+    ASSERT_TRUE(AwaitExpired(1));
+    clock->SetTime(0.1 + resolution);
+    ASSERT_TRUE(AwaitExpired(2));
+    EXPECT_EQ(std::vector< int >({1, 2}), expired);
+}
+
+TEST_F(TimerWheelTests, DemobilizeDiscardsPendingTimeouts) {
+    (void)wheel.Schedule(MakeCallback(1), 0.05);
+    wheel.Demobilize();
+    clock->SetTime(1.0);
+    EXPECT_EQ(std::vector< int >({}), ExpiredAfterPause());
+}
+
+TEST_F(TimerWheelTests, WheelIdlesAndStartsAgain) {
+    (void)wheel.Schedule(MakeCallback(1), 0.05);
+    clock->SetTime(0.05 + resolution);
+    ASSERT_TRUE(AwaitExpired(1));
+    clock->SetTime(5.0);
+    (void)wheel.Schedule(MakeCallback(2), 5.05);
+    EXPECT_EQ(std::vector< int >({1}), ExpiredAfterPause());
+    clock->SetTime(5.05 + resolution);
+    ASSERT_TRUE(AwaitExpired(2));
+}
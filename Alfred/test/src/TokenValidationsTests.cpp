@@ -0,0 +1,296 @@
+/**
+ * @file TokenValidationsTests.cpp
+ *
+ * This module contains the unit tests of the TokenValidations class.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <gtest/gtest.h>
+#include <Http/Client.hpp>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <Timekeeping/Clock.hpp>
+#include <Timekeeping/Scheduler.hpp>
+#include <TokenValidations.hpp>
+#include <vector>
+
+namespace {
+
+    /**
+     * This is how long, in real time, to wait for results
+     * delivered asynchronously.
+     */
+    constexpr auto resultWaitLimit = std::chrono::seconds(1);
+
+    /**
+     * This is a fake time-keeping object which is used to test the
+     * TokenValidations class.
+     */
+    struct MockClock
+        : public Timekeeping::Clock
+    {
+        // Properties
+
+        std::mutex mutex;
+        double currentTime = 0.0;
+
+        // Methods
+
+        void SetTime(double time) {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            currentTime = time;
+        }
+
+        // Timekeeping::Clock
+
+        virtual double GetCurrentTime() override {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            return currentTime;
+        }
+    };
+
+    /**
+     * This records a validation request made.
+     */
+    struct Request {
+        std::string target;
+        std::string authorization;
+        TokenValidations::CompletionDelegate completionDelegate;
+    };
+
+    /**
+     * This records the result of a validation delivered.
+     */
+    struct Result {
+        int id = 0;
+        bool valid = false;
+        intmax_t twitchId = 0;
+    };
+
+}
+
+/**
+ * This is the test fixture for these tests, providing common
+ * setup and teardown for each test.
+ */
+struct TokenValidationsTests
+    : public ::testing::Test
+{
+    // Properties
+
+    std::mutex mutex;
+    std::condition_variable resultsCondition;
+    std::vector< Result > results;
+    std::vector< Request > requests;
+    double cacheTime = 60.0;
+    std::shared_ptr< MockClock > clock = std::make_shared< MockClock >();
+    std::shared_ptr< Timekeeping::Scheduler > scheduler = std::make_shared< Timekeeping::Scheduler >();
+    TokenValidations tokenValidations;
+
+    // Methods
+
+    /**
+     * Validate the given token, recording the result under the
+     * given identifier.
+     *
+     * @param[in] token
+     *     This is the token to validate.
+     *
+     * @param[in] id
+     *     This is the identifier under which to record the result.
+     */
+    void Validate(
+        const std::string& token,
+        int id
+    ) {
+        tokenValidations.Validate(
+            token,
+            [this, id](bool valid, intmax_t twitchId){
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                Result result;
+                result.id = id;
+                result.valid = valid;
+                result.twitchId = twitchId;
+                results.push_back(result);
+                resultsCondition.notify_all();
+            }
+        );
+    }
+
+    /**
+     * Complete the validation request with the given index.
+     *
+     * @param[in] index
+     *     This is the index of the request to complete.
+     *
+     * @param[in] statusCode
+     *     This is the status code of the response to give.
+     *
+     * @param[in] body
+     *     This is the body of the response to give.
+     */
+    void Respond(
+        size_t index,
+        unsigned int statusCode,
+        const std::string& body
+    ) {
+        Http::Response response;
+        response.statusCode = statusCode;
+        response.body = body;
+        requests[index].completionDelegate(response);
+    }
+
+    /**
+     * Wait for the given number of results to have been delivered.
+     *
+     * @param[in] count
+     *     This is the number of results expected.
+     *
+     * @return
+     *     An indication of whether or not the number of results
+     *     reached the given number in time is returned.
+     */
+    bool AwaitResults(size_t count) {
+        std::unique_lock< decltype(mutex) > lock(mutex);
+        return resultsCondition.wait_for(
+            lock,
+            resultWaitLimit,
+            [this, count]{ return results.size() >= count; }
+        );
+    }
+
+    // ::testing::Test
+
+    virtual void SetUp() override {
+        scheduler->SetClock(clock);
+        tokenValidations.Mobilize(
+            [this](
+                Http::Request& request,
+                TokenValidations::CompletionDelegate completionDelegate
+            ){
+                Request record;
+                record.target = request.target.GenerateString();
+                record.authorization = request.headers.GetHeaderValue("Authorization");
+                record.completionDelegate = completionDelegate;
+                requests.push_back(std::move(record));
+            },
+            scheduler,
+            [this]{ return cacheTime; }
+        );
+    }
+
+    virtual void TearDown() override {
+        tokenValidations.Demobilize();
+    }
+};
+
+TEST_F(TokenValidationsTests, ValidToken) {
+    Validate("abc", 1);
+    ASSERT_EQ(1, requests.size());
+    EXPECT_EQ("https://id.twitch.tv/oauth2/validate", requests[0].target);
+    EXPECT_EQ("OAuth abc", requests[0].authorization);
+    EXPECT_TRUE(results.empty());
+    Respond(0, 200, "{\"user_id\": \"42\", \"expires_in\": 3600}");
+    ASSERT_EQ(1, results.size());
+    EXPECT_TRUE(results[0].valid);
+    EXPECT_EQ(42, results[0].twitchId);
+}
+
+TEST_F(TokenValidationsTests, InvalidToken) {
+    Validate("abc", 1);
+    Respond(0, 401, "{\"status\": 401, \"message\": \"invalid access token\"}");
+    ASSERT_EQ(1, results.size());
+    EXPECT_FALSE(results[0].valid);
+
+    // Tokens found invalid aren't remembered.
+    Validate("abc", 2);
+    EXPECT_EQ(2, requests.size());
+}
+
+TEST_F(TokenValidationsTests, ResponseWithoutUserIdMeansInvalid) {
+    Validate("abc", 1);
+    Respond(0, 200, "{\"login\": \"someone\"}");
+    ASSERT_EQ(1, results.size());
+    EXPECT_FALSE(results[0].valid);
+}
+
+TEST_F(TokenValidationsTests, ValidationsOfSameTokenShareRequest) {
+    Validate("abc", 1);
+    Validate("abc", 2);
+    Validate("xyz", 3);
+    ASSERT_EQ(2, requests.size());
+    EXPECT_EQ("OAuth xyz", requests[1].authorization);
+    Respond(0, 200, "{\"user_id\": \"42\"}");
+    ASSERT_EQ(2, results.size());
+    EXPECT_EQ(1, results[0].id);
+    EXPECT_EQ(2, results[1].id);
+    for (const auto& result: results) {
+        EXPECT_TRUE(result.valid);
+        EXPECT_EQ(42, result.twitchId);
+    }
+}
+
+TEST_F(TokenValidationsTests, ValidTokenRememberedUntilCacheTimeElapses) {
+    Validate("abc", 1);
+    Respond(0, 200, "{\"user_id\": \"42\", \"expires_in\": 3600}");
+    clock->SetTime(59.0);
+    Validate("abc", 2);
+    EXPECT_EQ(1, requests.size());
+    ASSERT_TRUE(AwaitResults(2));
+    EXPECT_EQ(2, results[1].id);
+    EXPECT_TRUE(results[1].valid);
+    EXPECT_EQ(42, results[1].twitchId);
+    clock->SetTime(60.0);
+    Validate("abc", 3);
+    EXPECT_EQ(2, requests.size());
+}
+
+TEST_F(TokenValidationsTests, ValidTokenNotRememberedLongerThanItLasts) {
+    Validate("abc", 1);
+    Respond(0, 200, "{\"user_id\": \"42\", \"expires_in\": 10}");
+    clock->SetTime(9.0);
+    Validate("abc", 2);
+    EXPECT_EQ(1, requests.size());
+    clock->SetTime(10.0);
+    Validate("abc", 3);
+    EXPECT_EQ(2, requests.size());
+}
+
+TEST_F(TokenValidationsTests, ZeroCacheTimeMeansNotRemembered) {
+    cacheTime = 0.0;
+    Validate("abc", 1);
+    Respond(0, 200, "{\"user_id\": \"42\"}");
+    ASSERT_EQ(1, results.size());
+    EXPECT_TRUE(results[0].valid);
+    Validate("abc", 2);
+    EXPECT_EQ(2, requests.size());
+}
+
+TEST_F(TokenValidationsTests, StalledValidationTriedAgainAfterTimeout) {
+    Validate("abc", 1);
+    clock->SetTime(29.0);
+    Validate("abc", 2);
+    EXPECT_EQ(1, requests.size());
+    clock->SetTime(30.0);
+    Validate("abc", 3);
+    ASSERT_EQ(2, requests.size());
+
+    // Whichever request completes first answers everyone waiting.
+    Respond(1, 200, "{\"user_id\": \"42\"}");
+    ASSERT_EQ(3, results.size());
+    Respond(0, 200, "{\"user_id\": \"42\"}");
+    EXPECT_EQ(3, results.size());
+}
+
+TEST_F(TokenValidationsTests, NothingAfterDemobilize) {
+    Validate("abc", 1);
+    tokenValidations.Demobilize();
+    Respond(0, 200, "{\"user_id\": \"42\"}");
+    Validate("abc", 2);
+    EXPECT_EQ(1, requests.size());
+    EXPECT_TRUE(results.empty());
+}
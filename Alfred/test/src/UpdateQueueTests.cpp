@@ -0,0 +1,147 @@
+/**
+ * @file UpdateQueueTests.cpp
+ *
+ * This module contains the unit tests of the UpdateQueue class.
+ */
+
+#include <gtest/gtest.h>
+#include <Store.hpp>
+#include <UpdateQueue.hpp>
+
+namespace {
+
+    /**
+     * Make an update which holds either the whole of the subscribed data
+     * or a patch to it.
+     *
+     * @param[in] patch
+     *     This indicates whether the update holds a patch.
+     *
+     * @return
+     *     The update made is returned.
+     */
+    Store::Update MakeUpdate(bool patch) {
+        Store::Update update;
+        update.patch = patch;
+        return update;
+    }
+
+}
+
+TEST(UpdateQueueTests, NothingDueWhenEmpty) {
+    UpdateQueue queue;
+    queue.Open("foo", 1, 0.0);
+    double flushTime;
+    EXPECT_FALSE(queue.GetNextFlushTime(flushTime));
+    EXPECT_TRUE(queue.TakeDue(0.0).empty());
+}
+
+TEST(UpdateQueueTests, UpdatesDueRightAwayWithoutRateLimit) {
+    UpdateQueue queue;
+    queue.Open("foo", 1, 0.0);
+    queue.Open("bar", 2, 0.0);
+    EXPECT_FALSE(queue.Queue("foo", 1, MakeUpdate(false), 0, 60.0, 10.0));
+    EXPECT_FALSE(queue.Queue("foo", 1, MakeUpdate(true), 0, 60.0, 10.0));
+    EXPECT_FALSE(queue.Queue("bar", 2, MakeUpdate(false), 0, 60.0, 10.0));
+    double flushTime;
+    ASSERT_TRUE(queue.GetNextFlushTime(flushTime));
+    EXPECT_EQ(0.0, flushTime);
+    auto due = queue.TakeDue(10.0);
+    ASSERT_EQ(2, due.size());
+    if (due[0].subscriptionId != "foo") {
+        std::swap(due[0], due[1]);
+    }
+    EXPECT_EQ("foo", due[0].subscriptionId);
+    EXPECT_EQ(1, due[0].subscriptionNumber);
+    EXPECT_EQ(2, due[0].updates.size());
+    EXPECT_FALSE(due[0].overflowed);
+    EXPECT_EQ("bar", due[1].subscriptionId);
+    EXPECT_EQ(2, due[1].subscriptionNumber);
+    EXPECT_EQ(1, due[1].updates.size());
+    EXPECT_FALSE(queue.GetNextFlushTime(flushTime));
+    EXPECT_TRUE(queue.TakeDue(10.0).empty());
+}
+
+TEST(UpdateQueueTests, RateLimitDelaysNextUpdates) {
+    UpdateQueue queue;
+    queue.Open("foo", 1, 0.5);
+    (void)queue.Queue("foo", 1, MakeUpdate(false), 0, 60.0, 10.0);
+    EXPECT_EQ(1, queue.TakeDue(10.0).size());
+    (void)queue.Queue("foo", 1, MakeUpdate(true), 0, 60.0, 10.1);
+    (void)queue.Queue("foo", 1, MakeUpdate(true), 0, 60.0, 10.2);
+    double flushTime;
+    ASSERT_TRUE(queue.GetNextFlushTime(flushTime));
+    EXPECT_EQ(10.5, flushTime);
+    EXPECT_TRUE(queue.TakeDue(10.4).empty());
+    const auto due = queue.TakeDue(10.5);
+    ASSERT_EQ(1, due.size());
+    EXPECT_EQ(2, due[0].updates.size());
+    EXPECT_EQ(0.5, due[0].minInterval);
+}
+
+TEST(UpdateQueueTests, SnapshotReplacesWaitingUpdates) {
+    UpdateQueue queue;
+    queue.Open("foo", 1, 0.0);
+    (void)queue.Queue("foo", 1, MakeUpdate(true), 0, 60.0, 10.0);
+    (void)queue.Queue("foo", 1, MakeUpdate(true), 0, 60.0, 10.0);
+    (void)queue.Queue("foo", 1, MakeUpdate(false), 0, 60.0, 10.0);
+    const auto due = queue.TakeDue(10.0);
+    ASSERT_EQ(1, due.size());
+    ASSERT_EQ(1, due[0].updates.size());
+    EXPECT_FALSE(due[0].updates[0].patch);
+}
+
+TEST(UpdateQueueTests, UpdatesForClosedOrReplacedSubscriptionsDropped) {
+    UpdateQueue queue;
+    EXPECT_FALSE(queue.Queue("foo", 1, MakeUpdate(false), 0, 60.0, 10.0));
+    queue.Open("foo", 1, 0.0);
+    (void)queue.Queue("foo", 1, MakeUpdate(false), 0, 60.0, 10.0);
+    queue.Open("foo", 2, 0.0);
+    (void)queue.Queue("foo", 1, MakeUpdate(true), 0, 60.0, 10.0);
+    double flushTime;
+    EXPECT_FALSE(queue.GetNextFlushTime(flushTime));
+    (void)queue.Queue("foo", 2, MakeUpdate(false), 0, 60.0, 10.0);
+    queue.Close("foo");
+    EXPECT_FALSE(queue.GetNextFlushTime(flushTime));
+    EXPECT_TRUE(queue.TakeDue(10.0).empty());
+    (void)queue.Queue("foo", 2, MakeUpdate(false), 0, 60.0, 10.0);
+    EXPECT_TRUE(queue.TakeDue(10.0).empty());
+}
+
+TEST(UpdateQueueTests, OverflowThrowsAwayUpdatesUntilSnapshot) {
+    UpdateQueue queue;
+    queue.Open("foo", 1, 0.0);
+    EXPECT_FALSE(queue.Queue("foo", 1, MakeUpdate(false), 2, 60.0, 10.0));
+    EXPECT_FALSE(queue.Queue("foo", 1, MakeUpdate(true), 2, 60.0, 10.0));
+    EXPECT_TRUE(queue.Queue("foo", 1, MakeUpdate(true), 2, 60.0, 10.0));
+    EXPECT_EQ(1, queue.GetOverflows());
+    EXPECT_FALSE(queue.Queue("foo", 1, MakeUpdate(true), 2, 60.0, 10.0));
+    double flushTime;
+    ASSERT_TRUE(queue.GetNextFlushTime(flushTime));
+    auto due = queue.TakeDue(10.0);
+    ASSERT_EQ(1, due.size());
+    EXPECT_TRUE(due[0].overflowed);
+    EXPECT_TRUE(due[0].updates.empty());
+    (void)queue.Queue("foo", 1, MakeUpdate(true), 2, 60.0, 10.0);
+    due = queue.TakeDue(10.0);
+    ASSERT_EQ(1, due.size());
+    EXPECT_FALSE(due[0].overflowed);
+    EXPECT_EQ(1, due[0].updates.size());
+}
+
+TEST(UpdateQueueTests, OverflowCountStartsAgainAfterWindow) {
+    UpdateQueue queue;
+    queue.Open("foo", 1, 0.0);
+    const auto overflow = [&queue](double now){
+        (void)queue.Queue("foo", 1, MakeUpdate(false), 1, 60.0, now);
+        return queue.Queue("foo", 1, MakeUpdate(true), 1, 60.0, now);
+    };
+    EXPECT_TRUE(overflow(100.0));
+    EXPECT_TRUE(overflow(130.0));
+    EXPECT_TRUE(overflow(159.0));
+    EXPECT_EQ(3, queue.GetOverflows());
+    EXPECT_TRUE(overflow(160.0));
+    EXPECT_EQ(1, queue.GetOverflows());
+    EXPECT_TRUE(overflow(219.0));
+    EXPECT_EQ(2, queue.GetOverflows());
+}